@@ -0,0 +1,174 @@
+/* *************************************************************************************************
+
+	TestCode_qbAMG
+
+	  Code to test the algebraic multigrid code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <functional>
+#include <chrono>
+
+#include "../qbSparse.h"
+#include "../qbCG.h"
+#include "../qbAMG.h"
+
+using namespace std;
+
+typedef std::function<void(const std::vector<double>&, std::vector<double>&)> Operator;
+
+// Function to build the 5-point Laplacian on an n x n grid, with coefficient k(x, y).
+qbSparseMatrix<double> Poisson2D(int n, std::function<double(int, int)> k)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=0; j<n; ++j)
+		{
+			int row = i*n + j;
+			double kij = k(i, j);
+			rows.push_back(row); cols.push_back(row); values.push_back(4.0 * kij);
+			if (i > 0)		{ rows.push_back(row); cols.push_back(row - n); values.push_back(-kij); }
+			if (i < n-1)	{ rows.push_back(row); cols.push_back(row + n); values.push_back(-kij); }
+			if (j > 0)		{ rows.push_back(row); cols.push_back(row - 1); values.push_back(-kij); }
+			if (j < n-1)	{ rows.push_back(row); cols.push_back(row + 1); values.push_back(-kij); }
+		}
+	}
+	// Symmetrize, A = (A + A')/2, so that the variable coefficient case is SPD.
+	qbSparseMatrix<double> A(n*n, n*n, rows, cols, values);
+	qbSparseMatrix<double> At = A.Transpose();
+	for (size_t k=0; k<values.size(); ++k)
+		values[k] *= 0.5;
+	for (int i=0; i<n*n; ++i)
+	{
+		for (int k=At.GetRowPtr()[i]; k<At.GetRowPtr()[i+1]; ++k)
+		{
+			rows.push_back(i); cols.push_back(At.GetColIndex()[k]); values.push_back(0.5 * At.GetValues()[k]);
+		}
+	}
+	return qbSparseMatrix<double>(n*n, n*n, rows, cols, values);
+}
+
+// Function to compute ||b - A*x|| / ||b||.
+double RelativeResidual(const qbSparseMatrix<double> &A, const std::vector<double> &b, const std::vector<double> &x)
+{
+	std::vector<double> Ax;
+	A.Multiply(x, Ax);
+	double rNorm = 0.0, bNorm = 0.0;
+	for (size_t i=0; i<b.size(); ++i)
+	{
+		rNorm += (b[i] - Ax[i]) * (b[i] - Ax[i]);
+		bNorm += b[i] * b[i];
+	}
+	return sqrt(rNorm / bNorm);
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing algebraic multigrid code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	int n = 300;
+	qbSparseMatrix<double> A = Poisson2D(n, [](int, int) { return 1.0; });
+	std::vector<double> b(n*n, 1.0);
+	Operator matVec = [&](const std::vector<double> &in, std::vector<double> &out) { A.Multiply(in, out); };
+
+	qbAMG<double> amg;
+	{
+		cout << "Testing setup for the 2D Poisson problem on a 300x300 grid (90000 unknowns):" << endl;
+		auto t0 = std::chrono::steady_clock::now();
+		amg.Setup(A);
+		auto t1 = std::chrono::steady_clock::now();
+		cout << "Setup time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << "Number of levels = " << amg.GetNumLevels() << ", sizes:";
+		for (int l=0; l<amg.GetNumLevels(); ++l)
+			cout << " " << amg.GetLevelSize(l);
+		cout << endl;
+		cout << "Operator complexity = " << std::setprecision(3) << amg.GetOperatorComplexity() << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing CG with and without the multigrid preconditioner (tolerance 1e-8):" << endl;
+		std::vector<double> x1, x2;
+		int numCycles = 0;
+		Operator precondition = [&](const std::vector<double> &in, std::vector<double> &out) { amg.Precondition(in, out); numCycles++; };
+
+		auto t0 = std::chrono::steady_clock::now();
+		int status1 = qbCG<double>(matVec, n*n, b, x1, 1e-8, 5000);
+		auto t1 = std::chrono::steady_clock::now();
+		int status2 = qbCG<double>(matVec, precondition, n*n, b, x2, 1e-8, 5000);
+		auto t2 = std::chrono::steady_clock::now();
+		cout << "CG:     status = " << status1 << ", relative residual = " << std::scientific << RelativeResidual(A, b, x1)
+			<< std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << "AMG-CG: status = " << status2 << ", iterations = " << numCycles << ", relative residual = " << std::scientific
+			<< RelativeResidual(A, b, x2) << std::fixed << ", time = " << std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing multigrid as a standalone solver (tolerance 1e-8, at most 100 cycles):" << endl;
+		std::vector<int> cycleTypes = {QBAMG_VCYCLE, QBAMG_WCYCLE, QBAMG_VCYCLE};
+		std::vector<int> smoothers = {QBAMG_CHEBYSHEV, QBAMG_CHEBYSHEV, QBAMG_JACOBI};
+		std::vector<std::string> names = {"V-cycle, Chebyshev", "W-cycle, Chebyshev", "V-cycle, Jacobi   "};
+		for (int t=0; t<3; ++t)
+		{
+			amg.SetCycleType(cycleTypes[t]);
+			amg.SetSmoother(smoothers[t]);
+			std::vector<double> x;
+			int status = amg.Solve(b, x, 1e-8, 100);
+			cout << names[t] << ": status = " << status << ", relative residual = " << std::scientific << RelativeResidual(A, b, x) << std::fixed << endl;
+		}
+		amg.SetCycleType(QBAMG_VCYCLE);
+		amg.SetSmoother(QBAMG_CHEBYSHEV);
+		cout << endl;
+	}
+
+	{
+		cout << "Testing setup reuse when only the values change (coefficient varying from 1 to 1000):" << endl;
+		qbSparseMatrix<double> B = Poisson2D(n, [n](int i, int j) { return pow(10.0, 3.0 * (i + j) / (2.0 * n)); });
+		cout << "Same pattern as A: " << (A.SamePattern(B) ? "True." : "False.") << endl;
+
+		qbAMG<double> fresh;
+		auto t0 = std::chrono::steady_clock::now();
+		fresh.Setup(B);
+		auto t1 = std::chrono::steady_clock::now();
+		amg.UpdateValues(B);
+		auto t2 = std::chrono::steady_clock::now();
+		cout << "Setup = " << std::chrono::duration<double>(t1 - t0).count() << " s, UpdateValues = "
+			<< std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+
+		Operator matVecB = [&](const std::vector<double> &in, std::vector<double> &out) { B.Multiply(in, out); };
+		int numCycles = 0;
+		Operator precondition = [&](const std::vector<double> &in, std::vector<double> &out) { amg.Precondition(in, out); numCycles++; };
+		std::vector<double> x;
+		int status = qbCG<double>(matVecB, precondition, n*n, b, x, 1e-8, 5000);
+		cout << "AMG-CG with the updated hierarchy: status = " << status << ", iterations = " << numCycles
+			<< ", relative residual = " << std::scientific << RelativeResidual(B, b, x) << std::fixed << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/* *************************************************************************************************
+
+	TestCode_qbCG
+
+	  Code to test the preconditioned conjugate gradient code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbLinSolve.h"
+#include "../qbSparse.h"
+#include "../qbCG.h"
+
+using namespace std;
+
+typedef std::function<void(const std::vector<double>&, std::vector<double>&)> Operator;
+
+// Function to build the 1D Laplacian with a variable coefficient, tridiag(-k(i), k(i) + k(i+1), -k(i+1)),
+// with k varying over six orders of magnitude.
+qbSparseMatrix<double> Laplacian1D(int n)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		double kLeft = pow(10.0, 6.0 * i / n);
+		double kRight = pow(10.0, 6.0 * (i + 1) / n);
+		rows.push_back(i); cols.push_back(i); values.push_back(kLeft + kRight);
+		if (i > 0)
+		{
+			rows.push_back(i); cols.push_back(i-1); values.push_back(-kLeft);
+		}
+		if (i < n-1)
+		{
+			rows.push_back(i); cols.push_back(i+1); values.push_back(-kRight);
+		}
+	}
+	return qbSparseMatrix<double>(n, n, rows, cols, values);
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing conjugate gradient code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	{
+		cout << "Testing against qbLinSolve with a 4x4 SPD matrix:" << endl;
+		std::vector<double> data = {4.0, 1.0, 0.0, 0.0, 1.0, 4.0, 1.0, 0.0, 0.0, 1.0, 4.0, 1.0, 0.0, 0.0, 1.0, 4.0};
+		qbMatrix2<double> denseA(4, 4, data);
+		qbSparseMatrix<double> A(denseA);
+		std::vector<double> b = {1.0, 2.0, 3.0, 4.0};
+		qbVector<double> reference(4);
+		qbLinSolve(denseA, qbVector<double>(b), reference);
+		Operator matVec = [&](const std::vector<double> &in, std::vector<double> &out) { A.Multiply(in, out); };
+		std::vector<double> x;
+		int status = qbCG<double>(matVec, 4, b, x);
+		cout << "Status = " << status << endl;
+		cout << "x = " << x[0] << " " << x[1] << " " << x[2] << " " << x[3] << endl;
+		cout << "Reference = " << reference.GetElement(0) << " " << reference.GetElement(1) << " " << reference.GetElement(2) << " " << reference.GetElement(3) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing Jacobi preconditioning on a 1D problem with a widely varying coefficient (n = 2000):" << endl;
+		int n = 2000;
+		qbSparseMatrix<double> A = Laplacian1D(n);
+		std::vector<double> b(n, 1.0);
+		std::vector<double> invDiagonal = A.Diagonal();
+		for (auto &value : invDiagonal)
+			value = 1.0 / value;
+
+		int numProducts = 0;
+		Operator matVec = [&](const std::vector<double> &in, std::vector<double> &out) { A.Multiply(in, out); numProducts++; };
+		Operator jacobi = [&](const std::vector<double> &in, std::vector<double> &out)
+		{
+			out.resize(in.size());
+			for (size_t i=0; i<in.size(); ++i)
+				out[i] = invDiagonal[i] * in[i];
+		};
+
+		std::vector<double> x1, x2;
+		int status1 = qbCG<double>(matVec, n, b, x1, 1e-8, 10000);
+		int iterations1 = numProducts;
+		numProducts = 0;
+		int status2 = qbCG<double>(matVec, jacobi, n, b, x2, 1e-8, 10000);
+		int iterations2 = numProducts;
+		cout << "No preconditioner:     status = " << status1 << ", matrix-vector products = " << iterations1 << endl;
+		cout << "Jacobi preconditioner: status = " << status2 << ", matrix-vector products = " << iterations2 << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing with an indefinite matrix:" << endl;
+		std::vector<double> data = {1.0, 0.0, 0.0, -1.0};
+		qbSparseMatrix<double> A(qbMatrix2<double>(2, 2, data));
+		Operator matVec = [&](const std::vector<double> &in, std::vector<double> &out) { A.Multiply(in, out); };
+		std::vector<double> b = {1.0, 1.0};
+		std::vector<double> x;
+		cout << "Status = " << qbCG<double>(matVec, 2, b, x) << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,320 @@
+/* *************************************************************************************************
+
+	TestCode_qbDecompCache
+
+	  Code to test the cache of matrix factorizations, and the qbLinSolve, qbLSQ and qbPCA
+	  functions that use it.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+#include <thread>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbDecompCache.h"
+#include "../qbLinSolve.h"
+#include "../qbLSQ.h"
+#include "../qbPCA.h"
+
+using namespace std;
+
+// Function to compute max|A*x - b|.
+double Residual(const qbMatrix2<double> &A, const qbVector<double> &x, const qbVector<double> &b)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		double sum = 0.0;
+		for (int j=0; j<A.GetNumCols(); ++j)
+			sum += A.GetElement(i, j) * x.GetElement(j);
+		maxDiff = std::max(maxDiff, fabs(sum - b.GetElement(i)));
+	}
+	return maxDiff;
+}
+
+// Function to compute max|a - b|.
+double MaxAbsDiff(const qbVector<double> &a, const qbVector<double> &b)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<a.GetNumDims(); ++i)
+		maxDiff = std::max(maxDiff, fabs(a.GetElement(i) - b.GetElement(i)));
+	return maxDiff;
+}
+
+double MaxAbsDiff(const qbMatrix2<double> &A, const qbMatrix2<double> &B)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(A.GetElement(i, j) - B.GetElement(i, j)));
+	}
+	return maxDiff;
+}
+
+void PrintStatistics(const qbDecompCache<double> &cache)
+{
+	qbDecompCache<double>::Statistics stats = cache.GetStatistics();
+	cout << "Statistics: hits = " << stats.hits << ", misses = " << stats.misses << ", evictions = " << stats.evictions
+		<< ", entries = " << stats.numEntries << ", storage = " << stats.storageSize << " bytes" << endl;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing the cache of matrix factorizations." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing the hash:" << endl;
+		qbMatrix2<double> A(40, 30);
+		generator.FillUniform(A, -1.0, 1.0);
+		qbMatrix2<double> B = A;
+		B.SetElement(0, 0, B.GetElement(0, 0));
+		qbMatrix2<double> C = A;
+		C.SetElement(39, 29, C.GetElement(39, 29) + 1e-15);
+		qbMatrix2<double> D(30, 40, A.GetData());
+		uint64_t hashA = qbDecompCacheKernels::HashMatrix(A);
+		cout << "Equal matrices have equal hashes: " << (hashA == qbDecompCacheKernels::HashMatrix(B) ? "True" : "False") << endl;
+		cout << "Changed last element changes the hash: " << (hashA != qbDecompCacheKernels::HashMatrix(C) ? "True" : "False") << endl;
+		cout << "Changed shape changes the hash: " << (hashA != qbDecompCacheKernels::HashMatrix(D) ? "True" : "False") << endl;
+
+		// Every length from 0 to 40 bytes (all of the tails) gives a different hash.
+		std::vector<unsigned char> bytes(40, 7);
+		std::vector<uint64_t> hashes;
+		for (size_t n=0; n<=bytes.size(); ++n)
+			hashes.push_back(qbDecompCacheKernels::Hash(bytes.data(), n, 0));
+		std::sort(hashes.begin(), hashes.end());
+		cout << "Hashes of each length are distinct: " << (std::unique(hashes.begin(), hashes.end()) == hashes.end() ? "True" : "False") << endl;
+
+		qbMatrix2<double> E(2000, 2000);
+		generator.FillUniform(E, -1.0, 1.0);
+		auto t0 = std::chrono::steady_clock::now();
+		uint64_t hashE = qbDecompCacheKernels::HashMatrix(E);
+		auto t1 = std::chrono::steady_clock::now();
+		double seconds = std::chrono::duration<double>(t1 - t0).count();
+
+		// For comparison, a plain sum reads the same data with almost no work per element.
+		const double* e = E.GetData();
+		double sum = 0.0;
+		auto t2 = std::chrono::steady_clock::now();
+		for (size_t i=0; i<(size_t)2000*2000; ++i)
+			sum += e[i];
+		auto t3 = std::chrono::steady_clock::now();
+		double sumSeconds = std::chrono::duration<double>(t3 - t2).count();
+		cout << "Hash of 2000x2000 matrix = " << std::hex << hashE << std::dec << ", time = " << seconds
+			<< " s (" << 2000.0 * 2000.0 * sizeof(double) / seconds / 1e9 << " GB/s), plain sum = "
+			<< 2000.0 * 2000.0 * sizeof(double) / sumSeconds / 1e9 << " GB/s (sum = " << sum << ")" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing repeated solves with LU (500x500):" << endl;
+		int n = 500;
+		qbMatrix2<double> A(n, n);
+		generator.FillUniform(A, -1.0, 1.0);
+		qbDecompCache<double> cache;
+		double maxResidual = 0.0;
+		double firstTime = 0.0, repeatTime = 0.0;
+		for (int r=0; r<5; ++r)
+		{
+			qbVector<double> b(n), x;
+			generator.FillUniform(b, -1.0, 1.0);
+			auto t0 = std::chrono::steady_clock::now();
+			int status = qbLinSolve(A, b, x, cache);
+			auto t1 = std::chrono::steady_clock::now();
+			double seconds = std::chrono::duration<double>(t1 - t0).count();
+			if (r == 0)
+				firstTime = seconds;
+			else
+				repeatTime = std::max(repeatTime, seconds);
+			if (status != 1)
+				cout << "Solve " << r << " failed with status " << status << endl;
+			maxResidual = std::max(maxResidual, Residual(A, x, b));
+		}
+		qbVector<double> b(n), x, xCached;
+		generator.FillUniform(b, -1.0, 1.0);
+		auto t0 = std::chrono::steady_clock::now();
+		qbLinSolve(A, b, x);
+		auto t1 = std::chrono::steady_clock::now();
+		qbLinSolve(A, b, xCached, cache);
+		cout << std::scientific << "Max residual = " << maxResidual << ", max |x - x(uncached)| = " << MaxAbsDiff(x, xCached) << std::fixed << endl;
+		cout << "Time: uncached = " << std::chrono::duration<double>(t1 - t0).count() << " s, first = " << firstTime
+			<< " s, repeated = " << repeatTime << " s" << endl;
+		PrintStatistics(cache);
+
+		// A singular matrix is cached as singular, and the solve falls back to classify the system.
+		qbMatrix2<double> S(3, 3, std::vector<double>{1.0, 2.0, 3.0, 2.0, 4.0, 6.0, 1.0, 0.0, 1.0});
+		qbVector<double> bs(std::vector<double>{1.0, 2.0, 3.0}), xs;
+		cout << "Singular (consistent) system: status = " << qbLinSolve(S, bs, xs, cache)
+			<< ", cached as singular = " << (cache.GetLU(S)->IsSingular() ? "True" : "False") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing repeated solves with Cholesky (500x500):" << endl;
+		int n = 500;
+		qbMatrix2<double> X(n, n), A;
+		generator.FillUniform(X, -1.0, 1.0);
+		qbGEMM(X.Transpose(), X, A);
+		for (int i=0; i<n; ++i)
+			A.SetElement(i, i, A.GetElement(i, i) + 1.0);
+		cout << "IsPositiveDefinite = " << (A.IsPositiveDefinite() ? "True" : "False") << endl;
+		qbDecompCache<double> cache;
+		double maxResidual = 0.0;
+		for (int r=0; r<3; ++r)
+		{
+			qbVector<double> b(n), x;
+			generator.FillUniform(b, -1.0, 1.0);
+			qbLinSolve(A, b, x, cache);
+			maxResidual = std::max(maxResidual, Residual(A, x, b));
+		}
+		cout << std::scientific << "Max residual = " << maxResidual << std::fixed << endl;
+		PrintStatistics(cache);
+
+		qbMatrix2<double> N(2, 2, std::vector<double>{1.0, 2.0, 2.0, 1.0});
+		cout << "Indefinite matrix: positive definite = " << (cache.GetCholesky(N)->IsPositiveDefinite() ? "True" : "False") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing repeated least squares fits (5000x40):" << endl;
+		int m = 5000, n = 40;
+		qbMatrix2<double> X(m, n);
+		generator.FillUniform(X, -1.0, 1.0);
+		qbDecompCache<double> cache;
+		double maxDiff = 0.0;
+		for (int r=0; r<3; ++r)
+		{
+			qbVector<double> y(m), beta, betaCached;
+			generator.FillUniform(y, -1.0, 1.0);
+			qbLSQ(X, y, beta);
+			qbLSQ(X, y, betaCached, cache);
+			maxDiff = std::max(maxDiff, MaxAbsDiff(beta, betaCached));
+		}
+		cout << std::scientific << "Max |beta - beta(uncached)| = " << maxDiff << std::fixed << endl;
+		PrintStatistics(cache);
+		qbMatrix2<double> W(3, 5);
+		cout << "Wide matrix: QR cached = " << (cache.GetQR(W) ? "True" : "False") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing repeated PCA (1000x50):" << endl;
+		qbMatrix2<double> data(1000, 50), components, componentsCached;
+		generator.FillUniform(data, -1.0, 1.0);
+		qbDecompCache<double> cache;
+		qbPCA::qbPCA(data, components);
+		qbPCA::qbPCA(data, componentsCached, cache);
+		int status = qbPCA::qbPCA(data, componentsCached, cache);
+		cout << "Status = " << status << std::scientific << ", max |components - components(uncached)| = "
+			<< MaxAbsDiff(components, componentsCached) << std::fixed << endl;
+		PrintStatistics(cache);
+		cout << endl;
+	}
+
+	{
+		cout << "Testing the memory budget and modified matrices:" << endl;
+		int n = 100;
+		size_t entrySize = 2 * (size_t)n * n * sizeof(double) + n * sizeof(int);
+		qbDecompCache<double> cache(3 * entrySize);
+		std::vector<qbMatrix2<double>> matrices;
+		for (int k=0; k<4; ++k)
+		{
+			matrices.push_back(qbMatrix2<double>(n, n));
+			generator.FillUniform(matrices.back(), -1.0, 1.0);
+		}
+		cache.GetLU(matrices[0]);
+		cache.GetLU(matrices[1]);
+		cache.GetLU(matrices[2]);
+		cache.GetLU(matrices[0]);
+		cache.GetLU(matrices[3]);
+		PrintStatistics(cache);
+		auto before = cache.GetStatistics();
+		cache.GetLU(matrices[0]);
+		cout << "Recently used matrix kept: " << (cache.GetStatistics().hits == before.hits + 1 ? "True" : "False") << endl;
+		cache.GetLU(matrices[1]);
+		cout << "Least recently used matrix evicted: " << (cache.GetStatistics().misses == before.misses + 1 ? "True" : "False") << endl;
+
+		// A copy with one element changed is a miss, and the copy that was cached is unchanged.
+		std::shared_ptr<const qbLU<double>> lu = cache.GetLU(matrices[0]);
+		before = cache.GetStatistics();
+		matrices[0].SetElement(5, 5, matrices[0].GetElement(5, 5) + 1.0);
+		std::shared_ptr<const qbLU<double>> luModified = cache.GetLU(matrices[0]);
+		cout << "Modified matrix is a miss: " << (cache.GetStatistics().misses == before.misses + 1 ? "True" : "False")
+			<< ", new factorization = " << (lu != luModified ? "True" : "False") << endl;
+
+		qbMatrix2<double> big(200, 200);
+		cache.GetLU(big);
+		cout << "Factorization larger than the budget is not cached: " << (cache.GetStatistics().storageSize <= cache.GetMemoryBudget() ? "True" : "False") << endl;
+		cache.SetMemoryBudget(entrySize);
+		PrintStatistics(cache);
+		cache.Clear();
+		PrintStatistics(cache);
+		cout << endl;
+	}
+
+	{
+		cout << "Testing concurrent use of one cache:" << endl;
+		int n = 150, numThreads = 4, numMatrices = 3;
+		std::vector<qbMatrix2<double>> matrices;
+		std::vector<qbVector<double>> rhs;
+		for (int k=0; k<numMatrices; ++k)
+		{
+			matrices.push_back(qbMatrix2<double>(n, n));
+			generator.FillUniform(matrices.back(), -1.0, 1.0);
+			qbVector<double> b(n);
+			generator.FillUniform(b, -1.0, 1.0);
+			rhs.push_back(b);
+		}
+		qbDecompCache<double> cache;
+		std::vector<double> maxResidual(numThreads, 0.0);
+		std::vector<std::thread> threads;
+		for (int t=0; t<numThreads; ++t)
+		{
+			threads.emplace_back([&, t]()
+			{
+				for (int r=0; r<20; ++r)
+				{
+					int k = (t + r) % numMatrices;
+					qbVector<double> x;
+					qbLinSolve(matrices[k], rhs[k], x, cache);
+					maxResidual[t] = std::max(maxResidual[t], Residual(matrices[k], x, rhs[k]));
+				}
+			});
+		}
+		for (std::thread &thread : threads)
+			thread.join();
+		cout << std::scientific << "Max residual = " << *std::max_element(maxResidual.begin(), maxResidual.end()) << std::fixed << endl;
+		qbDecompCache<double>::Statistics stats = cache.GetStatistics();
+		cout << "Entries = " << stats.numEntries << ", hits + misses = " << stats.hits + stats.misses << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -33,6 +33,10 @@
 #include "../qbMatrix.h"
 #include "../qbVector.h"
 #include "../qbEIG.h"
+#include "../qbEIGSym.h"
+#include "../qbGEMM.h"
+#include "../qbQR.h"
+#include "../qbRandom.h"
 
 using namespace std;
 
@@ -63,6 +67,61 @@ void PrintVector(qbVector<T> inputVector)
 	}    
 }
 
+// Function to compute the largest ||A*v - lambda*v|| over the columns v of V.
+double EigenResidual(const qbMatrix2<double> &A, const std::vector<double> &eigenValues, const qbMatrix2<double> &V)
+{
+	qbMatrix2<double> AV;
+	qbGEMM(A, V, AV);
+	double maxResidual = 0.0;
+	for (int j=0; j<V.GetNumCols(); ++j)
+	{
+		double sum = 0.0;
+		for (int i=0; i<V.GetNumRows(); ++i)
+		{
+			double r = AV.GetElement(i, j) - eigenValues[j] * V.GetElement(i, j);
+			sum += r * r;
+		}
+		maxResidual = std::max(maxResidual, sqrt(sum));
+	}
+	return maxResidual;
+}
+
+// Function to compute max|V'V - I|.
+double OrthogonalityError(const qbMatrix2<double> &V)
+{
+	qbMatrix2<double> VtV;
+	qbGEMM(V.Transpose(), V, VtV);
+	double maxError = 0.0;
+	for (int i=0; i<VtV.GetNumRows(); ++i)
+	{
+		for (int j=0; j<VtV.GetNumCols(); ++j)
+			maxError = std::max(maxError, fabs(VtV.GetElement(i, j) - ((i == j) ? 1.0 : 0.0)));
+	}
+	return maxError;
+}
+
+/* Function to find the smallest iteration limit for which solve(limit) converges (returns 0),
+	by bisection, since the solvers are deterministic. Returns -1 if maxLimit is not enough. */
+template <class F>
+int IterationsNeeded(F solve, int maxLimit)
+{
+	if (solve(maxLimit) != 0)
+		return -1;
+	int lower = 0, upper = maxLimit;
+	while (upper - lower > 1)
+	{
+		int middle = (lower + upper) / 2;
+		if (solve(middle) == 0)
+			upper = middle;
+		else
+			lower = middle;
+	}
+
+	// Solve once more with the limit found, so that the outputs are from a successful run.
+	solve(upper);
+	return upper;
+}
+
 int main()
 {
 	cout << "**********************************************" << endl;
@@ -94,6 +153,47 @@ int main()
 		cout << endl;
 	}
 	
+	{
+		cout << "Testing with a symmetric 4x4 matrix and multiple starts:" << endl;
+		std::vector<double> simpleData = {4.0, 1.0, -2.0, 2.0, 1.0, 2.0, 0.0, 1.0, -2.0, 0.0, 3.0, -2.0, 2.0, 1.0, -2.0, -1.0};
+		qbMatrix2<double> testMatrix(4, 4, simpleData);
+		PrintMatrix(testMatrix);
+		cout << endl;
+
+		double eigenValue;
+		qbVector<double> eigenVector;
+		int returnStatus = qbEIG_PIt<double>(testMatrix, eigenValue, eigenVector);
+		cout << "Single start: eigenvalue = " << eigenValue << ", status = " << returnStatus << endl;
+
+		returnStatus = qbEIG_PItMulti<double>(testMatrix, 4, eigenValue, eigenVector);
+		cout << "Four starts: eigenvalue = " << eigenValue << ", status = " << returnStatus << endl;
+		cout << "Eigenvector: " << endl;
+		PrintVector(eigenVector);
+
+		// Check the residual, ||Av - lambda*v||.
+		qbVector<double> residual = (testMatrix * eigenVector) - (eigenValue * eigenVector);
+		cout << "Residual norm = " << std::scientific << residual.norm() << std::fixed << endl;
+		cout << endl;
+	}
+	
+	{
+		cout << "Testing top-3 eigenpairs with implicit deflation:" << endl;
+		std::vector<double> simpleData = {4.0, 1.0, -2.0, 2.0, 1.0, 2.0, 0.0, 1.0, -2.0, 0.0, 3.0, -2.0, 2.0, 1.0, -2.0, -1.0};
+		qbMatrix2<double> testMatrix(4, 4, simpleData);
+
+		std::vector<double> eigenValues;
+		std::vector<qbVector<double>> eigenVectors;
+		int returnStatus = qbEIG_PItTopK<double>(testMatrix, 3, eigenValues, eigenVectors);
+		cout << "Status = " << returnStatus << endl;
+		for (size_t i=0; i<eigenValues.size(); ++i)
+		{
+			qbVector<double> residual = (testMatrix * eigenVectors[i]) - (eigenValues[i] * eigenVectors[i]);
+			cout << "Eigenvalue " << i << " = " << std::setprecision(6) << eigenValues[i]
+				<< ", residual norm = " << std::scientific << residual.norm() << std::fixed << endl;
+		}
+		cout << endl;
+	}
+	
 	cout << "**********************************************" << endl;
 	cout << "Testing eigenvalue and eigenvector code." << endl;
 	cout << "Inverse-Power Iteration Method." << endl;
@@ -253,6 +353,13 @@ int main()
 		
 		if (returnStatus == QBEIG_MAXITERATIONSEXCEEDED)
 			cout << ">>> Maximum iterations exceeded <<<" << endl;			
+
+		// The warm-started version must reject it too, whatever the basis.
+		qbMatrix2<double> basis(3, 3);
+		basis.SetToIdentity();
+		std::vector<double> warmValues;
+		int warmStatus = qbEigQR(testMatrix, warmValues, basis);
+		cout << "Warm-started qbEigQR: status = " << warmStatus << ((warmStatus == QBEIG_MATRIXNOTSYMMETRIC) ? " (matrix not symmetric)" : "") << endl;
 		
 		// Display the eigenvalues.
 		cout << "The estimated eigenvalues are:" << endl;
@@ -279,6 +386,131 @@ int main()
 		
 		cout << endl << endl;
 	}
+
+	cout << "**********************************************" << endl;
+	cout << "Testing eigenvalue and eigenvector code." << endl;
+	cout << "Warm-started solvers." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	{
+		/* A 40x40 symmetric matrix with eigenvalues 1.2^i and known eigenvectors Q, and a drifted
+			copy A2 = A + 1e-3*E. Each solver is run on A2 from a random start (cold) and from the
+			eigenvectors of A (warm). The iterations are the smallest limit for which the solver
+			converges. */
+		int n = 40, k = 5;
+		qbRandom generator(2021);
+		qbMatrix2<double> X(n, n), Q, R;
+		generator.FillUniform(X, -1.0, 1.0);
+		qbQR(X, Q, R);
+		qbMatrix2<double> D(n, n), QD, A;
+		for (int i=0; i<n; ++i)
+			D.SetElement(i, i, pow(1.2, i));
+		qbGEMM(Q, D, QD);
+		qbGEMM(QD, Q.Transpose(), A);
+		qbMatrix2<double> E(n, n);
+		generator.FillUniform(E, -1.0, 1.0);
+		qbMatrix2<double> A2 = A + 1e-3 * E;
+		A2 = 0.5 * (A2 + A2.Transpose());
+
+		// The eigenvectors of A in descending order of eigenvalue, and the reference solution for A2.
+		qbMatrix2<double> previous(n, n), previousTop(n, k);
+		std::vector<double> previousValues(n);
+		for (int j=0; j<n; ++j)
+		{
+			previousValues[j] = pow(1.2, n-1-j);
+			for (int i=0; i<n; ++i)
+			{
+				previous.SetElement(i, j, Q.GetElement(i, n-1-j));
+				if (j < k)
+					previousTop.SetElement(i, j, Q.GetElement(i, n-1-j));
+			}
+		}
+		std::vector<double> referenceValues;
+		qbMatrix2<double> referenceVectors;
+		qbEigSymmetric(A2, referenceValues, referenceVectors);
+
+		// qbEigSubspace, for the top k eigenpairs.
+		{
+			qbMatrix2<double> randomStart(n, k);
+			generator.FillUniform(randomStart, -1.0, 1.0);
+			for (int warm=0; warm<2; ++warm)
+			{
+				const qbMatrix2<double> &start = warm ? previousTop : randomStart;
+				std::vector<double> values;
+				qbMatrix2<double> vectors;
+				int iterations = IterationsNeeded([&](int limit) { return qbEigSubspace(A2, start, values, vectors, 1e-10, limit); }, 5000);
+				cout << "qbEigSubspace (" << (warm ? "warm" : "cold") << "): iterations = " << iterations << std::scientific
+					<< ", residual = " << EigenResidual(A2, values, vectors) << ", max |V'V - I| = " << OrthogonalityError(vectors)
+					<< std::fixed << endl;
+			}
+		}
+
+		// qbEigJacobi, on A2 (cold) and on V'*A2*V with V the previous eigenvectors (warm).
+		{
+			qbMatrix2<double> AV, VtAV;
+			qbGEMM(A2, previous, AV);
+			qbGEMM(previous.Transpose(), AV, VtAV);
+			VtAV = 0.5 * (VtAV + VtAV.Transpose());
+			for (int warm=0; warm<2; ++warm)
+			{
+				const qbMatrix2<double> &B = warm ? VtAV : A2;
+				std::vector<double> values;
+				qbMatrix2<double> Y, vectors;
+				int sweeps = IterationsNeeded([&](int limit) { return qbEigJacobi(B, values, Y, limit); }, 100);
+				if (warm)
+					qbGEMM(previous, Y, vectors);
+				else
+					vectors = Y;
+				cout << "qbEigJacobi (" << (warm ? "warm" : "cold") << "): sweeps = " << sweeps << std::scientific
+					<< ", residual = " << EigenResidual(A2, values, vectors) << ", max |V'V - I| = " << OrthogonalityError(vectors)
+					<< std::fixed << endl;
+			}
+		}
+
+		// qbEigQR returns only the eigenvalues, so compare them with the reference. Warm, it solves V'*A2*V with qbEigJacobi.
+		for (int warm=0; warm<2; ++warm)
+		{
+			std::vector<double> values;
+			int iterations = IterationsNeeded([&](int limit)
+			{
+				values.clear();
+				return warm ? qbEigQR(A2, values, previous, limit) : qbEigQR(A2, values, limit);
+			}, 10000);
+			std::sort(values.begin(), values.end(), std::greater<double>());
+			double maxError = 0.0;
+			for (int i=0; i<n; ++i)
+				maxError = std::max(maxError, fabs(values[i] - referenceValues[i]) / referenceValues[0]);
+			cout << "qbEigQR (" << (warm ? "warm" : "cold") << "): " << (warm ? "Jacobi sweeps" : "iterations") << " = " << iterations << std::scientific
+				<< ", max |lambda - lambda(reference)| / max|lambda| = " << maxError << std::fixed << endl;
+		}
+
+		// qbInvPIt for the top k eigenvectors, shifted by the previous eigenvalues.
+		for (int warm=0; warm<2; ++warm)
+		{
+			qbMatrix2<double> vectors(n, k);
+			std::vector<double> values(k);
+			int iterations = 0;
+			for (int j=0; j<k; ++j)
+			{
+				qbVector<double> previousVector(n), v;
+				for (int i=0; i<n; ++i)
+					previousVector.SetElement(i, previous.GetElement(i, j));
+				int needed = IterationsNeeded([&](int limit)
+				{
+					return warm ? qbInvPIt(A2, previousValues[j], v, previousVector, limit) : qbInvPIt(A2, previousValues[j], v, QBRANDOM_DEFAULTSEED, limit);
+				}, 100);
+				iterations = std::max(iterations, needed);
+				values[j] = qbVector<double>::dot(A2 * v, v) / qbVector<double>::dot(v, v);
+				for (int i=0; i<n; ++i)
+					vectors.SetElement(i, j, v.GetElement(i));
+			}
+			cout << "qbInvPIt (" << (warm ? "warm" : "cold") << "): iterations = " << iterations << std::scientific
+				<< ", residual = " << EigenResidual(A2, values, vectors) << ", max |V'V - I| = " << OrthogonalityError(vectors)
+				<< std::fixed << endl;
+		}
+		cout << endl;
+	}
 	
 	return 0;
 }
@@ -0,0 +1,272 @@
+/* *************************************************************************************************
+
+	TestCode_qbEIGSym
+
+	  Code to test the symmetric (tridiagonal divide-and-conquer) eigensolver.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbEIG.h"
+#include "../qbEIGSym.h"
+
+using namespace std;
+
+// Function to compute max|A*V - V*diag(lambda)| / max|lambda|.
+double Residual(const qbMatrix2<double> &A, const std::vector<double> &lambda, const qbMatrix2<double> &V)
+{
+	qbMatrix2<double> AV;
+	qbGEMM(A, V, AV);
+	double maxResidual = 0.0, maxLambda = 0.0;
+	for (int j=0; j<V.GetNumCols(); ++j)
+	{
+		maxLambda = std::max(maxLambda, fabs(lambda[j]));
+		for (int i=0; i<V.GetNumRows(); ++i)
+			maxResidual = std::max(maxResidual, fabs(AV.GetElement(i, j) - lambda[j] * V.GetElement(i, j)));
+	}
+	return maxResidual / maxLambda;
+}
+
+// Function to compute max|V'*V - I|.
+double Orthogonality(const qbMatrix2<double> &V)
+{
+	qbMatrix2<double> VtV;
+	qbGEMM(V.Transpose(), V, VtV);
+	double maxError = 0.0;
+	for (int i=0; i<VtV.GetNumRows(); ++i)
+	{
+		for (int j=0; j<VtV.GetNumCols(); ++j)
+			maxError = std::max(maxError, fabs(VtV.GetElement(i, j) - ((i == j) ? 1.0 : 0.0)));
+	}
+	return maxError;
+}
+
+// Function to form the dense matrix from a diagonal and off-diagonal.
+qbMatrix2<double> TridiagonalMatrix(const std::vector<double> &d, const std::vector<double> &e)
+{
+	int n = d.size();
+	qbMatrix2<double> T(n, n);
+	for (int i=0; i<n; ++i)
+	{
+		T.SetElement(i, i, d[i]);
+		if (i < n-1)
+		{
+			T.SetElement(i, i+1, e[i]);
+			T.SetElement(i+1, i, e[i]);
+		}
+	}
+	return T;
+}
+
+// Function to test qbEigTridiagonal on one matrix.
+void TestTridiagonal(const std::string &name, const std::vector<double> &d, const std::vector<double> &e)
+{
+	std::vector<double> lambda;
+	qbMatrix2<double> V;
+	int status = qbEigTridiagonal(d, e, lambda, V);
+	cout << name << ": status = " << status << ", residual = " << std::scientific << Residual(TridiagonalMatrix(d, e), lambda, V)
+		<< ", orthogonality = " << Orthogonality(V) << std::fixed << endl;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing symmetric eigenvalue code." << endl;
+	cout << "Divide-and-conquer method." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing with a 5x5 symmetric matrix against qbEigJacobi:" << endl;
+		std::vector<double> simpleData = {4.0, 1.0, -2.0, 2.0, 0.5,
+			1.0, 2.0, 0.0, 1.0, -1.0,
+			-2.0, 0.0, 3.0, -2.0, 1.5,
+			2.0, 1.0, -2.0, -1.0, 0.0,
+			0.5, -1.0, 1.5, 0.0, 6.0};
+		qbMatrix2<double> A(5, 5, simpleData);
+		std::vector<double> lambda, jacobiLambda;
+		qbMatrix2<double> V, jacobiV;
+		int status = qbEigSymmetric(A, lambda, V);
+		qbEigJacobi(A, jacobiLambda, jacobiV);
+		cout << "Status = " << status << endl;
+		for (int i=0; i<5; ++i)
+			cout << "lambda = " << std::setprecision(10) << lambda[i] << ", Jacobi = " << jacobiLambda[i] << std::setprecision(6) << endl;
+		cout << "Residual = " << std::scientific << Residual(A, lambda, V) << ", orthogonality = " << Orthogonality(V) << std::fixed << endl;
+
+		std::vector<double> d, e;
+		qbMatrix2<double> Q;
+		qbTridiagonalize(A, d, e, Q);
+		qbMatrix2<double> QT, QTQt;
+		qbGEMM(Q, TridiagonalMatrix(d, e), QT);
+		qbGEMM(QT, Q.Transpose(), QTQt);
+		double maxDiff = 0.0;
+		for (int i=0; i<5; ++i)
+		{
+			for (int j=0; j<5; ++j)
+				maxDiff = std::max(maxDiff, fabs(QTQt.GetElement(i, j) - A.GetElement(i, j)));
+		}
+		cout << "Tridiagonalization: max |Q*T*Q' - A| = " << std::scientific << maxDiff << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing tridiagonal matrices (n = 500):" << endl;
+		int n = 500;
+		std::vector<double> d(n, 2.0), e(n-1, -1.0);
+		std::vector<double> lambda;
+		qbMatrix2<double> V;
+		qbEigTridiagonal(d, e, lambda, V);
+		double maxError = 0.0;
+		for (int k=0; k<n; ++k)
+			maxError = std::max(maxError, fabs(lambda[n-1-k] - (2.0 - 2.0 * cos((k + 1) * M_PI / (n + 1)))));
+		cout << "1-2-1 matrix: max eigenvalue error = " << std::scientific << maxError << std::fixed << endl;
+		TestTridiagonal("1-2-1 matrix", d, e);
+
+		// Wilkinson matrix: pairs of eigenvalues agree to many digits, so most of them deflate.
+		for (int i=0; i<n; ++i)
+			d[i] = fabs(i - (n - 1) / 2.0);
+		std::fill(e.begin(), e.end(), 1.0);
+		TestTridiagonal("Wilkinson matrix", d, e);
+
+		// Many equal eigenvalues.
+		std::fill(d.begin(), d.end(), 1.0);
+		for (int i=0; i<n-1; ++i)
+			e[i] = (i % 50 == 49) ? 1e-3 : 0.0;
+		TestTridiagonal("Nearly diagonal", d, e);
+
+		generator.FillUniform(d.data(), d.size(), -1.0, 1.0);
+		generator.FillUniform(e.data(), e.size(), -1.0, 1.0);
+		TestTridiagonal("Random matrix", d, e);
+
+		// Graded matrix, with elements spanning 20 orders of magnitude.
+		for (int i=0; i<n; ++i)
+			d[i] = pow(10.0, -20.0 * i / n);
+		for (int i=0; i<n-1; ++i)
+			e[i] = 0.5 * d[i+1];
+		TestTridiagonal("Graded matrix", d, e);
+		cout << endl;
+	}
+
+	{
+		cout << "Testing the two-stage reduction (max |Q*T*Q' - A|, and the same with 4 threads):" << endl;
+		int sizes[3] = {10, 97, 300};
+		int bandwidths[3] = {1, 8, 32};
+		for (int s=0; s<3; ++s)
+		{
+			int n = sizes[s];
+			qbMatrix2<double> A(n, n);
+			generator.FillUniform(A, -1.0, 1.0);
+			A = A + A.Transpose();
+			for (int b=0; b<3; ++b)
+			{
+				std::vector<double> d, e;
+				qbMatrix2<double> Q;
+				int status = qbTridiagonalizeTwoStage(A, d, e, Q, bandwidths[b]);
+				qbMatrix2<double> QT, QTQt;
+				qbGEMM(Q, TridiagonalMatrix(d, e), QT);
+				qbGEMM(QT, Q.Transpose(), QTQt);
+				double maxDiff = 0.0;
+				for (int i=0; i<n; ++i)
+				{
+					for (int j=0; j<n; ++j)
+						maxDiff = std::max(maxDiff, fabs(QTQt.GetElement(i, j) - A.GetElement(i, j)));
+				}
+
+				// The pipelined bulge chasing must give the same result on any number of threads.
+				qbMatrix2<double> A4 = A;
+				std::vector<double> d4(n), e4(n-1);
+				qbEIGSymKernels::TwoStageReduction<double> reduction;
+				qbEIGSymKernels::TridiagonalizeTwoStage(n, bandwidths[b], A4.GetData(), d4.data(), e4.data(), reduction, 4);
+				cout << "n = " << setw(3) << n << ", bandwidth = " << setw(2) << bandwidths[b] << ": status = " << status
+					<< ", max difference = " << std::scientific << maxDiff << std::fixed << ", same with 4 threads: "
+					<< (((d == d4) && (e == e4)) ? "True." : "False.") << endl;
+			}
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error codes:" << endl;
+		std::vector<double> lambda;
+		qbMatrix2<double> V;
+		cout << "Non-square matrix: status = " << qbEigSymmetric(qbMatrix2<double>(3, 4), lambda, V) << endl;
+		std::vector<double> data = {1.0, 2.0, 3.0, 4.0};
+		cout << "Non-symmetric matrix: status = " << qbEigSymmetric(qbMatrix2<double>(2, 2, data), lambda, V) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a 800x800 covariance matrix:" << endl;
+		int n = 800;
+		qbMatrix2<double> X(2*n, n);
+		generator.FillUniform(X, -1.0, 1.0);
+		qbMatrix2<double> C;
+		qbGEMM(X.Transpose(), X, C);
+		C = C * (1.0 / (2*n - 1));
+		qbEIGKernels::Symmetrize(C);
+
+		auto t0 = std::chrono::steady_clock::now();
+		std::vector<double> d, e;
+		qbMatrix2<double> Q;
+		qbTridiagonalize(C, d, e, Q);
+		auto t1 = std::chrono::steady_clock::now();
+		std::vector<double> lambda;
+		qbMatrix2<double> Z;
+		int status = qbEigTridiagonal(d, e, lambda, Z);
+		auto t2 = std::chrono::steady_clock::now();
+		std::vector<double> lambdaQL(d);
+		qbMatrix2<double> ZQL(n, n);
+		ZQL.SetToIdentity();
+		qbEIGSymKernels::TridiagonalQL(n, lambdaQL.data(), e.data(), ZQL.GetData(), n);
+		auto t3 = std::chrono::steady_clock::now();
+
+		double maxDiff = 0.0;
+		for (int i=0; i<n; ++i)
+			maxDiff = std::max(maxDiff, fabs(lambda[i] - lambdaQL[n-1-i]));
+		cout << "Tridiagonal stage: status = " << status << ", max eigenvalue difference from QL iteration = " << std::scientific << maxDiff << std::fixed << endl;
+		cout << "Time: tridiagonalization = " << std::chrono::duration<double>(t1 - t0).count()
+			<< " s, divide-and-conquer = " << std::chrono::duration<double>(t2 - t1).count()
+			<< " s, QL iteration = " << std::chrono::duration<double>(t3 - t2).count() << " s" << endl;
+
+		t0 = std::chrono::steady_clock::now();
+		qbTridiagonalizeTwoStage(C, d, e, Q);
+		t1 = std::chrono::steady_clock::now();
+		cout << "Time: two-stage tridiagonalization = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+
+		qbMatrix2<double> V;
+		t0 = std::chrono::steady_clock::now();
+		status = qbEigSymmetric(C, lambda, V);
+		t1 = std::chrono::steady_clock::now();
+		cout << "qbEigSymmetric: status = " << status << ", residual = " << std::scientific << Residual(C, lambda, V)
+			<< ", orthogonality = " << Orthogonality(V) << std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << "Largest eigenvalues = " << lambda[0] << ", " << lambda[1] << ", " << lambda[2] << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
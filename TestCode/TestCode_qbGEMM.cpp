@@ -0,0 +1,137 @@
+/* *************************************************************************************************
+
+	TestCode_qbGEMM
+
+	  Code to test the blocked and Strassen-Winograd matrix multiplication code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <sstream>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbGEMM.h"
+
+using namespace std;
+
+// Function to compute the largest absolute difference between two matrices.
+template <class T>
+T MaxAbsDiff(const qbMatrix2<T> &A, const qbMatrix2<T> &B)
+{
+	T maxDiff = static_cast<T>(0.0);
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, static_cast<T>(fabs(A.GetElement(i,j) - B.GetElement(i,j))));
+	}
+	return maxDiff;
+}
+
+// Function to generate a random matrix.
+qbMatrix2<double> RandomMatrix(int numRows, int numCols, std::mt19937 &generator)
+{
+	std::uniform_real_distribution<double> distribution(-1.0, 1.0);
+	qbMatrix2<double> result(numRows, numCols);
+	for (int i=0; i<numRows; ++i)
+	{
+		for (int j=0; j<numCols; ++j)
+			result.SetElement(i, j, distribution(generator));
+	}
+	return result;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing matrix multiplication code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	std::mt19937 generator(12345);
+
+	{
+		cout << "Testing qbGEMM with a 3x4 by 4x2 product:" << endl;
+		std::vector<double> aData = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0, 9.0, 10.0, 11.0, 12.0};
+		std::vector<double> bData = {1.0, 0.0, 0.0, 1.0, 2.0, 0.0, 0.0, 2.0};
+		qbMatrix2<double> A(3, 4, aData);
+		qbMatrix2<double> B(4, 2, bData);
+		qbMatrix2<double> C;
+		int status = qbGEMM(A, B, C);
+		C.PrintMatrix();
+		cout << "Status = " << status << endl;
+		cout << "Max difference from * operator = " << MaxAbsDiff(C, A*B) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbGEMM with mismatched dimensions:" << endl;
+		qbMatrix2<double> A(3, 4);
+		qbMatrix2<double> B(3, 4);
+		qbMatrix2<double> C;
+		int status = qbGEMM(A, B, C);
+		cout << "Status = " << status << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbStrassen with a 300x300 product (crossover = 32):" << endl;
+		qbMatrix2<double> A = RandomMatrix(300, 300, generator);
+		qbMatrix2<double> B = RandomMatrix(300, 300, generator);
+		qbMatrix2<double> C1, C2;
+		qbGEMM(A, B, C1);
+		int status = qbStrassen(A, B, C2, 32);
+		cout << "Status = " << status << endl;
+		cout << "Max difference from qbGEMM = " << std::scientific << MaxAbsDiff(C1, C2) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbStrassen with an odd sized 257x257 product (crossover = 16):" << endl;
+		qbMatrix2<double> A = RandomMatrix(257, 257, generator);
+		qbMatrix2<double> B = RandomMatrix(257, 257, generator);
+		qbMatrix2<double> C1, C2;
+		qbGEMM(A, B, C1);
+		int status = qbStrassen(A, B, C2, 16);
+		cout << "Status = " << status << endl;
+		cout << "Max difference from qbGEMM = " << std::scientific << MaxAbsDiff(C1, C2) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Timing a 1024x1024 product:" << endl;
+		qbMatrix2<double> A = RandomMatrix(1024, 1024, generator);
+		qbMatrix2<double> B = RandomMatrix(1024, 1024, generator);
+		qbMatrix2<double> C1, C2;
+		auto t0 = std::chrono::steady_clock::now();
+		qbGEMM(A, B, C1);
+		auto t1 = std::chrono::steady_clock::now();
+		qbStrassen(A, B, C2, 128);
+		auto t2 = std::chrono::steady_clock::now();
+		cout << "qbGEMM:     " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << "qbStrassen: " << std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+		cout << "Max difference = " << std::scientific << MaxAbsDiff(C1, C2) << std::fixed << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
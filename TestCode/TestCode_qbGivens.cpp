@@ -0,0 +1,280 @@
+/* *************************************************************************************************
+
+	TestCode_qbGivens
+
+	  Code to test the Givens rotation QR decomposition and the QR update functions.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbQR.h"
+#include "../qbGivens.h"
+#include "../qbEIG.h"
+
+using namespace std;
+
+// Function to compute max|A - B|.
+double MaxAbsDiff(const qbMatrix2<double> &A, const qbMatrix2<double> &B)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(A.GetElement(i, j) - B.GetElement(i, j)));
+	}
+	return maxDiff;
+}
+
+// Function to print max|QR - A|, max|Q'Q - I| and max|R(i,j)| below the diagonal.
+void PrintQRErrors(const qbMatrix2<double> &A, const qbMatrix2<double> &Q, const qbMatrix2<double> &R)
+{
+	qbMatrix2<double> QR, QtQ;
+	qbGEMM(Q, R, QR);
+	qbGEMM(Q.Transpose(), Q, QtQ);
+	qbMatrix2<double> I(Q.GetNumCols(), Q.GetNumCols());
+	I.SetToIdentity();
+	double maxLower = 0.0;
+	for (int i=0; i<R.GetNumRows(); ++i)
+	{
+		for (int j=0; j<std::min(i, R.GetNumCols()); ++j)
+			maxLower = std::max(maxLower, fabs(R.GetElement(i, j)));
+	}
+	cout << std::scientific << "max |QR - A| = " << MaxAbsDiff(QR, A) << ", max |Q'Q - I| = " << MaxAbsDiff(QtQ, I)
+		<< ", max |R| below diagonal = " << maxLower << std::fixed << endl;
+}
+
+// Function to compute max|R1'R1 - R2'R2|.
+double GramDiff(const qbMatrix2<double> &R1, const qbMatrix2<double> &R2)
+{
+	qbMatrix2<double> G1, G2;
+	qbGEMM(R1.Transpose(), R1, G1);
+	qbGEMM(R2.Transpose(), R2, G2);
+	return MaxAbsDiff(G1, G2);
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing Givens rotation QR code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing rotation generation:" << endl;
+		double a[5] = {3.0, 0.0, -2.0, 1e200, 1e-200};
+		double b[5] = {4.0, 5.0, 0.0, 1e200, -3e-200};
+		for (int k=0; k<5; ++k)
+		{
+			double c, s, r;
+			qbGivensKernels::MakeRotation(a[k], b[k], c, s, r);
+			cout << std::scientific << "a = " << a[k] << ", b = " << b[k] << ": r = " << r << ", -s*a + c*b = " << (-s * a[k] + c * b[k])
+				<< ", c^2 + s^2 - 1 = " << (c * c + s * s - 1.0) << std::fixed << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbQRGivens:" << endl;
+		qbMatrix2<double> A(50, 30);
+		generator.FillUniform(A, -1.0, 1.0);
+		qbMatrix2<double> Q, R;
+		cout << "Dense 50x30 matrix: status = " << qbQRGivens(A, Q, R) << ", ";
+		PrintQRErrors(A, Q, R);
+
+		// Upper Hessenberg and banded matrices only need rotations inside the structure.
+		int n = 200;
+		qbMatrix2<double> H(n, n), B(n, n);
+		generator.FillUniform(H, -1.0, 1.0);
+		generator.FillUniform(B, -1.0, 1.0);
+		for (int i=0; i<n; ++i)
+		{
+			for (int j=0; j<n; ++j)
+			{
+				if (i > j + 1)
+					H.SetElement(i, j, 0.0);
+				if (abs(i - j) > 3)
+					B.SetElement(i, j, 0.0);
+			}
+		}
+		cout << "Hessenberg 200x200 matrix: status = " << qbQRGivens(H, Q, R) << ", ";
+		PrintQRErrors(H, Q, R);
+		cout << "Banded 200x200 matrix: status = " << qbQRGivens(B, Q, R) << ", ";
+		PrintQRErrors(B, Q, R);
+
+		std::vector<qbGivensKernels::Rotation<double>> rotations;
+		qbMatrix2<double> work = H;
+		qbGivensKernels::GivensQR(n, n, work.GetData(), n, rotations);
+		cout << "Rotations: Hessenberg = " << rotations.size();
+		work = B;
+		qbGivensKernels::GivensQR(n, n, work.GetData(), n, rotations);
+		int maxBandwidth = 0;
+		for (int i=0; i<n; ++i)
+		{
+			for (int j=i; j<n; ++j)
+			{
+				if (work.GetElement(i, j) != 0.0)
+					maxBandwidth = std::max(maxBandwidth, j - i);
+			}
+		}
+		cout << ", banded = " << rotations.size() << " (upper bandwidth of R = " << maxBandwidth << ")" << endl;
+		cout << "Wide matrix: status = " << qbQRGivens(qbMatrix2<double>(3, 4), Q, R) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing batched application of rotations:" << endl;
+		int m = 300, n = 1000;
+		std::vector<qbGivensKernels::Rotation<double>> rotations;
+		for (int k=0; k<2000; ++k)
+		{
+			int i = (k * 37) % m, j = (k * 101 + 1) % m;
+			if (i == j)
+				continue;
+			double theta = 0.001 * k;
+			rotations.push_back({i, j, cos(theta), sin(theta)});
+		}
+		qbMatrix2<double> A(m, n), At;
+		generator.FillUniform(A, -1.0, 1.0);
+		At = A.Transpose();
+
+		// Reference: one rotation at a time over whole rows.
+		qbMatrix2<double> ref = A;
+		for (const auto &g : rotations)
+			qbGivensKernels::RotatePair(n, g.c, g.s, ref.GetData() + (size_t)g.i*n, ref.GetData() + (size_t)g.j*n);
+
+		auto t0 = std::chrono::steady_clock::now();
+		qbGivensKernels::ApplyLeft(rotations, n, A.GetData(), n);
+		auto t1 = std::chrono::steady_clock::now();
+		qbGivensKernels::ApplyRight(rotations, n, At.GetData(), m);
+		cout << "ApplyLeft vs one at a time: max difference = " << std::scientific << MaxAbsDiff(A, ref)
+			<< ", ApplyRight on the transpose: max difference = " << MaxAbsDiff(At.Transpose(), ref) << std::fixed << endl;
+		cout << "Time: ApplyLeft with " << rotations.size() << " rotations = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+
+		// Sequences of adjacent rotations, from the bottom up (as in QR steps), are applied in wavefront order.
+		rotations.clear();
+		for (int p=0; p<40; ++p)
+		{
+			for (int i=m-2-(p%3); i>=p/2; --i)
+			{
+				double theta = 0.01 * (p + 1) * (i + 1);
+				rotations.push_back({i, i+1, cos(theta), sin(theta)});
+			}
+		}
+		std::vector<qbGivensKernels::Rotation<double>> ordered;
+		bool isWavefront = qbGivensKernels::WavefrontOrder(rotations, ordered);
+		generator.FillUniform(A, -1.0, 1.0);
+		At = A.Transpose();
+		ref = A;
+		for (const auto &g : rotations)
+			qbGivensKernels::RotatePair(n, g.c, g.s, ref.GetData() + (size_t)g.i*n, ref.GetData() + (size_t)g.j*n);
+		t0 = std::chrono::steady_clock::now();
+		qbGivensKernels::ApplyLeft(rotations, n, A.GetData(), n);
+		t1 = std::chrono::steady_clock::now();
+		qbGivensKernels::ApplyRight(rotations, n, At.GetData(), m);
+		cout << "Wavefront order = " << (isWavefront ? "True" : "False") << ", ApplyLeft vs one at a time: max difference = " << std::scientific
+			<< MaxAbsDiff(A, ref) << ", ApplyRight on the transpose: max difference = " << MaxAbsDiff(At.Transpose(), ref) << std::fixed << endl;
+		cout << "Time: ApplyLeft with 40 sequences of " << rotations.size() << " rotations = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbQRUpdate:" << endl;
+		int m = 60, n = 40;
+		qbMatrix2<double> A(m, n), Q, R;
+		generator.FillUniform(A, -1.0, 1.0);
+		qbQRGivens(A, Q, R);
+		for (int k=0; k<3; ++k)
+		{
+			qbVector<double> u(m), v(n);
+			generator.FillUniform(u, -1.0, 1.0);
+			generator.FillUniform(v, -1.0, 1.0);
+			for (int i=0; i<m; ++i)
+			{
+				for (int j=0; j<n; ++j)
+					A.SetElement(i, j, A.GetElement(i, j) + u.GetElement(i) * v.GetElement(j));
+			}
+			cout << "Update " << k << ": status = " << qbQRUpdate(Q, R, u, v) << ", ";
+			PrintQRErrors(A, Q, R);
+		}
+		cout << "Mismatched dimensions: status = " << qbQRUpdate(Q, R, qbVector<double>(m), qbVector<double>(n+1)) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbQRAddRow and qbQRDeleteRow:" << endl;
+		int m = 100, n = 10;
+		qbMatrix2<double> X(m + 1, n), Q, R, Rfull;
+		generator.FillUniform(X, -1.0, 1.0);
+		qbMatrix2<double> Xm(m, n, X.GetData());
+		qbQRThin(Xm, Q, R);
+		qbQRThin(X, Q, Rfull);
+		qbVector<double> x(std::vector<double>(X.GetData() + (size_t)m*n, X.GetData() + (size_t)(m+1)*n));
+
+		qbMatrix2<double> Radd = R;
+		cout << "Add row: status = " << qbQRAddRow(Radd, x) << ", max |R'R - X'X| = " << std::scientific << GramDiff(Radd, Rfull) << std::fixed << endl;
+		qbMatrix2<double> Rdel = Rfull;
+		cout << "Delete row: status = " << qbQRDeleteRow(Rdel, x) << ", max |R'R - X'X| = " << std::scientific << GramDiff(Rdel, R) << std::fixed << endl;
+
+		// Removing a row that was never added leaves a matrix that is not positive definite.
+		qbVector<double> big(std::vector<double>(n, 10.0));
+		Rdel = R;
+		cout << "Delete a row that is too large: status = " << qbQRDeleteRow(Rdel, big) << endl;
+		cout << "Mismatched dimensions: status = " << qbQRAddRow(Radd, qbVector<double>(n+1)) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing qbEigQR (Hessenberg QR steps) on a 150x150 symmetric matrix:" << endl;
+		int n = 150;
+		qbMatrix2<double> Q, R, A, D(n, n), M(n, n);
+		generator.FillUniform(M, -1.0, 1.0);
+		qbQR(M, Q, R);
+
+		// Well separated eigenvalues, so that the unshifted QR algorithm converges quickly.
+		for (int i=0; i<n; ++i)
+			D.SetElement(i, i, pow(1.2, i) * ((i % 2 == 0) ? 1.0 : -1.0));
+		qbMatrix2<double> QD;
+		qbGEMM(Q, D, QD);
+		qbGEMM(QD, Q.Transpose(), A);
+		qbEIGKernels::Symmetrize(A);
+
+		std::vector<double> lambda;
+		auto t0 = std::chrono::steady_clock::now();
+		int status = qbEigQR(A, lambda);
+		auto t1 = std::chrono::steady_clock::now();
+		double maxError = 0.0;
+		for (int i=0; i<n; ++i)
+			maxError = std::max(maxError, fabs(lambda[i] - D.GetElement(n-1-i, n-1-i)) / fabs(D.GetElement(n-1-i, n-1-i)));
+		cout << "Status = " << status << ", max relative eigenvalue error = " << std::scientific << maxError << std::fixed
+			<< ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
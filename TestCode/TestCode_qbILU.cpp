@@ -0,0 +1,219 @@
+/* *************************************************************************************************
+
+	TestCode_qbILU
+
+	  Code to test the incomplete factorization preconditioners.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <functional>
+#include <chrono>
+
+#include "../qbSparse.h"
+#include "../qbCG.h"
+#include "../qbILU.h"
+
+using namespace std;
+
+typedef std::function<void(const std::vector<double>&, std::vector<double>&)> Operator;
+
+/* Function to build a convection-diffusion operator on an n x n grid: the 5-point Laplacian plus
+	an upwind first derivative in the x direction with strength beta (non-symmetric for beta > 0). */
+qbSparseMatrix<double> ConvectionDiffusion2D(int n, double beta)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=0; j<n; ++j)
+		{
+			int row = i*n + j;
+			rows.push_back(row); cols.push_back(row); values.push_back(4.0 + beta);
+			if (i > 0)		{ rows.push_back(row); cols.push_back(row - n); values.push_back(-1.0); }
+			if (i < n-1)	{ rows.push_back(row); cols.push_back(row + n); values.push_back(-1.0); }
+			if (j > 0)		{ rows.push_back(row); cols.push_back(row - 1); values.push_back(-1.0 - beta); }
+			if (j < n-1)	{ rows.push_back(row); cols.push_back(row + 1); values.push_back(-1.0); }
+		}
+	}
+	return qbSparseMatrix<double>(n*n, n*n, rows, cols, values);
+}
+
+// Function to compute ||b - A*x|| / ||b||.
+double RelativeResidual(const qbSparseMatrix<double> &A, const std::vector<double> &b, const std::vector<double> &x)
+{
+	std::vector<double> Ax;
+	A.Multiply(x, Ax);
+	double rNorm = 0.0, bNorm = 0.0;
+	for (size_t i=0; i<b.size(); ++i)
+	{
+		rNorm += (b[i] - Ax[i]) * (b[i] - Ax[i]);
+		bNorm += b[i] * b[i];
+	}
+	return sqrt(rNorm / bNorm);
+}
+
+// Function to solve A*x = b with the preconditioned Richardson iteration x <- x + inv(M)*(b - A*x).
+int Richardson(const qbSparseMatrix<double> &A, qbILU<double> &M, const std::vector<double> &b, std::vector<double> &x, double tolerance, int maxIterations)
+{
+	x.assign(b.size(), 0.0);
+	std::vector<double> r(b.size()), z;
+	for (int iteration=0; iteration<maxIterations; ++iteration)
+	{
+		if (RelativeResidual(A, b, x) <= tolerance)
+			return iteration;
+		A.Multiply(x, r);
+		for (size_t i=0; i<b.size(); ++i)
+			r[i] = b[i] - r[i];
+		M.Precondition(r, z);
+		for (size_t i=0; i<b.size(); ++i)
+			x[i] += z[i];
+	}
+	return -1;
+}
+
+// Function to compute the largest absolute difference between two sparse matrices, as dense matrices.
+double MaxAbsDiff(const qbSparseMatrix<double> &A, const qbSparseMatrix<double> &B)
+{
+	qbMatrix2<double> difference = A.ToDense() - B.ToDense();
+	double maxDiff = 0.0;
+	for (int i=0; i<difference.GetNumRows(); ++i)
+	{
+		for (int j=0; j<difference.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(difference.GetElement(i, j)));
+	}
+	return maxDiff;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing incomplete factorization code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	{
+		cout << "Testing on a tridiagonal matrix (no fill-in, so the factorizations are exact):" << endl;
+		std::vector<int> rows, cols;
+		std::vector<double> values;
+		int n = 50;
+		for (int i=0; i<n; ++i)
+		{
+			rows.push_back(i); cols.push_back(i); values.push_back(2.5);
+			if (i > 0)		{ rows.push_back(i); cols.push_back(i-1); values.push_back(-1.0); }
+			if (i < n-1)	{ rows.push_back(i); cols.push_back(i+1); values.push_back(-1.0); }
+		}
+		qbSparseMatrix<double> A(n, n, rows, cols, values);
+
+		qbILU<double> ilu;
+		int status = ilu.FactorILU0(A);
+		cout << "ILU(0): status = " << status << ", max |L*U - A| = " << std::scientific << MaxAbsDiff(ilu.GetL() * ilu.GetU(), A) << std::fixed << endl;
+		status = ilu.FactorIC0(A);
+		cout << "IC(0):  status = " << status << ", max |L*L' - A| = " << std::scientific << MaxAbsDiff(ilu.GetL() * ilu.GetL().Transpose(), A) << std::fixed << endl;
+		status = ilu.FactorILUT(A, 1e-12, n);
+		cout << "ILUT:   status = " << status << ", max |L*U - A| = " << std::scientific << MaxAbsDiff(ilu.GetL() * ilu.GetU(), A) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error codes:" << endl;
+		qbILU<double> ilu;
+		std::vector<int> rows = {0, 1, 1}, cols = {1, 0, 1};
+		std::vector<double> values = {1.0, 1.0, 1.0};
+		cout << "Missing diagonal, ILU(0): status = " << ilu.FactorILU0(qbSparseMatrix<double>(2, 2, rows, cols, values)) << endl;
+		rows = {0, 0, 1, 1}; cols = {0, 1, 0, 1}; values = {1.0, 2.0, 2.0, 1.0};
+		cout << "Indefinite matrix, IC(0): status = " << ilu.FactorIC0(qbSparseMatrix<double>(2, 2, rows, cols, values)) << endl;
+		cout << "Non-square matrix: status = " << ilu.FactorILU0(qbSparseMatrix<double>(2, 3)) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing CG preconditioning for the 2D Poisson problem on a 300x300 grid (tolerance 1e-8):" << endl;
+		int n = 300;
+		qbSparseMatrix<double> A = ConvectionDiffusion2D(n, 0.0);
+		std::vector<double> b(n*n, 1.0);
+		std::vector<double> x;
+		int numIterations = 0;
+		Operator countedMatVec = [&](const std::vector<double> &in, std::vector<double> &out) { A.Multiply(in, out); numIterations++; };
+		auto t0 = std::chrono::steady_clock::now();
+		int status = qbCG<double>(countedMatVec, n*n, b, x, 1e-8, 5000);
+		auto t1 = std::chrono::steady_clock::now();
+		cout << "No preconditioner:      status = " << status << ", iterations = " << numIterations - 1 << ", relative residual = "
+			<< std::scientific << RelativeResidual(A, b, x) << std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+
+		qbILU<double> ic;
+		t0 = std::chrono::steady_clock::now();
+		status = ic.FactorIC0(A);
+		t1 = std::chrono::steady_clock::now();
+		cout << "IC(0) factorization:    status = " << status << ", levels = " << ic.GetNumLevels() << ", time = "
+			<< std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+
+		std::vector<std::string> names = {"IC(0), level schedule ", "IC(0), 2 Jacobi sweeps", "IC(0), 5 Jacobi sweeps"};
+		std::vector<int> methods = {QBILU_LEVELSCHEDULE, QBILU_JACOBI, QBILU_JACOBI};
+		std::vector<int> sweeps = {0, 2, 5};
+		for (int m=0; m<3; ++m)
+		{
+			ic.SetSolveMethod(methods[m]);
+			ic.SetNumJacobiSweeps(sweeps[m]);
+			Operator precondition = [&](const std::vector<double> &in, std::vector<double> &out) { ic.Precondition(in, out); };
+			numIterations = 0;
+			x.clear();
+			t0 = std::chrono::steady_clock::now();
+			status = qbCG<double>(countedMatVec, precondition, n*n, b, x, 1e-8, 5000);
+			t1 = std::chrono::steady_clock::now();
+			cout << names[m] << ": status = " << status << ", iterations = " << numIterations - 1 << ", relative residual = "
+				<< std::scientific << RelativeResidual(A, b, x) << std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing Richardson iteration for convection-diffusion (100x100 grid, beta = 5, tolerance 1e-8):" << endl;
+		int n = 100;
+		qbSparseMatrix<double> A = ConvectionDiffusion2D(n, 5.0);
+		std::vector<double> b(n*n, 1.0), x;
+		cout << "Non-zeros in A = " << A.GetNumNonZeros() << endl;
+
+		qbILU<double> ilu;
+		int status = ilu.FactorILU0(A);
+		int iterations = Richardson(A, ilu, b, x, 1e-8, 1000);
+		cout << "ILU(0):            status = " << status << ", non-zeros = " << ilu.GetNumNonZeros() << ", iterations = " << iterations << endl;
+
+		std::vector<double> tolerances = {1e-2, 1e-3, 1e-4};
+		std::vector<int> fills = {5, 10, 20};
+		for (int t=0; t<3; ++t)
+		{
+			status = ilu.FactorILUT(A, tolerances[t], fills[t]);
+			iterations = Richardson(A, ilu, b, x, 1e-8, 1000);
+			cout << "ILUT(" << std::scientific << std::setprecision(0) << tolerances[t] << std::fixed << std::setprecision(6) << ", " << setw(2) << fills[t]
+				<< "):   status = " << status << ", non-zeros = " << ilu.GetNumNonZeros() << ", iterations = " << iterations << endl;
+		}
+
+		ilu.FactorILU0(A);
+		ilu.SetSolveMethod(QBILU_JACOBI);
+		ilu.SetNumJacobiSweeps(5);
+		iterations = Richardson(A, ilu, b, x, 1e-8, 1000);
+		cout << "ILU(0), 5 sweeps:  iterations = " << iterations << ", relative residual = " << std::scientific << RelativeResidual(A, b, x) << std::fixed << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -175,5 +175,19 @@ int main()
 	  
   }
   
+  // Linear least squares - Test 3.
+  cout << "***************************************" << endl;
+  cout << "Test with exactly collinear columns." << endl;
+  {
+  	// The second column is twice the first, so there is no unique solution.
+  	std::vector<double> Xdata = {1.0, 2.0, 1.0, 2.0, 1.0, 2.0, 1.0, 2.0, 1.0, 2.0, 1.0, 2.0};
+  	qbMatrix2<double> X(6, 2, Xdata);
+  	std::vector<double> Ydata = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  	qbVector<double> y(Ydata), betaHat;
+  	int status = qbLSQ<double>(X, y, betaHat);
+  	cout << "Status = " << status << ((status == QBLSQ_NOINVERSE) ? " (no unique solution)" : "") << endl;
+  	cout << endl;
+  }
+  
 	return 0;
 }   
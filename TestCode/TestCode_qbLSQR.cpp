@@ -0,0 +1,227 @@
+/* *************************************************************************************************
+
+	TestCode_qbLSQR
+
+	  Code to test the LSQR and LSMR iterative least squares code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <functional>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbLSQ.h"
+#include "../qbLinSolve.h"
+#include "../qbLSQR.h"
+
+using namespace std;
+
+typedef std::function<void(const std::vector<double>&, std::vector<double>&)> Operator;
+
+// A minimal compressed sparse row matrix, for testing.
+struct TestSparseMatrix
+{
+	int numRows;
+	int numCols;
+	std::vector<int> rowStart;
+	std::vector<int> colIndex;
+	std::vector<double> values;
+};
+
+// Function to generate a random sparse matrix with a fixed number of entries per row.
+TestSparseMatrix RandomSparse(int numRows, int numCols, int entriesPerRow, qbRandom &generator)
+{
+	TestSparseMatrix A;
+	A.numRows = numRows;
+	A.numCols = numCols;
+	A.rowStart.push_back(0);
+	for (int i=0; i<numRows; ++i)
+	{
+		for (int k=0; k<entriesPerRow; ++k)
+		{
+			A.colIndex.push_back(std::min(static_cast<int>(generator.Uniform() * numCols), numCols - 1));
+			A.values.push_back(generator.Gaussian());
+		}
+		A.rowStart.push_back(A.colIndex.size());
+	}
+	return A;
+}
+
+// Function to compute ||A'(b - Ax)|| for a sparse matrix.
+double NormalResidual(const TestSparseMatrix &A, const std::vector<double> &b, const std::vector<double> &x)
+{
+	std::vector<double> Atr(A.numCols, 0.0);
+	for (int i=0; i<A.numRows; ++i)
+	{
+		double r = b[i];
+		for (int k=A.rowStart[i]; k<A.rowStart[i+1]; ++k)
+			r -= A.values[k] * x[A.colIndex[k]];
+		for (int k=A.rowStart[i]; k<A.rowStart[i+1]; ++k)
+			Atr[A.colIndex[k]] += A.values[k] * r;
+	}
+	return qbLSQRKernels::Norm(Atr);
+}
+
+// Function to compute the largest absolute difference between two vectors.
+double MaxAbsDiff(const std::vector<double> &a, const std::vector<double> &b)
+{
+	double maxDiff = 0.0;
+	for (size_t i=0; i<a.size(); ++i)
+		maxDiff = std::max(maxDiff, fabs(a[i] - b[i]));
+	return maxDiff;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing LSQR and LSMR code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	// A small dense test problem.
+	int numRows = 50;
+	int numCols = 8;
+	qbMatrix2<double> X(numRows, numCols);
+	qbVector<double> y(numRows);
+	generator.FillGaussian(X);
+	generator.FillGaussian(y);
+	const double *xData = X.GetData();
+	Operator denseMatVec = [&](const std::vector<double> &in, std::vector<double> &out)
+	{
+		for (int i=0; i<numRows; ++i)
+		{
+			out[i] = 0.0;
+			for (int j=0; j<numCols; ++j)
+				out[i] += xData[i*numCols + j] * in[j];
+		}
+	};
+	Operator denseRmatVec = [&](const std::vector<double> &in, std::vector<double> &out)
+	{
+		for (int j=0; j<numCols; ++j)
+		{
+			out[j] = 0.0;
+			for (int i=0; i<numRows; ++i)
+				out[j] += xData[i*numCols + j] * in[i];
+		}
+	};
+
+	{
+		cout << "Testing against qbLSQ with a dense 50x8 problem:" << endl;
+		qbVector<double> reference;
+		qbLSQ(X, y, reference);
+		std::vector<double> x1, x2;
+		int status1 = qbLSQR<double>(denseMatVec, denseRmatVec, numRows, numCols, y.data(), x1);
+		int status2 = qbLSMR<double>(denseMatVec, denseRmatVec, numRows, numCols, y.data(), x2);
+		cout << "LSQR: status = " << status1 << ", max difference from qbLSQ = " << std::scientific << MaxAbsDiff(x1, reference.data()) << endl;
+		cout << "LSMR: status = " << status2 << ", max difference from qbLSQ = " << MaxAbsDiff(x2, reference.data()) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing damping against the solution of (X'X + damping^2 * I) x = X'y:" << endl;
+		double damping = 2.0;
+		qbMatrix2<double> XtX = X.Transpose() * X;
+		for (int j=0; j<numCols; ++j)
+			XtX.SetElement(j, j, XtX.GetElement(j, j) + damping * damping);
+		qbVector<double> reference(numCols);
+		qbLinSolve(XtX, X.Transpose() * y, reference);
+		std::vector<double> x1, x2;
+		int status1 = qbLSQR<double>(denseMatVec, denseRmatVec, numRows, numCols, y.data(), x1, 1e-12, 1000, damping);
+		int status2 = qbLSMR<double>(denseMatVec, denseRmatVec, numRows, numCols, y.data(), x2, 1e-12, 1000, damping);
+		cout << "LSQR: status = " << status1 << ", max difference = " << std::scientific << MaxAbsDiff(x1, reference.data()) << endl;
+		cout << "LSMR: status = " << status2 << ", max difference = " << MaxAbsDiff(x2, reference.data()) << std::fixed << endl;
+		cout << endl;
+	}
+
+	// A large sparse test problem, with badly scaled columns.
+	TestSparseMatrix A = RandomSparse(20000, 2000, 5, generator);
+	for (size_t k=0; k<A.values.size(); ++k)
+		A.values[k] *= pow(10.0, 3.0 * (A.colIndex[k] % 7) / 6.0);
+	std::vector<double> b(A.numRows);
+	generator.FillGaussian(b.data(), b.size(), 0.0, 1.0);
+	Operator sparseMatVec = [&](const std::vector<double> &in, std::vector<double> &out)
+	{
+		for (int i=0; i<A.numRows; ++i)
+		{
+			double sum = 0.0;
+			for (int k=A.rowStart[i]; k<A.rowStart[i+1]; ++k)
+				sum += A.values[k] * in[A.colIndex[k]];
+			out[i] = sum;
+		}
+	};
+	Operator sparseRmatVec = [&](const std::vector<double> &in, std::vector<double> &out)
+	{
+		std::fill(out.begin(), out.end(), 0.0);
+		for (int i=0; i<A.numRows; ++i)
+		{
+			for (int k=A.rowStart[i]; k<A.rowStart[i+1]; ++k)
+				out[A.colIndex[k]] += A.values[k] * in[i];
+		}
+	};
+
+	{
+		cout << "Testing with a sparse 20000x2000 problem (5 entries per row, limited to 2000 iterations):" << endl;
+		std::vector<double> x1, x2;
+		int status1 = qbLSQR<double>(sparseMatVec, sparseRmatVec, A.numRows, A.numCols, b, x1, 1e-10, 2000);
+		int status2 = qbLSMR<double>(sparseMatVec, sparseRmatVec, A.numRows, A.numCols, b, x2, 1e-10, 2000);
+		cout << "LSQR: status = " << status1 << ", ||A'r|| = " << std::scientific << NormalResidual(A, b, x1) << endl;
+		cout << "LSMR: status = " << status2 << ", ||A'r|| = " << NormalResidual(A, b, x2) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing column scaling as a preconditioner (limited to 100 iterations):" << endl;
+		std::vector<double> columnNorm(A.numCols, 0.0);
+		for (size_t k=0; k<A.values.size(); ++k)
+			columnNorm[A.colIndex[k]] += A.values[k] * A.values[k];
+		for (auto &value : columnNorm)
+			value = (value > 0.0) ? sqrt(value) : 1.0;
+		Operator precondition = [&](const std::vector<double> &in, std::vector<double> &out)
+		{
+			for (int j=0; j<A.numCols; ++j)
+				out[j] = in[j] / columnNorm[j];
+		};
+
+		std::vector<double> x1, x2, x3;
+		int status1 = qbLSQR<double>(sparseMatVec, sparseRmatVec, A.numRows, A.numCols, b, x1, 1e-10, 100);
+		int status2 = qbLSQR<double>(sparseMatVec, sparseRmatVec, precondition, precondition, A.numRows, A.numCols, b, x2, 1e-10, 100);
+		int status3 = qbLSMR<double>(sparseMatVec, sparseRmatVec, precondition, precondition, A.numRows, A.numCols, b, x3, 1e-10, 100);
+		cout << "LSQR without preconditioner: status = " << status1 << ", ||A'r|| = " << std::scientific << NormalResidual(A, b, x1) << endl;
+		cout << "LSQR with preconditioner:    status = " << status2 << ", ||A'r|| = " << NormalResidual(A, b, x2) << endl;
+		cout << "LSMR with preconditioner:    status = " << status3 << ", ||A'r|| = " << NormalResidual(A, b, x3) << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing with a zero right hand side:" << endl;
+		std::vector<double> zero(A.numRows, 0.0);
+		std::vector<double> x;
+		int status = qbLSMR<double>(sparseMatVec, sparseRmatVec, A.numRows, A.numCols, zero, x);
+		cout << "Status = " << status << ", ||x|| = " << qbLSQRKernels::Norm(x) << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+/* *************************************************************************************************
+
+	TestCode_qbLU
+
+	  Code to test the LU and Cholesky factorization classes.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbLU.h"
+#include "../qbLinSolve.h"
+
+using namespace std;
+
+// Function to compute max|A*x - b|.
+double Residual(const qbMatrix2<double> &A, const std::vector<double> &x, const std::vector<double> &b)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		double sum = 0.0;
+		for (int j=0; j<A.GetNumCols(); ++j)
+			sum += A.GetElement(i, j) * x[j];
+		maxDiff = std::max(maxDiff, fabs(sum - b[i]));
+	}
+	return maxDiff;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing LU and Cholesky factorization code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing a simple 3x3 matrix (which needs pivoting):" << endl;
+		std::vector<double> simpleData = {0.0, 2.0, 1.0, 1.0, 1.0, 1.0, 2.0, 1.0, 0.0};
+		qbMatrix2<double> A(3, 3, simpleData);
+		std::vector<double> b = {3.0, 3.0, 3.0}, x(3);
+		qbLU<double> lu;
+		int status = lu.Factorize(A);
+		lu.Solve(b.data(), x.data());
+		cout << "Status = " << status << ", x = " << x[0] << ", " << x[1] << ", " << x[2] << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a random 400x400 matrix with several right hand sides:" << endl;
+		int n = 400;
+		qbMatrix2<double> A(n, n);
+		generator.FillUniform(A, -1.0, 1.0);
+		qbLU<double> lu;
+		auto t0 = std::chrono::steady_clock::now();
+		int status = lu.Factorize(A);
+		auto t1 = std::chrono::steady_clock::now();
+		double maxResidual = 0.0;
+		std::vector<double> b(n), x(n);
+		for (int r=0; r<10; ++r)
+		{
+			generator.FillUniform(b.data(), b.size(), -1.0, 1.0);
+			lu.Solve(b.data(), x.data());
+			maxResidual = std::max(maxResidual, Residual(A, x, b));
+		}
+		auto t2 = std::chrono::steady_clock::now();
+		cout << "Status = " << status << std::scientific << ", max residual = " << maxResidual << std::fixed << endl;
+		cout << "Time: factorize = " << std::chrono::duration<double>(t1 - t0).count() << " s, 10 solves = "
+			<< std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+		cout << "Storage = " << lu.GetStorageSize() << " bytes" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a symmetric positive definite 400x400 matrix:" << endl;
+		int n = 400;
+		qbMatrix2<double> X(n, n), A;
+		generator.FillUniform(X, -1.0, 1.0);
+		qbGEMM(X.Transpose(), X, A);
+		for (int i=0; i<n; ++i)
+			A.SetElement(i, i, A.GetElement(i, i) + 1.0);
+		qbCholesky<double> cholesky;
+		int status = cholesky.Factorize(A);
+		std::vector<double> b(n), x(n), xLU(n);
+		generator.FillUniform(b.data(), b.size(), -1.0, 1.0);
+		cholesky.Solve(b.data(), x.data());
+		qbLU<double> lu;
+		lu.Factorize(A);
+		lu.Solve(b.data(), xLU.data());
+		double maxDiff = 0.0;
+		for (int i=0; i<n; ++i)
+			maxDiff = std::max(maxDiff, fabs(x[i] - xLU[i]));
+		cout << "Status = " << status << std::scientific << ", max residual = " << Residual(A, x, b)
+			<< ", max |x - x(LU)| = " << maxDiff << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error handling:" << endl;
+		qbLU<double> lu;
+		qbCholesky<double> cholesky;
+		std::vector<double> singularData = {1.0, 2.0, 3.0, 2.0, 4.0, 6.0, 1.0, 0.0, 1.0};
+		qbMatrix2<double> S(3, 3, singularData);
+		std::vector<double> b = {1.0, 2.0, 3.0}, x(3);
+		cout << "Singular matrix: status = " << lu.Factorize(S) << ", solve = " << (lu.Solve(b.data(), x.data()) ? "True" : "False") << endl;
+		std::vector<double> indefiniteData = {1.0, 2.0, 2.0, 1.0};
+		cout << "Indefinite matrix: status = " << cholesky.Factorize(qbMatrix2<double>(2, 2, indefiniteData)) << endl;
+		std::vector<double> nonSymmetricData = {2.0, 1.0, 0.0, 2.0};
+		cout << "Non-symmetric matrix: status = " << cholesky.Factorize(qbMatrix2<double>(2, 2, nonSymmetricData)) << endl;
+		cout << "Non-square matrix: status = " << lu.Factorize(qbMatrix2<double>(2, 3)) << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -239,6 +239,107 @@ int main()
 	  else
 	  	cout << "Error condition: " << test << endl;
   }  
+  cout << endl;
   
+  // Test the single-pass row echelon form with partial pivoting.
+  cout << "***************************************************************" << endl;
+  cout << "Testing row echelon form with partial pivoting" << endl;
+  cout << "***************************************************************" << endl;
+  cout << endl;
+  {
+  	// A zero in the first pivot position needs a row swap.
+  	std::vector<double> swapData = {0.0, 2.0, 1.0, 4.0, 1.0, -1.0, 2.0, 1.0, 1.0, 3.0, 0.0, 2.0};
+  	qbMatrix2<double> swapMatrix(3, 4, swapData);
+  	qbMatrix2<double> result;
+  	std::vector<int> rowOrder;
+  	int numPivots = swapMatrix.RowEchelon(result, rowOrder);
+  	cout << "Row echelon form (pivots = " << numPivots << ", row order = " << rowOrder[0] << ", " << rowOrder[1] << ", " << rowOrder[2] << "):" << endl;
+  	PrintMatrix(result);
+  	numPivots = swapMatrix.RowEchelon(result, rowOrder, true);
+  	cout << "Reduced row echelon form (pivots = " << numPivots << "):" << endl;
+  	PrintMatrix(result);
+  	cout << endl;
+  	
+  	// A wide matrix with a column that has no pivot, converted in place.
+  	std::vector<double> wideData = {1.0, 2.0, 1.0, 0.0, 1.0, 2.0, 4.0, 3.0, 1.0, 0.0, 3.0, 6.0, 4.0, 1.0, 1.0};
+  	qbMatrix2<double> wideMatrix(3, 5, wideData);
+  	numPivots = wideMatrix.RowEchelon(wideMatrix, rowOrder, true);
+  	cout << "Wide matrix, reduced in place (pivots = " << numPivots << ", rank = " << qbMatrix2<double>(3, 5, wideData).Rank() << "):" << endl;
+  	PrintMatrix(wideMatrix);
+  	cout << endl;
+  	
+  	// A tall matrix.
+  	std::vector<double> tallData = {1.0, 2.0, 2.0, 4.0, 3.0, 6.0, 1.0, 1.0};
+  	qbMatrix2<double> tallMatrix(4, 2, tallData);
+  	cout << "Tall matrix: rank = " << tallMatrix.Rank() << endl;
+  	cout << endl;
+  }
+
+  // Test the direct solution of systems with a known structure.
+  cout << "***************************************************************" << endl;
+  cout << "Testing structured systems" << endl;
+  cout << "***************************************************************" << endl;
+  cout << endl;
+  {
+  	int n = 200;
+  	qbMatrix2<double> upper(n, n), lower(n, n), diagonal(n, n), spd(n, n);
+  	std::vector<double> bData(n);
+  	for (int i=0; i<n; ++i)
+  	{
+  		bData[i] = sin(1.0 + i);
+  		for (int j=0; j<n; ++j)
+  		{
+  			double value = cos(1.0 + i + 2.0 * j) / n;
+  			if (i == j)
+  				value += 2.0;
+  			if (j >= i)
+  				upper.SetElement(i, j, value);
+  			if (j <= i)
+  				lower.SetElement(i, j, value);
+  			if (j == i)
+  				diagonal.SetElement(i, j, value);
+  			spd.SetElement(i, j, ((i == j) ? 4.0 : 0.0) + 1.0 / (1.0 + i + j));
+  		}
+  	}
+  	qbVector<double> b(bData);
+
+  	// A copy of the SPD matrix that has not been tested, so that it is solved by elimination.
+  	qbMatrix2<double> spdGeneral(n, n, spd.GetData());
+  	cout << "Positive definite: " << (spd.IsPositiveDefinite() ? "True" : "False") << endl;
+
+  	const qbMatrix2<double> *matrices[5] = {&upper, &lower, &diagonal, &spd, &spdGeneral};
+  	std::string names[5] = {"Upper triangular", "Lower triangular", "Diagonal", "Positive definite", "Positive definite (by elimination)"};
+  	for (int k=0; k<5; ++k)
+  	{
+  		qbVector<double> solution;
+  		int status = qbLinSolve(*matrices[k], b, solution);
+  		double maxResidual = 0.0;
+  		for (int i=0; i<n; ++i)
+  		{
+  			double residual = -b.GetElement(i);
+  			for (int j=0; j<n; ++j)
+  				residual += matrices[k]->GetElement(i, j) * solution.GetElement(j);
+  			maxResidual = std::max(maxResidual, fabs(residual));
+  		}
+  		cout << names[k] << ": status = " << status << ", max residual = " << std::scientific << maxResidual << std::fixed
+  			<< ", known properties = " << matrices[k]->GetKnownProperties() << endl;
+  	}
+
+  	// A zero on the diagonal of a triangular matrix is left to the elimination to classify.
+  	upper.SetElement(n-1, n-1, 0.0);
+  	qbVector<double> solution;
+  	cout << "Singular upper triangular: status = " << qbLinSolve(upper, b, solution) << endl;
+
+  	// Small off-diagonal elements are not zero, so this is not treated as a diagonal matrix.
+  	std::vector<double> smallData = {1e-8, 5e-10, 5e-10, 1e-8};
+  	qbMatrix2<double> small(2, 2, smallData);
+  	qbVector<double> ones(std::vector<double>{1.0, 1.0});
+  	int status = qbLinSolve(small, ones, solution);
+  	cout << "Small 2x2 matrix: diagonal = " << (small.IsDiagonal() ? "True" : "False") << ", status = " << status
+  		<< ", x = " << std::scientific << solution.GetElement(0) << ", " << solution.GetElement(1) << " (expected " << 1.0 / 1.05e-8
+  		<< ")" << std::fixed << endl;
+  	cout << endl;
+  }
+
 	return 0;
 }   
@@ -124,6 +124,21 @@ int main()
 			cout << "And the final eigenvectors are:" << endl;
 			eigenvectors2.PrintMatrix();
 			
+			// Test warm-starting from the previous components.
+			cout << endl;
+			cout << "Testing warm-started PCA on slightly perturbed data..." << endl;
+			qbMatrix2<double> X3 = X;
+			for (int i=0; i<X3.GetNumRows(); ++i)
+				X3.SetElement(i, 0, X3.GetElement(i, 0) * 1.01);
+			qbMatrix2<double> coldComponents, warmComponents;
+			int coldResult = qbPCA::qbPCA(X3, coldComponents);
+			int warmResult = qbPCA::qbPCA(X3, warmComponents, eigenvectors2);
+			cout << "coldResult = " << coldResult << ", warmResult = " << warmResult << endl;
+			cout << "Warm-started eigenvectors are:" << endl;
+			warmComponents.PrintMatrix();
+			cout << "Cold-started eigenvectors are:" << endl;
+			coldComponents.PrintMatrix();
+			
 			// Test dimensionality reduction.
 			cout << endl;
 			cout << "Testing dimensionality reduction." << endl;
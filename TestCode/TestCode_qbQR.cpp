@@ -29,13 +29,32 @@
 #include <vector>
 #include <random>
 #include <fstream>
+#include <chrono>
 
 #include "../qbMatrix.h"
 #include "../qbVector.h"
 #include "../qbQR.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
 
 using namespace std;
 
+// Function to compute max|Q*R - A| and max|Q'*Q - I|.
+void QRErrors(const qbMatrix2<double> &A, const qbMatrix2<double> &Q, const qbMatrix2<double> &R, double &residual, double &orthogonality)
+{
+	qbMatrix2<double> QR, QtQ;
+	qbGEMM(Q, R, QR);
+	qbGEMM(Q.Transpose(), Q, QtQ);
+	residual = 0.0;
+	orthogonality = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+		for (int j=0; j<A.GetNumCols(); ++j)
+			residual = std::max(residual, fabs(QR.GetElement(i, j) - A.GetElement(i, j)));
+	for (int i=0; i<QtQ.GetNumRows(); ++i)
+		for (int j=0; j<QtQ.GetNumCols(); ++j)
+			orthogonality = std::max(orthogonality, fabs(QtQ.GetElement(i, j) - ((i == j) ? 1.0 : 0.0)));
+}
+
 int main()
 {
 	cout << "**********************************************" << endl;
@@ -178,5 +197,210 @@ int main()
 		cout << endl;		
 	}	
 	
+	{
+		cout << "Testing thin QR with a 6x3 matrix:" << endl;
+		std::vector<double> simpleData = {1, 2, 3, 4, 5, 6, 7, 8, 10, 2, 1, 1, 3, 5, 2, 9, 1, 4};
+		qbMatrix2<double> testMatrix(6, 3, simpleData);
+		testMatrix.PrintMatrix();
+		cout << endl;
+		cout << "Computing thin QR decomposition..." << endl;
+		qbMatrix2<double> Q, R;
+		int status = qbQRThin(testMatrix, Q, R);
+		cout << "Status = " << status << endl;
+		cout << "R = " << endl;
+		R.PrintMatrix();
+		cout << endl;
+		cout << "Q'Q = " << endl;
+		qbMatrix2<double> QtQ = Q.Transpose() * Q;
+		QtQ.PrintMatrix();
+		cout << endl;
+		cout << "QR = " << endl;
+		qbMatrix2<double> QR = Q*R;
+		QR.PrintMatrix();
+		cout << endl;
+	}
+	
+	{
+		cout << "Testing the compact WY form against applying the reflectors one at a time:" << endl;
+		qbRandom generator(2021);
+		int m = 100, k = 20, n = 30;
+		qbMatrix2<double> A(m, k), C(m, n);
+		generator.FillUniform(A, -1.0, 1.0);
+		generator.FillUniform(C, -1.0, 1.0);
+		std::vector<double> tau(k);
+		qbHouseholderKernels::QRFactor(m, k, A.GetData(), k, tau.data());
+		std::vector<double> V((size_t)m*k), Tm((size_t)k*k);
+		qbHouseholderKernels::ExtractV(m, k, A.GetData(), k, V.data());
+		qbHouseholderKernels::FormT(m, k, V.data(), tau.data(), Tm.data());
+
+		// H(0)*H(1)*...*H(k-1)*C, with the last reflector applied first.
+		qbMatrix2<double> reference = C;
+		for (int j=k-1; j>=0; --j)
+		{
+			for (int c=0; c<n; ++c)
+			{
+				double dot = 0.0;
+				for (int i=0; i<m; ++i)
+					dot += V[(size_t)i*k + j] * reference.GetElement(i, c);
+				for (int i=0; i<m; ++i)
+					reference.SetElement(i, c, reference.GetElement(i, c) - tau[j] * V[(size_t)i*k + j] * dot);
+			}
+		}
+		qbHouseholderKernels::ApplyBlockLeft(m, n, k, V.data(), Tm.data(), false, C.GetData(), n);
+		double maxDiff = 0.0;
+		for (int i=0; i<m; ++i)
+			for (int j=0; j<n; ++j)
+				maxDiff = std::max(maxDiff, fabs(C.GetElement(i, j) - reference.GetElement(i, j)));
+		cout << "Max difference = " << std::scientific << maxDiff << std::fixed << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing the blocked Hessenberg reduction against one reflector at a time:" << endl;
+		qbRandom generator(2021);
+		for (int n : {5, 32, 100, 300})
+		{
+			qbMatrix2<double> A(n, n);
+			generator.FillUniform(A, -1.0, 1.0);
+			qbMatrix2<double> reference = A;
+			double* a = reference.GetData();
+			std::vector<double> v(n);
+			for (int k=0; k<n-2; ++k)
+			{
+				// H = I - tau*v*v' from both sides, to rows and columns k+1 to n-1.
+				int len = n - k - 1;
+				double tau = qbHouseholderKernels::MakeReflector(len, a + (size_t)(k+1)*n + k, n, v.data());
+				for (int j=k+1; j<n; ++j)
+				{
+					double dot = 0.0;
+					for (int i=0; i<len; ++i)
+						dot += v[i] * a[(size_t)(k+1+i)*n + j];
+					for (int i=0; i<len; ++i)
+						a[(size_t)(k+1+i)*n + j] -= tau * v[i] * dot;
+				}
+				for (int r=0; r<n; ++r)
+				{
+					double dot = 0.0;
+					for (int i=0; i<len; ++i)
+						dot += a[(size_t)r*n + k+1+i] * v[i];
+					for (int i=0; i<len; ++i)
+						a[(size_t)r*n + k+1+i] -= tau * dot * v[i];
+				}
+			}
+
+			auto t0 = std::chrono::steady_clock::now();
+			qbHouseholderKernels::ReduceToHessenberg(n, A.GetData());
+			auto t1 = std::chrono::steady_clock::now();
+			double maxDiff = 0.0, maxLower = 0.0;
+			for (int i=0; i<n; ++i)
+			{
+				for (int j=0; j<n; ++j)
+				{
+					maxDiff = std::max(maxDiff, fabs(A.GetElement(i, j) - reference.GetElement(i, j)));
+					if (j < i-1)
+						maxLower = std::max(maxLower, fabs(A.GetElement(i, j)));
+				}
+			}
+			cout << n << "x" << n << ": max difference = " << std::scientific << maxDiff << ", max |H| below the subdiagonal = " << maxLower
+				<< std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing the blocked factorization on larger matrices:" << endl;
+		qbRandom generator(2021);
+		std::vector<int> rows = {300, 2000, 77};
+		std::vector<int> cols = {300, 200, 77};
+		for (int t=0; t<3; ++t)
+		{
+			qbMatrix2<double> A(rows[t], cols[t]), Q, R;
+			generator.FillUniform(A, -1.0, 1.0);
+			auto t0 = std::chrono::steady_clock::now();
+			int status = (rows[t] == cols[t]) ? qbQR(A, Q, R) : qbQRThin(A, Q, R);
+			auto t1 = std::chrono::steady_clock::now();
+			double residual, orthogonality;
+			QRErrors(A, Q, R, residual, orthogonality);
+			bool upperTriangular = true;
+			for (int i=0; i<R.GetNumRows(); ++i)
+				for (int j=0; j<i; ++j)
+					upperTriangular = upperTriangular && (R.GetElement(i, j) == 0.0);
+			cout << rows[t] << "x" << cols[t] << ": status = " << status << ", max |QR - A| = " << std::scientific << residual
+				<< ", max |Q'Q - I| = " << orthogonality << std::fixed << ", R upper triangular: " << (upperTriangular ? "True." : "False.")
+				<< " Time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		}
+		cout << endl;
+	}
+	
+	{
+		cout << "Testing CholeskyQR2 on 2000x50 matrices with given condition numbers:" << endl;
+		qbRandom generator(2021);
+		int m = 2000, n = 50;
+		qbMatrix2<double> U, V, Rdummy, G1(m, n), G2(n, n);
+		generator.FillUniform(G1, -1.0, 1.0);
+		generator.FillUniform(G2, -1.0, 1.0);
+		qbQRThin(G1, U, Rdummy);
+		qbQR(G2, V, Rdummy);
+		std::vector<std::string> names = {"Householder", "CholeskyQR2", "Shifted CholeskyQR3"};
+		std::vector<double> conditions = {1e2, 1e6, 1e10, 1e12, 1e16};
+		for (double condition : conditions)
+		{
+			// A = U*diag(s)*V', with singular values spaced logarithmically from 1 to 1/condition.
+			qbMatrix2<double> US = U, A;
+			for (int j=0; j<n; ++j)
+			{
+				double sigma = pow(condition, -static_cast<double>(j) / (n - 1));
+				for (int i=0; i<m; ++i)
+					US.SetElement(i, j, US.GetElement(i, j) * sigma);
+			}
+			qbGEMM(US, V.Transpose(), A);
+
+			std::vector<double> q((size_t)m*n), r((size_t)n*n);
+			int method = qbQRKernels::CholeskyQR(m, n, A.GetData(), q.data(), r.data());
+			double residual, orthogonality;
+			QRErrors(A, qbMatrix2<double>(m, n, q), qbMatrix2<double>(n, n, r), residual, orthogonality);
+			cout << "cond(A) = " << std::scientific << std::setprecision(0) << condition << std::setprecision(3) << ": method = " << names[method - 1]
+				<< ", max |QR - A| = " << residual << ", max |Q'Q - I| = " << orthogonality << std::fixed << endl;
+		}
+
+		/* A = U*K with K upper triangular, a unit diagonal and -0.5 above it. cond(A) grows
+			like 1.5^n, but the diagonal of its R factor is all ones. */
+		qbMatrix2<double> K(n, n), A;
+		for (int i=0; i<n; ++i)
+			for (int j=i; j<n; ++j)
+				K.SetElement(i, j, (i == j) ? 1.0 : -0.5);
+		qbGEMM(U, K, A);
+		std::vector<double> q((size_t)m*n), r((size_t)n*n);
+		int method = qbQRKernels::CholeskyQR(m, n, A.GetData(), q.data(), r.data());
+		double residual, orthogonality;
+		QRErrors(A, qbMatrix2<double>(m, n, q), qbMatrix2<double>(n, n, r), residual, orthogonality);
+		cout << "Unit diagonal R, cond(A) = " << std::scientific << std::setprecision(3) << qbQRKernels::EstimateCondition(n, K.GetData(), 20)
+			<< ": method = " << names[method - 1] << ", max |QR - A| = " << residual << ", max |Q'Q - I| = " << orthogonality << std::fixed << endl;
+
+		qbMatrix2<double> Q, R;
+		cout << "Invalid method: status = " << qbQRThin(U, Q, R, 7) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a 100000x50 matrix (timing):" << endl;
+		qbRandom generator(2021);
+		qbMatrix2<double> A(100000, 50), Q, R;
+		generator.FillUniform(A, -1.0, 1.0);
+		std::vector<int> methods = {QBQR_HOUSEHOLDER, QBQR_CHOLESKYQR2};
+		std::vector<std::string> names = {"Householder", "CholeskyQR2"};
+		for (int i=0; i<2; ++i)
+		{
+			auto t0 = std::chrono::steady_clock::now();
+			int status = qbQRThin(A, Q, R, methods[i]);
+			auto t1 = std::chrono::steady_clock::now();
+			double residual, orthogonality;
+			QRErrors(A, Q, R, residual, orthogonality);
+			cout << names[i] << ": status = " << status << ", max |QR - A| = " << std::scientific << residual << ", max |Q'Q - I| = " << orthogonality
+				<< std::fixed << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		}
+		cout << endl;
+	}
+	
 	return 0;
 }
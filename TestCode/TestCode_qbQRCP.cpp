@@ -0,0 +1,187 @@
+/* *************************************************************************************************
+
+	TestCode_qbQRCP
+
+	  Code to test the QR decomposition with column pivoting.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbQR.h"
+#include "../qbQRCP.h"
+
+using namespace std;
+
+// Function to compute max|A - B|.
+double MaxAbsDiff(const qbMatrix2<double> &A, const qbMatrix2<double> &B)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(A.GetElement(i, j) - B.GetElement(i, j)));
+	}
+	return maxDiff;
+}
+
+// Function to test one factorization, and return the number of |R(i,i)| above tol * |R(0,0)|.
+int TestQRCP(const std::string &name, const qbMatrix2<double> &A, int method, double tol = 1e-10)
+{
+	qbMatrix2<double> Q, R;
+	std::vector<int> order;
+	int status = qbQRCP(A, Q, R, order, method);
+
+	// Check that order is a permutation, and form A*P.
+	int m = A.GetNumRows(), n = A.GetNumCols(), k = std::min(m, n);
+	std::vector<int> count(n, 0);
+	bool isPermutation = (int(order.size()) == n);
+	qbMatrix2<double> AP(m, n);
+	for (int j=0; j<n && isPermutation; ++j)
+	{
+		isPermutation = (order[j] >= 0) && (order[j] < n) && (++count[order[j]] == 1);
+		for (int i=0; i<m && isPermutation; ++i)
+			AP.SetElement(i, j, A.GetElement(i, order[j]));
+	}
+
+	qbMatrix2<double> QR, QtQ;
+	qbGEMM(Q, R, QR);
+	qbGEMM(Q.Transpose(), Q, QtQ);
+	qbMatrix2<double> I(k, k);
+	I.SetToIdentity();
+
+	// Count the steps where |R(i,i)| increases, and the numerical rank.
+	int increases = 0, rank = 0;
+	for (int i=0; i<k; ++i)
+	{
+		if ((i > 0) && (fabs(R.GetElement(i, i)) > fabs(R.GetElement(i-1, i-1)) * (1.0 + 1e-12)))
+			++increases;
+		if (fabs(R.GetElement(i, i)) > tol * fabs(R.GetElement(0, 0)))
+			++rank;
+	}
+	cout << name << ": status = " << status << ", permutation = " << (isPermutation ? "True" : "False") << std::scientific
+		<< ", max |QR - AP| = " << MaxAbsDiff(QR, AP) << ", max |Q'Q - I| = " << MaxAbsDiff(QtQ, I) << std::fixed
+		<< ", increases in |R(i,i)| = " << increases << ", rank = " << rank << endl;
+	return rank;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing QR decomposition with column pivoting." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing a simple 4x4 matrix:" << endl;
+		std::vector<double> simpleData = {1.0, 10.0, 0.0, 2.0,
+			1.0, 10.0, 0.0, -2.0,
+			1.0, 10.0, 3.0, 2.0,
+			1.0, 10.0, 0.0, -2.0};
+		qbMatrix2<double> A(4, 4, simpleData);
+		qbMatrix2<double> Q, R;
+		std::vector<int> order;
+		qbQRCP(A, Q, R, order);
+		cout << "Column order = " << order[0] << ", " << order[1] << ", " << order[2] << ", " << order[3] << endl;
+		cout << "R = " << endl;
+		R.PrintMatrix();
+		TestQRCP("QP3", A, QBQRCP_QP3);
+		cout << "Invalid method: status = " << qbQRCP(A, Q, R, order, 0) << endl;
+		cout << endl;
+	}
+
+	{
+		// The randomized method chooses a block of pivots at a time, so |R(i,i)| need not decrease within a block.
+		cout << "Testing random matrices:" << endl;
+		int sizes[3][2] = {{300, 200}, {150, 400}, {37, 37}};
+		for (int s=0; s<3; ++s)
+		{
+			qbMatrix2<double> A(sizes[s][0], sizes[s][1]);
+			generator.FillUniform(A, -1.0, 1.0);
+			std::string size = std::to_string(sizes[s][0]) + "x" + std::to_string(sizes[s][1]);
+			TestQRCP("QP3 " + size, A, QBQRCP_QP3);
+			TestQRCP("Randomized " + size, A, QBQRCP_RANDOMIZED);
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing rank revealing (500x300 matrix of rank 50):" << endl;
+		qbMatrix2<double> X(500, 50), Y(50, 300), A;
+		generator.FillUniform(X, -1.0, 1.0);
+		generator.FillUniform(Y, -1.0, 1.0);
+		qbGEMM(X, Y, A);
+		TestQRCP("QP3", A, QBQRCP_QP3);
+		TestQRCP("Randomized", A, QBQRCP_RANDOMIZED);
+		cout << endl;
+	}
+
+	{
+		/* Singular values from 1 down to 1e-14: the column norms fall quickly, so the downdated
+			norms lose their accuracy and have to be recomputed. */
+		cout << "Testing norm downdating (400x200 matrix, singular values from 1 to 1e-14):" << endl;
+		int m = 400, n = 200;
+		qbMatrix2<double> U0(m, n), V0(n, n), U, R, V, Vt;
+		generator.FillUniform(U0, -1.0, 1.0);
+		generator.FillUniform(V0, -1.0, 1.0);
+		qbQRThin(U0, U, R);
+		qbQR(V0, V, R);
+		Vt = V.Transpose();
+		for (int i=0; i<m; ++i)
+		{
+			for (int j=0; j<n; ++j)
+				U.SetElement(i, j, U.GetElement(i, j) * pow(10.0, -14.0 * j / (n - 1)));
+		}
+		qbMatrix2<double> A;
+		qbGEMM(U, Vt, A);
+		TestQRCP("QP3", A, QBQRCP_QP3, 1e-20);
+		TestQRCP("Randomized", A, QBQRCP_RANDOMIZED, 1e-20);
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a 1200x600 matrix (timing):" << endl;
+		int m = 1200, n = 600;
+		qbMatrix2<double> A(m, n), Q, R;
+		generator.FillUniform(A, -1.0, 1.0);
+		std::vector<int> order;
+
+		auto t0 = std::chrono::steady_clock::now();
+		qbQRThin(A, Q, R);
+		auto t1 = std::chrono::steady_clock::now();
+		qbQRCP(A, Q, R, order, QBQRCP_QP3);
+		auto t2 = std::chrono::steady_clock::now();
+		qbQRCP(A, Q, R, order, QBQRCP_RANDOMIZED);
+		auto t3 = std::chrono::steady_clock::now();
+		cout << "Time: qbQRThin = " << std::chrono::duration<double>(t1 - t0).count()
+			<< " s, QP3 = " << std::chrono::duration<double>(t2 - t1).count()
+			<< " s, randomized = " << std::chrono::duration<double>(t3 - t2).count() << " s" << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+/* *************************************************************************************************
+
+	TestCode_qbRandom
+
+	  Code to test the random matrix and vector generation code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+
+using namespace std;
+
+// Function to compute the mean and variance of a set of values.
+void MeanAndVariance(const std::vector<double> &values, double &mean, double &variance)
+{
+	mean = 0.0;
+	for (auto value : values)
+		mean += value;
+	mean /= values.size();
+
+	variance = 0.0;
+	for (auto value : values)
+		variance += (value - mean) * (value - mean);
+	variance /= (values.size() - 1);
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing random number generation code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	{
+		cout << "Testing Philox4x32-10 against the published known-answer tests:" << endl;
+		uint32_t counter1[4] = {0, 0, 0, 0};
+		uint32_t key1[2] = {0, 0};
+		uint32_t counter2[4] = {0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff};
+		uint32_t key2[2] = {0xffffffff, 0xffffffff};
+		uint32_t expected1[4] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+		uint32_t expected2[4] = {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd};
+		uint32_t output1[4], output2[4];
+		qbRandom::Philox(counter1, key1, output1);
+		qbRandom::Philox(counter2, key2, output2);
+		bool match = true;
+		for (int i=0; i<4; ++i)
+			match = match && (output1[i] == expected1[i]) && (output2[i] == expected2[i]);
+		cout << "Known answers match: " << (match ? "True." : "False.") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing reproducibility (same seed, same result):" << endl;
+		qbMatrix2<double> A(3, 4);
+		qbMatrix2<double> B(3, 4);
+		qbRandom generator1(42);
+		qbRandom generator2(42);
+		generator1.FillUniform(A);
+		generator2.FillUniform(B);
+		A.PrintMatrix();
+		cout << "A == B: " << (A == B) << endl;
+
+		cout << "Next fill from the same generator:" << endl;
+		generator1.FillUniform(A);
+		A.PrintMatrix();
+		cout << endl;
+	}
+
+	{
+		cout << "Testing that the result does not depend on how the fill is split:" << endl;
+		// One large (multi-threaded) fill against several smaller sequential fills.
+		int numElements = 1 << 20;
+		std::vector<double> oneFill(numElements);
+		std::vector<double> manyFills(numElements);
+		qbRandom generator1(7, 3);
+		qbRandom generator2(7, 3);
+		generator1.FillGaussian(oneFill.data(), numElements, 0.0, 1.0);
+		int chunkSize = 1000;
+		for (int start=0; start<numElements; start+=chunkSize)
+		{
+			int count = std::min(chunkSize, numElements - start);
+			generator2.FillGaussian(manyFills.data() + start, count, 0.0, 1.0);
+		}
+		cout << "Fills identical: " << (oneFill == manyFills ? "True." : "False.") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing distributions (1,000,000 samples each):" << endl;
+		int numElements = 1000000;
+		std::vector<double> values(numElements);
+		double mean, variance;
+		qbRandom generator(2021);
+
+		generator.FillUniform(values.data(), numElements, -1.0, 1.0);
+		MeanAndVariance(values, mean, variance);
+		cout << "Uniform(-1, 1):    mean = " << std::setprecision(4) << mean << ", variance = " << variance << " (expected 0, 0.3333)" << endl;
+
+		generator.FillGaussian(values.data(), numElements, 2.0, 3.0);
+		MeanAndVariance(values, mean, variance);
+		cout << "Gaussian(2, 3):    mean = " << mean << ", variance = " << variance << " (expected 2, 9)" << endl;
+
+		generator.FillRademacher(values.data(), numElements);
+		MeanAndVariance(values, mean, variance);
+		cout << "Rademacher:        mean = " << mean << ", variance = " << variance << " (expected 0, 1)" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing vector fill (Rademacher, 10 elements):" << endl;
+		qbVector<float> v(10);
+		qbRandom generator(1);
+		generator.FillRademacher(v);
+		for (int i=0; i<v.GetNumDims(); ++i)
+			cout << v.GetElement(i) << " ";
+		cout << endl << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,171 @@
+/* *************************************************************************************************
+
+	TestCode_qbReorder
+
+	  Code to test the sparse matrix reordering and graph partitioning code.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <numeric>
+#include <chrono>
+
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbSparse.h"
+#include "../qbReorder.h"
+
+using namespace std;
+
+// Function to build the 5-point Laplacian on an n x n grid.
+qbSparseMatrix<double> Poisson2D(int n)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=0; j<n; ++j)
+		{
+			int row = i*n + j;
+			rows.push_back(row); cols.push_back(row); values.push_back(4.0);
+			if (i > 0)		{ rows.push_back(row); cols.push_back(row - n); values.push_back(-1.0); }
+			if (i < n-1)	{ rows.push_back(row); cols.push_back(row + n); values.push_back(-1.0); }
+			if (j > 0)		{ rows.push_back(row); cols.push_back(row - 1); values.push_back(-1.0); }
+			if (j < n-1)	{ rows.push_back(row); cols.push_back(row + 1); values.push_back(-1.0); }
+		}
+	}
+	return qbSparseMatrix<double>(n*n, n*n, rows, cols, values);
+}
+
+// Function to generate a random permutation.
+std::vector<int> RandomPermutation(int n, qbRandom &generator)
+{
+	std::vector<int> perm(n);
+	std::iota(perm.begin(), perm.end(), 0);
+	for (int i=n-1; i>0; --i)
+		std::swap(perm[i], perm[std::min(static_cast<int>(generator.Uniform() * (i + 1)), i)]);
+	return perm;
+}
+
+// Function to time repeated sparse matrix-vector products.
+double TimeSpMV(const qbSparseMatrix<double> &A, int numProducts)
+{
+	std::vector<double> x(A.GetNumCols(), 1.0), y;
+	auto t0 = std::chrono::steady_clock::now();
+	for (int k=0; k<numProducts; ++k)
+		A.Multiply(x, y);
+	auto t1 = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(t1 - t0).count();
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing reordering and partitioning code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+	int n = 500;
+	qbSparseMatrix<double> A = Poisson2D(n);
+
+	{
+		cout << "Testing RCM on a randomly ordered 2D Poisson matrix (500x500 grid):" << endl;
+		qbSparseMatrix<double> shuffled, reordered;
+		qbPermuteSymmetric(A, RandomPermutation(n*n, generator), shuffled);
+		std::vector<int> perm;
+		int status = qbReorderRCM(shuffled, perm);
+		qbPermuteSymmetric(shuffled, perm, reordered);
+		cout << "Status = " << status << endl;
+		cout << "Bandwidth: natural = " << qbBandwidth(A) << ", shuffled = " << qbBandwidth(shuffled) << ", RCM = " << qbBandwidth(reordered) << endl;
+		cout << "Time for 50 products: shuffled = " << TimeSpMV(shuffled, 50) << " s, RCM = " << TimeSpMV(reordered, 50) << " s" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing the multilevel partitioner (8 parts) against splitting the rows into blocks:" << endl;
+		int numParts = 8;
+		std::vector<int> part;
+		auto t0 = std::chrono::steady_clock::now();
+		int status = qbPartitionGraph(A, numParts, part);
+		auto t1 = std::chrono::steady_clock::now();
+		std::vector<int> blockPart(n*n);
+		for (int i=0; i<n*n; ++i)
+			blockPart[i] = (static_cast<long long>(i) * numParts) / (n*n);
+
+		std::vector<int> perm, partStart;
+		qbPartitionPermutation(part, numParts, perm, partStart);
+		int largest = 0;
+		for (int p=0; p<numParts; ++p)
+			largest = std::max(largest, partStart[p+1] - partStart[p]);
+		cout << "Status = " << status << ", time = " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << "Edge cut: partitioner = " << qbEdgeCut(A, part) << ", row blocks = " << qbEdgeCut(A, blockPart) << endl;
+		cout << "Largest part / average part = " << std::setprecision(4) << static_cast<double>(largest) * numParts / (n*n) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing that permuted matrices and vectors are consistent:" << endl;
+		qbSparseMatrix<double> B;
+		std::vector<int> perm = RandomPermutation(n*n, generator);
+		qbPermuteSymmetric(A, perm, B);
+		qbVector<double> x(n*n);
+		generator.FillUniform(x);
+		qbVector<double> px, pAx, Bpx, back;
+		qbPermute(x, perm, px);
+		qbPermute(A * x, perm, pAx);
+		Bpx = B * px;
+		qbInversePermute(px, perm, back);
+		double maxDiff1 = 0.0, maxDiff2 = 0.0;
+		for (int i=0; i<n*n; ++i)
+		{
+			maxDiff1 = std::max(maxDiff1, fabs(Bpx.GetElement(i) - pAx.GetElement(i)));
+			maxDiff2 = std::max(maxDiff2, fabs(back.GetElement(i) - x.GetElement(i)));
+		}
+		cout << "max |B*(P*x) - P*(A*x)| = " << maxDiff1 << endl;
+		cout << "max |inv(P)*(P*x) - x| = " << maxDiff2 << endl;
+
+		// The same, in place.
+		qbVector<double> inPlace = x;
+		qbPermute(inPlace, perm, inPlace);
+		double maxDiff3 = 0.0;
+		for (int i=0; i<n*n; ++i)
+			maxDiff3 = std::max(maxDiff3, fabs(inPlace.GetElement(i) - px.GetElement(i)));
+		qbInversePermute(inPlace, perm, inPlace);
+		double maxDiff4 = 0.0;
+		for (int i=0; i<n*n; ++i)
+			maxDiff4 = std::max(maxDiff4, fabs(inPlace.GetElement(i) - x.GetElement(i)));
+		cout << "In place: max |P*x - (P*x)| = " << maxDiff3 << ", max |inv(P)*(P*x) - x| = " << maxDiff4 << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error handling:" << endl;
+		std::vector<int> badPerm(n*n, 0);
+		qbSparseMatrix<double> B;
+		std::vector<int> part;
+		cout << "Invalid permutation: status = " << qbPermuteSymmetric(A, badPerm, B) << endl;
+		cout << "Invalid number of parts: status = " << qbPartitionGraph(A, 0, part) << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
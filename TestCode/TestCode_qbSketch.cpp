@@ -0,0 +1,152 @@
+/* *************************************************************************************************
+
+	TestCode_qbSketch
+
+	  Code to test the sketching operators and the randomized least squares solvers.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbLSQ.h"
+#include "../qbSketch.h"
+
+using namespace std;
+
+// Function to compute the residual norm ||X*beta - y||.
+double ResidualNorm(const qbMatrix2<double> &X, const qbVector<double> &y, const qbVector<double> &beta)
+{
+	qbVector<double> r = X * beta - y;
+	return r.norm();
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing sketching and randomized least squares code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	// An ill-conditioned 4000 x 20 test problem, y = X*beta + noise.
+	int numRows = 4000;
+	int numCols = 20;
+	qbRandom generator(2021);
+	qbMatrix2<double> X(numRows, numCols);
+	generator.FillGaussian(X);
+	for (int i=0; i<numRows; ++i)
+	{
+		for (int j=0; j<numCols; ++j)
+			X.SetElement(i, j, X.GetElement(i, j) * pow(10.0, -4.0 * j / (numCols - 1)));
+	}
+	qbVector<double> trueBeta(numCols);
+	generator.FillUniform(trueBeta, -1.0, 1.0);
+	qbVector<double> noise(numRows);
+	generator.FillGaussian(noise, 0.0, 1e-3);
+	qbVector<double> y = X * trueBeta + noise;
+
+	// Reference solution from qbLSQ.
+	qbVector<double> reference(numCols);
+	qbLSQ(X, y, reference);
+	double referenceResidual = ResidualNorm(X, y, reference);
+	cout << "Reference residual (qbLSQ) = " << std::scientific << referenceResidual << std::fixed << endl;
+	cout << endl;
+
+	{
+		cout << "Testing that each sketch approximately preserves norms in the column space:" << endl;
+		std::vector<int> sketchTypes = {QBSKETCH_GAUSSIAN, QBSKETCH_SRHT, QBSKETCH_COUNTSKETCH};
+		std::vector<std::string> sketchNames = {"Gaussian", "SRHT", "CountSketch"};
+		for (int t=0; t<3; ++t)
+		{
+			qbMatrix2<double> SX;
+			int status = qbSketch(sketchTypes[t], X, 400, SX);
+			qbVector<double> Xb = X * trueBeta;
+			qbVector<double> SXb = SX * trueBeta;
+			cout << sketchNames[t] << ": status = " << status << ", size = " << SX.GetNumRows() << "x" << SX.GetNumCols()
+				<< ", ||SXb|| / ||Xb|| = " << std::setprecision(4) << SXb.norm() / Xb.norm() << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing reproducibility (same seed, same sketch):" << endl;
+		qbMatrix2<double> S1, S2;
+		qbSketchSRHT(X, 100, S1, 99);
+		qbSketchSRHT(X, 100, S2, 99);
+		cout << "S1 == S2: " << (S1 == S2) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing sketch-and-solve:" << endl;
+		qbVector<double> beta;
+		int status = qbLSQSketchSolve(X, y, beta);
+		cout << "Status = " << status << endl;
+		cout << "Residual / reference residual = " << std::setprecision(4) << ResidualNorm(X, y, beta) / referenceResidual << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing sketch-and-precondition with each sketch type:" << endl;
+		std::vector<int> sketchTypes = {QBSKETCH_GAUSSIAN, QBSKETCH_SRHT, QBSKETCH_COUNTSKETCH};
+		std::vector<std::string> sketchNames = {"Gaussian", "SRHT", "CountSketch"};
+		std::vector<int> sketchSizes = {0, 0, 400};
+		for (int t=0; t<3; ++t)
+		{
+			qbVector<double> beta;
+			int status = qbLSQSketchPrecondition(X, y, beta, sketchTypes[t], sketchSizes[t]);
+			cout << sketchNames[t] << ": status = " << status << ", residual / reference residual = "
+				<< std::setprecision(10) << ResidualNorm(X, y, beta) / referenceResidual << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error handling:" << endl;
+		qbVector<double> beta;
+		cout << "Sketch size too small: status = " << qbLSQSketchSolve(X, y, beta, QBSKETCH_GAUSSIAN, 10) << endl;
+		cout << "Unknown sketch type: status = " << qbLSQSketchSolve(X, y, beta, 99) << endl;
+		qbMatrix2<double> Xd = X;
+		for (int i=0; i<numRows; ++i)
+			Xd.SetElement(i, 1, 2.0 * Xd.GetElement(i, 0));
+		cout << "Rank deficient: status = " << qbLSQSketchSolve(Xd, y, beta) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Timing a 100000x50 problem:" << endl;
+		qbMatrix2<double> A(100000, 50);
+		qbVector<double> b(100000);
+		generator.FillGaussian(A);
+		generator.FillGaussian(b);
+		qbVector<double> beta;
+		auto t0 = std::chrono::steady_clock::now();
+		qbLSQSketchPrecondition(A, b, beta);
+		auto t1 = std::chrono::steady_clock::now();
+		cout << "qbLSQSketchPrecondition: " << std::chrono::duration<double>(t1 - t0).count() << " s" << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
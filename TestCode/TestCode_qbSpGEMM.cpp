@@ -0,0 +1,156 @@
+/* *************************************************************************************************
+
+	TestCode_qbSpGEMM
+
+	  Code to test the sparse matrix-matrix product functions.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbRandom.h"
+#include "../qbSparse.h"
+#include "../qbSpGEMM.h"
+
+using namespace std;
+
+// Function to generate a random sparse matrix with numPerRow entries in each row.
+qbSparseMatrix<double> RandomSparse(int numRows, int numCols, int numPerRow, qbRandom &generator)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<numRows; ++i)
+	{
+		for (int k=0; k<numPerRow; ++k)
+		{
+			rows.push_back(i);
+			cols.push_back(static_cast<int>(generator.Uniform() * numCols));
+			values.push_back(generator.Uniform() * 2.0 - 1.0);
+		}
+	}
+	return qbSparseMatrix<double>(numRows, numCols, rows, cols, values);
+}
+
+// Function to compute the largest absolute difference between two sparse matrices (NaN if the patterns differ).
+double MaxAbsDiff(const qbSparseMatrix<double> &A, const qbSparseMatrix<double> &B)
+{
+	if (!A.SamePattern(B))
+		return NAN;
+	double maxDiff = 0.0;
+	for (int k=0; k<A.GetNumNonZeros(); ++k)
+		maxDiff = std::max(maxDiff, fabs(A.GetValues()[k] - B.GetValues()[k]));
+	return maxDiff;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing sparse matrix-matrix products." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing C = A*B against the sequential product (2000x1500 times 1500x1800):" << endl;
+		qbSparseMatrix<double> A = RandomSparse(2000, 1500, 6, generator);
+		qbSparseMatrix<double> B = RandomSparse(1500, 1800, 8, generator);
+		qbSparseMatrix<double> reference = A * B;
+		std::vector<int> accumulators = {QBSPGEMM_AUTO, QBSPGEMM_DENSE, QBSPGEMM_HASH};
+		std::vector<std::string> names = {"Auto ", "Dense", "Hash "};
+		for (int a=0; a<3; ++a)
+		{
+			qbSparseMatrix<double> C;
+			int status = qbSpGEMM(A, B, C, accumulators[a]);
+			cout << names[a] << ": status = " << status << ", non-zeros = " << C.GetNumNonZeros()
+				<< ", max difference = " << std::scientific << MaxAbsDiff(C, reference) << std::fixed << endl;
+		}
+		qbSparseMatrix<double> C;
+		cout << "Mismatched dimensions (A*A): status = " << qbSpGEMM(A, A, C) << endl;
+		cout << "Invalid accumulator: status = " << qbSpGEMM(A, B, C, 7) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing numeric reuse of the symbolic phase:" << endl;
+		qbSparseMatrix<double> A = RandomSparse(2000, 1500, 6, generator);
+		qbSparseMatrix<double> B = RandomSparse(1500, 1800, 8, generator);
+		qbSparseMatrix<double> C;
+		qbSpGEMMSymbolic(A, B, C);
+
+		// Change the values (not the pattern) of A and B, and recompute only the values of C.
+		for (auto &value : A.GetValues())
+			value = generator.Uniform();
+		for (auto &value : B.GetValues())
+			value *= -3.0;
+		int status = qbSpGEMMNumeric(A, B, C);
+		cout << "Numeric phase: status = " << status << ", max difference = " << std::scientific << MaxAbsDiff(C, A * B) << std::fixed << endl;
+
+		// A different pattern must be detected.
+		qbSparseMatrix<double> D = RandomSparse(2000, 1500, 6, generator);
+		cout << "Numeric phase with a different pattern: status = " << qbSpGEMMNumeric(D, B, C) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing C = A'*A (20000x3000, 5 non-zeros per row):" << endl;
+		qbSparseMatrix<double> A = RandomSparse(20000, 3000, 5, generator);
+		auto t0 = std::chrono::steady_clock::now();
+		qbSparseMatrix<double> reference = A.Transpose() * A;
+		auto t1 = std::chrono::steady_clock::now();
+		qbSparseMatrix<double> C;
+		int status = qbSpGEMMAtA(A, C);
+		auto t2 = std::chrono::steady_clock::now();
+		cout << "Status = " << status << ", non-zeros = " << C.GetNumNonZeros() << ", max difference = "
+			<< std::scientific << MaxAbsDiff(C, reference) << std::fixed << endl;
+		cout << "Time: sequential product = " << std::chrono::duration<double>(t1 - t0).count()
+			<< " s, qbSpGEMMAtA = " << std::chrono::duration<double>(t2 - t1).count() << " s" << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a large product (100000x100000, 10 non-zeros per row, squared):" << endl;
+		qbSparseMatrix<double> A = RandomSparse(100000, 100000, 10, generator);
+		auto t0 = std::chrono::steady_clock::now();
+		qbSparseMatrix<double> reference = A * A;
+		auto t1 = std::chrono::steady_clock::now();
+		qbSparseMatrix<double> C;
+		int status1 = qbSpGEMM(A, A, C);
+		auto t2 = std::chrono::steady_clock::now();
+		qbSparseMatrix<double> D;
+		qbSpGEMMSymbolic(A, A, D);
+		auto t3 = std::chrono::steady_clock::now();
+		int status2 = qbSpGEMMNumeric(A, A, D);
+		auto t4 = std::chrono::steady_clock::now();
+		cout << "qbSpGEMM: status = " << status1 << ", non-zeros = " << C.GetNumNonZeros() << ", max difference = "
+			<< std::scientific << MaxAbsDiff(C, reference) << std::fixed << endl;
+		cout << "Symbolic and numeric: status = " << status2 << ", max difference = "
+			<< std::scientific << MaxAbsDiff(D, reference) << std::fixed << endl;
+		cout << "Time: sequential product = " << std::chrono::duration<double>(t1 - t0).count()
+			<< " s, qbSpGEMM = " << std::chrono::duration<double>(t2 - t1).count()
+			<< " s, symbolic = " << std::chrono::duration<double>(t3 - t2).count()
+			<< " s, numeric = " << std::chrono::duration<double>(t4 - t3).count() << " s" << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+/* *************************************************************************************************
+
+	TestCode_qbSparse
+
+	  Code to test the sparse matrix class.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbSparse.h"
+
+using namespace std;
+
+// Function to compute the largest absolute difference between two matrices.
+template <class T>
+T MaxAbsDiff(const qbMatrix2<T> &A, const qbMatrix2<T> &B)
+{
+	T maxDiff = static_cast<T>(0.0);
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, static_cast<T>(fabs(A.GetElement(i,j) - B.GetElement(i,j))));
+	}
+	return maxDiff;
+}
+
+// Function to generate a random sparse matrix (about a fraction 'density' of entries non-zero).
+qbMatrix2<double> RandomSparseDense(int numRows, int numCols, double density, qbRandom &generator)
+{
+	qbMatrix2<double> result(numRows, numCols);
+	for (int i=0; i<numRows; ++i)
+	{
+		for (int j=0; j<numCols; ++j)
+		{
+			if (generator.Uniform() < density)
+				result.SetElement(i, j, generator.Uniform() * 2.0 - 1.0);
+		}
+	}
+	return result;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing sparse matrix code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing construction from triplets (with a duplicate entry):" << endl;
+		std::vector<int> rows = {0, 2, 1, 0, 2, 0};
+		std::vector<int> cols = {0, 1, 1, 3, 3, 0};
+		std::vector<double> values = {1.0, 2.0, 3.0, 4.0, 5.0, 10.0};
+		qbSparseMatrix<double> A(3, 4, rows, cols, values);
+		A.ToDense().PrintMatrix();
+		cout << "Non-zeros = " << A.GetNumNonZeros() << ", A(0,0) = " << A.GetElement(0, 0) << ", A(1,2) = " << A.GetElement(1, 2) << endl;
+		cout << "Transpose:" << endl;
+		A.Transpose().ToDense().PrintMatrix();
+		cout << endl;
+	}
+
+	{
+		cout << "Testing products against the dense equivalents (200x150 and 150x120, 5% dense):" << endl;
+		qbMatrix2<double> denseA = RandomSparseDense(200, 150, 0.05, generator);
+		qbMatrix2<double> denseB = RandomSparseDense(150, 120, 0.05, generator);
+		qbSparseMatrix<double> A(denseA);
+		qbSparseMatrix<double> B(denseB);
+		qbVector<double> x(150);
+		generator.FillUniform(x);
+
+		qbVector<double> y1 = A * x;
+		qbVector<double> y2 = denseA * x;
+		double maxDiff = 0.0;
+		for (int i=0; i<y1.GetNumDims(); ++i)
+			maxDiff = std::max(maxDiff, fabs(y1.GetElement(i) - y2.GetElement(i)));
+		cout << "A*x: max difference = " << std::scientific << maxDiff << endl;
+
+		std::vector<double> z1, z2;
+		A.MultiplyTranspose(y1.data(), z1);
+		A.Transpose().Multiply(y1.data(), z2);
+		maxDiff = 0.0;
+		for (size_t i=0; i<z1.size(); ++i)
+			maxDiff = std::max(maxDiff, fabs(z1[i] - z2[i]));
+		cout << "A'*y: max difference = " << maxDiff << endl;
+
+		qbSparseMatrix<double> C = A * B;
+		cout << "A*B: max difference = " << MaxAbsDiff(C.ToDense(), denseA * denseB) << std::fixed << endl;
+		cout << "Non-zeros in A, B, A*B = " << A.GetNumNonZeros() << ", " << B.GetNumNonZeros() << ", " << C.GetNumNonZeros() << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing in-place value updates:" << endl;
+		std::vector<double> data = {4.0, -1.0, 0.0, -1.0, 4.0, -1.0, 0.0, -1.0, 4.0};
+		qbSparseMatrix<double> A(qbMatrix2<double>(3, 3, data));
+		qbSparseMatrix<double> B = A;
+		for (auto &value : B.GetValues())
+			value *= 2.0;
+		B.ToDense().PrintMatrix();
+		std::vector<double> diagonal = B.Diagonal();
+		cout << "Diagonal = " << diagonal[0] << " " << diagonal[1] << " " << diagonal[2] << endl;
+		cout << "Same pattern as the original: " << (A.SamePattern(B) ? "True." : "False.") << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
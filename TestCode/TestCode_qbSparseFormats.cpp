@@ -0,0 +1,248 @@
+/* *************************************************************************************************
+
+	TestCode_qbSparseFormats
+
+	  Code to test the BSR and SELL-C-sigma sparse matrix formats and the format selection.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbRandom.h"
+#include "../qbSparse.h"
+#include "../qbSparseFormats.h"
+
+using namespace std;
+
+/* Function to generate a block matrix like those from a finite element discretization, with a
+	dense blockSize x blockSize block for each pair of neighbouring nodes on a numNodes x numNodes grid. */
+qbSparseMatrix<double> BlockGridMatrix(int numNodes, int blockSize, qbRandom &generator)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	int di[5] = {0, -1, 1, 0, 0};
+	int dj[5] = {0, 0, 0, -1, 1};
+	for (int i=0; i<numNodes; ++i)
+	{
+		for (int j=0; j<numNodes; ++j)
+		{
+			for (int k=0; k<5; ++k)
+			{
+				int ni = i + di[k];
+				int nj = j + dj[k];
+				if ((ni < 0) || (ni >= numNodes) || (nj < 0) || (nj >= numNodes))
+					continue;
+				for (int a=0; a<blockSize; ++a)
+				{
+					for (int b=0; b<blockSize; ++b)
+					{
+						rows.push_back((i * numNodes + j) * blockSize + a);
+						cols.push_back((ni * numNodes + nj) * blockSize + b);
+						values.push_back(generator.Uniform() * 2.0 - 1.0);
+					}
+				}
+			}
+		}
+	}
+	int n = numNodes * numNodes * blockSize;
+	return qbSparseMatrix<double>(n, n, rows, cols, values);
+}
+
+/* Function to generate a random matrix with the given range of row lengths. */
+qbSparseMatrix<double> RandomRowsMatrix(int n, int minLength, int maxLength, qbRandom &generator)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		int length = minLength + static_cast<int>(generator.Uniform() * (maxLength - minLength + 1));
+		for (int k=0; k<length; ++k)
+		{
+			rows.push_back(i);
+			cols.push_back(static_cast<int>(generator.Uniform() * n));
+			values.push_back(generator.Uniform() * 2.0 - 1.0);
+		}
+	}
+	return qbSparseMatrix<double>(n, n, rows, cols, values);
+}
+
+/* Function to generate a matrix with a few very long rows (a power law distribution of
+	row lengths, as in graphs from social networks or web links). */
+qbSparseMatrix<double> PowerLawMatrix(int n, qbRandom &generator)
+{
+	std::vector<int> rows, cols;
+	std::vector<double> values;
+	for (int i=0; i<n; ++i)
+	{
+		int length = std::min(n, static_cast<int>(2.0 / pow(1.0 - generator.Uniform(), 1.2)));
+		for (int k=0; k<length; ++k)
+		{
+			rows.push_back(i);
+			cols.push_back(static_cast<int>(generator.Uniform() * n));
+			values.push_back(1.0);
+		}
+	}
+	return qbSparseMatrix<double>(n, n, rows, cols, values);
+}
+
+// Function to compute the largest absolute difference between two vectors.
+double MaxAbsDiff(const std::vector<double> &a, const std::vector<double> &b)
+{
+	double maxDiff = 0.0;
+	for (size_t i=0; i<a.size(); ++i)
+		maxDiff = std::max(maxDiff, fabs(a[i] - b[i]));
+	return maxDiff;
+}
+
+// Function to return the name of a format.
+std::string FormatName(int format)
+{
+	if (format == QBSPARSE_BSR)
+		return "BSR";
+	if (format == QBSPARSE_SELL)
+		return "SELL";
+	return "CSR";
+}
+
+// Function to time numRepeats products with a callback, returning the best of numTrials runs.
+double TimeProduct(const std::function<void(const std::vector<double>&, std::vector<double>&)> &matVec,
+	const std::vector<double> &x, std::vector<double> &y, int numRepeats, int numTrials)
+{
+	double bestTime = 0.0;
+	for (int t=0; t<numTrials; ++t)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		for (int r=0; r<numRepeats; ++r)
+			matVec(x, y);
+		auto t1 = std::chrono::steady_clock::now();
+		double time = std::chrono::duration<double>(t1 - t0).count();
+		if ((t == 0) || (time < bestTime))
+			bestTime = time;
+	}
+	return bestTime;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing sparse matrix formats." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing BSR products against CSR (block sizes that do and don't divide the size):" << endl;
+		qbSparseMatrix<double> A = RandomRowsMatrix(1001, 2, 12, generator);
+		std::vector<double> x(1001), y1, y2;
+		generator.FillUniform(x.data(), x.size(), -1.0, 1.0);
+		A.Multiply(x, y1);
+		int sizes[4][2] = {{2, 2}, {3, 3}, {4, 4}, {2, 5}};
+		for (int s=0; s<4; ++s)
+		{
+			qbBSRMatrix<double> B(A, sizes[s][0], sizes[s][1]);
+			B.Multiply(x, y2);
+			cout << sizes[s][0] << "x" << sizes[s][1] << ": max difference = " << std::scientific << MaxAbsDiff(y1, y2)
+				<< std::fixed << ", fill ratio = " << B.GetFillRatio() << endl;
+		}
+		qbBSRMatrix<double> B(A, 3, 3);
+		cout << "Round trip to CSR has the same pattern: " << (B.ToCSR().SamePattern(A) ? "True." : "False.") << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing SELL-C-sigma products against CSR:" << endl;
+		qbSparseMatrix<double> A = RandomRowsMatrix(1001, 0, 12, generator);
+		std::vector<double> x(1001), y1, y2;
+		generator.FillUniform(x.data(), x.size(), -1.0, 1.0);
+		A.Multiply(x, y1);
+		int chunkSizes[4] = {4, 8, 16, 5};
+		int sigmas[3] = {1, 32, 1001};
+		for (int c=0; c<4; ++c)
+		{
+			for (int s=0; s<3; ++s)
+			{
+				qbSELLMatrix<double> S(A, chunkSizes[c], sigmas[s]);
+				S.Multiply(x, y2);
+				cout << "C = " << setw(2) << chunkSizes[c] << ", sigma = " << setw(4) << sigmas[s] << ": max difference = "
+					<< std::scientific << MaxAbsDiff(y1, y2) << std::fixed << ", fill ratio = " << S.GetFillRatio() << endl;
+			}
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing format selection and timing (best of 5 runs of 20 products each):" << endl;
+		std::vector<std::string> names = {"FEM 3x3 blocks", "Short regular rows", "Long rows", "Power law rows"};
+		std::vector<qbSparseMatrix<double>> matrices;
+		matrices.push_back(BlockGridMatrix(150, 3, generator));
+		matrices.push_back(RandomRowsMatrix(100000, 4, 8, generator));
+		matrices.push_back(RandomRowsMatrix(10000, 60, 80, generator));
+		matrices.push_back(PowerLawMatrix(50000, generator));
+		for (size_t m=0; m<matrices.size(); ++m)
+		{
+			const qbSparseMatrix<double> &A = matrices[m];
+			int blockSize;
+			int format = qbSelectSparseFormat(A, blockSize);
+			cout << names[m] << " (" << A.GetNumRows() << " rows, " << A.GetNumNonZeros() << " non-zeros): selected "
+				<< FormatName(format);
+			if (format == QBSPARSE_BSR)
+				cout << " " << blockSize << "x" << blockSize;
+			cout << endl;
+
+			std::vector<double> x(A.GetNumCols()), y1, y2;
+			generator.FillUniform(x.data(), x.size(), -1.0, 1.0);
+			A.Multiply(x, y1);
+			auto selected = qbSparseMatVec(A);
+			selected(x, y2);
+			cout << "  Selected format: max difference = " << std::scientific << MaxAbsDiff(y1, y2) << std::fixed << endl;
+
+			int formats[3] = {QBSPARSE_CSR, QBSPARSE_BSR, QBSPARSE_SELL};
+			for (int f=0; f<3; ++f)
+			{
+				auto matVec = qbSparseMatVec(A, formats[f]);
+				cout << "  " << setw(4) << FormatName(formats[f]) << ": time = " << std::setprecision(4)
+					<< TimeProduct(matVec, x, y2, 20, 5) << " s" << std::setprecision(6) << endl;
+			}
+
+			/* The selected format should be no slower than CSR. The two are timed in turn, so that
+				changes in the load on the machine affect both, and 10% is allowed for timing noise. */
+			double csrTime = 1.0;
+			double selectedTime = 1.0;
+			if (format != QBSPARSE_CSR)
+			{
+				auto csr = qbSparseMatVec(A, QBSPARSE_CSR);
+				csrTime = TimeProduct(csr, x, y2, 20, 1);
+				selectedTime = TimeProduct(selected, x, y2, 20, 1);
+				for (int t=1; t<10; ++t)
+				{
+					csrTime = std::min(csrTime, TimeProduct(csr, x, y2, 20, 1));
+					selectedTime = std::min(selectedTime, TimeProduct(selected, x, y2, 20, 1));
+				}
+			}
+			cout << "  Selected format no slower than CSR: " << ((selectedTime <= 1.1 * csrTime) ? "True." : "False.") << endl;
+		}
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,173 @@
+/* *************************************************************************************************
+
+	TestCode_qbTSQR
+
+	  Code to test the tall-skinny (TSQR) QR decomposition.
+
+	*** INPUTS ***
+
+	None
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <math.h>
+#include <vector>
+#include <chrono>
+
+#include "../qbMatrix.h"
+#include "../qbVector.h"
+#include "../qbRandom.h"
+#include "../qbGEMM.h"
+#include "../qbQR.h"
+#include "../qbTSQR.h"
+#include "../qbLSQ.h"
+
+using namespace std;
+
+// Function to compute max|A - B|.
+double MaxAbsDiff(const qbMatrix2<double> &A, const qbMatrix2<double> &B)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(A.GetElement(i, j) - B.GetElement(i, j)));
+	}
+	return maxDiff;
+}
+
+// Function to compute max| |A| - |B| | (R factors are unique only up to the signs of their rows).
+double MaxAbsDiffUpToSign(const qbMatrix2<double> &A, const qbMatrix2<double> &B)
+{
+	double maxDiff = 0.0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int j=0; j<A.GetNumCols(); ++j)
+			maxDiff = std::max(maxDiff, fabs(fabs(A.GetElement(i, j)) - fabs(B.GetElement(i, j))));
+	}
+	return maxDiff;
+}
+
+int main()
+{
+	cout << "**********************************************" << endl;
+	cout << "Testing TSQR decomposition code." << endl;
+	cout << "**********************************************" << endl;
+	cout << endl;
+
+	qbRandom generator(2021);
+
+	{
+		cout << "Testing a 5000x40 matrix with different numbers of blocks:" << endl;
+		int m = 5000, n = 40;
+		qbMatrix2<double> A(m, n);
+		generator.FillUniform(A, -1.0, 1.0);
+		qbMatrix2<double> Qref, Rref;
+		qbQRThin(A, Qref, Rref);
+
+		std::vector<int> numBlocks = {1, 2, 3, 7, 16, 1000};
+		for (int b : numBlocks)
+		{
+			qbTSQR<double> qr;
+			int status = qr.Factorize(A, b);
+			qbMatrix2<double> Q = qr.GetQ(), R = qr.GetR(), QR, QtQ, QtA;
+			qbGEMM(Q, R, QR);
+			qbGEMM(Q.Transpose(), Q, QtQ);
+			qbMatrix2<double> I(n, n);
+			I.SetToIdentity();
+			qr.ApplyQTranspose(A, QtA);
+			cout << "Blocks = " << setw(4) << b << " (used " << setw(3) << qr.GetNumBlocks() << "): status = " << status << std::scientific
+				<< ", max |QR - A| = " << MaxAbsDiff(QR, A) << ", max |Q'Q - I| = " << MaxAbsDiff(QtQ, I)
+				<< ", max |Q'A - R| = " << MaxAbsDiff(QtA, R) << ", |R| vs qbQRThin = " << MaxAbsDiffUpToSign(R, Rref) << std::fixed << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing error codes:" << endl;
+		qbTSQR<double> qr;
+		cout << "Wide matrix: status = " << qr.Factorize(qbMatrix2<double>(3, 4)) << endl;
+		qr.Factorize(qbMatrix2<double>(10, 2));
+		qbMatrix2<double> C;
+		try
+		{
+			qr.ApplyQTranspose(qbMatrix2<double>(9, 1), C);
+			cout << "Mismatched dimensions: no exception." << endl;
+		}
+		catch (const std::invalid_argument &e)
+		{
+			cout << "Mismatched dimensions: " << e.what() << endl;
+		}
+		cout << endl;
+	}
+
+	{
+		cout << "Testing least squares (qbLSQ) on a 100000x20 problem:" << endl;
+		int m = 100000, n = 20;
+		qbMatrix2<double> X(m, n);
+		generator.FillUniform(X, -1.0, 1.0);
+		std::vector<double> betaTrue(n), noise(m);
+		for (int j=0; j<n; ++j)
+			betaTrue[j] = j + 1.0;
+		generator.FillUniform(noise.data(), noise.size(), -1e-3, 1e-3);
+		qbVector<double> y(m);
+		for (int i=0; i<m; ++i)
+		{
+			double sum = noise[i];
+			for (int j=0; j<n; ++j)
+				sum += X.GetElement(i, j) * betaTrue[j];
+			y.SetElement(i, sum);
+		}
+
+		qbVector<double> beta;
+		int status = qbLSQ(X, y, beta);
+		double maxError = 0.0;
+		for (int j=0; j<n; ++j)
+			maxError = std::max(maxError, fabs(beta.GetElement(j) - betaTrue[j]));
+		cout << "Status = " << status << ", max |beta - beta_true| = " << std::scientific << maxError << std::fixed << endl;
+
+		// Two identical columns: X'X is singular.
+		for (int i=0; i<m; ++i)
+			X.SetElement(i, 1, X.GetElement(i, 0));
+		cout << "Rank deficient matrix: status = " << qbLSQ(X, y, beta) << endl;
+		cout << endl;
+	}
+
+	{
+		cout << "Testing a 50000x100 matrix (timing):" << endl;
+		int m = 50000, n = 100;
+		qbMatrix2<double> A(m, n);
+		generator.FillUniform(A, -1.0, 1.0);
+
+		auto t0 = std::chrono::steady_clock::now();
+		qbMatrix2<double> Q, R;
+		qbQRThin(A, Q, R);
+		auto t1 = std::chrono::steady_clock::now();
+		qbTSQR<double> qr;
+		int status = qr.Factorize(A);
+		auto t2 = std::chrono::steady_clock::now();
+		qbMatrix2<double> Qtsqr = qr.GetQ();
+		auto t3 = std::chrono::steady_clock::now();
+		cout << "Status = " << status << ", blocks = " << qr.GetNumBlocks() << ", |R| vs qbQRThin = " << std::scientific
+			<< MaxAbsDiffUpToSign(qr.GetR(), R) << std::fixed << endl;
+		cout << "Time: qbQRThin (R and Q) = " << std::chrono::duration<double>(t1 - t0).count()
+			<< " s, TSQR factorization (implicit Q) = " << std::chrono::duration<double>(t2 - t1).count()
+			<< " s, forming Q = " << std::chrono::duration<double>(t3 - t2).count() << " s" << endl;
+		cout << endl;
+	}
+
+	return 0;
+}
@@ -27,6 +27,8 @@
 #include <string>
 #include <sstream>
 #include <vector>
+#include <thread>
+#include <chrono>
 
 #include "../qbMatrix.h"
 
@@ -228,6 +230,219 @@ int main()
 		qbMatrix2<double> invertAccuracy = invertTest * invertResult;
 		PrintMatrix(invertAccuracy);
 		
+
+    // *******************************************************************
+    // Test transpose.
+		cout << endl << "**************************" << endl;
+		cout << "Test transpose." << endl;
+		cout << "testMatrix transposed:" << endl;
+		PrintMatrix(testMatrix.Transpose());
+		cout << "testMatrix transposed in place:" << endl;
+		qbMatrix2<double> inPlaceTest = testMatrix;
+		inPlaceTest.TransposeInPlace();
+		PrintMatrix(inPlaceTest);
+
+		cout << endl;
+		cout << "Compare against element-by-element transpose for larger sizes:" << endl;
+		int testSizes[4][2] = {{64, 64}, {37, 101}, {100, 3}, {129, 129}};
+		for (auto &testSize : testSizes)
+		{
+			int nRows = testSize[0];
+			int nCols = testSize[1];
+			qbMatrix2<double> bigMatrix(nRows, nCols);
+			for (int i=0; i<nRows; ++i)
+				for (int j=0; j<nCols; ++j)
+					bigMatrix.SetElement(i, j, static_cast<double>(i * nCols + j));
+
+			qbMatrix2<double> outOfPlace = bigMatrix.Transpose();
+			qbMatrix2<double> inPlace = bigMatrix;
+			inPlace.TransposeInPlace();
+
+			int numErrors = 0;
+			for (int i=0; i<nRows; ++i)
+			{
+				for (int j=0; j<nCols; ++j)
+				{
+					if (outOfPlace.GetElement(j, i) != bigMatrix.GetElement(i, j))
+						numErrors++;
+					if (inPlace.GetElement(j, i) != bigMatrix.GetElement(i, j))
+						numErrors++;
+				}
+			}
+			cout << nRows << "x" << nCols << ": result is " << inPlace.GetNumRows() << "x" << inPlace.GetNumCols()
+				<< ", errors = " << numErrors << endl;
+		}
+
+    // *******************************************************************
+    // Test copy-on-write storage.
+		cout << endl << "**************************" << endl;
+		cout << "Test copy-on-write storage." << endl;
+		{
+			qbMatrix2<double> original(3, 4, simpleData);
+			qbMatrix2<double> copy = original;
+			const qbMatrix2<double> &constCopy = copy;
+			const qbMatrix2<double> &constOriginal = original;
+			cout << "Copy shares storage: " << ((constCopy.GetData() == constOriginal.GetData()) ? "True" : "False") << endl;
+
+			// The first modification gives the copy its own storage, and leaves the original unchanged.
+			copy.SetElement(0, 0, -1.0);
+			cout << "After SetElement: shares storage = " << ((constCopy.GetData() == constOriginal.GetData()) ? "True" : "False")
+				<< ", copy(0,0) = " << copy.GetElement(0, 0) << ", original(0,0) = " << original.GetElement(0, 0) << endl;
+
+			// The same through the other mutating functions.
+			qbMatrix2<double> transposed = original, written = original, square(3, 3), identity;
+			transposed.TransposeInPlace();
+			written.GetData()[11] = 0.0;
+			identity = square;
+			identity.SetToIdentity();
+			qbMatrix2<double> resized = original;
+			resized.Resize(2, 2);
+			cout << "After TransposeInPlace, GetData, SetToIdentity and Resize of copies: original(2,3) = " << original.GetElement(2, 3)
+				<< ", original is " << original.GetNumRows() << "x" << original.GetNumCols()
+				<< ", square(0,0) = " << square.GetElement(0, 0) << ", identity(0,0) = " << identity.GetElement(0, 0) << endl;
+
+			// Copies of a large matrix in several threads, each modifying its own copy.
+			int n = 1000;
+			qbMatrix2<double> shared(n, n);
+			for (int i=0; i<n; ++i)
+				shared.SetElement(i, i, 1.0);
+			std::vector<double> traces(4);
+			std::vector<std::thread> threads;
+			for (int t=0; t<4; ++t)
+			{
+				threads.emplace_back([&shared, &traces, t, n]()
+				{
+					qbMatrix2<double> local = shared;
+					local.SetElement(0, 0, static_cast<double>(t));
+					double trace = 0.0;
+					for (int i=0; i<n; ++i)
+						trace += local.GetElement(i, i);
+					traces[t] = trace;
+				});
+			}
+			for (auto &thread : threads)
+				thread.join();
+			cout << "Traces of the modified copies = " << traces[0] << ", " << traces[1] << ", " << traces[2] << ", " << traces[3]
+				<< ", shared(0,0) = " << shared.GetElement(0, 0) << endl;
+
+			// Copying is O(1), whatever the size.
+			auto t0 = std::chrono::steady_clock::now();
+			double sum = 0.0;
+			for (int k=0; k<1000; ++k)
+			{
+				qbMatrix2<double> temp = shared;
+				sum += temp.GetElement(k, k);
+			}
+			auto t1 = std::chrono::steady_clock::now();
+			cout << "1000 copies of a " << n << "x" << n << " matrix: sum = " << sum << ", time per copy = "
+				<< std::scientific << std::chrono::duration<double>(t1 - t0).count() / 1000.0 << std::fixed << " s" << endl;
+		}
+
+    // *******************************************************************
+    // Test concurrent queries of a shared matrix.
+		cout << endl << "**************************" << endl;
+		cout << "Test concurrent queries of a shared matrix." << endl;
+		{
+			// A symmetric 5x5 matrix of rank 4 (XX', with X 5x4), shared (read-only) by several threads.
+			int n = 5;
+			qbMatrix2<double> X(n, n-1);
+			for (int i=0; i<n; ++i)
+			{
+				for (int j=0; j<n-1; ++j)
+					X.SetElement(i, j, ((i == j) ? 2.0 : 0.0) + 1.0 / (1.0 + i + j));
+			}
+			const qbMatrix2<double> model = X * X.Transpose();
+
+			double determinant = model.Determinant();
+			int rank = model.Rank();
+			qbMatrix2<double> echelon = model.RowEchelon();
+			cout << "Square = " << (model.IsSquare() ? "True" : "False") << ", symmetric = " << (model.IsSymmetric() ? "True" : "False")
+				<< ", row echelon = " << (model.IsRowEchelon() ? "True" : "False") << ", rank = " << rank
+				<< std::scientific << ", determinant = " << determinant << std::fixed << endl;
+
+			std::vector<int> mismatches(4, 0);
+			std::vector<std::thread> threads;
+			for (int t=0; t<4; ++t)
+			{
+				threads.emplace_back([&model, &mismatches, &echelon, determinant, rank, t]()
+				{
+					for (int k=0; k<200; ++k)
+					{
+						qbMatrix2<double> copy = model;
+						if (!model.IsSquare() || !model.IsSymmetric() || model.IsRowEchelon() || !model.IsNonZero())
+							mismatches[t]++;
+						if ((model.Rank() != rank) || (model.Determinant() != determinant))
+							mismatches[t]++;
+						if (!(model.RowEchelon() == echelon) || !(model.Transpose() == copy) || !model.Compare(copy, 1e-12))
+							mismatches[t]++;
+						if (model.FindSubMatrix(0, 0).GetElement(0, 0) != model.GetElement(1, 1))
+							mismatches[t]++;
+					}
+				});
+			}
+			for (auto &thread : threads)
+				thread.join();
+			cout << "Mismatches in 4 threads = " << mismatches[0] << ", " << mismatches[1] << ", " << mismatches[2] << ", " << mismatches[3]
+				<< ", copies share storage = " << ((model.GetData() == static_cast<const qbMatrix2<double>&>(qbMatrix2<double>(model)).GetData()) ? "True" : "False") << endl;
+
+			// Matrices of different shapes are never equal.
+			cout << "3x4 == 4x3: " << ((qbMatrix2<double>(3, 4) == qbMatrix2<double>(4, 3)) ? "True" : "False") << endl;
+		}
+
+    // *******************************************************************
+    // Test cached structural properties.
+		cout << endl << "**************************" << endl;
+		cout << "Test cached structural properties." << endl;
+		{
+			// The identity knows all of its properties; setting a diagonal element keeps the structural ones.
+			qbMatrix2<double> identity(4, 4);
+			identity.SetToIdentity();
+			cout << "Identity: known properties = " << identity.GetKnownProperties();
+			identity.SetElement(2, 2, 5.0);
+			cout << ", after setting (2,2) = " << identity.GetKnownProperties();
+			identity.SetElement(3, 0, 1.0);
+			cout << ", after setting (3,0) = " << identity.GetKnownProperties() << endl;
+			cout << "Upper triangular = " << (identity.IsUpperTriangular() ? "True" : "False")
+				<< ", lower triangular = " << (identity.IsLowerTriangular() ? "True" : "False")
+				<< ", upper Hessenberg = " << (identity.IsUpperHessenberg() ? "True" : "False")
+				<< ", transpose is upper triangular = " << ((identity.Transpose().GetKnownProperties() & QBMATRIX_UPPERTRIANGULAR) ? "True" : "False") << endl;
+
+			// Row echelon form sets the property as a by-product.
+			qbMatrix2<double> echelon = testMatrix.RowEchelon();
+			cout << "Row echelon form: known properties = " << echelon.GetKnownProperties() << ", row echelon = "
+				<< (echelon.IsRowEchelon() ? "True" : "False") << endl;
+
+			// Positive definite tests.
+			double spdData[9] = {4.0, 1.0, 0.5, 1.0, 3.0, 0.2, 0.5, 0.2, 2.0};
+			double indefiniteData[9] = {1.0, 2.0, 0.0, 2.0, 1.0, 0.0, 0.0, 0.0, 1.0};
+			cout << "Positive definite: SPD = " << (qbMatrix2<double>(3, 3, spdData).IsPositiveDefinite() ? "True" : "False")
+				<< ", indefinite = " << (qbMatrix2<double>(3, 3, indefiniteData).IsPositiveDefinite() ? "True" : "False")
+				<< ", non-symmetric = " << (testMatrix.IsPositiveDefinite() ? "True" : "False") << endl;
+
+			// Repeated symmetry tests of a large matrix only scan it once, until it is modified.
+			int n = 1500;
+			qbMatrix2<double> big(n, n);
+			for (int i=0; i<n; ++i)
+			{
+				for (int j=0; j<n; ++j)
+					big.SetElement(i, j, 1.0 / (1.0 + i + j));
+			}
+			auto t0 = std::chrono::steady_clock::now();
+			bool first = big.IsSymmetric();
+			auto t1 = std::chrono::steady_clock::now();
+			bool repeated = true;
+			for (int k=0; k<1000; ++k)
+				repeated = repeated && big.IsSymmetric();
+			auto t2 = std::chrono::steady_clock::now();
+			qbMatrix2<double> copy = big;
+			copy.GetData()[1] = 2.0;
+			cout << "Symmetric = " << (first ? "True" : "False") << ", after 1000 more tests = " << (repeated ? "True" : "False")
+				<< ", copy after a write through GetData() = " << (copy.IsSymmetric() ? "True" : "False")
+				<< ", original = " << (big.IsSymmetric() ? "True" : "False") << endl;
+			cout << "Time: first test = " << std::scientific << std::chrono::duration<double>(t1 - t0).count()
+				<< " s, cached tests = " << std::chrono::duration<double>(t2 - t1).count() / 1000.0 << std::fixed << " s each" << endl;
+		}
+
     // *******************************************************************
     // Test inversion of a singular matrix.
 		/*cout << endl << "**************************" << endl;
@@ -0,0 +1,716 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBAMG_H
+#define QBAMG_H
+
+/* *************************************************************************************************
+
+	qbAMG
+
+	Class to implement smoothed aggregation algebraic multigrid (Vanek, Mandel and Brezina,
+	Computing 56, 1996) for sparse symmetric positive definite systems A*x = b, such as those
+	from the discretization of Poisson-like equations. It can be used as a solver in its own
+	right, or (usually better) as a preconditioner for conjugate gradients (see qbCG.h).
+
+	Simple iterations like Jacobi quickly remove the oscillatory part of the error, but take
+	O(n) iterations to remove the smooth part. Multigrid handles the smooth error on a hierarchy
+	of coarser problems, where it is no longer smooth, so the work per digit of accuracy is
+	independent of the problem size. Algebraic multigrid builds the hierarchy from the matrix
+	alone, with no need for a geometric mesh:
+
+		1.	Strongly coupled unknowns (|a_ij| >= theta * sqrt(|a_ii * a_jj|)) are grouped into
+			small aggregates, each of which becomes one coarse unknown.
+		2.	The tentative prolongator maps each aggregate to a constant vector on its members
+			(the near null-space of a Poisson operator), and is smoothed with one step of damped
+			Jacobi, P = (I - omega * inv(D) * A) * Ptent, to improve the interpolation.
+		3.	The coarse operator is the Galerkin product Ac = P' * A * P.
+
+	This is repeated until the problem is small enough to solve directly (with a dense Cholesky
+	factorization). Setup reuse: the aggregation depends only on the strength of the connections,
+	so when only the values of A change (a new time step, or a new coefficient) UpdateValues
+	keeps the aggregates. If the sparsity pattern of A is also unchanged, the patterns of all the
+	operators are reused too, and only the numeric phase of the sparse products is repeated (see
+	qbSpGEMM.h), which is much cheaper than Setup.
+
+	Smoothers are damped Jacobi, or a Chebyshev polynomial in inv(D)*A, which targets the upper
+	part of the spectrum more effectively for the same number of matrix-vector products. Both
+	only need matrix-vector products and vector updates, so they run in parallel over the rows
+	(unlike Gauss-Seidel, which is inherently sequential). The same number of sweeps is used
+	before and after the coarse grid correction, so a cycle is a symmetric operator and is a valid
+	preconditioner for CG. V-cycles visit each level once, W-cycles visit the coarse levels twice
+	(more robust, but more work).
+
+	Note that the workspace is held by the object, so a single qbAMG object should not be used
+	by more than one thread at a time.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "qbSparse.h"
+#include "qbSpGEMM.h"
+#include "qbParallel.h"
+#include "qbRandom.h"
+
+// Define the cycle types.
+constexpr int QBAMG_VCYCLE = 1;
+constexpr int QBAMG_WCYCLE = 2;
+
+// Define the smoother types.
+constexpr int QBAMG_JACOBI = 1;
+constexpr int QBAMG_CHEBYSHEV = 2;
+
+// Define error codes.
+constexpr int QBAMG_MAXITERATIONSEXCEEDED = -1;
+
+template <class T>
+class qbAMG {
+public:
+	// Define the various constructors.
+	qbAMG();
+	qbAMG(const qbSparseMatrix<T>& A);
+
+	// Configuration methods (the last three take effect at the next call to Setup).
+	void SetCycleType(int cycleType);
+	void SetSmoother(int smootherType);
+	void SetNumSweeps(int numSweeps);
+	void SetStrengthThreshold(T threshold);
+	void SetMaxLevels(int maxLevels);
+	void SetCoarseSize(int coarseSize);
+
+	// Build the hierarchy.
+	void Setup(const qbSparseMatrix<T>& A);
+	// Rebuild the operators for a matrix with new values, keeping the aggregates.
+	void UpdateValues(const qbSparseMatrix<T>& A);
+
+	// Solve A*x = b with repeated cycles. x is used as the starting point if it has the right size.
+	int Solve(const std::vector<T>& b, std::vector<T>& x, T tolerance = static_cast<T>(1e-8), int maxIterations = 100);
+	// Apply one cycle, starting from zero, as a preconditioner: z ~ inv(A)*r.
+	void Precondition(const std::vector<T>& r, std::vector<T>& z);
+
+	// Information about the hierarchy.
+	int GetNumLevels() const;
+	int GetLevelSize(int level) const;
+	T GetOperatorComplexity() const;
+
+private:
+	struct Level {
+		qbSparseMatrix<T> A, P, R;
+		// The tentative prolongator, the smoothing operator and A*P, kept for UpdateValues.
+		qbSparseMatrix<T> tentative, S, AP;
+		std::vector<int> aggregate;
+		int numAggregates;
+		std::vector<T> invDiagonal;
+		T rho;
+		std::vector<T> x, b, r, d, temp;
+	};
+
+	int Aggregate(const qbSparseMatrix<T>& A, std::vector<int>& aggregate) const;
+	T EstimateSpectralRadius(const qbSparseMatrix<T>& A, const std::vector<T>& invDiagonal) const;
+	void ComputeSmootherData(int level);
+	void ComputeTransferOperators(int level, bool reusePattern);
+	void AllocateWorkspace();
+	void FactorCoarse();
+	void CoarseSolve(const std::vector<T>& b, std::vector<T>& x) const;
+	void Cycle(int level, const std::vector<T>& b, std::vector<T>& x);
+	void Smooth(Level& level, const std::vector<T>& b, std::vector<T>& x);
+	void JacobiSweep(Level& level, const std::vector<T>& b, std::vector<T>& x);
+	void ChebyshevSmooth(Level& level, const std::vector<T>& b, std::vector<T>& x);
+
+private:
+	std::vector<Level> m_levels;
+	std::vector<T> m_coarseFactor;
+	int m_cycleType, m_smootherType, m_numSweeps, m_maxLevels, m_coarseSize;
+	T m_strengthThreshold;
+};
+
+/* **************************************************************************************************
+CONSTRUCTOR FUNCTIONS
+/* *************************************************************************************************/
+// The default constructor.
+template <class T>
+qbAMG<T>::qbAMG() {
+	m_cycleType = QBAMG_VCYCLE;
+	m_smootherType = QBAMG_CHEBYSHEV;
+	m_numSweeps = 2;
+	m_maxLevels = 25;
+	m_coarseSize = 200;
+	m_strengthThreshold = static_cast<T>(0.08);
+}
+
+// Construct and build the hierarchy with the default settings.
+template <class T>
+qbAMG<T>::qbAMG(const qbSparseMatrix<T>& A) : qbAMG() {
+	Setup(A);
+}
+
+/* **************************************************************************************************
+CONFIGURATION FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+void qbAMG<T>::SetCycleType(int cycleType) {
+	if((cycleType != QBAMG_VCYCLE) and (cycleType != QBAMG_WCYCLE))
+		throw std::invalid_argument("Unknown cycle type.");
+	m_cycleType = cycleType;
+}
+
+template <class T>
+void qbAMG<T>::SetSmoother(int smootherType) {
+	if((smootherType != QBAMG_JACOBI) and (smootherType != QBAMG_CHEBYSHEV))
+		throw std::invalid_argument("Unknown smoother type.");
+	m_smootherType = smootherType;
+}
+
+// The number of Jacobi sweeps, or the degree of the Chebyshev polynomial.
+template <class T>
+void qbAMG<T>::SetNumSweeps(int numSweeps) {
+	m_numSweeps = std::max(1, numSweeps);
+}
+
+template <class T>
+void qbAMG<T>::SetStrengthThreshold(T threshold) {
+	m_strengthThreshold = threshold;
+}
+
+template <class T>
+void qbAMG<T>::SetMaxLevels(int maxLevels) {
+	m_maxLevels = std::max(1, maxLevels);
+}
+
+template <class T>
+void qbAMG<T>::SetCoarseSize(int coarseSize) {
+	m_coarseSize = std::max(1, coarseSize);
+}
+
+/* **************************************************************************************************
+SETUP FUNCTIONS
+/* *************************************************************************************************/
+// Build the hierarchy.
+template <class T>
+void qbAMG<T>::Setup(const qbSparseMatrix<T>& A) {
+	if(A.GetNumRows() != A.GetNumCols())
+		throw std::invalid_argument("The matrix must be square.");
+
+	m_levels.clear();
+	m_levels.emplace_back();
+	m_levels[0].A = A;
+
+	while(true) {
+		int l = m_levels.size() - 1;
+		int n = m_levels[l].A.GetNumRows();
+		if((n <= m_coarseSize) or (static_cast<int>(m_levels.size()) >= m_maxLevels))
+			break;
+
+		// Stop if the aggregation no longer reduces the problem size.
+		int numAggregates = Aggregate(m_levels[l].A, m_levels[l].aggregate);
+		if((numAggregates == 0) or (numAggregates >= n))
+			break;
+		m_levels[l].numAggregates = numAggregates;
+
+		m_levels.emplace_back();
+		ComputeTransferOperators(l, false);
+	}
+	ComputeSmootherData(m_levels.size() - 1);
+
+	AllocateWorkspace();
+	FactorCoarse();
+}
+
+// Rebuild the operators for a matrix with new values, keeping the aggregates.
+template <class T>
+void qbAMG<T>::UpdateValues(const qbSparseMatrix<T>& A) {
+	if(m_levels.empty())
+		throw std::invalid_argument("Setup must be called before UpdateValues.");
+	if((A.GetNumRows() != m_levels[0].A.GetNumRows()) or (A.GetNumCols() != m_levels[0].A.GetNumCols()))
+		throw std::invalid_argument("The matrix dimensions do not match the hierarchy.");
+
+	bool reusePattern = A.SamePattern(m_levels[0].A);
+	m_levels[0].A = A;
+	int numLevels = m_levels.size();
+	for(int l = 0; l < numLevels - 1; ++l)
+		ComputeTransferOperators(l, reusePattern);
+	ComputeSmootherData(numLevels - 1);
+	FactorCoarse();
+}
+
+/* Group the unknowns into aggregates of strongly connected neighbours (the standard
+	three pass greedy algorithm). Returns the number of aggregates. */
+template <class T>
+int qbAMG<T>::Aggregate(const qbSparseMatrix<T>& A, std::vector<int>& aggregate) const {
+	int n = A.GetNumRows();
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	const std::vector<T>& values = A.GetValues();
+	std::vector<T> diagonal = A.Diagonal();
+
+	// Find the strong connections.
+	std::vector<int> strongPtr(n + 1, 0);
+	std::vector<int> strongIndex;
+	strongIndex.reserve(colIndex.size());
+	for(int i = 0; i < n; ++i) {
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+			int j = colIndex[k];
+			if((j != i) and (fabs(values[k]) >= m_strengthThreshold * sqrt(fabs(diagonal[i] * diagonal[j]))))
+				strongIndex.push_back(j);
+		}
+		strongPtr[i + 1] = strongIndex.size();
+	}
+
+	aggregate.assign(n, -1);
+	int numAggregates = 0;
+
+	// Pass 1: make an aggregate from each node whose strong neighbours are all free.
+	for(int i = 0; i < n; ++i) {
+		if((aggregate[i] >= 0) or (strongPtr[i] == strongPtr[i + 1]))
+			continue;
+		bool allFree = true;
+		for(int k = strongPtr[i]; (k < strongPtr[i + 1]) and allFree; ++k)
+			allFree = (aggregate[strongIndex[k]] < 0);
+		if(allFree) {
+			aggregate[i] = numAggregates;
+			for(int k = strongPtr[i]; k < strongPtr[i + 1]; ++k)
+				aggregate[strongIndex[k]] = numAggregates;
+			numAggregates++;
+		}
+	}
+
+	// Pass 2: add each remaining node to the aggregate of a strong neighbour.
+	std::vector<int> firstPass = aggregate;
+	for(int i = 0; i < n; ++i) {
+		if(aggregate[i] >= 0)
+			continue;
+		for(int k = strongPtr[i]; k < strongPtr[i + 1]; ++k) {
+			if(firstPass[strongIndex[k]] >= 0) {
+				aggregate[i] = firstPass[strongIndex[k]];
+				break;
+			}
+		}
+	}
+
+	// Pass 3: make new aggregates from whatever is left (including isolated nodes).
+	for(int i = 0; i < n; ++i) {
+		if(aggregate[i] >= 0)
+			continue;
+		aggregate[i] = numAggregates;
+		for(int k = strongPtr[i]; k < strongPtr[i + 1]; ++k) {
+			if(aggregate[strongIndex[k]] < 0)
+				aggregate[strongIndex[k]] = numAggregates;
+		}
+		numAggregates++;
+	}
+
+	return numAggregates;
+}
+
+// Estimate the largest eigenvalue of inv(D)*A with a few steps of power iteration.
+template <class T>
+T qbAMG<T>::EstimateSpectralRadius(const qbSparseMatrix<T>& A, const std::vector<T>& invDiagonal) const {
+	int n = A.GetNumRows();
+	std::vector<T> v(n), w(n);
+	qbRandom randomGenerator;
+	randomGenerator.FillUniform(v.data(), n, static_cast<T>(0.0), static_cast<T>(1.0));
+
+	T rho = static_cast<T>(0.0);
+	for(int iteration = 0; iteration < 20; ++iteration) {
+		A.Multiply(v, w);
+		T vNormSq = static_cast<T>(0.0);
+		T wNormSq = static_cast<T>(0.0);
+		for(int i = 0; i < n; ++i) {
+			w[i] *= invDiagonal[i];
+			vNormSq += v[i] * v[i];
+			wNormSq += w[i] * w[i];
+		}
+		if(wNormSq == static_cast<T>(0.0))
+			break;
+		rho = sqrt(wNormSq / vNormSq);
+		T scale = static_cast<T>(1.0) / sqrt(wNormSq);
+		for(int i = 0; i < n; ++i)
+			v[i] = w[i] * scale;
+	}
+	return rho;
+}
+
+// Compute the inverse diagonal and the spectral radius estimate for a level.
+template <class T>
+void qbAMG<T>::ComputeSmootherData(int l) {
+	Level& level = m_levels[l];
+	std::vector<T> diagonal = level.A.Diagonal();
+	level.invDiagonal.resize(diagonal.size());
+	for(size_t i = 0; i < diagonal.size(); ++i)
+		level.invDiagonal[i] = (diagonal[i] != static_cast<T>(0.0)) ? static_cast<T>(1.0) / diagonal[i] : static_cast<T>(0.0);
+	level.rho = EstimateSpectralRadius(level.A, level.invDiagonal);
+}
+
+/* Form the smoothed prolongator, the restriction and the coarse operator below level l.
+	With reusePattern, the patterns from the previous call are kept and only the values
+	are recomputed. */
+template <class T>
+void qbAMG<T>::ComputeTransferOperators(int l, bool reusePattern) {
+	ComputeSmootherData(l);
+	Level& level = m_levels[l];
+	int n = level.A.GetNumRows();
+	const std::vector<int>& rowPtr = level.A.GetRowPtr();
+	const std::vector<int>& colIndex = level.A.GetColIndex();
+	const std::vector<T>& values = level.A.GetValues();
+
+	if(!reusePattern) {
+		// The tentative prolongator: one entry per row, 1/sqrt(aggregate size).
+		int numAggregates = level.numAggregates;
+		std::vector<int> aggregateSize(numAggregates, 0);
+		for(int i = 0; i < n; ++i)
+			aggregateSize[level.aggregate[i]]++;
+		std::vector<int> tentativePtr(n + 1);
+		std::vector<T> tentativeValues(n);
+		for(int i = 0; i < n; ++i) {
+			tentativePtr[i + 1] = i + 1;
+			tentativeValues[i] = static_cast<T>(1.0) / sqrt(static_cast<T>(aggregateSize[level.aggregate[i]]));
+		}
+		level.tentative.SetCSR(n, numAggregates, tentativePtr, level.aggregate, tentativeValues);
+
+		// The pattern of the smoothing operator: the pattern of A, plus the diagonal.
+		std::vector<int> sPtr(n + 1, 0);
+		std::vector<int> sIndex;
+		sIndex.reserve(colIndex.size() + n);
+		for(int i = 0; i < n; ++i) {
+			bool diagonalDone = false;
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+				if((colIndex[k] >= i) and !diagonalDone) {
+					if(colIndex[k] > i)
+						sIndex.push_back(i);
+					diagonalDone = true;
+				}
+				sIndex.push_back(colIndex[k]);
+			}
+			if(!diagonalDone)
+				sIndex.push_back(i);
+			sPtr[i + 1] = sIndex.size();
+		}
+		level.S.SetCSR(n, n, sPtr, sIndex, std::vector<T>(sIndex.size(), static_cast<T>(0.0)));
+	}
+
+	// The smoothing operator S = I - omega * inv(D) * A, with omega = 4 / (3 * rho).
+	T omega = static_cast<T>(4.0) / (static_cast<T>(3.0) * level.rho);
+	const std::vector<int>& sPtr = level.S.GetRowPtr();
+	const std::vector<int>& sIndex = level.S.GetColIndex();
+	std::vector<T>& sValues = level.S.GetValues();
+	const std::vector<T>& invDiagonal = level.invDiagonal;
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i) {
+			T factor = -omega * invDiagonal[i];
+			int ka = rowPtr[i];
+			for(int ks = sPtr[i]; ks < sPtr[i + 1]; ++ks) {
+				sValues[ks] = static_cast<T>(0.0);
+				if((ka < rowPtr[i + 1]) and (colIndex[ka] == sIndex[ks]))
+					sValues[ks] = factor * values[ka++];
+				if(sIndex[ks] == static_cast<int>(i))
+					sValues[ks] += static_cast<T>(1.0);
+			}
+		}
+	});
+
+	// P = S * Ptent, and the Galerkin coarse operator R * (A * P), with R = P'.
+	if(!reusePattern) {
+		qbSpGEMMSymbolic(level.S, level.tentative, level.P);
+		qbSpGEMMSymbolic(level.A, level.P, level.AP);
+	}
+	qbSpGEMMNumeric(level.S, level.tentative, level.P);
+	level.R = level.P.Transpose();
+	qbSpGEMMNumeric(level.A, level.P, level.AP);
+	if(!reusePattern)
+		qbSpGEMMSymbolic(level.R, level.AP, m_levels[l + 1].A);
+	qbSpGEMMNumeric(level.R, level.AP, m_levels[l + 1].A);
+}
+
+// Allocate the work vectors for each level.
+template <class T>
+void qbAMG<T>::AllocateWorkspace() {
+	for(auto& level : m_levels) {
+		int n = level.A.GetNumRows();
+		level.x.assign(n, static_cast<T>(0.0));
+		level.b.assign(n, static_cast<T>(0.0));
+		level.r.assign(n, static_cast<T>(0.0));
+		level.d.assign(n, static_cast<T>(0.0));
+		level.temp.assign(n, static_cast<T>(0.0));
+	}
+}
+
+/* Dense Cholesky factorization of the coarsest operator. A pivot that is zero to within
+	rounding (a singular, semi-definite operator, as with pure Neumann boundary conditions)
+	is dropped, giving a solution in the range of the operator. */
+template <class T>
+void qbAMG<T>::FactorCoarse() {
+	const qbSparseMatrix<T>& A = m_levels.back().A;
+	int n = A.GetNumRows();
+	qbMatrix2<T> dense = A.ToDense();
+	m_coarseFactor.assign(dense.GetData(), dense.GetData() + static_cast<size_t>(n) * n);
+	T* L = m_coarseFactor.data();
+
+	T maxDiagonal = static_cast<T>(0.0);
+	for(int i = 0; i < n; ++i)
+		maxDiagonal = std::max(maxDiagonal, fabs(L[static_cast<size_t>(i) * n + i]));
+	T pivotTolerance = static_cast<T>(n) * static_cast<T>(1e-12) * maxDiagonal;
+
+	for(int j = 0; j < n; ++j) {
+		T* rowJ = L + static_cast<size_t>(j) * n;
+		T pivot = rowJ[j];
+		for(int k = 0; k < j; ++k)
+			pivot -= rowJ[k] * rowJ[k];
+		if(pivot <= pivotTolerance) {
+			for(int k = 0; k <= j; ++k)
+				rowJ[k] = static_cast<T>(0.0);
+			for(int i = j + 1; i < n; ++i)
+				L[static_cast<size_t>(i) * n + j] = static_cast<T>(0.0);
+			continue;
+		}
+		rowJ[j] = sqrt(pivot);
+		for(int i = j + 1; i < n; ++i) {
+			T* rowI = L + static_cast<size_t>(i) * n;
+			T sum = rowI[j];
+			for(int k = 0; k < j; ++k)
+				sum -= rowI[k] * rowJ[k];
+			rowI[j] = sum / rowJ[j];
+		}
+	}
+}
+
+// Solve with the coarse Cholesky factor.
+template <class T>
+void qbAMG<T>::CoarseSolve(const std::vector<T>& b, std::vector<T>& x) const {
+	int n = b.size();
+	const T* L = m_coarseFactor.data();
+	x.resize(n);
+	for(int i = 0; i < n; ++i) {
+		const T* rowI = L + static_cast<size_t>(i) * n;
+		if(rowI[i] == static_cast<T>(0.0)) {
+			x[i] = static_cast<T>(0.0);
+			continue;
+		}
+		T sum = b[i];
+		for(int k = 0; k < i; ++k)
+			sum -= rowI[k] * x[k];
+		x[i] = sum / rowI[i];
+	}
+	for(int i = n - 1; i >= 0; --i) {
+		T lii = L[static_cast<size_t>(i) * n + i];
+		if(lii == static_cast<T>(0.0)) {
+			x[i] = static_cast<T>(0.0);
+			continue;
+		}
+		T sum = x[i];
+		for(int k = i + 1; k < n; ++k)
+			sum -= L[static_cast<size_t>(k) * n + i] * x[k];
+		x[i] = sum / lii;
+	}
+}
+
+/* **************************************************************************************************
+CYCLE AND SMOOTHER FUNCTIONS
+/* *************************************************************************************************/
+// Apply one cycle at the given level, improving x.
+template <class T>
+void qbAMG<T>::Cycle(int l, const std::vector<T>& b, std::vector<T>& x) {
+	int lastLevel = m_levels.size() - 1;
+	if(l == lastLevel) {
+		CoarseSolve(b, x);
+		return;
+	}
+
+	Level& level = m_levels[l];
+	Level& next = m_levels[l + 1];
+	int n = level.A.GetNumRows();
+
+	// Pre-smoothing.
+	Smooth(level, b, x);
+
+	// Restrict the residual and solve (approximately) on the next level.
+	level.A.Multiply(x, level.temp);
+	T* r = level.r.data();
+	const T* bData = b.data();
+	const T* Ax = level.temp.data();
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i)
+			r[i] = bData[i] - Ax[i];
+	});
+	level.R.Multiply(level.r, next.b);
+	std::fill(next.x.begin(), next.x.end(), static_cast<T>(0.0));
+	int numVisits = ((m_cycleType == QBAMG_WCYCLE) and (l + 1 < lastLevel)) ? 2 : 1;
+	for(int visit = 0; visit < numVisits; ++visit)
+		Cycle(l + 1, next.b, next.x);
+
+	// Interpolate the correction.
+	level.P.Multiply(next.x, level.temp);
+	T* xData = x.data();
+	const T* correction = level.temp.data();
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i)
+			xData[i] += correction[i];
+	});
+
+	// Post-smoothing.
+	Smooth(level, b, x);
+}
+
+template <class T>
+void qbAMG<T>::Smooth(Level& level, const std::vector<T>& b, std::vector<T>& x) {
+	if(m_smootherType == QBAMG_JACOBI) {
+		for(int sweep = 0; sweep < m_numSweeps; ++sweep)
+			JacobiSweep(level, b, x);
+	}
+	else {
+		ChebyshevSmooth(level, b, x);
+	}
+}
+
+// One damped Jacobi sweep, x = x + omega * inv(D) * (b - A*x), with omega = 4 / (3 * rho).
+template <class T>
+void qbAMG<T>::JacobiSweep(Level& level, const std::vector<T>& b, std::vector<T>& x) {
+	int n = level.A.GetNumRows();
+	const int* rowPtr = level.A.GetRowPtr().data();
+	const int* colIndex = level.A.GetColIndex().data();
+	const T* values = level.A.GetValues().data();
+	const T* invDiagonal = level.invDiagonal.data();
+	const T* bData = b.data();
+	const T* xOld = x.data();
+	T* xNew = level.temp.data();
+	T omega = static_cast<T>(4.0) / (static_cast<T>(3.0) * level.rho);
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i) {
+			T sum = bData[i];
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+				sum -= values[k] * xOld[colIndex[k]];
+			xNew[i] = xOld[i] + omega * invDiagonal[i] * sum;
+		}
+	});
+	x.swap(level.temp);
+}
+
+/* Chebyshev smoothing: the polynomial of degree m_numSweeps in inv(D)*A that is smallest
+	over [rho/30, 1.1*rho], the upper part of the spectrum, applied with the three term
+	recurrence (Saad, "Iterative Methods for Sparse Linear Systems", Algorithm 12.1). */
+template <class T>
+void qbAMG<T>::ChebyshevSmooth(Level& level, const std::vector<T>& b, std::vector<T>& x) {
+	int n = level.A.GetNumRows();
+	T upper = static_cast<T>(1.1) * level.rho;
+	T lower = level.rho / static_cast<T>(30.0);
+	T theta = (upper + lower) / static_cast<T>(2.0);
+	T delta = (upper - lower) / static_cast<T>(2.0);
+	T sigma = theta / delta;
+	T rhoK = static_cast<T>(1.0) / sigma;
+
+	T* xData = x.data();
+	T* r = level.r.data();
+	T* d = level.d.data();
+	T* Ad = level.temp.data();
+	const T* bData = b.data();
+	const T* invDiagonal = level.invDiagonal.data();
+
+	// r = inv(D) * (b - A*x), d = r / theta.
+	level.A.Multiply(x, level.temp);
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i) {
+			r[i] = invDiagonal[i] * (bData[i] - Ad[i]);
+			d[i] = r[i] / theta;
+		}
+	});
+
+	for(int k = 1; k <= m_numSweeps; ++k) {
+		qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i)
+				xData[i] += d[i];
+		});
+		if(k == m_numSweeps)
+			break;
+
+		level.A.Multiply(level.d, level.temp);
+		T rhoNew = static_cast<T>(1.0) / (static_cast<T>(2.0) * sigma - rhoK);
+		T dFactor = rhoNew * rhoK;
+		T rFactor = static_cast<T>(2.0) * rhoNew / delta;
+		qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i) {
+				r[i] -= invDiagonal[i] * Ad[i];
+				d[i] = dFactor * d[i] + rFactor * r[i];
+			}
+		});
+		rhoK = rhoNew;
+	}
+}
+
+/* **************************************************************************************************
+SOLVER FUNCTIONS
+/* *************************************************************************************************/
+// Solve A*x = b with repeated cycles.
+template <class T>
+int qbAMG<T>::Solve(const std::vector<T>& b, std::vector<T>& x, T tolerance, int maxIterations) {
+	const qbSparseMatrix<T>& A = m_levels[0].A;
+	int n = A.GetNumRows();
+	if(static_cast<int>(b.size()) != n)
+		throw std::invalid_argument("The length of b must equal the number of rows.");
+	if(static_cast<int>(x.size()) != n)
+		x.assign(n, static_cast<T>(0.0));
+
+	T bNorm = static_cast<T>(0.0);
+	for(auto value : b)
+		bNorm += value * value;
+	bNorm = sqrt(bNorm);
+
+	std::vector<T> Ax(n);
+	for(int iteration = 0; iteration < maxIterations; ++iteration) {
+		Cycle(0, b, x);
+
+		A.Multiply(x, Ax);
+		T rNorm = static_cast<T>(0.0);
+		for(int i = 0; i < n; ++i)
+			rNorm += (b[i] - Ax[i]) * (b[i] - Ax[i]);
+		if(sqrt(rNorm) <= tolerance * bNorm)
+			return 1;
+	}
+
+	return QBAMG_MAXITERATIONSEXCEEDED;
+}
+
+// Apply one cycle, from a zero starting point, as a preconditioner.
+template <class T>
+void qbAMG<T>::Precondition(const std::vector<T>& r, std::vector<T>& z) {
+	z.assign(r.size(), static_cast<T>(0.0));
+	Cycle(0, r, z);
+}
+
+/* **************************************************************************************************
+INFORMATION FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+int qbAMG<T>::GetNumLevels() const {
+	return m_levels.size();
+}
+
+template <class T>
+int qbAMG<T>::GetLevelSize(int level) const {
+	return m_levels.at(level).A.GetNumRows();
+}
+
+// The total number of non-zeros in all levels, relative to the number in A.
+template <class T>
+T qbAMG<T>::GetOperatorComplexity() const {
+	if(m_levels.empty())
+		return static_cast<T>(0.0);
+
+	T total = static_cast<T>(0.0);
+	for(const auto& level : m_levels)
+		total += level.A.GetNumNonZeros();
+	return total / static_cast<T>(m_levels[0].A.GetNumNonZeros());
+}
+
+#endif
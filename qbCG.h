@@ -0,0 +1,145 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBCG_H
+#define QBCG_H
+
+/* *************************************************************************************************
+
+	qbCG
+
+	Function to solve the linear system A*x = b, with A symmetric positive definite, using the
+	preconditioned conjugate gradient method. As with qbLSQR, A is only accessed through a
+	callback that computes y = A*x, so it is intended for large sparse systems.
+
+	The preconditioner callback computes z = inv(M)*r for a symmetric positive definite M that
+	approximates A (for example Jacobi scaling, an incomplete factorization, or one multigrid
+	cycle - see qbAMG.h). The number of iterations grows with the square root of the condition
+	number of inv(M)*A, so a good preconditioner is what makes CG practical for large problems.
+
+	*** INPUTS ***
+
+	matVec			FUNCTION		Computes y = A*x, with x and y of length numRows.
+	precondition	FUNCTION		(Optional) Computes z = inv(M)*r, with r and z of length numRows.
+	numRows			INT				The number of rows (and columns) in A.
+	b				std::vector<T>	The right hand side, of length numRows.
+	x				std::vector<T>	The solution (output). If it already has length numRows on
+									entry it is used as the starting point, otherwise the iteration
+									starts from zero.
+	tolerance		T				Iteration stops when ||b - A*x|| <= tolerance * ||b||.
+	maxIterations	INT				The maximum number of iterations.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates that the maximum number of iterations was exceeded.
+						-2 indicates that A (or M) is not positive definite.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <functional>
+
+// Define error codes.
+constexpr int QBCG_MAXITERATIONSEXCEEDED = -1;
+constexpr int QBCG_NOTPOSITIVEDEFINITE = -2;
+
+// The qbCG function, with a preconditioner.
+template <typename T>
+int qbCG(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &precondition,
+	int numRows, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000)
+{
+	if (static_cast<int>(b.size()) != numRows)
+		throw std::invalid_argument("The length of b must equal the number of rows.");
+
+	if (static_cast<int>(x.size()) != numRows)
+		x.assign(numRows, static_cast<T>(0.0));
+
+	// Compute the initial residual, r = b - A*x.
+	std::vector<T> r(numRows);
+	std::vector<T> Ap(numRows);
+	matVec(x, Ap);
+	T bNormSq = static_cast<T>(0.0);
+	T rNormSq = static_cast<T>(0.0);
+	for (int i=0; i<numRows; ++i)
+	{
+		r[i] = b[i] - Ap[i];
+		bNormSq += b[i] * b[i];
+		rNormSq += r[i] * r[i];
+	}
+	T threshold = tolerance * tolerance * bNormSq;
+	if (rNormSq <= threshold)
+		return 1;
+
+	std::vector<T> z(numRows);
+	precondition(r, z);
+	std::vector<T> p = z;
+	T rz = static_cast<T>(0.0);
+	for (int i=0; i<numRows; ++i)
+		rz += r[i] * z[i];
+
+	for (int iteration=0; iteration<maxIterations; ++iteration)
+	{
+		matVec(p, Ap);
+		T pAp = static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+			pAp += p[i] * Ap[i];
+		if (pAp <= static_cast<T>(0.0))
+			return QBCG_NOTPOSITIVEDEFINITE;
+
+		// Update x and r together.
+		T alpha = rz / pAp;
+		rNormSq = static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+		{
+			x[i] += alpha * p[i];
+			r[i] -= alpha * Ap[i];
+			rNormSq += r[i] * r[i];
+		}
+		if (rNormSq <= threshold)
+			return 1;
+
+		precondition(r, z);
+		T rzNew = static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+			rzNew += r[i] * z[i];
+		if (rzNew <= static_cast<T>(0.0))
+			return QBCG_NOTPOSITIVEDEFINITE;
+
+		T beta = rzNew / rz;
+		rz = rzNew;
+		for (int i=0; i<numRows; ++i)
+			p[i] = z[i] + beta * p[i];
+	}
+
+	return QBCG_MAXITERATIONSEXCEEDED;
+}
+
+// The qbCG function, without a preconditioner.
+template <typename T>
+int qbCG(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	int numRows, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000)
+{
+	auto identity = [](const std::vector<T> &r, std::vector<T> &z)
+	{
+		z = r;
+	};
+	return qbCG<T>(matVec, identity, numRows, b, x, tolerance, maxIterations);
+}
+
+#endif
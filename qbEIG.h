@@ -10,15 +10,243 @@
 #include <iomanip>
 #include <math.h>
 #include <vector>
+#include <algorithm>
+#include <functional>
 
 #include "qbMatrix.h"
 #include "qbVector.h"
 #include "qbQR.h"
+#include "qbGivens.h"
+#include "qbGEMM.h"
+#include "qbRandom.h"
+#include "qbLU.h"
 
 // Define error codes.
 constexpr int QBEIG_MATRIXNOTSQUARE = -1;
 constexpr int QBEIG_MAXITERATIONSEXCEEDED = -2;
 constexpr int QBEIG_MATRIXNOTSYMMETRIC = -3;
+constexpr int QBEIG_SINGULARSHIFT = -4;
+
+namespace qbEIGKernels
+{
+
+/* Orthonormalize the columns of V in place using modified Gram-Schmidt, applied
+	twice for numerical orthogonality ("twice is enough"). Columns that are
+	(numerically) linearly dependent on the previous ones are replaced by a unit
+	vector orthogonal to them. */
+template <typename T>
+void Orthonormalize(qbMatrix2<T> &V)
+{
+	int n = V.GetNumRows();
+	int k = V.GetNumCols();
+	T *v = V.GetData();
+	for (int j=0; j<k; ++j)
+	{
+		// Norm of the column before orthogonalization, to detect dependence.
+		T originalNorm = static_cast<T>(0.0);
+		for (int i=0; i<n; ++i)
+			originalNorm += v[(size_t)i*k + j] * v[(size_t)i*k + j];
+		originalNorm = sqrt(originalNorm);
+
+		int replacement = 0;
+		T norm = static_cast<T>(0.0);
+		while (true)
+		{
+			for (int pass=0; pass<2; ++pass)
+			{
+				for (int p=0; p<j; ++p)
+				{
+					T dotProduct = static_cast<T>(0.0);
+					for (int i=0; i<n; ++i)
+						dotProduct += v[(size_t)i*k + p] * v[(size_t)i*k + j];
+					for (int i=0; i<n; ++i)
+						v[(size_t)i*k + j] -= dotProduct * v[(size_t)i*k + p];
+				}
+			}
+
+			norm = static_cast<T>(0.0);
+			for (int i=0; i<n; ++i)
+				norm += v[(size_t)i*k + j] * v[(size_t)i*k + j];
+			norm = sqrt(norm);
+
+			if ((norm > static_cast<T>(1e-10) * originalNorm) || (replacement >= n))
+				break;
+
+			// Replace a dependent column by the next unit vector and try again.
+			for (int i=0; i<n; ++i)
+				v[(size_t)i*k + j] = (i == replacement) ? static_cast<T>(1.0) : static_cast<T>(0.0);
+			originalNorm = static_cast<T>(1.0);
+			replacement++;
+		}
+
+		for (int i=0; i<n; ++i)
+			v[(size_t)i*k + j] /= norm;
+	}
+}
+
+// Replace a (nearly) symmetric matrix by its symmetric part, (A + A')/2.
+template <typename T>
+void Symmetrize(qbMatrix2<T> &A)
+{
+	int n = A.GetNumRows();
+	T *a = A.GetData();
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=i+1; j<n; ++j)
+		{
+			T average = static_cast<T>(0.5) * (a[(size_t)i*n + j] + a[(size_t)j*n + i]);
+			a[(size_t)i*n + j] = average;
+			a[(size_t)j*n + i] = average;
+		}
+	}
+	A.SetProperties(QBMATRIX_SYMMETRIC);
+}
+
+/* Fused matrix-vector product and norm for power iteration. Computes
+	z = scale * (A * w) for the n x n row-major matrix A in a single pass, while
+	also accumulating zz = z.z, xz = x.z and rr = ||z - shift*x||^2, where
+	x = scale * w is the current (normalized) iterate. Folding the scale factor
+	into the product means that the normalization of the previous iterate never
+	needs a pass of its own. */
+template <typename T>
+void GEMVNorm(int n, const T *A, const T *w, T scale, T shift, T *z, T &zz, T &xz, T &rr)
+{
+	T zzSum = static_cast<T>(0.0);
+	T xzSum = static_cast<T>(0.0);
+	T rrSum = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+	{
+		const T *aRow = A + (size_t)i*n;
+		T rowSum = static_cast<T>(0.0);
+		for (int j=0; j<n; ++j)
+			rowSum += aRow[j] * w[j];
+
+		T xi = scale * w[i];
+		T zi = scale * rowSum;
+		z[i] = zi;
+		zzSum += zi * zi;
+		xzSum += xi * zi;
+		rrSum += (zi - shift * xi) * (zi - shift * xi);
+	}
+	zz = zzSum;
+	xz = xzSum;
+	rr = rrSum;
+}
+
+}
+
+/* Function to compute the eigenvalues and eigenvectors of a (small) symmetric matrix
+	using the cyclic Jacobi method. The eigenvalues are returned in descending order,
+	with the corresponding eigenvectors as the columns of eigenVectors. Jacobi is
+	particularly effective when the matrix is already close to diagonal, as is the
+	case for the projected matrices in qbEigSubspace. */
+template <typename T>
+int qbEigJacobi(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues, qbMatrix2<T> &eigenVectors,
+	int maxSweeps = 50)
+{
+	// Verify that the input matrix is square and symmetric.
+	qbMatrix2<T> A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	int n = A.GetNumRows();
+	qbMatrix2<T> V(n, n);
+	V.SetToIdentity();
+	T *a = A.GetData();
+	T *v = V.GetData();
+
+	/* Sweep over the off-diagonal elements until they are negligible. The test is made before
+		each sweep and once more after the last one, so that a final sweep that converges counts. */
+	int sweep = 0;
+	bool converged = false;
+	while (!converged)
+	{
+		T offDiagonal = static_cast<T>(0.0);
+		T diagonal = static_cast<T>(0.0);
+		for (int i=0; i<n; ++i)
+		{
+			diagonal += a[(size_t)i*n + i] * a[(size_t)i*n + i];
+			for (int j=i+1; j<n; ++j)
+				offDiagonal += a[(size_t)i*n + j] * a[(size_t)i*n + j];
+		}
+		if (offDiagonal <= static_cast<T>(1e-30) * diagonal || offDiagonal == static_cast<T>(0.0))
+		{
+			converged = true;
+			break;
+		}
+		if (sweep == maxSweeps)
+			break;
+
+		for (int p=0; p<n-1; ++p)
+		{
+			for (int q=p+1; q<n; ++q)
+			{
+				T apq = a[(size_t)p*n + q];
+				if (apq == static_cast<T>(0.0))
+					continue;
+
+				// Compute the rotation that annihilates A(p,q).
+				T app = a[(size_t)p*n + p];
+				T aqq = a[(size_t)q*n + q];
+				T theta = (aqq - app) / (static_cast<T>(2.0) * apq);
+				T t = ((theta >= static_cast<T>(0.0)) ? static_cast<T>(1.0) : static_cast<T>(-1.0))
+					/ (fabs(theta) + sqrt(theta*theta + static_cast<T>(1.0)));
+				T c = static_cast<T>(1.0) / sqrt(t*t + static_cast<T>(1.0));
+				T sn = t * c;
+
+				// Apply the rotation to rows / columns p and q of A.
+				for (int k=0; k<n; ++k)
+				{
+					T akp = a[(size_t)k*n + p];
+					T akq = a[(size_t)k*n + q];
+					a[(size_t)k*n + p] = c*akp - sn*akq;
+					a[(size_t)k*n + q] = sn*akp + c*akq;
+				}
+				for (int k=0; k<n; ++k)
+				{
+					T apk = a[(size_t)p*n + k];
+					T aqk = a[(size_t)q*n + k];
+					a[(size_t)p*n + k] = c*apk - sn*aqk;
+					a[(size_t)q*n + k] = sn*apk + c*aqk;
+				}
+
+				// Accumulate the eigenvectors.
+				for (int k=0; k<n; ++k)
+				{
+					T vkp = v[(size_t)k*n + p];
+					T vkq = v[(size_t)k*n + q];
+					v[(size_t)k*n + p] = c*vkp - sn*vkq;
+					v[(size_t)k*n + q] = sn*vkp + c*vkq;
+				}
+			}
+		}
+		sweep++;
+	}
+
+	// Sort into descending order of eigenvalue.
+	std::vector<int> order(n);
+	for (int i=0; i<n; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [a, n](int i, int j) { return a[(size_t)i*n + i] > a[(size_t)j*n + j]; });
+
+	eigenValues.resize(n);
+	eigenVectors.Resize(n, n);
+	T *ev = eigenVectors.GetData();
+	for (int j=0; j<n; ++j)
+	{
+		eigenValues[j] = a[(size_t)order[j]*n + order[j]];
+		for (int i=0; i<n; ++i)
+			ev[(size_t)i*n + j] = v[(size_t)i*n + order[j]];
+	}
+
+	if (!converged)
+		return QBEIG_MAXITERATIONSEXCEEDED;
+
+	return 0;
+}
 
 // Function to estimate (real) eigenvalues using QR decomposition.
 /* Note that this is only valid for matrices that have ALL real
@@ -26,7 +254,7 @@ constexpr int QBEIG_MATRIXNOTSYMMETRIC = -3;
 	real eigenvalues are symmetric matrices. Therefore, this function
 	is only guaranteed to work with symmetric matrices. */
 template <typename T>
-int qbEigQR(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues)
+int qbEigQR(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues, int maxIterations = 10000)
 {
 	// Make a copy of the input matrix.
 	qbMatrix2<T> A = inputMatrix;
@@ -42,29 +270,26 @@ int qbEigQR(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues)
 	// The number of eigenvalues is equal to the number of rows.
 	int numRows = A.GetNumRows();
 	
-	// Create an identity matrix of the same dimensions.
-	qbMatrix2<T> identityMatrix(numRows, numRows);
-	identityMatrix.SetToIdentity();
-	
-	// Create matrices to store Q and R.
-	qbMatrix2<T> Q (numRows, numRows);
-	qbMatrix2<T> R (numRows, numRows);
+	/* Reduce A to upper Hessenberg form once (for a symmetric matrix this is tridiagonal).
+		The QR algorithm preserves this form, so each iteration can then be done with n-1
+		Givens rotations in O(n^2) operations, instead of a full QR decomposition and a
+		matrix product. */
+	qbHouseholderKernels::ReduceToHessenberg(numRows, A.GetData());
+	std::vector<qbGivensKernels::Rotation<T>> rotations;
 	
 	// Loop through each iteration.
-	int maxIterations = 10e3;
 	int iterationCount = 0;
 	bool continueFlag = true;
 	while ((iterationCount < maxIterations) && continueFlag)
 	{
-		// Compute the QR decomposition of A.
-		int returnValue = qbQR<T>(A, Q, R);
-		
-		// Compute the next value of A as the product of R and Q.
-		A = R * Q;
+		// Compute the QR decomposition of A, and the next value of A as the product of R and Q.
+		qbGivensKernels::HessenbergQRStep(numRows, A.GetData(), rotations);
 		
 		/* Check if A is now close enough to being upper-triangular.
 			We can do this using the IsRowEchelon() function from the 
-			qbMatrix2 class. */
+			qbMatrix2 class. A is still upper Hessenberg, and telling it
+			so means that only the subdiagonal has to be tested. */
+		A.SetProperties(QBMATRIX_UPPERHESSENBERG);
 		if (A.IsRowEchelon())
 			continueFlag = false;
 						
@@ -77,16 +302,59 @@ int qbEigQR(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues)
 		eigenValues.push_back(A.GetElement(i,i));
 	
 	// Set the return status accordingly.
-	if (iterationCount == maxIterations)
+	if (continueFlag)
 		return QBEIG_MAXITERATIONSEXCEEDED;
 	else
 		return 0;	
 	
 }
 
-// Function to perform inverse power iteration method.
+// Function to estimate (real) eigenvalues, warm-started from a previous eigenbasis.
+/* The columns of initialBasis should be (approximate) eigenvectors of a similar matrix, for
+	example from the previous run on slowly drifting data. This is the Rayleigh-Ritz step:
+	V'AV, where V is an orthonormalized copy of initialBasis, has the same eigenvalues as A
+	but is already close to diagonal. Its eigenvalues are computed with qbEigJacobi (at most
+	maxSweeps sweeps), which converges quadratically from there; the QR algorithm would first
+	reduce V'AV to Hessenberg form, which mixes its rows and loses the head start. */
 template <typename T>
-int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &eigenVector)
+int qbEigQR(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues, const qbMatrix2<T> &initialBasis,
+	int maxSweeps = 50)
+{
+	// Verify that the input matrix is square and symmetric.
+	qbMatrix2<T> A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	// The basis must be complete for the transformed matrix to have the same eigenvalues.
+	if ((initialBasis.GetNumRows() != A.GetNumRows()) || (initialBasis.GetNumCols() != A.GetNumCols()))
+		return qbEigQR(inputMatrix, eigenValues);
+
+	// Orthonormalize the basis and form V'AV.
+	qbMatrix2<T> V = initialBasis;
+	qbEIGKernels::Orthonormalize(V);
+	qbMatrix2<T> AV, VtAV;
+	qbGEMM(A, V, AV);
+	qbGEMM(V.Transpose(), AV, VtAV);
+
+	// Restore exact symmetry, which rounding in the products may have disturbed.
+	qbEIGKernels::Symmetrize(VtAV);
+
+	std::vector<T> values;
+	qbMatrix2<T> Y;
+	int returnStatus = qbEigJacobi(VtAV, values, Y, maxSweeps);
+	eigenValues.insert(eigenValues.end(), values.begin(), values.end());
+	return returnStatus;
+}
+
+// Function to perform inverse power iteration method, starting from the given initial vector.
+/* Passing a previously computed eigenvector as initialVector (a warm start) typically
+	means that only a couple of iterations are required. */
+template <typename T>
+int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &eigenVector, const qbVector<T> &initialVector,
+	int maxIterations = 100)
 {
 	// Make a copy of the input matrix.
 	qbMatrix2<T> A = inputMatrix;
@@ -94,11 +362,6 @@ int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &
 	// Verify that the input matrix is square.
 	if (!A.IsSquare())
 		return QBEIG_MATRIXNOTSQUARE;
-		
-  // Setup a random number generator.
-	std::random_device myRandomDevice;
-  std::mt19937 myRandomGenerator(myRandomDevice());
-	std::uniform_int_distribution<int> myDistribution(1.0, 10.0);
 	
 	/* The number of eigenvectors and eigenvalues that we will compute will be
 		equal to the number of rows in the input matrix. */
@@ -108,32 +371,43 @@ int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &
 	qbMatrix2<T> identityMatrix(numRows, numRows);
 	identityMatrix.SetToIdentity();
 	
-	// Create an initial vector, v.
-	qbVector<T> v(numRows);
-	for (int i=0; i<numRows; ++i)
-		v.SetElement(i, static_cast<T>(myDistribution(myRandomGenerator)));
+	// Start from the initial vector, v.
+	qbVector<T> v = initialVector;
+	v.Normalize();
+
+	/* Factorize the shifted matrix. This does not change between iterations, so we only need
+		to do it once, and each iteration is then an O(n^2) solve. A shift that is (numerically)
+		equal to an eigenvalue makes the matrix singular, so move it slightly away, which
+		changes only the rate of convergence. */
+	qbLU<T> shiftedLU;
+	T shift = eigenValue;
+	T perturbation = std::max(static_cast<T>(1.0), static_cast<T>(fabs(eigenValue))) * static_cast<T>(1e-7);
+	for (int attempt=0; (shiftedLU.Factorize(A - (shift * identityMatrix)) != 1) && (attempt < 3); ++attempt)
+	{
+		shift += perturbation;
+		perturbation *= static_cast<T>(10.0);
+	}
+	if (shiftedLU.IsSingular())
+		return QBEIG_SINGULARSHIFT;
 		
 	// Iterate.
-	int maxIterations = 100;
 	int iterationCount = 0;
 	T deltaThreshold = static_cast<T>(1e-9);
 	T delta = static_cast<T>(1e6);
 	qbVector<T> prevVector(numRows);
-	qbMatrix2<T> tempMatrix(numRows, numRows);
 	
 	while ((iterationCount < maxIterations) && (delta > deltaThreshold))
 	{
 		// Store a copy of the current working vector to use for computing delta.
 		prevVector = v;
 		
-		// Compute the next value of v.
-		tempMatrix = A - (eigenValue * identityMatrix);
-		tempMatrix.Inverse();
-		v = tempMatrix * v;
+		// Compute the next value of v, by solving (A - shift*I)*v = prevVector.
+		shiftedLU.Solve(prevVector.GetData(), v.GetData());
 		v.Normalize();
 		
-		// Compute delta.
-		delta = (v - prevVector).norm();
+		/* Compute delta. If the shifted eigenvalue is negative, v changes sign on
+			each iteration, so we compare against both signs. */
+		delta = std::min((v - prevVector).norm(), (v + prevVector).norm());
 		
 		// Increment iteration count.
 		iterationCount++;
@@ -143,16 +417,37 @@ int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &
 	eigenVector = v;
 	
 	// Set the return status accordingly.
-	if (iterationCount == maxIterations)
+	if (delta > deltaThreshold)
 		return QBEIG_MAXITERATIONSEXCEEDED;
 	else
 		return 0;
 		
 }
 
-// The qbEIG function (power iteration method).
+// Function to perform inverse power iteration method.
 template <typename T>
-int qbEIG_PIt(const qbMatrix2<T> &X, T &eigenValue, qbVector<T> &eigenVector)
+int qbInvPIt(const qbMatrix2<T> &inputMatrix, const T &eigenValue, qbVector<T> &eigenVector, uint64_t seed = QBRANDOM_DEFAULTSEED,
+	int maxIterations = 100)
+{
+	// Verify that the input matrix is square.
+	if (!inputMatrix.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+		
+	// Create a random initial vector, v.
+	int numRows = inputMatrix.GetNumRows();
+	qbVector<T> v(numRows);
+	qbRandom randomGenerator(seed);
+	randomGenerator.FillUniform(v, static_cast<T>(1.0), static_cast<T>(10.0));
+		
+	return qbInvPIt<T>(inputMatrix, eigenValue, eigenVector, v, maxIterations);
+}
+
+/* The qbEIG function (power iteration method).
+	Iterates until the residual ||Av - lambda*v|| falls below tolerance * |lambda|, with
+	lambda estimated by the Rayleigh quotient, or until maxIterations is reached. */
+template <typename T>
+int qbEIG_PIt(const qbMatrix2<T> &X, T &eigenValue, qbVector<T> &eigenVector, T tolerance = static_cast<T>(1e-10), int maxIterations = 1000,
+	uint64_t seed = QBRANDOM_DEFAULTSEED)
 {
 	// Make a copy of the input matrix.
 	qbMatrix2<T> inputMatrix = X;
@@ -161,51 +456,373 @@ int qbEIG_PIt(const qbMatrix2<T> &X, T &eigenValue, qbVector<T> &eigenVector)
 	if (!inputMatrix.IsSquare())
 		return QBEIG_MATRIXNOTSQUARE;
 	
-  // Setup a random number generator.
-	std::random_device myRandomDevice;
-  std::mt19937 myRandomGenerator(myRandomDevice());
-	std::uniform_int_distribution<int> myDistribution(1.0, 10.0);
-	
 	/* The number of eigenvectors and eigenvalues that we will compute will be
 		equal to the number of rows in the input matrix. */
 	int numRows = inputMatrix.GetNumRows();
-	
-	// Create an identity matrix of the same dimensions.
-	qbMatrix2<T> identityMatrix(numRows, numRows);
-	identityMatrix.SetToIdentity();
 
 	/* **************************************************************
 		Compute the eigenvector.
 	************************************************************** */
 		
-	// Create an initial vector, v.
-	qbVector<T> v(numRows);
+	/* Create an initial vector, w. We work with two buffers that are swapped
+		each iteration, so nothing is allocated inside the loop. The current
+		iterate is x = scale * w. */
+	std::vector<T> w(numRows);
+	std::vector<T> z(numRows);
+	qbRandom randomGenerator(seed);
+	randomGenerator.FillUniform(w.data(), w.size(), static_cast<T>(1.0), static_cast<T>(10.0));
+	T sumSq = static_cast<T>(0.0);
 	for (int i=0; i<numRows; ++i)
-		v.SetElement(i, static_cast<T>(myDistribution(myRandomGenerator)));
+		sumSq += w[i] * w[i];
+	T scale = static_cast<T>(1.0) / sqrt(sumSq);
 		
-	// Loop over the required number of iterations.
-	qbVector<T> v1(numRows);
-	int numIterations = 1000;
-	for (int i=0; i<numIterations; ++i)
+	// Iterate until the residual is small enough.
+	const T *A = inputMatrix.GetData();
+	T lambda = static_cast<T>(0.0);
+	T zz = static_cast<T>(0.0);
+	T xz = static_cast<T>(0.0);
+	T rr = static_cast<T>(0.0);
+	bool converged = false;
+	int iterationCount = 0;
+	while ((iterationCount < maxIterations) && !converged)
 	{
-		v1 = inputMatrix * v;
-		v1.Normalize();
-		v = v1;
-	}
+		/* z = A*x, together with z.z, x.z and the residual ||z - lambda*x||, using the
+			eigenvalue estimate from the previous iteration. Since the Rayleigh quotient
+			minimizes this residual, the test below is conservative. */
+		qbEIGKernels::GEMVNorm(numRows, A, w.data(), scale, lambda, z.data(), zz, xz, rr);
+		converged = (sqrt(rr) <= tolerance * fabs(lambda));
 
-	// Store this eigenvector.
-	eigenVector = v1;
-	
-	/* **************************************************************
-		Compute the eigenvalue corresponding to this eigenvector.
-	************************************************************** */	
-	
-	// Compute the cumulative sum.
-	T cumulativeSum = static_cast<T>(0.0);
-	for (int i=1; i<numRows; ++i)
-		cumulativeSum += inputMatrix.GetElement(0,i) * v1.GetElement(i);
+		// The Rayleigh quotient gives the new eigenvalue estimate.
+		lambda = xz;
+
+		// The new iterate is z / ||z||.
+		std::swap(w, z);
+		if (zz > static_cast<T>(0.0))
+			scale = static_cast<T>(1.0) / sqrt(zz);
 		
-	eigenValue = (cumulativeSum / v1.GetElement(0)) + inputMatrix.GetElement(0,0);
+		iterationCount++;
+	}
+
+	// Store this eigenvector and the corresponding eigenvalue.
+	for (int i=0; i<numRows; ++i)
+		w[i] *= scale;
+	eigenVector = qbVector<T>(w);
+	eigenValue = lambda;
+
+	if (!converged)
+		return QBEIG_MAXITERATIONSEXCEEDED;
+
+	return 0;
+}
+
+/* Power iteration with several random starts run together.
+	The numStarts start vectors are stored as the columns of an [n x numStarts] block, so
+	that each iteration is a single blocked matrix-matrix product rather than numStarts
+	matrix-vector products, which reuses each element of A numStarts times while it is in
+	cache. The result is the converged pair with the largest |eigenvalue|, which guards
+	against an unlucky start that is (nearly) orthogonal to the dominant eigenvector. */
+template <typename T>
+int qbEIG_PItMulti(const qbMatrix2<T> &X, int numStarts, T &eigenValue, qbVector<T> &eigenVector, T tolerance = static_cast<T>(1e-10), int maxIterations = 1000,
+	uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	// Verify that the input matrix is square.
+	if (!X.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (numStarts < 1)
+		numStarts = 1;
+
+	int numRows = X.GetNumRows();
+	int s = numStarts;
+
+	// Create the block of start vectors (row-major, one column per start) and normalize.
+	std::vector<T> V((size_t)numRows*s);
+	std::vector<T> W((size_t)numRows*s);
+	qbRandom randomGenerator(seed);
+	randomGenerator.FillGaussian(V.data(), V.size(), static_cast<T>(0.0), static_cast<T>(1.0));
+
+	std::vector<T> zz(s, static_cast<T>(0.0));
+	std::vector<T> xz(s, static_cast<T>(0.0));
+	std::vector<T> rr(s, static_cast<T>(0.0));
+	std::vector<T> lambda(s, static_cast<T>(0.0));
+	std::vector<T> invNorm(s, static_cast<T>(0.0));
+	std::vector<bool> converged(s, false);
+	for (int i=0; i<numRows; ++i)
+		for (int j=0; j<s; ++j)
+			zz[j] += V[(size_t)i*s + j] * V[(size_t)i*s + j];
+	for (int i=0; i<numRows; ++i)
+		for (int j=0; j<s; ++j)
+			V[(size_t)i*s + j] /= sqrt(zz[j]);
+
+	int best = 0;
+	int iterationCount = 0;
+	bool finished = false;
+	while ((iterationCount < maxIterations) && !finished)
+	{
+		// W = A*V as a single blocked product.
+		qbGEMMKernels::BlockedGEMM(numRows, s, numRows, X.GetData(), numRows, V.data(), s, W.data(), s, false);
+
+		// Column norms, Rayleigh quotients and residuals in one pass over the block.
+		std::fill(zz.begin(), zz.end(), static_cast<T>(0.0));
+		std::fill(xz.begin(), xz.end(), static_cast<T>(0.0));
+		std::fill(rr.begin(), rr.end(), static_cast<T>(0.0));
+		for (int i=0; i<numRows; ++i)
+		{
+			const T *vRow = V.data() + (size_t)i*s;
+			const T *wRow = W.data() + (size_t)i*s;
+			for (int j=0; j<s; ++j)
+			{
+				T r = wRow[j] - lambda[j] * vRow[j];
+				zz[j] += wRow[j] * wRow[j];
+				xz[j] += vRow[j] * wRow[j];
+				rr[j] += r * r;
+			}
+		}
+
+		// Check each start for convergence and find the current best.
+		best = 0;
+		for (int j=0; j<s; ++j)
+		{
+			converged[j] = (sqrt(rr[j]) <= tolerance * fabs(lambda[j]));
+			lambda[j] = xz[j];
+			if (fabs(lambda[j]) > fabs(lambda[best]))
+				best = j;
+		}
+		finished = converged[best];
+
+		// Normalize the new block of iterates.
+		for (int j=0; j<s; ++j)
+			invNorm[j] = (zz[j] > static_cast<T>(0.0)) ? static_cast<T>(1.0) / sqrt(zz[j]) : static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+			for (int j=0; j<s; ++j)
+				W[(size_t)i*s + j] *= invNorm[j];
+		std::swap(V, W);
+
+		iterationCount++;
+	}
+
+	// Return the best eigenpair.
+	std::vector<T> result(numRows);
+	for (int i=0; i<numRows; ++i)
+		result[i] = V[(size_t)i*s + best];
+	eigenVector = qbVector<T>(result);
+	eigenValue = lambda[best];
+
+	if (!finished)
+		return QBEIG_MAXITERATIONSEXCEEDED;
+
+	return 0;
+}
+
+/* Top-k eigenpairs by power iteration with implicit deflation.
+	The matrix is only accessed through the matVec callback, which must compute
+	y = A*x, so A can be stored in any form (dense, sparse or matrix-free). Once
+	an eigenpair (lambda_j, u_j) has converged, it is deflated by projecting
+	the iterate onto the orthogonal complement of the converged eigenvectors
+	before and after each product, i.e. we iterate with P*A*P, P = I - U*U'.
+	For symmetric A this has the same effect as Hotelling deflation,
+	A - sum(lambda_j * u_j * u_j'), but the stored matrix is never modified or
+	copied, and it costs only O(n*k) extra work per product.
+	Eigenpairs are returned in order of decreasing |eigenvalue|. Only valid for
+	symmetric matrices, and intended for small k. */
+template <typename T>
+int qbEIG_PItTopK(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec, int numRows, int k,
+	std::vector<T> &eigenValues, std::vector<qbVector<T>> &eigenVectors,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	k = std::min(k, numRows);
+	qbRandom randomGenerator(seed);
+
+	// Storage for the converged eigenvectors.
+	std::vector<std::vector<T>> U;
+	eigenValues.clear();
+	eigenVectors.clear();
+
+	// Function to project a vector onto the orthogonal complement of U.
+	auto Project = [&U, numRows](std::vector<T> &v)
+	{
+		for (const auto &u : U)
+		{
+			T dotProduct = static_cast<T>(0.0);
+			for (int i=0; i<numRows; ++i)
+				dotProduct += u[i] * v[i];
+			for (int i=0; i<numRows; ++i)
+				v[i] -= dotProduct * u[i];
+		}
+	};
+
+	int returnStatus = 0;
+	std::vector<T> x(numRows);
+	std::vector<T> z(numRows);
+	for (int p=0; p<k; ++p)
+	{
+		// Create a random start vector in the deflated subspace.
+		randomGenerator.FillGaussian(x.data(), x.size(), static_cast<T>(0.0), static_cast<T>(1.0));
+		Project(x);
+		T sumSq = static_cast<T>(0.0);
+		for (auto element : x)
+			sumSq += element * element;
+		for (auto &element : x)
+			element /= sqrt(sumSq);
+
+		T lambda = static_cast<T>(0.0);
+		bool converged = false;
+		int iterationCount = 0;
+		while ((iterationCount < maxIterations) && !converged)
+		{
+			// z = P*A*x (x is already in the deflated subspace).
+			matVec(x, z);
+			Project(z);
+
+			// Norm, Rayleigh quotient and residual in a single pass.
+			T zz = static_cast<T>(0.0);
+			T xz = static_cast<T>(0.0);
+			T rr = static_cast<T>(0.0);
+			for (int i=0; i<numRows; ++i)
+			{
+				T r = z[i] - lambda * x[i];
+				zz += z[i] * z[i];
+				xz += x[i] * z[i];
+				rr += r * r;
+			}
+
+			// If the deflated matrix annihilates x, the remaining eigenvalues are zero.
+			if (zz == static_cast<T>(0.0))
+			{
+				lambda = static_cast<T>(0.0);
+				converged = true;
+				break;
+			}
+
+			converged = (sqrt(rr) <= tolerance * fabs(lambda));
+			lambda = xz;
+
+			T invNorm = static_cast<T>(1.0) / sqrt(zz);
+			for (int i=0; i<numRows; ++i)
+				x[i] = z[i] * invNorm;
+
+			iterationCount++;
+		}
+
+		if (!converged)
+			returnStatus = QBEIG_MAXITERATIONSEXCEEDED;
+
+		// Store this eigenpair and deflate it from subsequent iterations.
+		U.push_back(x);
+		eigenValues.push_back(lambda);
+		eigenVectors.push_back(qbVector<T>(x));
+	}
+
+	return returnStatus;
+}
+
+// Top-k eigenpairs by power iteration, for a dense symmetric matrix.
+template <typename T>
+int qbEIG_PItTopK(const qbMatrix2<T> &X, int k, std::vector<T> &eigenValues, std::vector<qbVector<T>> &eigenVectors,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	// Verify that the input matrix is square and symmetric.
+	if (!X.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!X.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	int numRows = X.GetNumRows();
+	const T *aData = X.GetData();
+	auto matVec = [aData, numRows](const std::vector<T> &x, std::vector<T> &y)
+	{
+		for (int i=0; i<numRows; ++i)
+		{
+			const T *aRow = aData + (size_t)i*numRows;
+			T rowSum = static_cast<T>(0.0);
+			for (int j=0; j<numRows; ++j)
+				rowSum += aRow[j] * x[j];
+			y[i] = rowSum;
+		}
+	};
+
+	return qbEIG_PItTopK<T>(matVec, numRows, k, eigenValues, eigenVectors, tolerance, maxIterations, seed);
+}
+
+/* Subspace iteration with Rayleigh-Ritz refinement, warm-started from an initial basis.
+	The columns of initialBasis [n x k] span the starting subspace, for example the
+	eigenvectors from a previous solve on a similar matrix. Each iteration projects A onto
+	the current subspace, solves the small [k x k] eigenproblem with qbEigJacobi and forms
+	the Ritz vectors. Iteration stops once every Ritz pair satisfies
+	||A*v - theta*v|| <= tolerance * max|theta|. When the initial basis is already close
+	to the wanted eigenvectors this takes only one or two iterations. For k < n, the
+	subspace converges towards the k largest-magnitude eigenvalues. The eigenvalues are
+	returned in descending order. Only valid for symmetric matrices. */
+template <typename T>
+int qbEigSubspace(const qbMatrix2<T> &inputMatrix, const qbMatrix2<T> &initialBasis, std::vector<T> &eigenValues,
+	qbMatrix2<T> &eigenVectors, T tolerance = static_cast<T>(1e-10), int maxIterations = 100)
+{
+	// Verify that the input matrix is square and symmetric.
+	const qbMatrix2<T> &A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	int n = A.GetNumRows();
+	int k = initialBasis.GetNumCols();
+	if ((initialBasis.GetNumRows() != n) || (k < 1) || (k > n))
+		throw std::invalid_argument("The initial basis must have the same number of rows as the matrix, and between 1 and n columns.");
+
+	qbMatrix2<T> V = initialBasis;
+	qbMatrix2<T> W, H, Y, ritzVectors, ritzProducts;
+	std::vector<T> theta;
+	bool converged = false;
+	int iterationCount = 0;
+	while ((iterationCount < maxIterations) && !converged)
+	{
+		// Orthonormal basis for the current subspace, and its image under A.
+		qbEIGKernels::Orthonormalize(V);
+		qbGEMM(A, V, W);
+
+		// Rayleigh-Ritz: project A onto the subspace and solve the small problem.
+		qbGEMM(V.Transpose(), W, H);
+		qbEIGKernels::Symmetrize(H);
+		qbEigJacobi(H, theta, Y);
+
+		// Ritz vectors, V*Y, and their images, A*V*Y = W*Y.
+		qbGEMM(V, Y, ritzVectors);
+		qbGEMM(W, Y, ritzProducts);
+
+		// Check the residual of each Ritz pair.
+		T maxTheta = static_cast<T>(0.0);
+		for (auto value : theta)
+			maxTheta = std::max(maxTheta, static_cast<T>(fabs(value)));
+
+		converged = true;
+		const T *x = ritzVectors.GetData();
+		const T *ax = ritzProducts.GetData();
+		for (int j=0; (j<k) && converged; ++j)
+		{
+			T residual = static_cast<T>(0.0);
+			for (int i=0; i<n; ++i)
+			{
+				T r = ax[(size_t)i*k + j] - theta[j] * x[(size_t)i*k + j];
+				residual += r * r;
+			}
+			if (sqrt(residual) > tolerance * maxTheta)
+				converged = false;
+		}
+
+		// The next subspace is A applied to the current Ritz vectors.
+		if (!converged)
+			V = ritzProducts;
+
+		iterationCount++;
+	}
+
+	eigenValues = theta;
+	eigenVectors = ritzVectors;
+
+	if (!converged)
+		return QBEIG_MAXITERATIONSEXCEEDED;
 
 	return 0;
 }
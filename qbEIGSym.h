@@ -0,0 +1,1214 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBEIGSYM_H
+#define QBEIGSYM_H
+
+/* *************************************************************************************************
+
+	qbTridiagonalize / qbTridiagonalizeTwoStage / qbEigTridiagonal / qbEigSymmetric
+
+	Functions to compute ALL the eigenvalues and eigenvectors of a dense symmetric matrix, by
+	reduction to tridiagonal form followed by Cuppen's divide-and-conquer method.
+
+	*** INPUTS ***
+
+	A					qbMatrix2<T>		The (square, symmetric) input matrix.
+	d					std::vector<T>		(qbEigTridiagonal only) The diagonal of the tridiagonal matrix.
+	e					std::vector<T>		(qbEigTridiagonal only) The off-diagonal (one shorter than d).
+	bandwidth	INT							(qbTridiagonalizeTwoStage only) The bandwidth of the intermediate
+														band matrix.
+
+	*** OUTPUTS ***
+
+	eigenValues		std::vector<T>		The eigenvalues, in descending order.
+	eigenVectors	qbMatrix2<T>			The corresponding (orthonormal) eigenvectors, as columns.
+
+	INT				Flag indicating success or failure of the process.
+						0 Indicates success.
+						-1 indicates failure due to a non-square matrix.
+						-2 indicates that the QL iteration used for the smallest subproblems did not
+							converge.
+						-3 indicates failure due to a non-symmetric matrix.
+
+	qbTridiagonalize reduces A to tridiagonal form, A = Q*T*Q', with Householder reflections,
+	returning the diagonal and off-diagonal of T and the orthogonal matrix Q. Half of its work is
+	in matrix-vector products, so it is limited by memory bandwidth and runs on one thread.
+
+	qbTridiagonalizeTwoStage computes the same reduction in two stages:
+
+		1.	Dense to band. Each panel of b columns is reduced by a Householder QR factorization of
+				the part below the band, and the trailing matrix is updated from both sides with the
+				compact WY form of the panel reflectors, I - V*T*V'. The update is a symmetric rank-2b
+				update done entirely with (parallel) matrix-matrix products.
+		2.	Band to tridiagonal, by bulge chasing. Sweep s annihilates column s of the band with a
+				reflector of length b, which creates a bulge b rows further down; the bulge is chased
+				off the end of the matrix one block at a time. Step k of a sweep only touches a window
+				of 2b rows, so successive sweeps run as a pipeline on separate threads, each trailing
+				the previous one by three steps. The result does not depend on the number of threads.
+
+	Q = Q1*Q2 is never formed unless asked for: the eigenvectors are back transformed by applying
+	the bulge chasing reflectors to column slices in parallel and then the panel reflectors with
+	matrix-matrix products.
+
+	qbEigTridiagonal solves the tridiagonal problem. The matrix is torn in two by a rank-one
+	modification, the two halves are solved recursively (as parallel tasks near the top of the
+	recursion) and the solutions are merged by solving the eigenproblem of a diagonal matrix plus a
+	rank-one update, D + rho*z*z'. The merge:
+
+		1.	Deflates: eigenpairs for which the component of z is negligible, or for which two
+				diagonal entries are close enough to be combined with a Givens rotation, are already
+				known and are passed through unchanged.
+		2.	Solves the secular equation 1 + rho * sum(z_j^2 / (d_j - lambda)) = 0 for the remaining
+				eigenvalues, one root per interval between poles, with a rational (two-pole)
+				interpolation safeguarded by bisection. Each root is computed relative to its nearest
+				pole so that the differences d_j - lambda are accurate.
+		3.	Recomputes z from the computed eigenvalues (Gu and Eisenstat), which makes the
+				eigenvectors numerically orthogonal without any reorthogonalization.
+		4.	Multiplies the eigenvectors of the two halves by the eigenvectors of the rank-one
+				problem. This is a matrix-matrix product, done with the blocked GEMM kernel split
+				across threads, and exploits the block structure (the columns from each half are zero
+				in the rows of the other half) to halve the work.
+
+	Deflation is often substantial in practice, so the cost is typically well below the O(n^3)
+	of QR iteration with eigenvector accumulation, and almost all of it is in the GEMM products.
+
+	qbEigSymmetric combines the reduction and the tridiagonal solver and back transforms the
+	eigenvectors. It uses the two-stage reduction for large matrices when more than one thread is
+	available.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <math.h>
+#include <vector>
+#include <future>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "qbMatrix.h"
+#include "qbEIG.h"
+#include "qbGEMM.h"
+#include "qbHouseholder.h"
+#include "qbParallel.h"
+
+// Bandwidth of the intermediate band matrix in the two-stage reduction.
+constexpr int QBEIG_BANDWIDTH = 32;
+
+// qbEigSymmetric uses the two-stage reduction for matrices with at least this many rows.
+constexpr int QBEIG_TWOSTAGEMINSIZE = 128;
+
+namespace qbEIGSymKernels
+{
+
+// Subproblems of this size or smaller are solved directly by QL iteration.
+constexpr int DC_MINSIZE = 32;
+
+// Subproblems smaller than this are not split into parallel tasks.
+constexpr int DC_MINPARALLELSIZE = 256;
+
+// The GEMM and reflector building blocks are shared with qbQR.
+using qbHouseholderKernels::ParallelGEMM;
+using qbHouseholderKernels::MakeReflector;
+
+/* Householder reduction of the n x n symmetric row-major matrix a to tridiagonal form.
+	Only the lower triangle is referenced. On return d and e hold the diagonal and the
+	off-diagonal, and the Householder vectors are stored below the subdiagonal of a
+	(with the leading one implied), with their scale factors in tau. */
+template <typename T>
+void Tridiagonalize(int n, T* a, T* d, T* e, T* tau)
+{
+	std::vector<T> v(n), p(n);
+	for (int k=0; k<n-2; ++k)
+	{
+		// Form the reflector that annihilates A(k+2:n, k).
+		T alpha = a[(size_t)(k+1)*n + k];
+		T sigma = static_cast<T>(0.0);
+		for (int i=k+2; i<n; ++i)
+			sigma += a[(size_t)i*n + k] * a[(size_t)i*n + k];
+
+		if (sigma == static_cast<T>(0.0))
+		{
+			tau[k] = static_cast<T>(0.0);
+			e[k] = alpha;
+			continue;
+		}
+
+		T norm = sqrt(alpha*alpha + sigma);
+		T beta = (alpha <= static_cast<T>(0.0)) ? norm : -norm;
+		T t = (beta - alpha) / beta;
+		T scale = static_cast<T>(1.0) / (alpha - beta);
+		v[k+1] = static_cast<T>(1.0);
+		for (int i=k+2; i<n; ++i)
+		{
+			a[(size_t)i*n + k] *= scale;
+			v[i] = a[(size_t)i*n + k];
+		}
+		tau[k] = t;
+		e[k] = beta;
+
+		// p = tau * A22 * v, from the lower triangle of the trailing matrix.
+		std::fill(p.begin() + k + 1, p.end(), static_cast<T>(0.0));
+		for (int i=k+1; i<n; ++i)
+		{
+			const T* aRow = a + (size_t)i*n;
+			T vi = v[i];
+			T sum = static_cast<T>(0.0);
+			for (int j=k+1; j<i; ++j)
+			{
+				sum += aRow[j] * v[j];
+				p[j] += aRow[j] * vi;
+			}
+			p[i] += sum + aRow[i] * vi;
+		}
+
+		// w = p - (tau/2)*(p'v)*v, then the rank-two update A22 = A22 - v*w' - w*v'.
+		T pv = static_cast<T>(0.0);
+		for (int i=k+1; i<n; ++i)
+		{
+			p[i] *= t;
+			pv += p[i] * v[i];
+		}
+		T K = static_cast<T>(0.5) * t * pv;
+		for (int i=k+1; i<n; ++i)
+			p[i] -= K * v[i];
+
+		for (int i=k+1; i<n; ++i)
+		{
+			T* aRow = a + (size_t)i*n;
+			T vi = v[i];
+			T wi = p[i];
+			for (int j=k+1; j<=i; ++j)
+				aRow[j] -= vi * p[j] + wi * v[j];
+		}
+	}
+
+	for (int k=0; k<n; ++k)
+		d[k] = a[(size_t)k*n + k];
+	if (n > 1)
+		e[n-2] = a[(size_t)(n-1)*n + (n-2)];
+}
+
+/* Form Q = H(0)*H(1)*...*H(n-3) explicitly from the reflectors stored by Tridiagonalize.
+	The reflectors act on rows 1 to n-1 and are stored like those of a QR factorization of
+	A(1:n, 0:n-2), so the blocked QR kernel forms the trailing block of Q. */
+template <typename T>
+void FormQ(int n, const T* a, const T* tau, T* q)
+{
+	std::fill(q, q + (size_t)n*n, static_cast<T>(0.0));
+	q[0] = static_cast<T>(1.0);
+	if (n > 1)
+		qbHouseholderKernels::FormQ(n-1, n-1, std::max(n-2, 0), a + n, n, tau, q + n + 1, n);
+}
+
+/* Data for the two-stage reduction A = Q1*Q2*T*Q2'*Q1'. Q1 is a product of block reflectors
+	I - V*T*V', one per panel of the dense-to-band stage, acting on rows panelStart+b to n.
+	Q2 is the product of the reflectors of the bulge chasing stage: sweep s, step k has a
+	reflector of length min(b, n - r0) starting at row r0 = s + 1 + k*b, with its vector at
+	offset k*b in sweepVectors[s]. */
+template <typename T>
+struct TwoStageReduction
+{
+	int n = 0;
+	int b = 0;
+	std::vector<int> panelStart;
+	std::vector<int> panelSize;
+	std::vector<std::vector<T>> panelV;
+	std::vector<std::vector<T>> panelT;
+	std::vector<std::vector<T>> sweepVectors;
+	std::vector<std::vector<T>> sweepTau;
+};
+
+/* C = C + A*Bt' + B*At' for the m x m symmetric row-major matrix C, where A and B are m x k
+	and At and Bt are their transposes. The lower triangle is computed a block of rows at a
+	time with the blocked GEMM kernel, and then mirrored into the upper triangle. */
+template <typename T>
+void SymmetricRank2kUpdate(int m, int k, const T* A, const T* B, const T* At, const T* Bt, T* C, int ldc)
+{
+	constexpr int BLOCK = 64;
+	size_t numBlocks = (m + BLOCK - 1) / BLOCK;
+	size_t minBlocks = std::max(static_cast<size_t>(1), static_cast<size_t>(1 << 22) / std::max(static_cast<size_t>(1), (size_t)m*k*BLOCK));
+	qbParallelFor(numBlocks, minBlocks, [=](size_t first, size_t last)
+	{
+		for (size_t blk=first; blk<last; ++blk)
+		{
+			int i0 = static_cast<int>(blk) * BLOCK;
+			int rows = std::min(BLOCK, m - i0);
+			int cols = i0 + rows;
+			T* cBlock = C + (size_t)i0*ldc;
+			qbGEMMKernels::BlockedGEMM(rows, cols, k, A + (size_t)i0*k, k, Bt, m, cBlock, ldc, true);
+			qbGEMMKernels::BlockedGEMM(rows, cols, k, B + (size_t)i0*k, k, At, m, cBlock, ldc, true);
+		}
+	});
+
+	// Mirror a tile at a time, so that the column reads stay in cache.
+	for (int i0=0; i0<m; i0+=BLOCK)
+	{
+		for (int j0=i0; j0<m; j0+=BLOCK)
+		{
+			for (int i=i0; i<std::min(i0 + BLOCK, m); ++i)
+			{
+				for (int j=std::max(j0, i+1); j<std::min(j0 + BLOCK, m); ++j)
+					C[(size_t)i*ldc + j] = C[(size_t)j*ldc + i];
+			}
+		}
+	}
+}
+
+/* Dense to band reduction of the n x n symmetric row-major matrix a, with blocked Householder
+	transformations. Each panel of b columns is reduced by a QR factorization of the part below
+	the band, and the trailing matrix is updated from both sides with the compact WY form of the
+	panel reflectors, using only matrix-matrix products. On return the lower triangle of a holds
+	the band matrix (bandwidth b). */
+template <typename T>
+void ReduceToBand(int n, int b, T* a, TwoStageReduction<T> &reduction)
+{
+	for (int k=0; k + b < n - 1; k += b)
+	{
+		int m = n - k - b;
+		int nb = std::min(b, m);
+		int bk = std::min(b, n - k);
+		T* panel = a + (size_t)(k + b)*n + k;
+
+		/* QR factorization of the panel, with the reflectors copied to V (unit lower trapezoidal)
+			and the compact WY factor in Tm, so that H(0)*...*H(nb-1) = I - V*Tm*V'. The part of
+			the panel below the band is then zero. */
+		std::vector<T> V((size_t)m*nb), Tm((size_t)nb*nb), tau(nb);
+		qbHouseholderKernels::QRFactor(m, bk, panel, n, tau.data());
+		qbHouseholderKernels::ExtractV(m, nb, panel, n, V.data());
+		qbHouseholderKernels::FormT(m, nb, V.data(), tau.data(), Tm.data());
+		for (int i=1; i<m; ++i)
+			std::fill(panel + (size_t)i*n, panel + (size_t)i*n + std::min(i, nb), static_cast<T>(0.0));
+
+		/* Two-sided update of the trailing matrix A22 (both triangles are kept):
+			X = A22*V*T, M = T'*V'*X, W = X - V*M/2, A22 = A22 - V*W' - W*V'. */
+		T* A22 = a + (size_t)(k + b)*n + (k + b);
+		std::vector<T> AV((size_t)m*nb), X((size_t)m*nb), Vt((size_t)nb*m);
+		for (int i=0; i<m; ++i)
+		{
+			for (int j=0; j<nb; ++j)
+				Vt[(size_t)j*m + i] = V[(size_t)i*nb + j];
+		}
+		ParallelGEMM(m, nb, m, A22, n, V.data(), nb, AV.data(), nb);
+		qbGEMMKernels::BlockedGEMM(m, nb, nb, AV.data(), nb, Tm.data(), nb, X.data(), nb, false);
+
+		std::vector<T> M((size_t)nb*nb);
+		qbGEMMKernels::BlockedGEMM(nb, nb, m, Vt.data(), m, X.data(), nb, M.data(), nb, false);
+		qbHouseholderKernels::TriangularMultiply(nb, nb, Tm.data(), true, M.data());
+
+		std::vector<T> negW(X);
+		qbGEMMKernels::BlockedGEMM(m, nb, nb, V.data(), nb, M.data(), nb, AV.data(), nb, false);
+		for (size_t i=0; i<negW.size(); ++i)
+			negW[i] = static_cast<T>(0.5) * AV[i] - negW[i];
+		std::vector<T> negWt((size_t)nb*m);
+		for (int i=0; i<m; ++i)
+		{
+			for (int j=0; j<nb; ++j)
+				negWt[(size_t)j*m + i] = negW[(size_t)i*nb + j];
+		}
+		SymmetricRank2kUpdate(m, nb, V.data(), negW.data(), Vt.data(), negWt.data(), A22, n);
+
+		reduction.panelStart.push_back(k);
+		reduction.panelSize.push_back(nb);
+		reduction.panelV.push_back(std::move(V));
+		reduction.panelT.push_back(std::move(Tm));
+	}
+}
+
+/* Symmetric two-sided application of the reflector (v, tau) to the diagonal block
+	starting at r0, using only the lower triangle. */
+template <typename T>
+void ApplyTwoSided(int n, T* a, int r0, int len, const T* v, T tau, T* p)
+{
+	for (int i=0; i<len; ++i)
+		p[i] = static_cast<T>(0.0);
+	for (int i=0; i<len; ++i)
+	{
+		const T* aRow = a + (size_t)(r0 + i)*n + r0;
+		T sum = static_cast<T>(0.0);
+		for (int j=0; j<i; ++j)
+		{
+			sum += aRow[j] * v[j];
+			p[j] += aRow[j] * v[i];
+		}
+		p[i] += sum + aRow[i] * v[i];
+	}
+
+	T pv = static_cast<T>(0.0);
+	for (int i=0; i<len; ++i)
+	{
+		p[i] *= tau;
+		pv += p[i] * v[i];
+	}
+	T K = static_cast<T>(0.5) * tau * pv;
+	for (int i=0; i<len; ++i)
+		p[i] -= K * v[i];
+
+	for (int i=0; i<len; ++i)
+	{
+		T* aRow = a + (size_t)(r0 + i)*n + r0;
+		for (int j=0; j<=i; ++j)
+			aRow[j] -= v[i] * p[j] + p[i] * v[j];
+	}
+}
+
+/* One step of a bulge chasing sweep: annihilate column col below row r0 with a reflector on
+	rows r0 to r0+len, apply it to the rest of the bulge (columns col+1 to r0) from the left,
+	to the diagonal block from both sides, and to the block below from the right, which
+	creates the bulge for the next step. */
+template <typename T>
+void BulgeChaseStep(int n, int b, T* a, int col, int r0, int len, T* v, T &tau, T* work)
+{
+	tau = MakeReflector(len, a + (size_t)r0*n + col, n, v);
+	if (tau == static_cast<T>(0.0))
+		return;
+
+	// Left update of the remaining columns of the bulge.
+	int numCols = r0 - col - 1;
+	if (numCols > 0)
+	{
+		for (int c=0; c<numCols; ++c)
+			work[c] = static_cast<T>(0.0);
+		for (int i=0; i<len; ++i)
+		{
+			const T* aRow = a + (size_t)(r0 + i)*n + col + 1;
+			for (int c=0; c<numCols; ++c)
+				work[c] += v[i] * aRow[c];
+		}
+		for (int i=0; i<len; ++i)
+		{
+			T* aRow = a + (size_t)(r0 + i)*n + col + 1;
+			T scale = tau * v[i];
+			for (int c=0; c<numCols; ++c)
+				aRow[c] -= scale * work[c];
+		}
+	}
+
+	ApplyTwoSided(n, a, r0, len, v, tau, work);
+
+	// Right update of the block below.
+	int rowEnd = std::min(r0 + len + b, n);
+	for (int i=r0+len; i<rowEnd; ++i)
+	{
+		T* aRow = a + (size_t)i*n + r0;
+		T sum = static_cast<T>(0.0);
+		for (int j=0; j<len; ++j)
+			sum += aRow[j] * v[j];
+		sum *= tau;
+		for (int j=0; j<len; ++j)
+			aRow[j] -= sum * v[j];
+	}
+}
+
+/* Band to tridiagonal reduction by bulge chasing. Sweep s annihilates column s of the band and
+	chases the resulting bulge down the diagonal, b rows per step. Step k of sweep s only touches
+	rows s+1+k*b to s+1+(k+2)*b, so it can run as soon as sweep s-1 has completed step k+2: the
+	sweeps are distributed round-robin over numThreads threads and run as a pipeline, each one
+	trailing the previous sweep by three steps. The result does not depend on numThreads. */
+template <typename T>
+void BandToTridiagonal(int n, int b, T* a, TwoStageReduction<T> &reduction, int numThreads)
+{
+	int numSweeps = std::max(n - 2, 0);
+	reduction.sweepVectors.assign(numSweeps, std::vector<T>());
+	reduction.sweepTau.assign(numSweeps, std::vector<T>());
+	std::vector<std::atomic<int>> progress(numSweeps);
+	for (auto &p : progress)
+		p.store(0);
+
+	auto runSweeps = [&](int thread)
+	{
+		std::vector<T> work(2*b + 1);
+		for (int s=thread; s<numSweeps; s+=numThreads)
+		{
+			int numSteps = (n - s - 2 + b - 1) / b;
+			std::vector<T> &vectors = reduction.sweepVectors[s];
+			std::vector<T> &taus = reduction.sweepTau[s];
+			vectors.assign((size_t)numSteps*b, static_cast<T>(0.0));
+			taus.assign(numSteps, static_cast<T>(0.0));
+			for (int k=0; k<numSteps; ++k)
+			{
+				int r0 = s + 1 + k*b;
+				int len = std::min(b, n - r0);
+				int col = (k == 0) ? s : r0 - b;
+				if (s > 0)
+				{
+					while (progress[s-1].load(std::memory_order_acquire) < k + 3)
+						std::this_thread::yield();
+				}
+				BulgeChaseStep(n, b, a, col, r0, len, vectors.data() + (size_t)k*b, taus[k], work.data());
+				progress[s].store(k + 1, std::memory_order_release);
+			}
+			progress[s].store(std::numeric_limits<int>::max(), std::memory_order_release);
+		}
+	};
+
+	numThreads = std::max(1, std::min(numThreads, numSweeps));
+	std::vector<std::thread> threads;
+	for (int t=1; t<numThreads; ++t)
+		threads.emplace_back(runSweeps, t);
+	runSweeps(0);
+	for (auto &thread : threads)
+		thread.join();
+}
+
+/* Apply the bulge chasing reflectors (Q2) in reverse order to columns first to last of the
+	n x numCols row-major matrix y. */
+template <typename T>
+void ApplySweepReflectors(const TwoStageReduction<T> &reduction, T* y, int numCols, size_t first, size_t last)
+{
+	int n = reduction.n;
+	int b = reduction.b;
+	int width = static_cast<int>(last - first);
+	std::vector<T> w(width);
+	for (int s=static_cast<int>(reduction.sweepTau.size())-1; s>=0; --s)
+	{
+		const std::vector<T> &taus = reduction.sweepTau[s];
+		for (int k=static_cast<int>(taus.size())-1; k>=0; --k)
+		{
+			T tau = taus[k];
+			if (tau == static_cast<T>(0.0))
+				continue;
+			int r0 = s + 1 + k*b;
+			int len = std::min(b, n - r0);
+			const T* v = reduction.sweepVectors[s].data() + (size_t)k*b;
+			std::fill(w.begin(), w.end(), static_cast<T>(0.0));
+			for (int i=0; i<len; ++i)
+			{
+				const T* yRow = y + (size_t)(r0 + i)*numCols + first;
+				for (int c=0; c<width; ++c)
+					w[c] += v[i] * yRow[c];
+			}
+			for (int i=0; i<len; ++i)
+			{
+				T* yRow = y + (size_t)(r0 + i)*numCols + first;
+				T scale = tau * v[i];
+				for (int c=0; c<width; ++c)
+					yRow[c] -= scale * w[c];
+			}
+		}
+	}
+}
+
+/* Apply Q = Q1*Q2 from a two-stage reduction to the n x numCols row-major matrix y, from the
+	left. The bulge chasing reflectors are applied in reverse order to independent column
+	slices of y in parallel, then the panel reflectors of Q1 with matrix-matrix products. */
+template <typename T>
+void ApplyTwoStageQ(const TwoStageReduction<T> &reduction, T* y, int numCols)
+{
+	int n = reduction.n;
+	int b = reduction.b;
+	qbParallelFor(numCols, 64, [&](size_t first, size_t last)
+	{
+		ApplySweepReflectors(reduction, y, numCols, first, last);
+	});
+
+	// Y(k+b:n, :) = (I - V*T*V') * Y(k+b:n, :) for each panel, in reverse order.
+	for (int p=static_cast<int>(reduction.panelStart.size())-1; p>=0; --p)
+	{
+		int row0 = reduction.panelStart[p] + b;
+		int m = n - row0;
+		int nb = reduction.panelSize[p];
+		qbHouseholderKernels::ApplyBlockLeft(m, numCols, nb, reduction.panelV[p].data(), reduction.panelT[p].data(), false,
+			y + (size_t)row0*numCols, numCols);
+	}
+}
+
+/* Two-stage reduction of the n x n symmetric row-major matrix a to tridiagonal form, with
+	bandwidth b for the intermediate band matrix. */
+template <typename T>
+void TridiagonalizeTwoStage(int n, int b, T* a, T* d, T* e, TwoStageReduction<T> &reduction, int numThreads)
+{
+	reduction.n = n;
+	reduction.b = b;
+	ReduceToBand(n, b, a, reduction);
+	BandToTridiagonal(n, b, a, reduction, numThreads);
+
+	for (int k=0; k<n; ++k)
+		d[k] = a[(size_t)k*n + k];
+	for (int k=0; k<n-1; ++k)
+		e[k] = a[(size_t)(k+1)*n + k];
+}
+
+/* Sort the eigenvalues in d into ascending order, permuting the columns of the n x n
+	block q (leading dimension ldq) to match. */
+template <typename T>
+void SortAscending(int n, T* d, T* q, int ldq)
+{
+	std::vector<int> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [d](int i, int j) { return d[i] < d[j]; });
+
+	std::vector<T> values(d, d + n);
+	std::vector<T> row(n);
+	for (int j=0; j<n; ++j)
+		d[j] = values[order[j]];
+	for (int i=0; i<n; ++i)
+	{
+		T* qRow = q + (size_t)i*ldq;
+		std::copy(qRow, qRow + n, row.begin());
+		for (int j=0; j<n; ++j)
+			qRow[j] = row[order[j]];
+	}
+}
+
+/* Implicit QL iteration for the symmetric tridiagonal matrix with diagonal d and
+	off-diagonal e, accumulating the eigenvectors into the n x n block q, which must
+	be set to the identity on entry. Used for the smallest subproblems. */
+template <typename T>
+int TridiagonalQL(int n, T* d, const T* eIn, T* q, int ldq)
+{
+	const T eps = std::numeric_limits<T>::epsilon();
+	std::vector<T> e(n, static_cast<T>(0.0));
+	for (int i=0; i<n-1; ++i)
+		e[i] = eIn[i];
+
+	for (int l=0; l<n; ++l)
+	{
+		int iteration = 0;
+		int m;
+		do
+		{
+			// Look for a negligible off-diagonal element to split the matrix.
+			for (m=l; m<n-1; ++m)
+			{
+				T dd = fabs(d[m]) + fabs(d[m+1]);
+				if (fabs(e[m]) <= eps * dd)
+					break;
+			}
+			if (m == l)
+				break;
+
+			if (iteration++ == 30)
+				return QBEIG_MAXITERATIONSEXCEEDED;
+
+			// Wilkinson shift, then chase the bulge from m up to l.
+			T g = (d[l+1] - d[l]) / (static_cast<T>(2.0) * e[l]);
+			T r = hypot(g, static_cast<T>(1.0));
+			g = d[m] - d[l] + e[l] / (g + ((g >= static_cast<T>(0.0)) ? r : -r));
+			T s = static_cast<T>(1.0);
+			T c = static_cast<T>(1.0);
+			T p = static_cast<T>(0.0);
+			int i;
+			for (i=m-1; i>=l; --i)
+			{
+				T f = s * e[i];
+				T b = c * e[i];
+				r = hypot(f, g);
+				e[i+1] = r;
+				if (r == static_cast<T>(0.0))
+				{
+					// Recover from underflow.
+					d[i+1] -= p;
+					e[m] = static_cast<T>(0.0);
+					break;
+				}
+				s = f / r;
+				c = g / r;
+				g = d[i+1] - p;
+				r = (d[i] - g) * s + static_cast<T>(2.0) * c * b;
+				p = s * r;
+				d[i+1] = g + p;
+				g = c * r - b;
+
+				for (int k=0; k<n; ++k)
+				{
+					T* qRow = q + (size_t)k*ldq;
+					f = qRow[i+1];
+					qRow[i+1] = s * qRow[i] + c * f;
+					qRow[i] = c * qRow[i] - s * f;
+				}
+			}
+			if ((r == static_cast<T>(0.0)) && (i >= l))
+				continue;
+			d[l] -= p;
+			e[l] = g;
+			e[m] = static_cast<T>(0.0);
+		} while (m != l);
+	}
+
+	SortAscending(n, d, q, ldq);
+	return 0;
+}
+
+/* Find root i (0 <= i < K) of the secular equation 1/rho + sum(z_j^2 / (d_j - lambda)) = 0
+	for ascending poles d and rho > 0. Root i lies in (d_i, d_i+1), or in (d_K-1, d_K-1 + rho*z'z)
+	for the last root. The root is computed as lambda = d_origin + tau, where d_origin is the
+	nearer end of the interval, and delta_j = d_j - lambda is returned as (d_j - d_origin) - tau,
+	which is accurate even when lambda is very close to a pole. */
+template <typename T>
+T SecularRoot(int K, const T* d, const T* z, T rho, int i, T* delta)
+{
+	const T eps = std::numeric_limits<T>::epsilon();
+	const T zero = static_cast<T>(0.0);
+	T invRho = static_cast<T>(1.0) / rho;
+	bool last = (i == K-1);
+
+	// Choose the origin from the sign of the secular function at the middle of the interval.
+	int origin = i;
+	T lo, hi;
+	if (!last)
+	{
+		T mid = static_cast<T>(0.5) * (d[i+1] - d[i]);
+		T f = invRho;
+		for (int j=0; j<K; ++j)
+			f += z[j] * z[j] / ((d[j] - d[i]) - mid);
+		if (f >= zero)
+		{
+			lo = zero;
+			hi = mid;
+		}
+		else
+		{
+			origin = i + 1;
+			lo = -mid;
+			hi = zero;
+		}
+	}
+	else
+	{
+		T zz = zero;
+		for (int j=0; j<K; ++j)
+			zz += z[j] * z[j];
+		lo = zero;
+		hi = rho * zz;
+	}
+
+	for (int j=0; j<K; ++j)
+		delta[j] = d[j] - d[origin];
+
+	T tau = static_cast<T>(0.5) * (lo + hi);
+	for (int iteration=0; iteration<200; ++iteration)
+	{
+		// psi sums the poles at or below root i, phi the poles above it.
+		T psi = zero, dpsi = zero, phi = zero, dphi = zero;
+		for (int j=0; j<=i; ++j)
+		{
+			T t = z[j] / (delta[j] - tau);
+			psi += z[j] * t;
+			dpsi += t * t;
+		}
+		for (int j=i+1; j<K; ++j)
+		{
+			T t = z[j] / (delta[j] - tau);
+			phi += z[j] * t;
+			dphi += t * t;
+		}
+		T f = invRho + psi + phi;
+		if (f < zero)
+			lo = tau;
+		else
+			hi = tau;
+
+		T errorBound = eps * (static_cast<T>(8.0) * (phi - psi) + static_cast<T>(2.0) * invRho
+			+ static_cast<T>(3.0) * fabs(tau) * (dpsi + dphi));
+		if (fabs(f) <= errorBound)
+			break;
+
+		/* Replace psi and phi by one-pole models that match their value and slope at tau,
+			psi(x) ~ a1 + b1/(delta_i - x) and phi(x) ~ a2 + b2/(delta_i+1 - x), and solve the
+			model equation for the new iterate. */
+		T newTau = static_cast<T>(0.5) * (lo + hi);
+		T di = delta[i] - tau;
+		T b1 = dpsi * di * di;
+		if (!last)
+		{
+			T dn = delta[i+1] - tau;
+			T b2 = dphi * dn * dn;
+			T c = f - b1 / di - b2 / dn;
+			T gap = delta[i+1] - delta[i];
+
+			// With p = delta_i - x: c*p^2 + (c*gap + b1 + b2)*p + b1*gap = 0, root in (-gap, 0).
+			T B = c * gap + b1 + b2;
+			T C = b1 * gap;
+			T p = static_cast<T>(1.0);
+			if (c == zero)
+			{
+				p = -C / B;
+			}
+			else
+			{
+				T discriminant = std::max(zero, B*B - static_cast<T>(4.0) * c * C);
+				T qq = static_cast<T>(-0.5) * (B + ((B >= zero) ? sqrt(discriminant) : -sqrt(discriminant)));
+				T p1 = qq / c;
+				T p2 = (qq != zero) ? C / qq : p1;
+				p = ((p1 < zero) && (p1 > -gap)) ? p1 : p2;
+			}
+			if ((p < zero) && (p > -gap))
+				newTau = delta[i] - p;
+		}
+		else
+		{
+			T c = f - b1 / di;
+			if (c > zero)
+				newTau = delta[i] + b1 / c;
+		}
+
+		if (!(newTau > lo) || !(newTau < hi))
+			newTau = static_cast<T>(0.5) * (lo + hi);
+		if ((newTau == tau) || (hi - lo <= static_cast<T>(2.0) * eps * std::max(fabs(lo), fabs(hi))))
+			break;
+		tau = newTau;
+	}
+
+	for (int j=0; j<K; ++j)
+		delta[j] -= tau;
+
+	return d[origin] + tau;
+}
+
+/* Merge step of divide-and-conquer. On entry the n x n block q is block diagonal, with the
+	eigenvectors of the two halves (of sizes m and n-m) in its diagonal blocks, and d holds their
+	eigenvalues, each half in ascending order. The full matrix is this block diagonal matrix plus
+	rho*v*v', with v = e_m-1 + sign*e_m. On return d and q hold the eigenpairs of the full matrix,
+	in ascending order. */
+template <typename T>
+void Merge(int n, int m, T* d, T* q, int ldq, T rho, T sign)
+{
+	const T eps = std::numeric_limits<T>::epsilon();
+	const T zero = static_cast<T>(0.0);
+
+	// z = Q'*v is the last row of the first block and the first row of the second.
+	std::vector<T> z(n);
+	for (int j=0; j<m; ++j)
+		z[j] = q[(size_t)(m-1)*ldq + j];
+	for (int j=m; j<n; ++j)
+		z[j] = sign * q[(size_t)m*ldq + j];
+
+	T zNorm = zero;
+	for (int j=0; j<n; ++j)
+		zNorm += z[j] * z[j];
+	rho *= zNorm;
+	zNorm = sqrt(zNorm);
+	for (int j=0; j<n; ++j)
+		z[j] /= zNorm;
+
+	// Visit the poles in ascending order (each half is already sorted).
+	std::vector<int> order(n);
+	std::iota(order.begin(), order.end(), 0);
+	std::inplace_merge(order.begin(), order.begin() + m, order.end(), [d](int i, int j) { return d[i] < d[j]; });
+
+	/* Column types: 1 is non-zero only in the first m rows, 3 only in the last n-m rows and
+		2 (after a deflating rotation mixes the halves) in both. */
+	std::vector<int> type(n);
+	for (int j=0; j<n; ++j)
+		type[j] = (j < m) ? 1 : 3;
+
+	T dMax = zero, zMax = zero;
+	for (int j=0; j<n; ++j)
+	{
+		dMax = std::max(dMax, static_cast<T>(fabs(d[j])));
+		zMax = std::max(zMax, static_cast<T>(fabs(z[j])));
+	}
+	T tolerance = static_cast<T>(8.0) * eps * std::max(dMax, zMax);
+
+	// Deflation.
+	std::vector<int> deflated, active;
+	int previous = -1;
+	for (int k=0; k<n; ++k)
+	{
+		int j = order[k];
+		if (rho * fabs(z[j]) <= tolerance)
+		{
+			// Negligible coupling: (d_j, q_j) is already an eigenpair.
+			deflated.push_back(j);
+			continue;
+		}
+		if (previous < 0)
+		{
+			previous = j;
+			continue;
+		}
+
+		/* Two close poles: a rotation in the plane of their columns zeroes one component of
+			z, at the cost of an off-diagonal element t*c*s that is below the tolerance. */
+		T s = z[previous];
+		T c = z[j];
+		T r = hypot(c, s);
+		T t = d[j] - d[previous];
+		c /= r;
+		s = -s / r;
+		if (fabs(t * c * s) <= tolerance)
+		{
+			z[j] = r;
+			z[previous] = zero;
+			if (type[previous] != type[j])
+			{
+				type[previous] = 2;
+				type[j] = 2;
+			}
+			for (int i=0; i<n; ++i)
+			{
+				T* qRow = q + (size_t)i*ldq;
+				T qp = qRow[previous];
+				T qj = qRow[j];
+				qRow[previous] = c * qp + s * qj;
+				qRow[j] = c * qj - s * qp;
+			}
+			T dp = d[previous] * c * c + d[j] * s * s;
+			d[j] = d[previous] * s * s + d[j] * c * c;
+			d[previous] = dp;
+			deflated.push_back(previous);
+		}
+		else
+		{
+			active.push_back(previous);
+		}
+		previous = j;
+	}
+	if (previous >= 0)
+		active.push_back(previous);
+
+	int K = static_cast<int>(active.size());
+	std::vector<T> values(n);
+	std::vector<T> vectors((size_t)n*n);
+	if (K > 0)
+	{
+		// The remaining poles are distinct and in ascending order.
+		std::vector<T> dK(K), zK(K);
+		for (int k=0; k<K; ++k)
+		{
+			dK[k] = d[active[k]];
+			zK[k] = z[active[k]];
+		}
+
+		// Solve the secular equation, one independent root per row of delta.
+		std::vector<T> lambda(K);
+		std::vector<T> delta((size_t)K*K);
+		qbParallelFor(K, 256, [&](size_t first, size_t last)
+		{
+			for (size_t i=first; i<last; ++i)
+				lambda[i] = SecularRoot(K, dK.data(), zK.data(), rho, static_cast<int>(i), delta.data() + i*K);
+		});
+
+		// Recompute z from the computed eigenvalues (Gu and Eisenstat).
+		for (int j=0; j<K; ++j)
+		{
+			T w = delta[(size_t)j*K + j];
+			for (int i=0; i<K; ++i)
+			{
+				if (i != j)
+					w *= delta[(size_t)i*K + j] / (dK[j] - dK[i]);
+			}
+			T zHat = sqrt(std::max(zero, -w));
+			zK[j] = (zK[j] >= zero) ? zHat : -zHat;
+		}
+
+		/* Eigenvectors of the rank-one problem, u_i = inv(D - lambda_i*I)*z normalized, stored
+			as the columns of U with the rows grouped by column type. */
+		std::vector<int> grouped;
+		for (int t=1; t<=3; ++t)
+		{
+			for (int k=0; k<K; ++k)
+			{
+				if (type[active[k]] == t)
+					grouped.push_back(k);
+			}
+		}
+		int n1 = static_cast<int>(std::count_if(active.begin(), active.end(), [&](int j) { return type[j] == 1; }));
+		int n3 = static_cast<int>(std::count_if(active.begin(), active.end(), [&](int j) { return type[j] == 3; }));
+		int n2 = K - n1 - n3;
+
+		std::vector<T> U((size_t)K*K);
+		for (int i=0; i<K; ++i)
+		{
+			const T* deltaRow = delta.data() + (size_t)i*K;
+			T norm = zero;
+			for (int j=0; j<K; ++j)
+				norm += (zK[j] / deltaRow[j]) * (zK[j] / deltaRow[j]);
+			norm = sqrt(norm);
+			for (int a=0; a<K; ++a)
+			{
+				int j = grouped[a];
+				U[(size_t)a*K + i] = zK[j] / deltaRow[j] / norm;
+			}
+		}
+
+		/* Multiply by the eigenvectors of the two halves. Types 1 and 2 contribute to the first
+			m rows and types 2 and 3 to the last n-m rows. */
+		int nTop = n1 + n2;
+		int nBottom = n2 + n3;
+		std::vector<T> qTop((size_t)m*nTop), qBottom((size_t)(n-m)*nBottom);
+		for (int i=0; i<m; ++i)
+		{
+			const T* qRow = q + (size_t)i*ldq;
+			for (int a=0; a<nTop; ++a)
+				qTop[(size_t)i*nTop + a] = qRow[active[grouped[a]]];
+		}
+		for (int i=0; i<n-m; ++i)
+		{
+			const T* qRow = q + (size_t)(m+i)*ldq;
+			for (int a=0; a<nBottom; ++a)
+				qBottom[(size_t)i*nBottom + a] = qRow[active[grouped[n1 + a]]];
+		}
+
+		std::vector<T> product((size_t)n*K, zero);
+		if (nTop > 0)
+			ParallelGEMM(m, K, nTop, qTop.data(), nTop, U.data(), K, product.data(), K);
+		if (nBottom > 0)
+			ParallelGEMM(n-m, K, nBottom, qBottom.data(), nBottom, U.data() + (size_t)n1*K, K, product.data() + (size_t)m*K, K);
+
+		for (int i=0; i<K; ++i)
+			values[i] = lambda[i];
+		for (int r=0; r<n; ++r)
+		{
+			for (int i=0; i<K; ++i)
+				vectors[(size_t)r*n + i] = product[(size_t)r*K + i];
+		}
+	}
+
+	// The deflated eigenpairs follow the computed ones.
+	for (int k=0; k<static_cast<int>(deflated.size()); ++k)
+	{
+		int j = deflated[k];
+		values[K + k] = d[j];
+		for (int r=0; r<n; ++r)
+			vectors[(size_t)r*n + K + k] = q[(size_t)r*ldq + j];
+	}
+
+	for (int r=0; r<n; ++r)
+		std::copy(vectors.begin() + (size_t)r*n, vectors.begin() + (size_t)(r+1)*n, q + (size_t)r*ldq);
+	std::copy(values.begin(), values.end(), d);
+	SortAscending(n, d, q, ldq);
+}
+
+/* Divide-and-conquer for the n x n tridiagonal matrix with diagonal d and off-diagonal e.
+	On return d holds the eigenvalues in ascending order and the n x n block q the
+	eigenvectors. The two halves are solved as parallel tasks while depth < maxDepth. */
+template <typename T>
+int DivideConquer(int n, T* d, const T* e, T* q, int ldq, int depth, int maxDepth)
+{
+	if (n <= DC_MINSIZE)
+	{
+		for (int i=0; i<n; ++i)
+		{
+			std::fill(q + (size_t)i*ldq, q + (size_t)i*ldq + n, static_cast<T>(0.0));
+			q[(size_t)i*ldq + i] = static_cast<T>(1.0);
+		}
+		return TridiagonalQL(n, d, e, q, ldq);
+	}
+
+	// Tear the matrix in two: T = diag(T1, T2) + rho*v*v' with v = e_m-1 + sign*e_m.
+	int m = n / 2;
+	T rho = fabs(e[m-1]);
+	T sign = (e[m-1] >= static_cast<T>(0.0)) ? static_cast<T>(1.0) : static_cast<T>(-1.0);
+	d[m-1] -= rho;
+	d[m] -= rho;
+
+	for (int i=0; i<m; ++i)
+		std::fill(q + (size_t)i*ldq + m, q + (size_t)i*ldq + n, static_cast<T>(0.0));
+	for (int i=m; i<n; ++i)
+		std::fill(q + (size_t)i*ldq, q + (size_t)i*ldq + m, static_cast<T>(0.0));
+
+	int status1, status2;
+	if ((depth < maxDepth) && (n >= DC_MINPARALLELSIZE))
+	{
+		auto task = std::async(std::launch::async, [=]() { return DivideConquer(m, d, e, q, ldq, depth + 1, maxDepth); });
+		status2 = DivideConquer(n - m, d + m, e + m, q + (size_t)m*ldq + m, ldq, depth + 1, maxDepth);
+		status1 = task.get();
+	}
+	else
+	{
+		status1 = DivideConquer(m, d, e, q, ldq, depth + 1, maxDepth);
+		status2 = DivideConquer(n - m, d + m, e + m, q + (size_t)m*ldq + m, ldq, depth + 1, maxDepth);
+	}
+	if (status1 != 0)
+		return status1;
+	if (status2 != 0)
+		return status2;
+
+	if (rho != static_cast<T>(0.0))
+		Merge(n, m, d, q, ldq, rho, sign);
+	else
+		SortAscending(n, d, q, ldq);
+
+	return 0;
+}
+
+/* Solve the tridiagonal eigenproblem in place, with d and the n x n row-major q holding the
+	eigenvalues (ascending) and eigenvectors on return. The matrix is scaled to unit maximum
+	element first so that the tolerances are independent of its scale. */
+template <typename T>
+int SolveTridiagonal(int n, T* d, std::vector<T> e, T* q)
+{
+	T scale = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+		scale = std::max(scale, static_cast<T>(fabs(d[i])));
+	for (int i=0; i<n-1; ++i)
+		scale = std::max(scale, static_cast<T>(fabs(e[i])));
+
+	if (scale == static_cast<T>(0.0))
+	{
+		std::fill(q, q + (size_t)n*n, static_cast<T>(0.0));
+		for (int i=0; i<n; ++i)
+			q[(size_t)i*n + i] = static_cast<T>(1.0);
+		return 0;
+	}
+
+	for (int i=0; i<n; ++i)
+		d[i] /= scale;
+	for (int i=0; i<n-1; ++i)
+		e[i] /= scale;
+
+	// Enough levels of parallel tasks to occupy every thread.
+	int maxDepth = 0;
+	while ((static_cast<size_t>(1) << maxDepth) < qbParallelNumThreads())
+		maxDepth++;
+
+	int status = DivideConquer(n, d, e.data(), q, n, 0, maxDepth);
+
+	for (int i=0; i<n; ++i)
+		d[i] *= scale;
+
+	return status;
+}
+
+/* Reverse ascending eigenvalues (and the columns of the n x n row-major q) into the
+	descending order used by the rest of the library. */
+template <typename T>
+void ReverseOrder(int n, T* d, T* q)
+{
+	std::reverse(d, d + n);
+	for (int i=0; i<n; ++i)
+		std::reverse(q + (size_t)i*n, q + (size_t)(i+1)*n);
+}
+
+}
+
+// Function to reduce a symmetric matrix to tridiagonal form, A = Q*T*Q'.
+template <typename T>
+int qbTridiagonalize(const qbMatrix2<T> &inputMatrix, std::vector<T> &d, std::vector<T> &e, qbMatrix2<T> &Q)
+{
+	// Verify that the input matrix is square and symmetric.
+	qbMatrix2<T> A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	int n = A.GetNumRows();
+	std::vector<T> tau(std::max(n-2, 0));
+	d.resize(n);
+	e.resize(std::max(n-1, 0));
+	qbEIGSymKernels::Tridiagonalize(n, A.GetData(), d.data(), e.data(), tau.data());
+
+	Q.Resize(n, n);
+	qbEIGSymKernels::FormQ(n, A.GetData(), tau.data(), Q.GetData());
+
+	return 0;
+}
+
+// Function to compute the eigenvalues and eigenvectors of a symmetric tridiagonal matrix.
+template <typename T>
+int qbEigTridiagonal(const std::vector<T> &d, const std::vector<T> &e, std::vector<T> &eigenValues, qbMatrix2<T> &eigenVectors)
+{
+	int n = static_cast<int>(d.size());
+	if ((n < 1) || (static_cast<int>(e.size()) != n-1))
+		throw std::invalid_argument("The off-diagonal must have one element fewer than the (non-empty) diagonal.");
+
+	eigenValues = d;
+	eigenVectors.Resize(n, n);
+	int status = qbEIGSymKernels::SolveTridiagonal(n, eigenValues.data(), e, eigenVectors.GetData());
+	qbEIGSymKernels::ReverseOrder(n, eigenValues.data(), eigenVectors.GetData());
+
+	return status;
+}
+
+// Function to reduce a symmetric matrix to tridiagonal form in two stages (dense to band, band to tridiagonal).
+template <typename T>
+int qbTridiagonalizeTwoStage(const qbMatrix2<T> &inputMatrix, std::vector<T> &d, std::vector<T> &e, qbMatrix2<T> &Q,
+	int bandwidth = QBEIG_BANDWIDTH)
+{
+	// Verify that the input matrix is square and symmetric.
+	qbMatrix2<T> A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	if (bandwidth < 1)
+		throw std::invalid_argument("The bandwidth must be at least one.");
+
+	int n = A.GetNumRows();
+	d.resize(n);
+	e.resize(std::max(n-1, 0));
+	qbEIGSymKernels::TwoStageReduction<T> reduction;
+	qbEIGSymKernels::TridiagonalizeTwoStage(n, bandwidth, A.GetData(), d.data(), e.data(), reduction,
+		static_cast<int>(qbParallelNumThreads()));
+
+	Q.Resize(n, n);
+	Q.SetToIdentity();
+	qbEIGSymKernels::ApplyTwoStageQ(reduction, Q.GetData(), n);
+
+	return 0;
+}
+
+/* Function to compute all the eigenvalues and eigenvectors of a symmetric matrix. When more
+	than one thread is available, matrices with at least QBEIG_TWOSTAGEMINSIZE rows are reduced
+	in two stages and the eigenvectors are back transformed by applying the reflectors directly,
+	rather than by forming Q. Every part of that path runs in parallel, but it does about 50%
+	more arithmetic than the (sequential) one-stage reduction, so on a single thread the
+	one-stage path is used instead. */
+template <typename T>
+int qbEigSymmetric(const qbMatrix2<T> &inputMatrix, std::vector<T> &eigenValues, qbMatrix2<T> &eigenVectors)
+{
+	// Verify that the input matrix is square and symmetric.
+	qbMatrix2<T> A = inputMatrix;
+	if (!A.IsSquare())
+		return QBEIG_MATRIXNOTSQUARE;
+
+	if (!A.IsSymmetric())
+		return QBEIG_MATRIXNOTSYMMETRIC;
+
+	int n = A.GetNumRows();
+	if (n == 0)
+	{
+		eigenValues.clear();
+		eigenVectors.Resize(0, 0);
+		return 0;
+	}
+
+	std::vector<T> d(n), e(n-1);
+	if ((n < QBEIG_TWOSTAGEMINSIZE) || (qbParallelNumThreads() < 2))
+	{
+		// One-stage reduction, then eigenVectors = Q*Z.
+		std::vector<T> tau(std::max(n-2, 0));
+		qbEIGSymKernels::Tridiagonalize(n, A.GetData(), d.data(), e.data(), tau.data());
+		qbMatrix2<T> Q(n, n), Z(n, n);
+		qbEIGSymKernels::FormQ(n, A.GetData(), tau.data(), Q.GetData());
+
+		int status = qbEIGSymKernels::SolveTridiagonal(n, d.data(), e, Z.GetData());
+		qbEIGSymKernels::ReverseOrder(n, d.data(), Z.GetData());
+
+		eigenVectors.Resize(n, n);
+		qbEIGSymKernels::ParallelGEMM(n, n, n, Q.GetData(), n, Z.GetData(), n, eigenVectors.GetData(), n);
+		eigenValues = d;
+		return status;
+	}
+
+	// Two-stage reduction, then apply Q1*Q2 to the eigenvectors of T in place.
+	qbEIGSymKernels::TwoStageReduction<T> reduction;
+	qbEIGSymKernels::TridiagonalizeTwoStage(n, std::min(QBEIG_BANDWIDTH, n-1), A.GetData(), d.data(), e.data(), reduction,
+		static_cast<int>(qbParallelNumThreads()));
+
+	eigenVectors.Resize(n, n);
+	int status = qbEIGSymKernels::SolveTridiagonal(n, d.data(), e, eigenVectors.GetData());
+	qbEIGSymKernels::ReverseOrder(n, d.data(), eigenVectors.GetData());
+	qbEIGSymKernels::ApplyTwoStageQ(reduction, eigenVectors.GetData(), n);
+	eigenValues = d;
+
+	return status;
+}
+
+#endif
@@ -0,0 +1,357 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBGEMM_H
+#define QBGEMM_H
+
+/* *************************************************************************************************
+
+	qbGEMM / qbStrassen
+
+	Functions to compute the general matrix-matrix product C = A*B.
+
+	*** INPUTS ***
+
+	A					qbMatrix2<T>	The left hand matrix.
+	B					qbMatrix2<T>	The right hand matrix.
+	C					qbMatrix2<T>	The output matrix (resized as required).
+	crossover	INT						(qbStrassen only) Sub-problems of this size or smaller are
+													computed with the blocked kernel.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates failure due to mismatched matrix dimensions.
+
+	qbGEMM uses a cache-blocked triple loop and produces the same rounding behaviour as the
+	element-by-element * operator (up to the order of summation).
+
+	qbStrassen is opt-in. Above the crossover it applies the Strassen-Winograd recursion (7 products
+	and 15 additions per level) on top of the blocked kernel, with the seven top-level products
+	computed in parallel. Below the top level the workspace-minimizing schedule of Boyer, Dumas,
+	Pernet and Zhou is used, which needs only two quadrant-sized temporaries per level (about 2n^2/3
+	elements in total).
+
+	*** ERROR BOUND ***
+
+	Strassen-type algorithms do NOT satisfy the usual componentwise bound of conventional
+	multiplication, |C - fl(AB)| <= n*u*|A||B|. Only a normwise bound holds. For the Winograd
+	variant with recursion stopped at size n0 (Higham, Accuracy and Stability of Numerical
+	Algorithms, 2nd ed., Sec. 23.2.2):
+
+		||C - fl(AB)|| <= [ (n/n0)^log2(18) * (n0^2 + 6*n0) - 6*n ] * u * ||A|| * ||B|| + O(u^2)
+
+	where u is the unit roundoff. In practice the error is much smaller than this, but elements of
+	C that are small relative to ||A||*||B|| can lose relative accuracy. Use qbGEMM where this
+	matters.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <future>
+#include <thread>
+#include <algorithm>
+
+#include "qbMatrix.h"
+
+// Define error codes.
+constexpr int QBGEMM_DIMENSIONMISMATCH = -1;
+
+// Default crossover below which qbStrassen uses the blocked kernel.
+constexpr int QBGEMM_STRASSENCROSSOVER = 512;
+
+namespace qbGEMMKernels
+{
+
+// Block sizes for the blocked kernel (rows of A, shared dimension, columns of B).
+constexpr int BLOCK_M = 64;
+constexpr int BLOCK_K = 256;
+constexpr int BLOCK_N = 512;
+
+/* The blocked kernel. Computes C = A*B (or C += A*B if accumulate is set) for
+	row-major data with leading dimensions lda, ldb and ldc. The innermost loop
+	runs along a row of B and C so that it is contiguous and vectorizes. */
+template <typename T>
+void BlockedGEMM(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc, bool accumulate)
+{
+	if (!accumulate)
+	{
+		for (int i=0; i<m; ++i)
+			std::fill(C + (size_t)i*ldc, C + (size_t)i*ldc + n, static_cast<T>(0.0));
+	}
+
+	for (int kk=0; kk<k; kk+=BLOCK_K)
+	{
+		int kMax = std::min(kk + BLOCK_K, k);
+		for (int ii=0; ii<m; ii+=BLOCK_M)
+		{
+			int iMax = std::min(ii + BLOCK_M, m);
+			for (int jj=0; jj<n; jj+=BLOCK_N)
+			{
+				int jMax = std::min(jj + BLOCK_N, n);
+				for (int i=ii; i<iMax; ++i)
+				{
+					T* cRow = C + (size_t)i*ldc;
+					const T* aRow = A + (size_t)i*lda;
+					for (int p=kk; p<kMax; ++p)
+					{
+						T a = aRow[p];
+						const T* bRow = B + (size_t)p*ldb;
+						for (int j=jj; j<jMax; ++j)
+							cRow[j] += a * bRow[j];
+					}
+				}
+			}
+		}
+	}
+}
+
+// C = A + B for n x n blocks.
+template <typename T>
+void Add(int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc)
+{
+	for (int i=0; i<n; ++i)
+	{
+		const T* a = A + (size_t)i*lda;
+		const T* b = B + (size_t)i*ldb;
+		T* c = C + (size_t)i*ldc;
+		for (int j=0; j<n; ++j)
+			c[j] = a[j] + b[j];
+	}
+}
+
+// C = A - B for n x n blocks.
+template <typename T>
+void Sub(int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc)
+{
+	for (int i=0; i<n; ++i)
+	{
+		const T* a = A + (size_t)i*lda;
+		const T* b = B + (size_t)i*ldb;
+		T* c = C + (size_t)i*ldc;
+		for (int j=0; j<n; ++j)
+			c[j] = a[j] - b[j];
+	}
+}
+
+/* Sequential Strassen-Winograd recursion for C = A*B (n x n, n even at every level
+	above the crossover). Uses the schedule of Boyer et al. (2009), which needs only
+	the two temporaries X and Y, the remaining intermediates being held in the
+	quadrants of C. */
+template <typename T>
+void StrassenSequential(int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc, int crossover)
+{
+	if (n <= crossover)
+	{
+		BlockedGEMM(n, n, n, A, lda, B, ldb, C, ldc, false);
+		return;
+	}
+
+	int h = n / 2;
+	const T* A11 = A;
+	const T* A12 = A + h;
+	const T* A21 = A + (size_t)h*lda;
+	const T* A22 = A21 + h;
+	const T* B11 = B;
+	const T* B12 = B + h;
+	const T* B21 = B + (size_t)h*ldb;
+	const T* B22 = B21 + h;
+	T* C11 = C;
+	T* C12 = C + h;
+	T* C21 = C + (size_t)h*ldc;
+	T* C22 = C21 + h;
+
+	std::vector<T> xData((size_t)h*h);
+	std::vector<T> yData((size_t)h*h);
+	T* X = xData.data();
+	T* Y = yData.data();
+
+	Sub(h, A11, lda, A21, lda, X, h);								// S3 = A11 - A21
+	Sub(h, B22, ldb, B12, ldb, Y, h);								// T3 = B22 - B12
+	StrassenSequential(h, X, h, Y, h, C21, ldc, crossover);			// P7 = S3*T3
+	Add(h, A21, lda, A22, lda, X, h);								// S1 = A21 + A22
+	Sub(h, B12, ldb, B11, ldb, Y, h);								// T1 = B12 - B11
+	StrassenSequential(h, X, h, Y, h, C22, ldc, crossover);			// P5 = S1*T1
+	Sub(h, X, h, A11, lda, X, h);									// S2 = S1 - A11
+	Sub(h, B22, ldb, Y, h, Y, h);									// T2 = B22 - T1
+	StrassenSequential(h, X, h, Y, h, C12, ldc, crossover);			// P6 = S2*T2
+	Sub(h, A12, lda, X, h, X, h);									// S4 = A12 - S2
+	StrassenSequential(h, X, h, B22, ldb, C11, ldc, crossover);		// P3 = S4*B22
+	StrassenSequential(h, A11, lda, B11, ldb, X, h, crossover);		// P1 = A11*B11
+	Add(h, X, h, C12, ldc, C12, ldc);								// U2 = P1 + P6
+	Add(h, C12, ldc, C21, ldc, C21, ldc);							// U3 = U2 + P7
+	Add(h, C12, ldc, C22, ldc, C12, ldc);							// U4 = U2 + P5
+	Add(h, C21, ldc, C22, ldc, C22, ldc);							// U7 = U3 + P5 -> C22
+	Add(h, C12, ldc, C11, ldc, C12, ldc);							// U5 = U4 + P3 -> C12
+	Sub(h, Y, h, B21, ldb, Y, h);									// T4 = T2 - B21
+	StrassenSequential(h, A22, lda, Y, h, C11, ldc, crossover);		// P4 = A22*T4
+	Sub(h, C21, ldc, C11, ldc, C21, ldc);							// U6 = U3 - P4 -> C21
+	StrassenSequential(h, A12, lda, B21, ldb, C11, ldc, crossover);	// P2 = A12*B21
+	Add(h, X, h, C11, ldc, C11, ldc);								// U1 = P1 + P2 -> C11
+}
+
+/* Top level of the recursion, with the seven products computed as parallel tasks.
+	Each task needs its own operands, so this level trades the low-memory schedule
+	for 15 quadrant-sized temporaries. */
+template <typename T>
+void StrassenParallel(int n, const T* A, int lda, const T* B, int ldb, T* C, int ldc, int crossover)
+{
+	int h = n / 2;
+	size_t hh = (size_t)h*h;
+	const T* A11 = A;
+	const T* A12 = A + h;
+	const T* A21 = A + (size_t)h*lda;
+	const T* A22 = A21 + h;
+	const T* B11 = B;
+	const T* B12 = B + h;
+	const T* B21 = B + (size_t)h*ldb;
+	const T* B22 = B21 + h;
+
+	// Form the operands of the seven products.
+	std::vector<T> S1(hh), S2(hh), S3(hh), S4(hh);
+	std::vector<T> T1(hh), T2(hh), T3(hh), T4(hh);
+	Add(h, A21, lda, A22, lda, S1.data(), h);
+	Sub(h, S1.data(), h, A11, lda, S2.data(), h);
+	Sub(h, A11, lda, A21, lda, S3.data(), h);
+	Sub(h, A12, lda, S2.data(), h, S4.data(), h);
+	Sub(h, B12, ldb, B11, ldb, T1.data(), h);
+	Sub(h, B22, ldb, T1.data(), h, T2.data(), h);
+	Sub(h, B22, ldb, B12, ldb, T3.data(), h);
+	Sub(h, T2.data(), h, B21, ldb, T4.data(), h);
+
+	// Compute the products in parallel.
+	std::vector<std::vector<T>> P(7, std::vector<T>(hh));
+	const T* lhs[7] = {A11, A12, S4.data(), A22, S1.data(), S2.data(), S3.data()};
+	const T* rhs[7] = {B11, B21, B22, T4.data(), T1.data(), T2.data(), T3.data()};
+	int lhsLd[7] = {lda, lda, h, lda, h, h, h};
+	int rhsLd[7] = {ldb, ldb, ldb, h, h, h, h};
+	std::vector<std::future<void>> tasks;
+	for (int i=0; i<7; ++i)
+	{
+		tasks.push_back(std::async(std::launch::async, [=, &P]()
+		{
+			StrassenSequential(h, lhs[i], lhsLd[i], rhs[i], rhsLd[i], P[i].data(), h, crossover);
+		}));
+	}
+	for (auto &task : tasks)
+		task.get();
+
+	// Combine the products into the quadrants of C.
+	T* C11 = C;
+	T* C12 = C + h;
+	T* C21 = C + (size_t)h*ldc;
+	T* C22 = C21 + h;
+	for (int i=0; i<h; ++i)
+	{
+		for (int j=0; j<h; ++j)
+		{
+			size_t idx = (size_t)i*h + j;
+			T u2 = P[0][idx] + P[5][idx];
+			T u3 = u2 + P[6][idx];
+			T u4 = u2 + P[4][idx];
+			C11[(size_t)i*ldc + j] = P[0][idx] + P[1][idx];
+			C12[(size_t)i*ldc + j] = u4 + P[2][idx];
+			C21[(size_t)i*ldc + j] = u3 - P[3][idx];
+			C22[(size_t)i*ldc + j] = u3 + P[4][idx];
+		}
+	}
+}
+
+}
+
+// The qbGEMM function (blocked, conventional multiplication).
+template <typename T>
+int qbGEMM(const qbMatrix2<T> &A, const qbMatrix2<T> &B, qbMatrix2<T> &C)
+{
+	// Verify the dimensions of the inputs.
+	if (A.GetNumCols() != B.GetNumRows())
+		return QBGEMM_DIMENSIONMISMATCH;
+
+	int m = A.GetNumRows();
+	int k = A.GetNumCols();
+	int n = B.GetNumCols();
+
+	qbMatrix2<T> result(m, n);
+	qbGEMMKernels::BlockedGEMM(m, n, k, A.GetData(), k, B.GetData(), n, result.GetData(), n, false);
+	C = result;
+
+	return 1;
+}
+
+// The qbStrassen function (opt-in Strassen-Winograd multiplication for large square matrices).
+template <typename T>
+int qbStrassen(const qbMatrix2<T> &A, const qbMatrix2<T> &B, qbMatrix2<T> &C, int crossover = QBGEMM_STRASSENCROSSOVER)
+{
+	// Verify the dimensions of the inputs.
+	if (A.GetNumCols() != B.GetNumRows())
+		return QBGEMM_DIMENSIONMISMATCH;
+
+	/* The recursion is only applied to square products above the crossover,
+		everything else goes straight to the blocked kernel. */
+	int n = A.GetNumRows();
+	if ((crossover < 1) || (n <= crossover) || (A.GetNumCols() != n) || (B.GetNumCols() != n))
+		return qbGEMM(A, B, C);
+
+	/* Find the number of levels of recursion and the padded size, which must be
+		divisible by two at every level. Padding is at most 2^levels - 1 rows and columns. */
+	int levels = 0;
+	int baseSize = n;
+	while (baseSize > crossover)
+	{
+		baseSize = (baseSize + 1) / 2;
+		levels++;
+	}
+	int paddedSize = baseSize << levels;
+
+	// Zero-pad the inputs if required.
+	const T* aData = A.GetData();
+	const T* bData = B.GetData();
+	std::vector<T> aPadded, bPadded, cPadded;
+	if (paddedSize != n)
+	{
+		aPadded.assign((size_t)paddedSize*paddedSize, static_cast<T>(0.0));
+		bPadded.assign((size_t)paddedSize*paddedSize, static_cast<T>(0.0));
+		cPadded.assign((size_t)paddedSize*paddedSize, static_cast<T>(0.0));
+		for (int i=0; i<n; ++i)
+		{
+			std::copy(aData + (size_t)i*n, aData + (size_t)(i+1)*n, aPadded.begin() + (size_t)i*paddedSize);
+			std::copy(bData + (size_t)i*n, bData + (size_t)(i+1)*n, bPadded.begin() + (size_t)i*paddedSize);
+		}
+		aData = aPadded.data();
+		bData = bPadded.data();
+	}
+
+	qbMatrix2<T> result(n, n);
+	T* cData = (paddedSize != n) ? cPadded.data() : result.GetData();
+
+	// Parallelize over the seven top-level products if we have more than one core.
+	if (std::thread::hardware_concurrency() > 1)
+		qbGEMMKernels::StrassenParallel(paddedSize, aData, paddedSize, bData, paddedSize, cData, paddedSize, crossover);
+	else
+		qbGEMMKernels::StrassenSequential(paddedSize, aData, paddedSize, bData, paddedSize, cData, paddedSize, crossover);
+
+	// Extract the result from the padded output.
+	if (paddedSize != n)
+	{
+		T* resultData = result.GetData();
+		for (int i=0; i<n; ++i)
+			std::copy(cPadded.begin() + (size_t)i*paddedSize, cPadded.begin() + (size_t)i*paddedSize + n, resultData + (size_t)i*n);
+	}
+
+	C = result;
+	return 1;
+}
+
+#endif
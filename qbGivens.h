@@ -0,0 +1,442 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBGIVENS_H
+#define QBGIVENS_H
+
+/* *************************************************************************************************
+
+	qbQRGivens / qbQRUpdate / qbQRAddRow / qbQRDeleteRow
+
+	Functions to compute and update QR decompositions with Givens rotations.
+
+	*** INPUTS ***
+
+	A					qbMatrix2<T>	The [m x n] matrix to decompose (m >= n).
+	Q					qbMatrix2<T>	The [m x m] orthogonal factor (output of qbQRGivens, updated
+													in place by qbQRUpdate).
+	R					qbMatrix2<T>	The upper triangular factor ([m x n] for qbQRGivens and
+													qbQRUpdate, [n x n] for qbQRAddRow and qbQRDeleteRow).
+	u, v			qbVector<T>		(qbQRUpdate only) The rank-one change, A + u*v'.
+	x					qbVector<T>		(qbQRAddRow / qbQRDeleteRow only) The row to add or remove.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates failure due to the matrix having more columns than rows.
+						-2 indicates failure due to mismatched dimensions.
+						-3 indicates that the downdated matrix is not positive definite, so the
+							row cannot be removed (qbQRDeleteRow).
+
+	A Givens rotation G = [c s; -s c] acts on just two rows, so it can zero one element at a time
+	without touching the rest of the matrix. Householder QR fills in any structure the matrix
+	has, but with rotations only the non-zero part of each pair of rows is updated: an upper
+	Hessenberg matrix needs n-1 rotations of O(n) work each, and a banded matrix keeps its band
+	(widened by the lower bandwidth). qbQRGivens finds the structure itself, from the last
+	non-zero element of each column and row.
+
+	qbQRUpdate computes the QR decomposition of A + u*v' from that of A in O(m^2) operations
+	(Golub and Van Loan, Matrix Computations, Sec. 6.5): rotations reduce Q'*u to a multiple of
+	the first unit vector, which makes R upper Hessenberg, and a second sequence of rotations
+	restores the triangular form. qbQRAddRow and qbQRDeleteRow update only the R factor (as for
+	least squares, where R'R = X'X) when a row x is added to or removed from X, in O(n^2)
+	operations. Removing a row uses the LINPACK downdating method, which fails if R'R - x*x' is
+	not positive definite.
+
+	The rotations are generated without overflow or underflow (one square root and one division
+	each). Sequences of rotations are applied in batches: from the left a block of columns at a
+	time, so that the block stays in cache while every rotation of the sequence (or of several
+	sequences) passes over it, and from the right a row at a time, with the rows in parallel.
+	Several sequences of adjacent rotations (such as the two in qbQRUpdate, or the one per
+	column from qbQRGivens) are interleaved in wavefront order, so that each pair of rows (or
+	elements of a row) has all of the sequences applied to it while it is in cache.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "qbMatrix.h"
+#include "qbVector.h"
+#include "qbParallel.h"
+
+// Define error codes.
+constexpr int QBGIVENS_MATRIXTOOWIDE = -1;
+constexpr int QBGIVENS_DIMENSIONMISMATCH = -2;
+constexpr int QBGIVENS_NOTPOSITIVEDEFINITE = -3;
+
+namespace qbGivensKernels
+{
+
+// Width of the column blocks for applying rotations from the left.
+constexpr int BLOCK_COLS = 256;
+
+// Number of sequences of adjacent rotations that are interleaved in each wavefront.
+constexpr int WAVEFRONT_SEQUENCES = 16;
+
+// A rotation of rows (or columns) i and j: [x_i; x_j] = [c s; -s c] * [x_i; x_j].
+template <typename T>
+struct Rotation
+{
+	int i;
+	int j;
+	T c;
+	T s;
+};
+
+// Compute c and s such that [c s; -s c] * [a; b] = [r; 0].
+template <typename T>
+void MakeRotation(T a, T b, T &c, T &s, T &r)
+{
+	if (b == static_cast<T>(0.0))
+	{
+		c = static_cast<T>(1.0);
+		s = static_cast<T>(0.0);
+		r = a;
+	}
+	else if (fabs(b) > fabs(a))
+	{
+		T t = a / b;
+		T u = sqrt(static_cast<T>(1.0) + t*t);
+		s = static_cast<T>(1.0) / u;
+		c = t * s;
+		r = b * u;
+	}
+	else
+	{
+		T t = b / a;
+		T u = sqrt(static_cast<T>(1.0) + t*t);
+		c = static_cast<T>(1.0) / u;
+		s = t * c;
+		r = a * u;
+	}
+}
+
+// Rotate the len contiguous elements of x and y: x = c*x + s*y, y = c*y - s*x.
+template <typename T>
+void RotatePair(int len, T c, T s, T* x, T* y)
+{
+	for (int k=0; k<len; ++k)
+	{
+		T xk = x[k];
+		T yk = y[k];
+		x[k] = c * xk + s * yk;
+		y[k] = c * yk - s * xk;
+	}
+}
+
+/* Reorder rotations that form sequences of adjacent rotations (i, i+1), with i decreasing
+	along each sequence (as from GivensQR or qbQRUpdate), for wavefront application (Van Zee,
+	van de Geijn and Quintana-Orti, 2011). The sequences are taken WAVEFRONT_SEQUENCES at a time,
+	and rotation i of sequence p is put in wave p + (top - i), so that each wave touches a window
+	of rows (or columns) that moves down by one per wave. Each pair of rows is then rotated by
+	every sequence in the group while it is in cache, instead of once per sequence. Rotations
+	that share a row are kept in their original order, so the product is unchanged. Returns
+	false if the rotations don't have this form, or form a single sequence. */
+template <typename T>
+bool WavefrontOrder(const std::vector<Rotation<T>> &rotations, std::vector<Rotation<T>> &ordered)
+{
+	size_t numRotations = rotations.size();
+	std::vector<int> sequence(numRotations);
+	int numSequences = 0;
+	int top = 0;
+	int bottom = 0;
+	for (size_t k=0; k<numRotations; ++k)
+	{
+		const Rotation<T> &g = rotations[k];
+		if (g.j != g.i + 1)
+			return false;
+		if ((k == 0) || (g.i >= rotations[k-1].i))
+			++numSequences;
+		sequence[k] = numSequences - 1;
+		top = (k == 0) ? g.i : std::max(top, g.i);
+		bottom = (k == 0) ? g.i : std::min(bottom, g.i);
+	}
+	if (numSequences < 2)
+		return false;
+
+	// A stable counting sort by (group, wave), which keeps the sequences of a wave in order.
+	size_t wavesPerGroup = WAVEFRONT_SEQUENCES + top - bottom;
+	size_t numGroups = (numSequences + WAVEFRONT_SEQUENCES - 1) / WAVEFRONT_SEQUENCES;
+	std::vector<size_t> start(numGroups*wavesPerGroup + 1, 0);
+	std::vector<size_t> key(numRotations);
+	for (size_t k=0; k<numRotations; ++k)
+	{
+		int group = sequence[k] / WAVEFRONT_SEQUENCES;
+		int wave = sequence[k] % WAVEFRONT_SEQUENCES + top - rotations[k].i;
+		key[k] = (size_t)group*wavesPerGroup + wave;
+		++start[key[k] + 1];
+	}
+	for (size_t w=1; w<start.size(); ++w)
+		start[w] += start[w-1];
+	ordered.resize(numRotations);
+	for (size_t k=0; k<numRotations; ++k)
+		ordered[start[key[k]]++] = rotations[k];
+	return true;
+}
+
+/* A = G(last)*...*G(1)*G(0)*A for the row-major matrix a with numCols columns. Each block of
+	columns has the whole sequence applied to it before moving on, and the blocks are
+	independent, so they are processed in parallel. Sequences of adjacent rotations are
+	applied in wavefront order. */
+template <typename T>
+void ApplyLeft(const std::vector<Rotation<T>> &rotations, int numCols, T* a, int lda)
+{
+	if (rotations.empty())
+		return;
+
+	std::vector<Rotation<T>> wavefront;
+	const std::vector<Rotation<T>> &order = WavefrontOrder(rotations, wavefront) ? wavefront : rotations;
+
+	size_t numBlocks = (numCols + BLOCK_COLS - 1) / BLOCK_COLS;
+	size_t minBlocks = std::max(static_cast<size_t>(1), static_cast<size_t>(1 << 16) / (rotations.size() * BLOCK_COLS));
+	qbParallelFor(numBlocks, minBlocks, [&](size_t first, size_t last)
+	{
+		for (size_t blk=first; blk<last; ++blk)
+		{
+			int j0 = static_cast<int>(blk) * BLOCK_COLS;
+			int len = std::min(BLOCK_COLS, numCols - j0);
+			for (const Rotation<T> &g : order)
+				RotatePair(len, g.c, g.s, a + (size_t)g.i*lda + j0, a + (size_t)g.j*lda + j0);
+		}
+	});
+}
+
+/* A = A*G(0)'*G(1)'*...*G(last)' for the row-major matrix a with numRows rows. Each row has
+	the whole sequence applied to it, with the rows in parallel. If upperHessenberg is set, the
+	product is known to be upper Hessenberg (as for R*Q in a QR step on a Hessenberg matrix),
+	and rotation (i, j) is only applied to rows 0 to max(i, j). Sequences of adjacent rotations
+	are applied in wavefront order, so that only a short window of each row is in use at a time. */
+template <typename T>
+void ApplyRight(const std::vector<Rotation<T>> &rotations, int numRows, T* a, int lda, bool upperHessenberg = false)
+{
+	if (rotations.empty())
+		return;
+
+	std::vector<Rotation<T>> wavefront;
+	const std::vector<Rotation<T>> &order = WavefrontOrder(rotations, wavefront) ? wavefront : rotations;
+
+	size_t minRows = std::max(static_cast<size_t>(16), static_cast<size_t>(1 << 16) / rotations.size());
+	qbParallelFor(numRows, minRows, [&](size_t first, size_t last)
+	{
+		for (size_t r=first; r<last; ++r)
+		{
+			T* row = a + r*lda;
+			for (const Rotation<T> &g : order)
+			{
+				if (upperHessenberg && (static_cast<int>(r) > std::max(g.i, g.j)))
+					continue;
+				T x = row[g.i];
+				T y = row[g.j];
+				row[g.i] = g.c * x + g.s * y;
+				row[g.j] = g.c * y - g.s * x;
+			}
+		}
+	});
+}
+
+/* Givens QR factorization of the m x n row-major matrix a, in place (R is left in a). The
+	elements below the diagonal are zeroed from the bottom of each column upwards, with
+	rotations of adjacent rows, starting from the last non-zero element of the column. Each
+	rotation only updates the columns up to the last non-zero element of either row. The
+	rotations are returned in the order in which they were applied, so that A = Q*R with
+	Q = G(0)'*G(1)'*...*G(last)'. */
+template <typename T>
+void GivensQR(int m, int n, T* a, int lda, std::vector<Rotation<T>> &rotations)
+{
+	rotations.clear();
+
+	// One past the last non-zero column of each row.
+	std::vector<int> rowEnd(m);
+	for (int i=0; i<m; ++i)
+	{
+		int end = n;
+		while ((end > 0) && (a[(size_t)i*lda + end - 1] == static_cast<T>(0.0)))
+			--end;
+		rowEnd[i] = end;
+	}
+
+	for (int j=0; j<std::min(m-1, n); ++j)
+	{
+		int lastRow = m - 1;
+		while ((lastRow > j) && (a[(size_t)lastRow*lda + j] == static_cast<T>(0.0)))
+			--lastRow;
+
+		for (int i=lastRow; i>j; --i)
+		{
+			T* upper = a + (size_t)(i-1)*lda;
+			T* lower = a + (size_t)i*lda;
+			if (lower[j] == static_cast<T>(0.0))
+				continue;
+
+			T c, s, r;
+			MakeRotation(upper[j], lower[j], c, s, r);
+			upper[j] = r;
+			lower[j] = static_cast<T>(0.0);
+			int end = std::max(rowEnd[i-1], rowEnd[i]);
+			RotatePair(end - j - 1, c, s, upper + j + 1, lower + j + 1);
+			rowEnd[i-1] = end;
+			rowEnd[i] = end;
+			rotations.push_back({i-1, i, c, s});
+		}
+	}
+}
+
+/* One step of the (unshifted) QR algorithm on the n x n upper Hessenberg row-major matrix a,
+	in place: H = R*Q where H = Q*R. Costs O(n^2), and the result is upper Hessenberg again. */
+template <typename T>
+void HessenbergQRStep(int n, T* a, std::vector<Rotation<T>> &rotations)
+{
+	GivensQR(n, n, a, n, rotations);
+	ApplyRight(rotations, n, a, n, true);
+}
+
+}
+
+// The qbQRGivens function.
+template <typename T>
+int qbQRGivens(const qbMatrix2<T> &A, qbMatrix2<T> &Q, qbMatrix2<T> &R)
+{
+	int numRows = A.GetNumRows();
+	int numCols = A.GetNumCols();
+	if (numRows < numCols)
+		return QBGIVENS_MATRIXTOOWIDE;
+
+	qbMatrix2<T> Rmat = A;
+	std::vector<qbGivensKernels::Rotation<T>> rotations;
+	qbGivensKernels::GivensQR(numRows, numCols, Rmat.GetData(), numCols, rotations);
+
+	// Q = I*G(0)'*G(1)'*...
+	qbMatrix2<T> Qmat(numRows, numRows);
+	Qmat.SetToIdentity();
+	qbGivensKernels::ApplyRight(rotations, numRows, Qmat.GetData(), numRows);
+	Rmat.SetProperties(QBMATRIX_UPPERTRIANGULAR);
+
+	Q = Qmat;
+	R = Rmat;
+	return 1;
+}
+
+// The qbQRUpdate function: replace Q and R with the QR decomposition of Q*R + u*v'.
+template <typename T>
+int qbQRUpdate(qbMatrix2<T> &Q, qbMatrix2<T> &R, const qbVector<T> &u, const qbVector<T> &v)
+{
+	int numRows = R.GetNumRows();
+	int numCols = R.GetNumCols();
+	if ((Q.GetNumRows() != numRows) || (Q.GetNumCols() != numRows) || (u.GetNumDims() != numRows) || (v.GetNumDims() != numCols))
+		return QBGIVENS_DIMENSIONMISMATCH;
+
+	// w = Q'*u.
+	std::vector<T> w(numRows, static_cast<T>(0.0));
+	const T* q = Q.GetData();
+	for (int r=0; r<numRows; ++r)
+	{
+		T ur = u.GetElement(r);
+		const T* qRow = q + (size_t)r*numRows;
+		for (int i=0; i<numRows; ++i)
+			w[i] += qRow[i] * ur;
+	}
+
+	/* Rotate w onto the first unit vector, from the bottom up, applying the same rotations
+		to R. Rotation (i-1, i) only touches columns i-1 onwards, so R becomes upper Hessenberg. */
+	T* r = R.GetData();
+	std::vector<qbGivensKernels::Rotation<T>> rotations;
+	for (int i=numRows-1; i>0; --i)
+	{
+		T c, s, rho;
+		qbGivensKernels::MakeRotation(w[i-1], w[i], c, s, rho);
+		w[i-1] = rho;
+		w[i] = static_cast<T>(0.0);
+		int j0 = std::min(i-1, numCols);
+		qbGivensKernels::RotatePair(numCols - j0, c, s, r + (size_t)(i-1)*numCols + j0, r + (size_t)i*numCols + j0);
+		rotations.push_back({i-1, i, c, s});
+	}
+
+	// Q*R + u*v' = Q*(R + w*v'), and w is now zero apart from its first element.
+	for (int j=0; j<numCols; ++j)
+		r[j] += w[0] * v.GetElement(j);
+
+	// Restore the triangular form (one rotation per column), and apply both sequences to Q together.
+	std::vector<qbGivensKernels::Rotation<T>> second;
+	qbGivensKernels::GivensQR(numRows, numCols, r, numCols, second);
+	rotations.insert(rotations.end(), second.begin(), second.end());
+	qbGivensKernels::ApplyRight(rotations, numRows, Q.GetData(), numRows);
+
+	return 1;
+}
+
+// The qbQRAddRow function: update the [n x n] R factor of X when the row x is added to X.
+template <typename T>
+int qbQRAddRow(qbMatrix2<T> &R, const qbVector<T> &x)
+{
+	int n = R.GetNumCols();
+	if ((R.GetNumRows() != n) || (x.GetNumDims() != n))
+		return QBGIVENS_DIMENSIONMISMATCH;
+
+	// Rotate x into R one row at a time: rotation k zeros x(k) against R(k, k).
+	std::vector<T> work(x.GetData(), x.GetData() + n);
+	T* r = R.GetData();
+	for (int k=0; k<n; ++k)
+	{
+		T* rRow = r + (size_t)k*n;
+		T c, s, rho;
+		qbGivensKernels::MakeRotation(rRow[k], work[k], c, s, rho);
+		rRow[k] = rho;
+		work[k] = static_cast<T>(0.0);
+		qbGivensKernels::RotatePair(n - k - 1, c, s, rRow + k + 1, work.data() + k + 1);
+	}
+	return 1;
+}
+
+// The qbQRDeleteRow function: update the [n x n] R factor of X when the row x is removed from X.
+template <typename T>
+int qbQRDeleteRow(qbMatrix2<T> &R, const qbVector<T> &x)
+{
+	int n = R.GetNumCols();
+	if ((R.GetNumRows() != n) || (x.GetNumDims() != n))
+		return QBGIVENS_DIMENSIONMISMATCH;
+
+	// Solve R'*p = x, and find rho such that ||[p; rho]|| = 1.
+	T* r = R.GetData();
+	std::vector<T> p(n);
+	T pNorm = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+	{
+		T sum = x.GetElement(i);
+		for (int k=0; k<i; ++k)
+			sum -= r[(size_t)k*n + i] * p[k];
+		if (r[(size_t)i*n + i] == static_cast<T>(0.0))
+			return QBGIVENS_NOTPOSITIVEDEFINITE;
+		p[i] = sum / r[(size_t)i*n + i];
+		pNorm += p[i] * p[i];
+	}
+	if (!(pNorm < static_cast<T>(1.0)))
+		return QBGIVENS_NOTPOSITIVEDEFINITE;
+	T rho = sqrt(static_cast<T>(1.0) - pNorm);
+
+	/* Rotations that zero p(n-1), ..., p(0) against rho, applied to [R; 0]. The extra row
+		becomes x' and what is left in R is the downdated factor. */
+	std::vector<T> extra(n, static_cast<T>(0.0));
+	for (int k=n-1; k>=0; --k)
+	{
+		T c, s, rhoNew;
+		qbGivensKernels::MakeRotation(rho, p[k], c, s, rhoNew);
+		rho = rhoNew;
+		qbGivensKernels::RotatePair(n - k, c, s, extra.data() + k, r + (size_t)k*n + k);
+	}
+	return 1;
+}
+
+#endif
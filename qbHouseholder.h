@@ -0,0 +1,455 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBHOUSEHOLDER_H
+#define QBHOUSEHOLDER_H
+
+/* *************************************************************************************************
+
+	qbHouseholderKernels
+
+	Building blocks for the Householder-based factorizations (qbQR, qbQRThin and the symmetric
+	eigensolver reductions in qbEIGSym).
+
+	*** INPUTS ***
+
+	None (kernels only, working directly on row-major data).
+
+	*** OUTPUTS ***
+
+	None
+
+	A reflector is H = I - tau*v*v', with v[0] = 1. Applying reflectors one at a time is limited
+	by memory bandwidth, since every reflector has to stream through the whole trailing matrix.
+	Instead, a block of k reflectors is accumulated into the compact WY form
+
+		H(0)*H(1)*...*H(k-1) = I - V*T*V'
+
+	where V (m x k) is unit lower trapezoidal and T (k x k) is upper triangular (Schreiber and
+	Van Loan, 1989). The block is then applied to an m x n matrix C as
+
+		W = V'*C				(GEMM)
+		W = T*W					(triangular multiply)
+		C = C - V*W			(GEMM)
+
+	so that almost all of the work is in matrix-matrix products. QRFactor and FormQ use this for
+	a blocked QR factorization: each panel of BLOCK_SIZE columns is factorized with single
+	reflectors and the rest of the matrix is updated with one block reflector. ReduceToHessenberg
+	works by panels in the same way, with the update from the right done by one GEMM.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "qbGEMM.h"
+#include "qbParallel.h"
+
+namespace qbHouseholderKernels
+{
+
+// Number of reflectors accumulated into each block reflector.
+constexpr int BLOCK_SIZE = 32;
+
+/* C = A*B (or C += A*B if accumulate is set) for row-major data, with the columns of B and C
+	split across threads. Small products are computed on the calling thread. */
+template <typename T>
+void ParallelGEMM(int m, int n, int k, const T* A, int lda, const T* B, int ldb, T* C, int ldc, bool accumulate = false)
+{
+	size_t work = std::max(static_cast<size_t>(1), (size_t)m*k);
+	size_t minColumns = std::max(static_cast<size_t>(64), static_cast<size_t>(1 << 22) / work);
+	qbParallelFor(n, minColumns, [=](size_t first, size_t last)
+	{
+		qbGEMMKernels::BlockedGEMM(m, static_cast<int>(last - first), k, A, lda, B + first, ldb, C + first, ldc, accumulate);
+	});
+}
+
+/* Householder reflector for the len elements x[0], x[stride], ... Stores v (with v[0] = 1)
+	and returns tau, with the element that remains (beta) in x[0] and zeros below it. */
+template <typename T>
+T MakeReflector(int len, T* x, size_t stride, T* v)
+{
+	v[0] = static_cast<T>(1.0);
+	T alpha = x[0];
+	T sigma = static_cast<T>(0.0);
+	for (int i=1; i<len; ++i)
+		sigma += x[i*stride] * x[i*stride];
+
+	if (sigma == static_cast<T>(0.0))
+	{
+		for (int i=1; i<len; ++i)
+			v[i] = static_cast<T>(0.0);
+		return static_cast<T>(0.0);
+	}
+
+	T norm = sqrt(alpha*alpha + sigma);
+	T beta = (alpha <= static_cast<T>(0.0)) ? norm : -norm;
+	T scale = static_cast<T>(1.0) / (alpha - beta);
+	for (int i=1; i<len; ++i)
+	{
+		v[i] = x[i*stride] * scale;
+		x[i*stride] = static_cast<T>(0.0);
+	}
+	x[0] = beta;
+	return (beta - alpha) / beta;
+}
+
+/* Copy k reflectors stored below the diagonal of the m x k block a (the unit diagonal is
+	implied) into the explicit m x k matrix V. */
+template <typename T>
+void ExtractV(int m, int k, const T* a, int lda, T* V)
+{
+	for (int i=0; i<m; ++i)
+	{
+		const T* aRow = a + (size_t)i*lda;
+		T* vRow = V + (size_t)i*k;
+		for (int j=0; j<k; ++j)
+			vRow[j] = (j < i) ? aRow[j] : ((j == i) ? static_cast<T>(1.0) : static_cast<T>(0.0));
+	}
+}
+
+/* Upper triangular factor Tm (k x k) of the compact WY form H(0)*...*H(k-1) = I - V*Tm*V',
+	for the m x k matrix of reflectors V and their scale factors tau. */
+template <typename T>
+void FormT(int m, int k, const T* V, const T* tau, T* Tm)
+{
+	std::fill(Tm, Tm + (size_t)k*k, static_cast<T>(0.0));
+	std::vector<T> t(k);
+	for (int j=0; j<k; ++j)
+	{
+		// t = -tau(j) * V(:, 0:j)' * V(:, j), then column j of Tm is Tm(0:j, 0:j) * t.
+		std::fill(t.begin(), t.begin() + j, static_cast<T>(0.0));
+		for (int r=j; r<m; ++r)
+		{
+			const T* vRow = V + (size_t)r*k;
+			T vj = vRow[j];
+			for (int i=0; i<j; ++i)
+				t[i] += vRow[i] * vj;
+		}
+		for (int i=0; i<j; ++i)
+		{
+			T sum = static_cast<T>(0.0);
+			for (int p=i; p<j; ++p)
+				sum += Tm[(size_t)i*k + p] * t[p];
+			Tm[(size_t)i*k + j] = -tau[j] * sum;
+		}
+		Tm[(size_t)j*k + j] = tau[j];
+	}
+}
+
+/* W = Tm*W (or Tm'*W if transpose is set) in place, for the k x k upper triangular Tm and
+	the k x n row-major W. */
+template <typename T>
+void TriangularMultiply(int k, int n, const T* Tm, bool transpose, T* W)
+{
+	if (!transpose)
+	{
+		// Row i of the result only needs rows i to k-1, which have not been overwritten yet.
+		for (int i=0; i<k; ++i)
+		{
+			T* wRow = W + (size_t)i*n;
+			T tii = Tm[(size_t)i*k + i];
+			for (int j=0; j<n; ++j)
+				wRow[j] *= tii;
+			for (int p=i+1; p<k; ++p)
+			{
+				T tip = Tm[(size_t)i*k + p];
+				const T* pRow = W + (size_t)p*n;
+				for (int j=0; j<n; ++j)
+					wRow[j] += tip * pRow[j];
+			}
+		}
+	}
+	else
+	{
+		for (int i=k-1; i>=0; --i)
+		{
+			T* wRow = W + (size_t)i*n;
+			T tii = Tm[(size_t)i*k + i];
+			for (int j=0; j<n; ++j)
+				wRow[j] *= tii;
+			for (int p=0; p<i; ++p)
+			{
+				T tpi = Tm[(size_t)p*k + i];
+				const T* pRow = W + (size_t)p*n;
+				for (int j=0; j<n; ++j)
+					wRow[j] += tpi * pRow[j];
+			}
+		}
+	}
+}
+
+/* C = (I - V*Tm*V') * C, or C = (I - V*Tm'*V') * C if transpose is set, for the m x n
+	row-major C with leading dimension ldc. V is m x k and Tm is k x k. */
+template <typename T>
+void ApplyBlockLeft(int m, int n, int k, const T* V, const T* Tm, bool transpose, T* C, int ldc)
+{
+	if ((m == 0) || (n == 0) || (k == 0))
+		return;
+
+	std::vector<T> Vt((size_t)k*m);
+	for (int i=0; i<m; ++i)
+	{
+		for (int j=0; j<k; ++j)
+			Vt[(size_t)j*m + i] = V[(size_t)i*k + j];
+	}
+
+	std::vector<T> W((size_t)k*n);
+	ParallelGEMM(k, n, m, Vt.data(), m, C, ldc, W.data(), n);
+	TriangularMultiply(k, n, Tm, transpose, W.data());
+	for (size_t i=0; i<W.size(); ++i)
+		W[i] = -W[i];
+	ParallelGEMM(m, n, k, V, k, W.data(), n, C, ldc, true);
+}
+
+/* Blocked Householder QR factorization of the m x n row-major matrix a (leading dimension lda).
+	On return R is in the upper triangle and the min(m, n) reflectors are stored below the
+	diagonal (with the leading one implied), with their scale factors in tau. */
+template <typename T>
+void QRFactor(int m, int n, T* a, int lda, T* tau)
+{
+	int numReflectors = std::min(m, n);
+	std::vector<T> v(m), w(BLOCK_SIZE);
+	for (int j=0; j<numReflectors; j+=BLOCK_SIZE)
+	{
+		int nb = std::min(BLOCK_SIZE, numReflectors - j);
+
+		// Factorize the panel A(j:m, j:j+nb) one reflector at a time.
+		for (int c=j; c<j+nb; ++c)
+		{
+			int len = m - c;
+			T* x = a + (size_t)c*lda + c;
+			tau[c] = MakeReflector(len, x, lda, v.data());
+			for (int i=1; i<len; ++i)
+				x[(size_t)i*lda] = v[i];
+
+			int numPanelCols = j + nb - c - 1;
+			if ((numPanelCols == 0) || (tau[c] == static_cast<T>(0.0)))
+				continue;
+
+			std::fill(w.begin(), w.begin() + numPanelCols, static_cast<T>(0.0));
+			for (int i=0; i<len; ++i)
+			{
+				const T* row = x + (size_t)i*lda + 1;
+				for (int p=0; p<numPanelCols; ++p)
+					w[p] += v[i] * row[p];
+			}
+			for (int i=0; i<len; ++i)
+			{
+				T* row = x + (size_t)i*lda + 1;
+				T scale = tau[c] * v[i];
+				for (int p=0; p<numPanelCols; ++p)
+					row[p] -= scale * w[p];
+			}
+		}
+
+		// Update the trailing columns with the block reflector: A = (I - V*T'*V') * A.
+		if (j + nb < n)
+		{
+			std::vector<T> V((size_t)(m-j)*nb), Tm((size_t)nb*nb);
+			ExtractV(m-j, nb, a + (size_t)j*lda + j, lda, V.data());
+			FormT(m-j, nb, V.data(), tau + j, Tm.data());
+			ApplyBlockLeft(m-j, n-j-nb, nb, V.data(), Tm.data(), true, a + (size_t)j*lda + j + nb, lda);
+		}
+	}
+}
+
+/* C = Q*C (or C = Q'*C if transpose is set) for the m x n row-major matrix C, where
+	Q = H(0)*H(1)*...*H(k-1) is given by the k reflectors stored by QRFactor in a. */
+template <typename T>
+void ApplyQ(int m, int n, int k, const T* a, int lda, const T* tau, bool transpose, T* C, int ldc)
+{
+	int numBlocks = (k + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	for (int blk=0; blk<numBlocks; ++blk)
+	{
+		// Q*C applies the last block first, Q'*C the first block first.
+		int j = (transpose ? blk : numBlocks - 1 - blk) * BLOCK_SIZE;
+		int nb = std::min(BLOCK_SIZE, k - j);
+		std::vector<T> V((size_t)(m-j)*nb), Tm((size_t)nb*nb);
+		ExtractV(m-j, nb, a + (size_t)j*lda + j, lda, V.data());
+		FormT(m-j, nb, V.data(), tau + j, Tm.data());
+		ApplyBlockLeft(m-j, n, nb, V.data(), Tm.data(), transpose, C + (size_t)j*ldc, ldc);
+	}
+}
+
+/* Reduce the n x n row-major matrix a to upper Hessenberg form by the similarity transform
+	H = Q'*A*Q, BLOCK_SIZE columns at a time. The reflectors are not kept, and the elements
+	below the subdiagonal are set to zero.
+
+	Within a panel, column c of the partly transformed matrix is formed when it is needed, from
+	the matrix A0 at the start of the panel, the reflectors V and their compact WY factor Tm so
+	far, and Y = A0*V*Tm (as in LAPACK's DLAHR2):
+
+		b = (I - V*Tm'*V') * (A0(:, c) - Y*V(c, :)')
+
+	This needs the product of A0 with each new reflector (the only matrix-vector work), which
+	gives the next column of Y. At the end of the panel the rest of the matrix is updated with
+	one GEMM from the right, A = A0 - Y*V', and one block reflector from the left. */
+template <typename T>
+void ReduceToHessenberg(int n, T* a)
+{
+	int numReflectors = n - 2;
+	std::vector<T> b(n), v(n), s(BLOCK_SIZE), av(n);
+	for (int k=0; k<numReflectors; k+=BLOCK_SIZE)
+	{
+		int nb = std::min(BLOCK_SIZE, numReflectors - k);
+
+		// V is stored for rows k+1 to n-1, and the transformed panel columns are kept in P.
+		int m = n - k - 1;
+		std::vector<T> V((size_t)m*nb, static_cast<T>(0.0)), Tm((size_t)nb*nb, static_cast<T>(0.0));
+		std::vector<T> Y((size_t)n*nb, static_cast<T>(0.0)), P((size_t)n*nb);
+		for (int i=0; i<nb; ++i)
+		{
+			int c = k + i;
+
+			// b = A0(:, c) - Y*V(c, :)' (row c of V is only non-zero after the first column).
+			for (int r=0; r<n; ++r)
+				b[r] = a[(size_t)r*n + c];
+			if (i > 0)
+			{
+				const T* vc = V.data() + (size_t)(c-k-1)*nb;
+				for (int r=0; r<n; ++r)
+				{
+					const T* yRow = Y.data() + (size_t)r*nb;
+					for (int j=0; j<i; ++j)
+						b[r] -= yRow[j] * vc[j];
+				}
+			}
+
+			// b(k+1:n) = (I - V*Tm'*V') * b(k+1:n).
+			if (i > 0)
+			{
+				std::fill(s.begin(), s.begin() + i, static_cast<T>(0.0));
+				for (int r=0; r<m; ++r)
+				{
+					const T* vRow = V.data() + (size_t)r*nb;
+					for (int j=0; j<i; ++j)
+						s[j] += vRow[j] * b[k+1+r];
+				}
+				for (int j=i-1; j>=0; --j)
+				{
+					T sum = static_cast<T>(0.0);
+					for (int p=0; p<=j; ++p)
+						sum += Tm[(size_t)p*nb + j] * s[p];
+					s[j] = sum;
+				}
+				for (int r=0; r<m; ++r)
+				{
+					const T* vRow = V.data() + (size_t)r*nb;
+					T sum = static_cast<T>(0.0);
+					for (int j=0; j<i; ++j)
+						sum += vRow[j] * s[j];
+					b[k+1+r] -= sum;
+				}
+			}
+
+			// The reflector for b(c+1:n), which leaves the final column c.
+			int len = n - c - 1;
+			T tau = MakeReflector(len, b.data() + c + 1, 1, v.data());
+			for (int r=0; r<n; ++r)
+				P[(size_t)r*nb + i] = b[r];
+			for (int r=0; r<len; ++r)
+				V[(size_t)(c-k+r)*nb + i] = v[r];
+
+			// Column i of Tm is -tau*Tm*(V'*v), with tau on the diagonal.
+			for (int j=0; j<i; ++j)
+			{
+				T sum = static_cast<T>(0.0);
+				for (int r=0; r<len; ++r)
+					sum += V[(size_t)(c-k+r)*nb + j] * v[r];
+				s[j] = sum;
+			}
+			for (int j=0; j<i; ++j)
+			{
+				T sum = static_cast<T>(0.0);
+				for (int p=j; p<i; ++p)
+					sum += Tm[(size_t)j*nb + p] * s[p];
+				Tm[(size_t)j*nb + i] = -tau * sum;
+			}
+			Tm[(size_t)i*nb + i] = tau;
+
+			/* Column i of Y is tau*(A0*v - Y*(V'*v)), with A0*v from the columns that the panel hasn't
+				touched. This runs once per column, so a thread is only worth starting for at least 1 << 16
+				multiply-adds. */
+			qbParallelFor(n, std::max(1, (1 << 16) / std::max(len, 1)), [&](size_t first, size_t last)
+			{
+				for (size_t r=first; r<last; ++r)
+				{
+					const T* aRow = a + r*n + c + 1;
+					T sum = static_cast<T>(0.0);
+					for (int p=0; p<len; ++p)
+						sum += aRow[p] * v[p];
+					av[r] = sum;
+				}
+			});
+			for (int r=0; r<n; ++r)
+			{
+				T* yRow = Y.data() + (size_t)r*nb;
+				T sum = av[r];
+				for (int j=0; j<i; ++j)
+					sum -= yRow[j] * s[j];
+				yRow[i] = tau * sum;
+			}
+		}
+
+		// The panel columns are final (with zeros below the subdiagonal).
+		for (int r=0; r<n; ++r)
+		{
+			for (int i=0; i<nb; ++i)
+				a[(size_t)r*n + k + i] = P[(size_t)r*nb + i];
+		}
+
+		// From the right: A(:, k+nb:n) -= Y * V(k+nb:n, :)'.
+		int numTrailing = n - k - nb;
+		if (numTrailing == 0)
+			continue;
+		std::vector<T> Vt((size_t)nb*numTrailing);
+		for (int r=0; r<numTrailing; ++r)
+		{
+			for (int j=0; j<nb; ++j)
+				Vt[(size_t)j*numTrailing + r] = V[(size_t)(nb-1+r)*nb + j];
+		}
+		for (size_t i=0; i<Y.size(); ++i)
+			Y[i] = -Y[i];
+		ParallelGEMM(n, numTrailing, nb, Y.data(), nb, Vt.data(), numTrailing, a + k + nb, n, true);
+
+		// From the left: A(k+1:n, k+nb:n) = (I - V*Tm'*V') * A(k+1:n, k+nb:n).
+		ApplyBlockLeft(m, numTrailing, nb, V.data(), Tm.data(), true, a + (size_t)(k+1)*n + k + nb, n);
+	}
+}
+
+/* Form the first numCols columns of Q = H(0)*H(1)*...*H(k-1) in the m x numCols row-major
+	matrix q, from the k reflectors stored by QRFactor in a (k <= numCols <= m). The blocks are
+	applied in reverse order, so that each one only touches the trailing part of q. */
+template <typename T>
+void FormQ(int m, int numCols, int k, const T* a, int lda, const T* tau, T* q, int ldq)
+{
+	for (int i=0; i<m; ++i)
+	{
+		std::fill(q + (size_t)i*ldq, q + (size_t)i*ldq + numCols, static_cast<T>(0.0));
+		if (i < numCols)
+			q[(size_t)i*ldq + i] = static_cast<T>(1.0);
+	}
+
+	int lastBlock = (k > 0) ? ((k - 1) / BLOCK_SIZE) * BLOCK_SIZE : -1;
+	for (int j=lastBlock; j>=0; j-=BLOCK_SIZE)
+	{
+		int nb = std::min(BLOCK_SIZE, k - j);
+		std::vector<T> V((size_t)(m-j)*nb), Tm((size_t)nb*nb);
+		ExtractV(m-j, nb, a + (size_t)j*lda + j, lda, V.data());
+		FormT(m-j, nb, V.data(), tau + j, Tm.data());
+		ApplyBlockLeft(m-j, numCols-j, nb, V.data(), Tm.data(), false, q + (size_t)j*ldq + j, ldq);
+	}
+}
+
+}
+
+#endif
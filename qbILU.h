@@ -0,0 +1,537 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBILU_H
+#define QBILU_H
+
+/* *************************************************************************************************
+
+	qbILU
+
+	Class to compute incomplete factorizations of a sparse matrix, A ~ L*U, for use as
+	preconditioners with iterative solvers (qbCG, or a simple Richardson iteration). A complete
+	LU factorization of a sparse matrix fills in most of the band of the matrix; an incomplete
+	factorization keeps only some of the entries, so it is cheap to compute and to apply, while
+	inv(L*U)*A is still much better conditioned than A.
+
+	FactorILU0	ILU(0). L and U keep exactly the sparsity pattern of A (L is unit lower
+				triangular), and all fill-in is discarded.
+
+	FactorILUT	ILUT (Saad, Numerical Linear Algebra with Applications 1(4), 1994). Fill-in is
+				allowed, but in each row entries smaller than dropTolerance times the norm of the
+				row of A are dropped, and at most maxFill of the largest entries are kept in each
+				of L and U. A more accurate (and more expensive) factorization than ILU(0), for
+				harder and non-symmetric problems.
+
+	FactorIC0	Incomplete Cholesky IC(0), for symmetric positive definite A: A ~ L*L', with L
+				keeping the pattern of the lower triangle of A. The preconditioner is symmetric
+				positive definite, so it can be used with CG.
+
+	Applying the preconditioner, z = inv(U)*inv(L)*r, needs a forward and a backward substitution,
+	which are inherently sequential: each unknown depends on the ones before it. Two solve methods
+	are available:
+
+	QBILU_LEVELSCHEDULE	The unknowns are grouped into levels, where each level depends only on
+						earlier levels (the level of row i is one more than the highest level of
+						the rows it depends on). The rows within a level are independent, and are
+						solved in parallel. This gives the exact triangular solves, and scales
+						with the width of the levels: for a 5-point operator in natural ordering
+						there are about 2*n levels for an n x n grid.
+
+	QBILU_JACOBI		The triangular systems are solved approximately, with a fixed number of
+						Jacobi sweeps, x <- inv(D)*(r - N*x), where N is the strictly triangular
+						part (Chow and Patel, SIAM J. Sci. Comput. 37(2), 2015). Each sweep is a
+						parallel sparse matrix-vector product, so this scales fully with the number
+						of cores, at the cost of a slightly weaker preconditioner. A fixed number of
+						sweeps is a fixed linear operator, and for IC(0) the backward sweeps are the
+						transpose of the forward sweeps, so the preconditioner stays symmetric.
+
+	The factorization functions return an INT flag:
+
+						1 Indicates success.
+						-1 indicates a zero pivot (or a missing diagonal entry).
+						-2 indicates that the matrix is not positive definite (FactorIC0).
+						-3 indicates that the matrix is not square.
+
+	Note that the workspace is held by the object, so a single qbILU object should not be used
+	by more than one thread at a time.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "qbSparse.h"
+#include "qbParallel.h"
+
+// Define the solve methods.
+constexpr int QBILU_LEVELSCHEDULE = 1;
+constexpr int QBILU_JACOBI = 2;
+
+// Define error codes.
+constexpr int QBILU_ZEROPIVOT = -1;
+constexpr int QBILU_NOTPOSITIVEDEFINITE = -2;
+constexpr int QBILU_MATRIXNOTSQUARE = -3;
+
+template <class T>
+class qbILU {
+public:
+	// Define the various constructors.
+	qbILU();
+
+	// Configuration methods.
+	void SetSolveMethod(int solveMethod);
+	void SetNumJacobiSweeps(int numSweeps);
+
+	// Compute the factorization.
+	int FactorILU0(const qbSparseMatrix<T>& A);
+	int FactorILUT(const qbSparseMatrix<T>& A, T dropTolerance = static_cast<T>(1e-3), int maxFill = 10);
+	int FactorIC0(const qbSparseMatrix<T>& A);
+
+	// Apply the preconditioner: z = inv(U)*inv(L)*r.
+	void Precondition(const std::vector<T>& r, std::vector<T>& z);
+
+	// Information about the factorization.
+	qbSparseMatrix<T> GetL() const;
+	qbSparseMatrix<T> GetU() const;
+	int GetNumNonZeros() const;
+	int GetNumLevels() const;
+
+private:
+	/* A triangular factor: the strictly triangular part, the inverse of the diagonal, and
+		the rows grouped by level (level l is levelRows[levelPtr[l]] to levelRows[levelPtr[l+1]-1]). */
+	struct Triangle {
+		qbSparseMatrix<T> offDiagonal;
+		std::vector<T> invDiagonal;
+		std::vector<int> levelPtr;
+		std::vector<int> levelRows;
+	};
+
+	void SetFactors(int n, const std::vector<int>& lPtr, const std::vector<int>& lIndex, const std::vector<T>& lValues, const std::vector<T>& lDiagonal,
+		const std::vector<int>& uPtr, const std::vector<int>& uIndex, const std::vector<T>& uValues, const std::vector<T>& uDiagonal);
+	void ComputeLevels(Triangle& triangle, bool lower);
+	void SolveLevels(const Triangle& triangle, const std::vector<T>& r, std::vector<T>& x) const;
+	void SolveJacobi(const Triangle& triangle, const std::vector<T>& r, std::vector<T>& x, std::vector<T>& temp) const;
+	qbSparseMatrix<T> AddDiagonal(const Triangle& triangle) const;
+
+private:
+	Triangle m_lower, m_upper;
+	int m_solveMethod, m_numJacobiSweeps;
+	std::vector<T> m_work, m_temp;
+};
+
+/* **************************************************************************************************
+CONSTRUCTOR FUNCTIONS
+/* *************************************************************************************************/
+// The default constructor.
+template <class T>
+qbILU<T>::qbILU() {
+	m_solveMethod = QBILU_LEVELSCHEDULE;
+	m_numJacobiSweeps = 3;
+}
+
+/* **************************************************************************************************
+CONFIGURATION FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+void qbILU<T>::SetSolveMethod(int solveMethod) {
+	if((solveMethod != QBILU_LEVELSCHEDULE) and (solveMethod != QBILU_JACOBI))
+		throw std::invalid_argument("Unknown solve method.");
+	m_solveMethod = solveMethod;
+}
+
+template <class T>
+void qbILU<T>::SetNumJacobiSweeps(int numSweeps) {
+	m_numJacobiSweeps = std::max(0, numSweeps);
+}
+
+/* **************************************************************************************************
+FACTORIZATION FUNCTIONS
+/* *************************************************************************************************/
+// ILU(0): Gaussian elimination restricted to the pattern of A (the IKJ variant, by rows).
+template <class T>
+int qbILU<T>::FactorILU0(const qbSparseMatrix<T>& A) {
+	if(A.GetNumRows() != A.GetNumCols())
+		return QBILU_MATRIXNOTSQUARE;
+
+	int n = A.GetNumRows();
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	std::vector<T> values = A.GetValues();
+
+	// Find the diagonal entries.
+	std::vector<int> diagonalPos(n);
+	for(int i = 0; i < n; ++i) {
+		auto first = colIndex.begin() + rowPtr[i];
+		auto last = colIndex.begin() + rowPtr[i + 1];
+		auto position = std::lower_bound(first, last, i);
+		if((position == last) or (*position != i))
+			return QBILU_ZEROPIVOT;
+		diagonalPos[i] = position - colIndex.begin();
+	}
+
+	// Row i: eliminate with each earlier row k in the pattern, updating only entries in the pattern.
+	std::vector<int> position(n, -1);
+	for(int i = 0; i < n; ++i) {
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+			position[colIndex[k]] = k;
+
+		for(int ik = rowPtr[i]; ik < diagonalPos[i]; ++ik) {
+			int k = colIndex[ik];
+			values[ik] /= values[diagonalPos[k]];
+			T lik = values[ik];
+			for(int kj = diagonalPos[k] + 1; kj < rowPtr[k + 1]; ++kj) {
+				int ij = position[colIndex[kj]];
+				if(ij >= 0)
+					values[ij] -= lik * values[kj];
+			}
+		}
+
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+			position[colIndex[k]] = -1;
+		if(values[diagonalPos[i]] == static_cast<T>(0.0))
+			return QBILU_ZEROPIVOT;
+	}
+
+	// Split into the strictly lower part (unit diagonal), and the upper part.
+	std::vector<int> lPtr(n + 1, 0), uPtr(n + 1, 0), lIndex, uIndex;
+	std::vector<T> lValues, uValues, lDiagonal(n, static_cast<T>(1.0)), uDiagonal(n);
+	for(int i = 0; i < n; ++i) {
+		for(int k = rowPtr[i]; k < diagonalPos[i]; ++k) {
+			lIndex.push_back(colIndex[k]);
+			lValues.push_back(values[k]);
+		}
+		for(int k = diagonalPos[i] + 1; k < rowPtr[i + 1]; ++k) {
+			uIndex.push_back(colIndex[k]);
+			uValues.push_back(values[k]);
+		}
+		lPtr[i + 1] = lIndex.size();
+		uPtr[i + 1] = uIndex.size();
+		uDiagonal[i] = values[diagonalPos[i]];
+	}
+	SetFactors(n, lPtr, lIndex, lValues, lDiagonal, uPtr, uIndex, uValues, uDiagonal);
+	return 1;
+}
+
+/* ILUT: each row is eliminated in full (in a dense work row), with the multipliers applied in
+	increasing column order, then the small entries are dropped and the largest maxFill kept. */
+template <class T>
+int qbILU<T>::FactorILUT(const qbSparseMatrix<T>& A, T dropTolerance, int maxFill) {
+	if(A.GetNumRows() != A.GetNumCols())
+		return QBILU_MATRIXNOTSQUARE;
+
+	int n = A.GetNumRows();
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	const std::vector<T>& values = A.GetValues();
+
+	std::vector<int> lPtr(n + 1, 0), uPtr(n + 1, 0), lIndex, uIndex;
+	std::vector<T> lValues, uValues, lDiagonal(n, static_cast<T>(1.0)), uDiagonal(n);
+
+	std::vector<T> w(n, static_cast<T>(0.0));
+	std::vector<int> marker(n, -1);
+	std::vector<int> nonZeros;
+	std::vector<std::pair<T, int>> kept;
+	std::priority_queue<int, std::vector<int>, std::greater<int>> lowerColumns;
+	auto keepLargest = [&kept, maxFill](std::vector<int>& index, std::vector<T>& value) {
+		if(static_cast<int>(kept.size()) > maxFill) {
+			std::nth_element(kept.begin(), kept.begin() + maxFill, kept.end(),
+				[](const std::pair<T, int>& a, const std::pair<T, int>& b) { return fabs(a.first) > fabs(b.first); });
+			kept.resize(maxFill);
+		}
+		std::sort(kept.begin(), kept.end(), [](const std::pair<T, int>& a, const std::pair<T, int>& b) { return a.second < b.second; });
+		for(auto& entry : kept) {
+			index.push_back(entry.second);
+			value.push_back(entry.first);
+		}
+	};
+
+	for(int i = 0; i < n; ++i) {
+		// Load row i of A, and find the drop threshold for this row.
+		nonZeros.clear();
+		T rowNormSq = static_cast<T>(0.0);
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+			int j = colIndex[k];
+			w[j] = values[k];
+			marker[j] = i;
+			nonZeros.push_back(j);
+			if(j < i)
+				lowerColumns.push(j);
+			rowNormSq += values[k] * values[k];
+		}
+		T threshold = dropTolerance * sqrt(rowNormSq);
+
+		// Eliminate, in increasing column order (fill-in below the diagonal joins the queue).
+		while(!lowerColumns.empty()) {
+			int k = lowerColumns.top();
+			lowerColumns.pop();
+			w[k] /= uDiagonal[k];
+			if(fabs(w[k]) < threshold) {
+				w[k] = static_cast<T>(0.0);
+				continue;
+			}
+			for(int kj = uPtr[k]; kj < uPtr[k + 1]; ++kj) {
+				int j = uIndex[kj];
+				if(marker[j] != i) {
+					marker[j] = i;
+					w[j] = static_cast<T>(0.0);
+					nonZeros.push_back(j);
+					if(j < i)
+						lowerColumns.push(j);
+				}
+				w[j] -= w[k] * uValues[kj];
+			}
+		}
+
+		// Keep the largest entries of the lower and upper parts.
+		kept.clear();
+		for(int j : nonZeros) {
+			if((j < i) and (fabs(w[j]) >= threshold) and (w[j] != static_cast<T>(0.0)))
+				kept.push_back(std::make_pair(w[j], j));
+		}
+		keepLargest(lIndex, lValues);
+		kept.clear();
+		for(int j : nonZeros) {
+			if((j > i) and (fabs(w[j]) >= threshold) and (w[j] != static_cast<T>(0.0)))
+				kept.push_back(std::make_pair(w[j], j));
+		}
+		keepLargest(uIndex, uValues);
+		lPtr[i + 1] = lIndex.size();
+		uPtr[i + 1] = uIndex.size();
+
+		if((marker[i] != i) or (w[i] == static_cast<T>(0.0)))
+			return QBILU_ZEROPIVOT;
+		uDiagonal[i] = w[i];
+	}
+	SetFactors(n, lPtr, lIndex, lValues, lDiagonal, uPtr, uIndex, uValues, uDiagonal);
+	return 1;
+}
+
+/* IC(0), by rows: L(i,j) = (A(i,j) - sum_k L(i,k)*L(j,k)) / L(j,j) for j < i in the pattern,
+	and L(i,i) = sqrt(A(i,i) - sum_k L(i,k)^2). Only the lower triangle of A is used. */
+template <class T>
+int qbILU<T>::FactorIC0(const qbSparseMatrix<T>& A) {
+	if(A.GetNumRows() != A.GetNumCols())
+		return QBILU_MATRIXNOTSQUARE;
+
+	int n = A.GetNumRows();
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	const std::vector<T>& values = A.GetValues();
+
+	std::vector<int> lPtr(n + 1, 0), lIndex;
+	std::vector<T> lValues, diagonal(n);
+	std::vector<T> w(n, static_cast<T>(0.0));
+	std::vector<int> marker(n, -1);
+	for(int i = 0; i < n; ++i) {
+		bool hasDiagonal = false;
+		for(int k = rowPtr[i]; (k < rowPtr[i + 1]) and (colIndex[k] <= i); ++k) {
+			int j = colIndex[k];
+			T s = values[k];
+			// Row j of L is complete, and the entries of row i before column j are final.
+			for(int jk = lPtr[j]; (j < i) and (jk < lPtr[j + 1]); ++jk) {
+				if(marker[lIndex[jk]] == i)
+					s -= w[lIndex[jk]] * lValues[jk];
+			}
+			if(j < i) {
+				w[j] = s / diagonal[j];
+				marker[j] = i;
+				lIndex.push_back(j);
+				lValues.push_back(w[j]);
+			}
+			else {
+				for(int ik = lPtr[i]; ik < static_cast<int>(lIndex.size()); ++ik)
+					s -= lValues[ik] * lValues[ik];
+				if(s <= static_cast<T>(0.0))
+					return QBILU_NOTPOSITIVEDEFINITE;
+				diagonal[i] = sqrt(s);
+				hasDiagonal = true;
+			}
+		}
+		if(!hasDiagonal)
+			return QBILU_ZEROPIVOT;
+		lPtr[i + 1] = lIndex.size();
+	}
+
+	// U = L', stored by rows.
+	qbSparseMatrix<T> L;
+	L.SetCSR(n, n, lPtr, lIndex, lValues);
+	qbSparseMatrix<T> U = L.Transpose();
+	SetFactors(n, lPtr, lIndex, lValues, diagonal, U.GetRowPtr(), U.GetColIndex(), U.GetValues(), diagonal);
+	return 1;
+}
+
+// Store the factors, and compute the level schedules.
+template <class T>
+void qbILU<T>::SetFactors(int n, const std::vector<int>& lPtr, const std::vector<int>& lIndex, const std::vector<T>& lValues, const std::vector<T>& lDiagonal,
+	const std::vector<int>& uPtr, const std::vector<int>& uIndex, const std::vector<T>& uValues, const std::vector<T>& uDiagonal) {
+	m_lower.offDiagonal.SetCSR(n, n, lPtr, lIndex, lValues);
+	m_upper.offDiagonal.SetCSR(n, n, uPtr, uIndex, uValues);
+	m_lower.invDiagonal.resize(n);
+	m_upper.invDiagonal.resize(n);
+	for(int i = 0; i < n; ++i) {
+		m_lower.invDiagonal[i] = static_cast<T>(1.0) / lDiagonal[i];
+		m_upper.invDiagonal[i] = static_cast<T>(1.0) / uDiagonal[i];
+	}
+	ComputeLevels(m_lower, true);
+	ComputeLevels(m_upper, false);
+	m_work.assign(n, static_cast<T>(0.0));
+	m_temp.assign(n, static_cast<T>(0.0));
+}
+
+/* The level of each row is one more than the highest level of the rows it depends on (the
+	earlier rows for L, the later rows for U). The rows are then sorted by level. */
+template <class T>
+void qbILU<T>::ComputeLevels(Triangle& triangle, bool lower) {
+	int n = triangle.offDiagonal.GetNumRows();
+	const std::vector<int>& rowPtr = triangle.offDiagonal.GetRowPtr();
+	const std::vector<int>& colIndex = triangle.offDiagonal.GetColIndex();
+	std::vector<int> level(n, 0);
+	int numLevels = 0;
+	for(int step = 0; step < n; ++step) {
+		int i = lower ? step : n - 1 - step;
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+			level[i] = std::max(level[i], level[colIndex[k]] + 1);
+		numLevels = std::max(numLevels, level[i] + 1);
+	}
+
+	triangle.levelPtr.assign(numLevels + 1, 0);
+	for(int i = 0; i < n; ++i)
+		triangle.levelPtr[level[i] + 1]++;
+	std::partial_sum(triangle.levelPtr.begin(), triangle.levelPtr.end(), triangle.levelPtr.begin());
+	std::vector<int> next(triangle.levelPtr.begin(), triangle.levelPtr.end() - 1);
+	triangle.levelRows.resize(n);
+	for(int i = 0; i < n; ++i)
+		triangle.levelRows[next[level[i]]++] = i;
+}
+
+/* **************************************************************************************************
+SOLVE FUNCTIONS
+/* *************************************************************************************************/
+// Apply the preconditioner: z = inv(U)*inv(L)*r.
+template <class T>
+void qbILU<T>::Precondition(const std::vector<T>& r, std::vector<T>& z) {
+	if(r.size() != m_work.size())
+		throw std::invalid_argument("The vector length does not match the factorization.");
+
+	z.resize(r.size());
+	if(m_solveMethod == QBILU_LEVELSCHEDULE) {
+		SolveLevels(m_lower, r, m_work);
+		SolveLevels(m_upper, m_work, z);
+	}
+	else {
+		SolveJacobi(m_lower, r, m_work, m_temp);
+		SolveJacobi(m_upper, m_work, z, m_temp);
+	}
+}
+
+// Exact triangular solve, one level at a time, with the rows of each level in parallel.
+template <class T>
+void qbILU<T>::SolveLevels(const Triangle& triangle, const std::vector<T>& r, std::vector<T>& x) const {
+	const std::vector<int>& rowPtr = triangle.offDiagonal.GetRowPtr();
+	const std::vector<int>& colIndex = triangle.offDiagonal.GetColIndex();
+	const std::vector<T>& values = triangle.offDiagonal.GetValues();
+	const std::vector<T>& invDiagonal = triangle.invDiagonal;
+	int numLevels = triangle.levelPtr.size() - 1;
+	for(int l = 0; l < numLevels; ++l) {
+		const int* rows = triangle.levelRows.data() + triangle.levelPtr[l];
+		qbParallelFor(triangle.levelPtr[l + 1] - triangle.levelPtr[l], QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last) {
+			for(size_t m = first; m < last; ++m) {
+				int i = rows[m];
+				T sum = r[i];
+				for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+					sum -= values[k] * x[colIndex[k]];
+				x[i] = sum * invDiagonal[i];
+			}
+		});
+	}
+}
+
+// Approximate triangular solve with Jacobi sweeps, x <- inv(D)*(r - N*x), starting from inv(D)*r.
+template <class T>
+void qbILU<T>::SolveJacobi(const Triangle& triangle, const std::vector<T>& r, std::vector<T>& x, std::vector<T>& temp) const {
+	const std::vector<int>& rowPtr = triangle.offDiagonal.GetRowPtr();
+	const std::vector<int>& colIndex = triangle.offDiagonal.GetColIndex();
+	const std::vector<T>& values = triangle.offDiagonal.GetValues();
+	const std::vector<T>& invDiagonal = triangle.invDiagonal;
+	int n = r.size();
+	qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i)
+			x[i] = r[i] * invDiagonal[i];
+	});
+	for(int sweep = 0; sweep < m_numJacobiSweeps; ++sweep) {
+		qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i) {
+				T sum = r[i];
+				for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+					sum -= values[k] * x[colIndex[k]];
+				temp[i] = sum * invDiagonal[i];
+			}
+		});
+		std::swap(x, temp);
+	}
+}
+
+/* **************************************************************************************************
+INFORMATION FUNCTIONS
+/* *************************************************************************************************/
+// Return the lower factor, including its diagonal.
+template <class T>
+qbSparseMatrix<T> qbILU<T>::GetL() const {
+	return AddDiagonal(m_lower);
+}
+
+// Return the upper factor, including its diagonal.
+template <class T>
+qbSparseMatrix<T> qbILU<T>::GetU() const {
+	return AddDiagonal(m_upper);
+}
+
+// The number of stored entries in L and U (counting the diagonal once).
+template <class T>
+int qbILU<T>::GetNumNonZeros() const {
+	return m_lower.offDiagonal.GetNumNonZeros() + m_upper.offDiagonal.GetNumNonZeros() + m_work.size();
+}
+
+// The number of sequential steps in the level scheduled solves (the larger of L and U).
+template <class T>
+int qbILU<T>::GetNumLevels() const {
+	int numLevels = std::max(m_lower.levelPtr.size(), m_upper.levelPtr.size());
+	return std::max(0, numLevels - 1);
+}
+
+template <class T>
+qbSparseMatrix<T> qbILU<T>::AddDiagonal(const Triangle& triangle) const {
+	int n = triangle.offDiagonal.GetNumRows();
+	const std::vector<int>& rowPtr = triangle.offDiagonal.GetRowPtr();
+	const std::vector<int>& colIndex = triangle.offDiagonal.GetColIndex();
+	const std::vector<T>& values = triangle.offDiagonal.GetValues();
+	std::vector<int> rows, cols;
+	std::vector<T> entries;
+	for(int i = 0; i < n; ++i) {
+		for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+			rows.push_back(i);
+			cols.push_back(colIndex[k]);
+			entries.push_back(values[k]);
+		}
+		rows.push_back(i);
+		cols.push_back(i);
+		entries.push_back(static_cast<T>(1.0) / triangle.invDiagonal[i]);
+	}
+	return qbSparseMatrix<T>(n, n, rows, cols, entries);
+}
+
+#endif
@@ -26,6 +26,12 @@
 						1 Indicates success.
 						-1 indicates failure due to there being no computable inverse.
 
+	The solution of the normal equations, X'X*beta = X'y, is computed from the QR decomposition
+	X = QR as beta = inv(R)*Q'y, which avoids forming X'X (and squaring the condition number).
+	The QR decomposition uses TSQR (see qbTSQR.h), which suits the usual case of many more
+	observations than unknowns. The overload that takes a qbDecompCache reuses the factorization
+	for repeated fits with the same X.
+
 	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
 	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
 	YouTube channel at:
@@ -39,40 +45,92 @@
 #include <iomanip>
 #include <math.h>
 #include <vector>
+#include <limits>
+#include <algorithm>
 #include "qbVector.h"
 #include "qbMatrix.h"
+#include "qbTSQR.h"
 
 // Define error codes.
 constexpr int QBLSQ_NOINVERSE = -1;
 
-// The qbLSQ function.
+// Declared in qbDecompCache.h, which must be included to use the overload that takes a cache.
+template <class T>
+class qbDecompCache;
+
+namespace qbLSQKernels
+{
+
+// Function to compute beta = inv(R)*Q'y from the QR decomposition of X.
 template <typename T>
-int qbLSQ(const qbMatrix2<T> &Xin, const qbVector<T> &yin, qbVector<T> &result)
+int SolveFromQR(const qbTSQR<T> &qr, const qbVector<T> &yin, qbVector<T> &result)
 {
-	// Firstly, make a copy of X and y.
-	qbMatrix2<T> X = Xin;
-	qbVector<T> y = yin;
+	int numRows = yin.GetNumDims();
+	qbMatrix2<T> y(numRows, 1, yin.GetData()), Qty;
+	qr.ApplyQTranspose(y, Qty);
+	qbMatrix2<T> R = qr.GetR();
+	int numCols = R.GetNumCols();
 	
-	// Compute the tranpose of X.
-	qbMatrix2<T> XT = X.Transpose();
-	
-	// Compute XTX.
-	qbMatrix2<T> XTX = XT * X;
+	/* If R is (numerically) singular then so is X'X, and there is no unique solution. As in
+		LAPACK, a diagonal element is negligible if it is below max(m, n)*u*||R||, using the
+		Frobenius norm of all of R (the diagonal alone can be much smaller than ||X||). */
+	T normSquared = static_cast<T>(0.0);
+	for (int i=0; i<numCols; ++i)
+	{
+		for (int j=i; j<numCols; ++j)
+			normSquared += R.GetElement(i, j) * R.GetElement(i, j);
+	}
+	T tolerance = sqrt(normSquared) * static_cast<T>(std::max(numRows, numCols)) * std::numeric_limits<T>::epsilon();
+	for (int i=0; i<numCols; ++i)
+	{
+		if (fabs(R.GetElement(i, i)) <= tolerance)
+			return QBLSQ_NOINVERSE;
+	}
 	
-	// Compute the inverse of this.
-	if (!XTX.Inverse())
+	// Solve R*beta = Q'y by back substitution.
+	std::vector<T> beta(numCols);
+	for (int i=numCols-1; i>=0; --i)
 	{
-		// We were unable to compute the inverse.
-		return QBLSQ_NOINVERSE;
+		T sum = Qty.GetElement(i, 0);
+		for (int j=i+1; j<numCols; ++j)
+			sum -= R.GetElement(i, j) * beta[j];
+		beta[i] = sum / R.GetElement(i, i);
 	}
+	result = qbVector<T>(beta);
+	
+	return 1;
+}
+
+}
+
+// The qbLSQ function.
+template <typename T>
+int qbLSQ(const qbMatrix2<T> &Xin, const qbVector<T> &yin, qbVector<T> &result)
+{
+	if (yin.GetNumDims() != Xin.GetNumRows())
+		throw std::invalid_argument("The number of observations in X and y must match.");
 	
-	// Multiply the inverse by XT.
-	qbMatrix2<T> XTXXT = XTX * XT;
+	/* Compute the thin QR decomposition X = QR, with TSQR so that the blocks of rows are
+		factorized in parallel. Q is not formed: Q'y is computed with the stored reflectors. */
+	qbTSQR<T> qr;
+	if (qr.Factorize(Xin) != 1)
+		return QBLSQ_NOINVERSE;
 	
-	// And multiply by y to get the final result.
-	result = XTXXT * y;
+	return qbLSQKernels::SolveFromQR(qr, yin, result);
+}
+
+// The qbLSQ function, with the QR decomposition of X taken from (or added to) cache.
+template <typename T>
+int qbLSQ(const qbMatrix2<T> &Xin, const qbVector<T> &yin, qbVector<T> &result, qbDecompCache<T> &cache)
+{
+	if (yin.GetNumDims() != Xin.GetNumRows())
+		throw std::invalid_argument("The number of observations in X and y must match.");
 	
-	return 1;
+	auto qr = cache.GetQR(Xin);
+	if (!qr)
+		return QBLSQ_NOINVERSE;
+	
+	return qbLSQKernels::SolveFromQR(*qr, yin, result);
 }
 
 #endif
@@ -0,0 +1,428 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBLSQR_H
+#define QBLSQR_H
+
+/* *************************************************************************************************
+
+	qbLSQR / qbLSMR
+
+	Functions to solve the least squares problem
+
+		min ||A*x - b||^2 + damping^2 * ||x||^2
+
+	iteratively, using either the LSQR algorithm of Paige and Saunders (ACM TOMS 8(1), 1982) or
+	the LSMR algorithm of Fong and Saunders (SIAM J. Sci. Comput. 33(5), 2011). Both are based on
+	Golub-Kahan bidiagonalization and are mathematically equivalent to CG / MINRES on the normal
+	equations, but never form A'A (which would square the condition number, and for a large
+	sparse A would be far denser than A itself).
+
+	The matrix A is never accessed directly, only through callbacks that compute products with A
+	and its transpose, so A can be dense, sparse or implicit. Memory use is a handful of vectors of
+	length numRows and numCols.
+
+	LSQR reduces ||r|| monotonically, LSMR reduces ||A'r|| monotonically. LSMR is the safer
+	choice when the iteration may be stopped early, since ||A'r|| (the quantity that is zero at
+	the least squares solution) is then guaranteed to be small.
+
+	*** INPUTS ***
+
+	matVec			FUNCTION		Computes y = A*x, with x of length numCols and y of length numRows.
+	rmatVec			FUNCTION		Computes y = A'*x, with x of length numRows and y of length numCols.
+	precondition	FUNCTION		(Optional) Computes y = inv(M)*x, with x and y of length numCols.
+	rprecondition	FUNCTION		(Optional) Computes y = inv(M)'*x, with x and y of length numCols.
+	numRows			INT				The number of rows in A.
+	numCols			INT				The number of columns in A.
+	b				std::vector<T>	The right hand side, of length numRows.
+	x				std::vector<T>	The solution (output), of length numCols.
+	tolerance		T				Stopping tolerance (see below).
+	maxIterations	INT				The maximum number of iterations.
+	damping			T				The ridge (Tikhonov) damping parameter. Zero for ordinary
+									least squares.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates that the maximum number of iterations was exceeded.
+
+	With a preconditioner the problem is solved with right preconditioning: the iteration runs on
+	A*inv(M), and the solution is mapped back with x = inv(M)*y. A good M (a diagonal scaling of
+	the columns, an incomplete factorization, or the R factor of a sketch of A) makes A*inv(M)
+	well conditioned, and so cuts the number of iterations. Note that in this case the damping
+	applies to y rather than x.
+
+	Iteration stops when either
+
+		||r|| <= tolerance * (||A||*||x|| + ||b||)		(a compatible system), or
+		||A'r|| <= tolerance * ||A||*||r||				(a least squares solution),
+
+	where r = b - A*x (extended with damping*x when damping is non-zero), and the norms are the
+	estimates that the algorithms maintain as they run, so they cost nothing extra to compute.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <functional>
+
+// Define error codes.
+constexpr int QBLSQR_MAXITERATIONSEXCEEDED = -1;
+
+namespace qbLSQRKernels
+{
+
+// Compute the norm of a vector.
+template <typename T>
+T Norm(const std::vector<T> &v)
+{
+	T sumSq = static_cast<T>(0.0);
+	for (auto element : v)
+		sumSq += element * element;
+	return sqrt(sumSq);
+}
+
+// Scale a vector in place.
+template <typename T>
+void Scale(std::vector<T> &v, T factor)
+{
+	for (auto &element : v)
+		element *= factor;
+}
+
+// Compute a plane rotation [c s; -s c] such that [c s; -s c] * [a; b] = [r; 0].
+template <typename T>
+void SymOrtho(T a, T b, T &c, T &s, T &r)
+{
+	if (b == static_cast<T>(0.0))
+	{
+		c = (a < static_cast<T>(0.0)) ? static_cast<T>(-1.0) : static_cast<T>(1.0);
+		s = static_cast<T>(0.0);
+		r = fabs(a);
+	}
+	else if (a == static_cast<T>(0.0))
+	{
+		c = static_cast<T>(0.0);
+		s = (b < static_cast<T>(0.0)) ? static_cast<T>(-1.0) : static_cast<T>(1.0);
+		r = fabs(b);
+	}
+	else
+	{
+		r = sqrt(a * a + b * b);
+		c = a / r;
+		s = b / r;
+	}
+}
+
+// Solve a right-preconditioned problem with the given solver.
+template <typename T, typename Solver>
+int SolvePreconditioned(Solver solver,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmatVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &precondition,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rprecondition,
+	int numRows, int numCols, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance, int maxIterations, T damping)
+{
+	// The preconditioned operator, A*inv(M), and its transpose.
+	std::vector<T> temp(numCols);
+	auto pMatVec = [&](const std::vector<T> &in, std::vector<T> &out)
+	{
+		precondition(in, temp);
+		matVec(temp, out);
+	};
+	auto pRmatVec = [&](const std::vector<T> &in, std::vector<T> &out)
+	{
+		rmatVec(in, temp);
+		rprecondition(temp, out);
+	};
+
+	// Solve for y, then map back to x = inv(M)*y.
+	std::vector<T> y;
+	int status = solver(pMatVec, pRmatVec, numRows, numCols, b, y, tolerance, maxIterations, damping);
+	x.resize(numCols);
+	precondition(y, x);
+	return status;
+}
+
+}
+
+// The qbLSQR function.
+template <typename T>
+int qbLSQR(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmatVec,
+	int numRows, int numCols, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, T damping = static_cast<T>(0.0))
+{
+	x.assign(numCols, static_cast<T>(0.0));
+
+	// Initialize the bidiagonalization: beta*u = b, alpha*v = A'*u.
+	std::vector<T> u = b;
+	std::vector<T> v(numCols);
+	std::vector<T> Av(numRows);
+	std::vector<T> Atu(numCols);
+	T beta = qbLSQRKernels::Norm(u);
+	T bNorm = beta;
+	if (beta == static_cast<T>(0.0))
+		return 1;
+	qbLSQRKernels::Scale(u, static_cast<T>(1.0) / beta);
+
+	rmatVec(u, v);
+	T alpha = qbLSQRKernels::Norm(v);
+	if (alpha == static_cast<T>(0.0))
+		return 1;
+	qbLSQRKernels::Scale(v, static_cast<T>(1.0) / alpha);
+
+	std::vector<T> w = v;
+	T phiBar = beta;
+	T rhoBar = alpha;
+	T aNormSq = static_cast<T>(0.0);
+	T dampResidualSq = static_cast<T>(0.0);
+	T dampSq = damping * damping;
+
+	for (int iteration=0; iteration<maxIterations; ++iteration)
+	{
+		// Continue the bidiagonalization: beta*u = A*v - alpha*u.
+		matVec(v, Av);
+		for (int i=0; i<numRows; ++i)
+			u[i] = Av[i] - alpha * u[i];
+		beta = qbLSQRKernels::Norm(u);
+		if (beta > static_cast<T>(0.0))
+			qbLSQRKernels::Scale(u, static_cast<T>(1.0) / beta);
+
+		aNormSq += alpha * alpha + beta * beta + dampSq;
+
+		// alpha*v = A'*u - beta*v.
+		rmatVec(u, Atu);
+		for (int j=0; j<numCols; ++j)
+			v[j] = Atu[j] - beta * v[j];
+		alpha = qbLSQRKernels::Norm(v);
+		if (alpha > static_cast<T>(0.0))
+			qbLSQRKernels::Scale(v, static_cast<T>(1.0) / alpha);
+
+		// Apply a plane rotation to eliminate the damping parameter.
+		T rhoBar1 = rhoBar;
+		T psi = static_cast<T>(0.0);
+		if (damping != static_cast<T>(0.0))
+		{
+			rhoBar1 = sqrt(rhoBar * rhoBar + dampSq);
+			T c1 = rhoBar / rhoBar1;
+			T s1 = damping / rhoBar1;
+			psi = s1 * phiBar;
+			phiBar = c1 * phiBar;
+		}
+
+		// Apply the next plane rotation to eliminate beta.
+		T rho = sqrt(rhoBar1 * rhoBar1 + beta * beta);
+		T c = rhoBar1 / rho;
+		T s = beta / rho;
+		T theta = s * alpha;
+		rhoBar = -c * alpha;
+		T phi = c * phiBar;
+		phiBar = s * phiBar;
+
+		// Update x and w.
+		T xFactor = phi / rho;
+		T wFactor = theta / rho;
+		T xNormSq = static_cast<T>(0.0);
+		for (int j=0; j<numCols; ++j)
+		{
+			x[j] += xFactor * w[j];
+			w[j] = v[j] - wFactor * w[j];
+			xNormSq += x[j] * x[j];
+		}
+
+		// Estimates of ||r||, ||A'r|| and ||A|| for the stopping tests.
+		dampResidualSq += psi * psi;
+		T rNorm = sqrt(phiBar * phiBar + dampResidualSq);
+		T arNorm = fabs(phiBar * c) * alpha;
+		T aNorm = sqrt(aNormSq);
+
+		if (rNorm <= tolerance * (aNorm * sqrt(xNormSq) + bNorm))
+			return 1;
+		if (arNorm <= tolerance * aNorm * rNorm)
+			return 1;
+	}
+
+	return QBLSQR_MAXITERATIONSEXCEEDED;
+}
+
+// The qbLSQR function, with right preconditioning.
+template <typename T>
+int qbLSQR(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmatVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &precondition,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rprecondition,
+	int numRows, int numCols, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, T damping = static_cast<T>(0.0))
+{
+	return qbLSQRKernels::SolvePreconditioned<T>(
+		[](const std::function<void(const std::vector<T>&, std::vector<T>&)> &mv,
+			const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmv,
+			int m, int n, const std::vector<T> &bb, std::vector<T> &xx, T tol, int maxIt, T damp)
+		{
+			return qbLSQR<T>(mv, rmv, m, n, bb, xx, tol, maxIt, damp);
+		},
+		matVec, rmatVec, precondition, rprecondition, numRows, numCols, b, x, tolerance, maxIterations, damping);
+}
+
+// The qbLSMR function.
+template <typename T>
+int qbLSMR(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmatVec,
+	int numRows, int numCols, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, T damping = static_cast<T>(0.0))
+{
+	x.assign(numCols, static_cast<T>(0.0));
+
+	// Initialize the bidiagonalization: beta*u = b, alpha*v = A'*u.
+	std::vector<T> u = b;
+	std::vector<T> v(numCols);
+	std::vector<T> Av(numRows);
+	std::vector<T> Atu(numCols);
+	T beta = qbLSQRKernels::Norm(u);
+	T bNorm = beta;
+	if (beta == static_cast<T>(0.0))
+		return 1;
+	qbLSQRKernels::Scale(u, static_cast<T>(1.0) / beta);
+
+	rmatVec(u, v);
+	T alpha = qbLSQRKernels::Norm(v);
+	if (alpha == static_cast<T>(0.0))
+		return 1;
+	qbLSQRKernels::Scale(v, static_cast<T>(1.0) / alpha);
+
+	// Variables for the two sets of rotations that give x.
+	T zetaBar = alpha * beta;
+	T alphaBar = alpha;
+	T rho = static_cast<T>(1.0);
+	T rhoBar = static_cast<T>(1.0);
+	T cBar = static_cast<T>(1.0);
+	T sBar = static_cast<T>(0.0);
+	T zeta = static_cast<T>(0.0);
+	std::vector<T> h = v;
+	std::vector<T> hBar(numCols, static_cast<T>(0.0));
+
+	// Variables for the estimate of ||r||.
+	T betaDD = beta;
+	T betaD = static_cast<T>(0.0);
+	T rhoDOld = static_cast<T>(1.0);
+	T tauTildeOld = static_cast<T>(0.0);
+	T thetaTilde = static_cast<T>(0.0);
+	T dSum = static_cast<T>(0.0);
+
+	T aNormSq = alpha * alpha;
+
+	for (int iteration=0; iteration<maxIterations; ++iteration)
+	{
+		// Continue the bidiagonalization: beta*u = A*v - alpha*u, alpha*v = A'*u - beta*v.
+		matVec(v, Av);
+		for (int i=0; i<numRows; ++i)
+			u[i] = Av[i] - alpha * u[i];
+		beta = qbLSQRKernels::Norm(u);
+		if (beta > static_cast<T>(0.0))
+			qbLSQRKernels::Scale(u, static_cast<T>(1.0) / beta);
+
+		rmatVec(u, Atu);
+		for (int j=0; j<numCols; ++j)
+			v[j] = Atu[j] - beta * v[j];
+		alpha = qbLSQRKernels::Norm(v);
+		if (alpha > static_cast<T>(0.0))
+			qbLSQRKernels::Scale(v, static_cast<T>(1.0) / alpha);
+
+		// Rotation to eliminate the damping parameter.
+		T cHat, sHat, alphaHat;
+		qbLSQRKernels::SymOrtho(alphaBar, damping, cHat, sHat, alphaHat);
+
+		// Rotation P(k) to eliminate beta.
+		T rhoOld = rho;
+		T c, s;
+		qbLSQRKernels::SymOrtho(alphaHat, beta, c, s, rho);
+		T thetaNew = s * alpha;
+		alphaBar = c * alpha;
+
+		// Rotation Pbar(k) to eliminate thetaNew.
+		T rhoBarOld = rhoBar;
+		T zetaOld = zeta;
+		T thetaBar = sBar * rho;
+		qbLSQRKernels::SymOrtho(cBar * rho, thetaNew, cBar, sBar, rhoBar);
+		zeta = cBar * zetaBar;
+		zetaBar = -sBar * zetaBar;
+
+		// Update hBar, x and h.
+		T hBarFactor = thetaBar * rho / (rhoOld * rhoBarOld);
+		T xFactor = zeta / (rho * rhoBar);
+		T hFactor = thetaNew / rho;
+		T xNormSq = static_cast<T>(0.0);
+		for (int j=0; j<numCols; ++j)
+		{
+			hBar[j] = h[j] - hBarFactor * hBar[j];
+			x[j] += xFactor * hBar[j];
+			h[j] = v[j] - hFactor * h[j];
+			xNormSq += x[j] * x[j];
+		}
+
+		// Estimate ||r||.
+		T betaAcute = cHat * betaDD;
+		T betaCheck = -sHat * betaDD;
+		T betaHat = c * betaAcute;
+		betaDD = -s * betaAcute;
+
+		T thetaTildeOld = thetaTilde;
+		T cTildeOld, sTildeOld, rhoTildeOld;
+		qbLSQRKernels::SymOrtho(rhoDOld, thetaBar, cTildeOld, sTildeOld, rhoTildeOld);
+		thetaTilde = sTildeOld * rhoBar;
+		rhoDOld = cTildeOld * rhoBar;
+		betaD = -sTildeOld * betaD + cTildeOld * betaHat;
+
+		tauTildeOld = (zetaOld - thetaTildeOld * tauTildeOld) / rhoTildeOld;
+		T tauD = (zeta - thetaTilde * tauTildeOld) / rhoDOld;
+		dSum += betaCheck * betaCheck;
+		T rNorm = sqrt(dSum + (betaD - tauD) * (betaD - tauD) + betaDD * betaDD);
+
+		// Estimate ||A|| and ||A'r||.
+		aNormSq += beta * beta;
+		T aNorm = sqrt(aNormSq);
+		aNormSq += alpha * alpha;
+		T arNorm = fabs(zetaBar);
+
+		if (rNorm <= tolerance * (aNorm * sqrt(xNormSq) + bNorm))
+			return 1;
+		if (arNorm <= tolerance * aNorm * rNorm)
+			return 1;
+	}
+
+	return QBLSQR_MAXITERATIONSEXCEEDED;
+}
+
+// The qbLSMR function, with right preconditioning.
+template <typename T>
+int qbLSMR(const std::function<void(const std::vector<T>&, std::vector<T>&)> &matVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmatVec,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &precondition,
+	const std::function<void(const std::vector<T>&, std::vector<T>&)> &rprecondition,
+	int numRows, int numCols, const std::vector<T> &b, std::vector<T> &x,
+	T tolerance = static_cast<T>(1e-10), int maxIterations = 1000, T damping = static_cast<T>(0.0))
+{
+	return qbLSQRKernels::SolvePreconditioned<T>(
+		[](const std::function<void(const std::vector<T>&, std::vector<T>&)> &mv,
+			const std::function<void(const std::vector<T>&, std::vector<T>&)> &rmv,
+			int m, int n, const std::vector<T> &bb, std::vector<T> &xx, T tol, int maxIt, T damp)
+		{
+			return qbLSMR<T>(mv, rmv, m, n, bb, xx, tol, maxIt, damp);
+		},
+		matVec, rmatVec, precondition, rprecondition, numRows, numCols, b, x, tolerance, maxIterations, damping);
+}
+
+#endif
@@ -0,0 +1,279 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBLU_H
+#define QBLU_H
+
+/* *************************************************************************************************
+
+	qbLU / qbCholesky
+
+	Classes to factorize a square matrix once, and then solve with the factors as often as
+	required, at O(n^2) per solve instead of O(n^3).
+
+	qbLU			LU factorization with partial pivoting, P*A = L*U, for general square matrices.
+	qbCholesky		Cholesky factorization, A = R'*R, for symmetric positive definite matrices.
+
+	Factorize returns an INT flag:
+
+						1 Indicates success.
+						-1 indicates failure due to the matrix not being square.
+						-2 indicates that the matrix is (numerically) singular.
+						-3 indicates that the matrix is not symmetric positive definite.
+
+	Solve returns false if the factorization failed. The triangular solve kernels are shared
+	with qbLinSolve.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "qbMatrix.h"
+#include "qbQR.h"
+#include "qbParallel.h"
+
+// Define error codes.
+constexpr int QBLU_MATRIXNOTSQUARE = -1;
+constexpr int QBLU_SINGULAR = -2;
+constexpr int QBLU_NOTPOSITIVEDEFINITE = -3;
+
+namespace qbLUKernels
+{
+
+// Pivots smaller than this are treated as zero, as in the elimination (see qbMatrix2::CloseEnough).
+constexpr double MIN_PIVOT = 1e-9;
+
+/* Solve a*x = b for the n x n row-major triangular matrix a, by back substitution (upper) or
+	forward substitution (lower), taking the diagonal as one if unitDiagonal is set. b and x
+	may be the same array. Returns false, leaving the caller to classify the system, if a
+	diagonal element is (close to) zero. */
+template <typename T>
+bool SolveTriangular(int n, const T* a, const T* b, T* x, bool upper, bool unitDiagonal = false)
+{
+	if (!unitDiagonal)
+	{
+		for (int i=0; i<n; ++i)
+		{
+			if (fabs(a[(size_t)i*n + i]) < MIN_PIVOT)
+				return false;
+		}
+	}
+
+	for (int k=0; k<n; ++k)
+	{
+		int i = upper ? (n-1-k) : k;
+		const T* aRow = a + (size_t)i*n;
+		T sum = b[i];
+		int jStart = upper ? i+1 : 0;
+		int jEnd = upper ? n : i;
+		for (int j=jStart; j<jEnd; ++j)
+			sum -= aRow[j] * x[j];
+		x[i] = unitDiagonal ? sum : (sum / aRow[i]);
+	}
+	return true;
+}
+
+// Solve a*x = b for the n x n row-major diagonal matrix a (returns false if it is singular).
+template <typename T>
+bool SolveDiagonal(int n, const T* a, const T* b, T* x)
+{
+	for (int i=0; i<n; ++i)
+	{
+		T pivot = a[(size_t)i*n + i];
+		if (fabs(pivot) < MIN_PIVOT)
+			return false;
+		x[i] = b[i] / pivot;
+	}
+	return true;
+}
+
+/* LU factorization with partial pivoting, P*A = L*U, of the n x n row-major matrix a in place
+	(L has a unit diagonal, and is stored below it). Row k was swapped with row pivots[k] at step
+	k. Returns false if a pivot is smaller than MIN_PIVOT. */
+template <typename T>
+bool LUFactor(int n, T* a, int* pivots)
+{
+	for (int k=0; k<n; ++k)
+	{
+		int p = k;
+		for (int i=k+1; i<n; ++i)
+		{
+			if (fabs(a[(size_t)i*n + k]) > fabs(a[(size_t)p*n + k]))
+				p = i;
+		}
+		pivots[k] = p;
+		if (fabs(a[(size_t)p*n + k]) < MIN_PIVOT)
+			return false;
+		if (p != k)
+			std::swap_ranges(a + (size_t)k*n, a + (size_t)(k+1)*n, a + (size_t)p*n);
+
+		// Update the rows below in parallel, with enough work per thread to be worth starting one.
+		const T* pivotRow = a + (size_t)k*n;
+		int numBelow = n - k - 1;
+		qbParallelFor(numBelow, std::max(1, 65536 / std::max(numBelow, 1)), [=](size_t first, size_t last)
+		{
+			for (size_t r=first; r<last; ++r)
+			{
+				T* row = a + (size_t)(k+1+r)*n;
+				T l = row[k] / pivotRow[k];
+				row[k] = l;
+				for (int j=k+1; j<n; ++j)
+					row[j] -= l * pivotRow[j];
+			}
+		});
+	}
+	return true;
+}
+
+}
+
+/* **************************************************************************************************
+LU FACTORIZATION
+/* *************************************************************************************************/
+template <class T>
+class qbLU {
+public:
+	qbLU();
+
+	int Factorize(const qbMatrix2<T>& A);
+
+	// Solve A*x = b for the n-element b, returning false if A is singular.
+	bool Solve(const T* b, T* x) const;
+
+	// Information about the factorization.
+	int GetSize() const;
+	bool IsSingular() const;
+	size_t GetStorageSize() const;
+
+private:
+	int m_n;
+	bool m_singular;
+	std::vector<T> m_lu;
+	std::vector<int> m_pivots;
+};
+
+template <class T>
+qbLU<T>::qbLU() {
+	m_n = 0;
+	m_singular = true;
+}
+
+template <class T>
+int qbLU<T>::Factorize(const qbMatrix2<T>& A) {
+	if(A.GetNumRows() != A.GetNumCols())
+		return QBLU_MATRIXNOTSQUARE;
+
+	m_n = A.GetNumRows();
+	m_lu.assign(A.GetData(), A.GetData() + (size_t)m_n * m_n);
+	m_pivots.assign(m_n, 0);
+	m_singular = !qbLUKernels::LUFactor(m_n, m_lu.data(), m_pivots.data());
+	return m_singular ? QBLU_SINGULAR : 1;
+}
+
+template <class T>
+bool qbLU<T>::Solve(const T* b, T* x) const {
+	if(m_singular)
+		return false;
+
+	// Apply the row swaps to b, then solve L*y = P*b and U*x = y in place.
+	std::copy(b, b + m_n, x);
+	for(int k = 0; k < m_n; ++k)
+		std::swap(x[k], x[m_pivots[k]]);
+	qbLUKernels::SolveTriangular(m_n, m_lu.data(), x, x, false, true);
+	return qbLUKernels::SolveTriangular(m_n, m_lu.data(), x, x, true);
+}
+
+template <class T>
+int qbLU<T>::GetSize() const {
+	return m_n;
+}
+
+template <class T>
+bool qbLU<T>::IsSingular() const {
+	return m_singular;
+}
+
+template <class T>
+size_t qbLU<T>::GetStorageSize() const {
+	return m_lu.size() * sizeof(T) + m_pivots.size() * sizeof(int);
+}
+
+/* **************************************************************************************************
+CHOLESKY FACTORIZATION
+/* *************************************************************************************************/
+template <class T>
+class qbCholesky {
+public:
+	qbCholesky();
+
+	int Factorize(const qbMatrix2<T>& A);
+
+	// Solve A*x = b for the n-element b, returning false if A is not positive definite.
+	bool Solve(const T* b, T* x) const;
+
+	// Information about the factorization.
+	int GetSize() const;
+	bool IsPositiveDefinite() const;
+	size_t GetStorageSize() const;
+
+private:
+	int m_n;
+	bool m_positiveDefinite;
+	std::vector<T> m_r;
+};
+
+template <class T>
+qbCholesky<T>::qbCholesky() {
+	m_n = 0;
+	m_positiveDefinite = false;
+}
+
+template <class T>
+int qbCholesky<T>::Factorize(const qbMatrix2<T>& A) {
+	if(A.GetNumRows() != A.GetNumCols())
+		return QBLU_MATRIXNOTSQUARE;
+
+	// Only the upper triangle is used, so check the symmetry first (which A may already know).
+	m_n = A.GetNumRows();
+	m_r.assign((size_t)m_n * m_n, static_cast<T>(0.0));
+	m_positiveDefinite = A.IsSymmetric() && qbQRKernels::Cholesky(m_n, A.GetData(), m_r.data());
+	return m_positiveDefinite ? 1 : QBLU_NOTPOSITIVEDEFINITE;
+}
+
+template <class T>
+bool qbCholesky<T>::Solve(const T* b, T* x) const {
+	if(!m_positiveDefinite)
+		return false;
+
+	// R'*y = b is y*R = b for the row vector y, then R*x = y.
+	std::copy(b, b + m_n, x);
+	qbQRKernels::SolveUpperRight(1, m_n, m_r.data(), x);
+	return qbLUKernels::SolveTriangular(m_n, m_r.data(), x, x, true);
+}
+
+template <class T>
+int qbCholesky<T>::GetSize() const {
+	return m_n;
+}
+
+template <class T>
+bool qbCholesky<T>::IsPositiveDefinite() const {
+	return m_positiveDefinite;
+}
+
+template <class T>
+size_t qbCholesky<T>::GetStorageSize() const {
+	return m_r.size() * sizeof(T);
+}
+
+#endif
@@ -3,7 +3,7 @@
 // MIT license
 
 #ifndef QBLINSOLVE_H
-#define QBLINESOLVE_H
+#define QBLINSOLVE_H
 
 /* *************************************************************************************************
 
@@ -26,7 +26,13 @@
 						-1 indicates failure due to there being no unique solution (infinite solutions).
 						-2 indicates failure due to there being no solution.
 								
-	Uses Gaussian elimination on the augmented matrix, followed by back substitution.
+	Uses Gaussian elimination with partial pivoting on the augmented matrix (a single pass, which
+	also gives the ranks of both matrices), followed by back substitution. Square systems with
+	a structure that the matrix already knows about, or that is cheap to detect, are solved
+	directly instead: triangular (and diagonal) matrices by substitution, and matrices known to
+	be positive definite (see qbMatrix2::IsPositiveDefinite) by Cholesky factorization. The
+	overload that takes a qbDecompCache reuses the factorization for repeated solves with the
+	same matrix.
 
 	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
 	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
@@ -44,11 +50,16 @@
 
 #include "qbMatrix.h"
 #include "qbVector.h"
+#include "qbLU.h"
 
 // Define error codes.
 constexpr int QBLINSOLVE_NOUNIQUESOLUTION = -1;
 constexpr int QBLINSOLVE_NOSOLUTIONS = -2;
 
+// Declared in qbDecompCache.h, which must be included to use the overload that takes a cache.
+template <class T>
+class qbDecompCache;
+
 // The qbLinSolve function.
 template <typename T>
 int qbLinSolve(const qbMatrix2<T> &aMatrix, const qbVector<T> &bVector, qbVector<T> &resultVec)
@@ -57,9 +68,32 @@ int qbLinSolve(const qbMatrix2<T> &aMatrix, const qbVector<T> &bVector, qbVector
 	// We will use this to create the augmented matrix, so we have
 	// to make a copy.
 	qbMatrix2<T> inputMatrix = aMatrix;
-	
-	// Compute the rank of the original matrix.
-	int originalRank = inputMatrix.Rank();
+	int numCols = aMatrix.GetNumCols();
+
+	/* Solve a square system directly if the matrix has a suitable structure. Testing for a
+		triangular matrix is free if the result is already known, and otherwise usually stops at
+		the first element, while positive definiteness is only used when it is already known. */
+	int n = aMatrix.GetNumRows();
+	if ((n == numCols) && (n > 0) && (bVector.GetNumDims() == n))
+	{
+		std::vector<T> x(n);
+		bool solved = false;
+		if (aMatrix.IsDiagonal())
+			solved = qbLUKernels::SolveDiagonal(n, aMatrix.GetData(), bVector.GetData(), x.data());
+		else if (aMatrix.IsUpperTriangular() || aMatrix.IsLowerTriangular())
+			solved = qbLUKernels::SolveTriangular(n, aMatrix.GetData(), bVector.GetData(), x.data(), aMatrix.IsUpperTriangular());
+		else if (aMatrix.GetKnownProperties() & QBMATRIX_POSITIVEDEFINITE)
+		{
+			qbCholesky<T> cholesky;
+			solved = (cholesky.Factorize(aMatrix) == 1) && cholesky.Solve(bVector.GetData(), x.data());
+		}
+
+		if (solved)
+		{
+			resultVec = qbVector<T>(x);
+			return 1;
+		}
+	}
 
 	/* Combine inputMatrix and bVector together into a single matrix,
 		ready for using Gaussian elimination to reduce to 
@@ -77,14 +111,27 @@ int qbLinSolve(const qbMatrix2<T> &aMatrix, const qbVector<T> &bVector, qbVector
 	// Combine the two matrices together.
 	inputMatrix.Join(bMatrix);
 	
-	/* Use Gaussian elmination to convert to row-echelon form. */
-	qbMatrix2<T> rowEchelonMatrix = inputMatrix.RowEchelon();
+	/* Use Gaussian elmination (with partial pivoting) to convert to row-echelon form.
+		The number of pivots is the rank of the augmented matrix. */
+	qbMatrix2<T> rowEchelonMatrix;
+	std::vector<int> rowOrder;
+	int augmentedRank = inputMatrix.RowEchelon(rowEchelonMatrix, rowOrder);
 	
-	/* Comute the rank of the augmented matrix.
-		Note that we do this after performing Gaussian elimination to
-		reduce the matrix to row echelon form so that if this was 
-		successful, there is no need to repeat this operation twice. */
-	int augmentedRank = rowEchelonMatrix.Rank();
+	/* The elimination of the original matrix does not depend on the last column, so its
+		rank comes from the same pass: it is one less if the last pivot is in the last column
+		(the elements to the left of a pivot are exactly zero). */
+	int originalRank = augmentedRank;
+	if (augmentedRank > 0)
+	{
+		bool lastPivotInLastColumn = true;
+		for (int j=0; j<numCols; ++j)
+		{
+			if (rowEchelonMatrix.GetElement(augmentedRank-1, j) != static_cast<T>(0.0))
+				lastPivotInLastColumn = false;
+		}
+		if (lastPivotInLastColumn)
+			originalRank--;
+	}
 	
 	/* ********************************************************************* 
 		Test the two ranks to determine the nature of the system we
@@ -145,4 +192,32 @@ int qbLinSolve(const qbMatrix2<T> &aMatrix, const qbVector<T> &bVector, qbVector
 	return 1;	
 }
 
+/* The qbLinSolve function, with the factorization of a square matrix taken from (or added to)
+	cache, so that solving again with the same matrix only costs the triangular solves. Matrices
+	known to be positive definite use the Cholesky factorization, and the others LU. Triangular
+	matrices, and systems without a unique solution, are left to the function above. */
+template <typename T>
+int qbLinSolve(const qbMatrix2<T> &aMatrix, const qbVector<T> &bVector, qbVector<T> &resultVec, qbDecompCache<T> &cache)
+{
+	int n = aMatrix.GetNumRows();
+	bool isTriangular = aMatrix.IsUpperTriangular() || aMatrix.IsLowerTriangular();
+	if ((n == aMatrix.GetNumCols()) && (n > 0) && (bVector.GetNumDims() == n) && !isTriangular)
+	{
+		std::vector<T> x(n);
+		bool solved;
+		if (aMatrix.GetKnownProperties() & QBMATRIX_POSITIVEDEFINITE)
+			solved = cache.GetCholesky(aMatrix)->Solve(bVector.GetData(), x.data());
+		else
+			solved = cache.GetLU(aMatrix)->Solve(bVector.GetData(), x.data());
+
+		if (solved)
+		{
+			resultVec = qbVector<T>(x);
+			return 1;
+		}
+	}
+
+	return qbLinSolve(aMatrix, bVector, resultVec);
+}
+
 #endif
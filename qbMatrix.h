@@ -11,6 +11,29 @@
 
 	Class to provide capability to handle two-dimensional matrices.
 
+	The elements are stored in a reference-counted buffer that is shared between copies, so
+	copying a matrix (or assigning one to another) is O(1) and the elements are only copied when
+	one of the matrices that share them is first modified (copy-on-write). A pointer returned by
+	the non-const GetData() is valid for writing until the matrix is next copied or resized.
+
+	The const member functions (the queries such as IsSymmetric(), Rank() and Determinant(), as
+	well as Transpose(), RowEchelon() and copying) only read the matrix, so any number of threads
+	may use them on the same matrix at once without synchronization, provided that no thread
+	modifies it in the meantime. Note that the non-const GetData() and operator[] count as
+	modifications, since they may copy the shared elements, so readers should access a shared
+	matrix through a const reference.
+
+	Structural properties (symmetric, triangular, upper Hessenberg and positive definite, see the
+	QBMATRIX_ flags below) are cached: once a property has been tested, or set by the operation
+	that produced the matrix, testing it again is free, and it is forgotten when the matrix is
+	modified. Since the cache cannot see writes through a pointer, the pointer returned by the
+	non-const GetData() should not be kept for writing across a query of the matrix.
+
+	The properties decide which elements a solver may ignore, so the triangular, diagonal and
+	Hessenberg tests look for exact zeros, and the symmetry test allows differences of up to
+	1e-9 times the largest element. IsRowEchelon() is the tolerant version of the upper
+	triangular test (to within CloseEnough), for use as a convergence test.
+
 	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
 	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
 	YouTube channel at:
@@ -25,8 +48,115 @@
 #include <math.h>
 #include <vector>
 #include <exception>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <limits>
 #include "qbVector.h"
 
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+namespace qbMatrixKernels
+{
+
+/* Transpose a 4x4 tile from src (leading dimension srcLd) into dst (leading
+	dimension dstLd). The generic version works element by element, while the
+	float and double overloads below do the transpose in SIMD registers where
+	the instruction set is available. */
+template <class T>
+inline void TransposeTile4(const T* src, int srcLd, T* dst, int dstLd) {
+	for(int i = 0; i < 4; ++i) {
+		for(int j = 0; j < 4; ++j)
+			dst[j * dstLd + i] = src[i * srcLd + j];
+	}
+}
+
+#if defined(__SSE__)
+inline void TransposeTile4(const float* src, int srcLd, float* dst, int dstLd) {
+	__m128 r0 = _mm_loadu_ps(src);
+	__m128 r1 = _mm_loadu_ps(src + srcLd);
+	__m128 r2 = _mm_loadu_ps(src + 2 * srcLd);
+	__m128 r3 = _mm_loadu_ps(src + 3 * srcLd);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(dst, r0);
+	_mm_storeu_ps(dst + dstLd, r1);
+	_mm_storeu_ps(dst + 2 * dstLd, r2);
+	_mm_storeu_ps(dst + 3 * dstLd, r3);
+}
+#endif
+
+#if defined(__AVX__)
+inline void TransposeTile4(const double* src, int srcLd, double* dst, int dstLd) {
+	__m256d r0 = _mm256_loadu_pd(src);
+	__m256d r1 = _mm256_loadu_pd(src + srcLd);
+	__m256d r2 = _mm256_loadu_pd(src + 2 * srcLd);
+	__m256d r3 = _mm256_loadu_pd(src + 3 * srcLd);
+	__m256d t0 = _mm256_unpacklo_pd(r0, r1);
+	__m256d t1 = _mm256_unpackhi_pd(r0, r1);
+	__m256d t2 = _mm256_unpacklo_pd(r2, r3);
+	__m256d t3 = _mm256_unpackhi_pd(r2, r3);
+	_mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+	_mm256_storeu_pd(dst + dstLd, _mm256_permute2f128_pd(t1, t3, 0x20));
+	_mm256_storeu_pd(dst + 2 * dstLd, _mm256_permute2f128_pd(t0, t2, 0x31));
+	_mm256_storeu_pd(dst + 3 * dstLd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+#endif
+
+// Transpose an 8x8 tile as four 4x4 register transposes.
+template <class T>
+inline void TransposeTile8(const T* src, int srcLd, T* dst, int dstLd) {
+	TransposeTile4(src, srcLd, dst, dstLd);
+	TransposeTile4(src + 4, srcLd, dst + 4 * dstLd, dstLd);
+	TransposeTile4(src + 4 * srcLd, srcLd, dst + 4, dstLd);
+	TransposeTile4(src + 4 * srcLd + 4, srcLd, dst + 4 * dstLd + 4, dstLd);
+}
+
+/* Cache-oblivious out-of-place transpose of the nRows x nCols block at src into dst.
+	The larger dimension is split in half until the block fits comfortably in L1,
+	at which point it is processed as 8x8 register tiles with a scalar clean-up
+	of the edges. */
+template <class T>
+void TransposeRecursive(const T* src, int srcLd, T* dst, int dstLd, int nRows, int nCols) {
+	if((nRows <= 32) && (nCols <= 32)) {
+		int fullRows = nRows - (nRows % 8);
+		int fullCols = nCols - (nCols % 8);
+		for(int i = 0; i < fullRows; i += 8) {
+			for(int j = 0; j < fullCols; j += 8)
+				TransposeTile8(src + i * srcLd + j, srcLd, dst + j * dstLd + i, dstLd);
+		}
+		for(int i = 0; i < nRows; ++i) {
+			int jStart = (i < fullRows) ? fullCols : 0;
+			for(int j = jStart; j < nCols; ++j)
+				dst[j * dstLd + i] = src[i * srcLd + j];
+		}
+		return;
+	}
+
+	if(nRows >= nCols) {
+		int half = nRows / 2;
+		TransposeRecursive(src, srcLd, dst, dstLd, half, nCols);
+		TransposeRecursive(src + half * srcLd, srcLd, dst + half, dstLd, nRows - half, nCols);
+	}
+	else {
+		int half = nCols / 2;
+		TransposeRecursive(src, srcLd, dst, dstLd, nRows, half);
+		TransposeRecursive(src + half, srcLd, dst + half * dstLd, dstLd, nRows, nCols - half);
+	}
+}
+
+}
+
+/* Structural properties of a matrix, as a bit mask. A matrix is diagonal when it is both upper
+	and lower triangular, and positive definite implies symmetric. */
+constexpr unsigned QBMATRIX_SYMMETRIC = 1;
+constexpr unsigned QBMATRIX_UPPERTRIANGULAR = 2;
+constexpr unsigned QBMATRIX_LOWERTRIANGULAR = 4;
+constexpr unsigned QBMATRIX_DIAGONAL = QBMATRIX_UPPERTRIANGULAR | QBMATRIX_LOWERTRIANGULAR;
+constexpr unsigned QBMATRIX_UPPERHESSENBERG = 8;
+constexpr unsigned QBMATRIX_POSITIVEDEFINITE = 16;
+
 template <class T>
 class qbMatrix2 {
 public:
@@ -50,20 +180,30 @@ public:
 	int GetNumRows() const;
 	int GetNumCols() const;
 
+	// Direct access to the underlying (row-major) data.
+	T* GetData();
+	const T* GetData() const;
+
 	// Manipulation methods.
 	// Compute matrix inverse.
 	bool Inverse();
 	// Convert to row echelon form.
-	qbMatrix2<T> RowEchelon();
+	qbMatrix2<T> RowEchelon() const;
+	/* Convert to row echelon form (or reduced row echelon form) in result, with partial pivoting.
+		rowOrder[i] is the row of this matrix that ended up as row i, and the number of pivots
+		(the rank) is returned. */
+	int RowEchelon(qbMatrix2<T>& result, std::vector<int>& rowOrder, bool reduced = false) const;
 	// Return the transpose.
 	qbMatrix2<T> Transpose() const;
+	// Transpose in place (works for non-square matrices too).
+	void TransposeInPlace();
 
 	// Compute determinant.
-	T Determinant();
+	T Determinant() const;
 
 		// Overload == operator.
-	bool operator== (const qbMatrix2<T>& rhs);
-	bool Compare(const qbMatrix2<T>& matrix1, double tolerance);
+	bool operator== (const qbMatrix2<T>& rhs) const;
+	bool Compare(const qbMatrix2<T>& matrix1, double tolerance) const;
 
 	// Overload the assignment operator.
 	qbMatrix2<T> operator= (const qbMatrix2<T>& rhs);
@@ -73,6 +213,7 @@ public:
 		if((ind.first < 0 or ind.first >= m_nRows) or (ind.second < 0 or ind.second >= m_nCols)) {
 			throw std::invalid_argument("Matrix index out of range");
 		}
+		Detach();
 		int idx = Sub2Ind(ind.first, ind.second);
 		return m_matrixData[idx];
 	}
@@ -103,29 +244,54 @@ public:
 
 	bool Separate(qbMatrix2<T>& matrix1, qbMatrix2<T>& matrix2, int colNum);
 	bool Join(const qbMatrix2<T>& matrix2);
-	qbMatrix2<T> FindSubMatrix(int rowNum, int colNum);
+	qbMatrix2<T> FindSubMatrix(int rowNum, int colNum) const;
 
 	// Function to return the rank of the matrix.
-	int Rank();
-
-	bool IsSquare();
-	bool IsRowEchelon();
-	bool IsNonZero();
-	bool IsSymmetric();
-	void PrintMatrix();
-	void PrintMatrix(int precision);
+	int Rank() const;
+
+	bool IsSquare() const;
+	bool IsRowEchelon() const;
+	bool IsNonZero() const;
+	bool IsSymmetric() const;
+	bool IsUpperTriangular() const;
+	bool IsLowerTriangular() const;
+	bool IsDiagonal() const;
+	bool IsUpperHessenberg() const;
+	bool IsPositiveDefinite() const;
+	void PrintMatrix() const;
+	void PrintMatrix(int precision) const;
+
+	// Return the properties that are known to hold, without testing for any others.
+	unsigned GetKnownProperties() const;
+	/* Record that the matrix has the given properties, for a function that has just produced
+		a matrix with a known structure (the properties are not checked). */
+	void SetProperties(unsigned properties);
 
 private:
 	int Sub2Ind(int row, int col) const;
-	bool CloseEnough(T f1, T f2);
+	void Allocate(int numElements);
+	void Detach(bool copyData = true);
+	bool CloseEnough(T f1, T f2) const;
 	void SwapRow(int i, int j);
 	void MultAdd(int i, int j, T multFactor);
 	void MultRow(int i, T multFactor);
-	int FindRowWithMaxElement(int colNumber, int startingRow);
+	int FindRowWithMaxElement(int colNumber, int startingRow) const;
+	bool IsZeroOutsideBand(int lowerBandwidth, int upperBandwidth) const;
+	int KnownProperty(unsigned property) const;
+	void RecordProperties(unsigned properties, bool value) const;
+	static unsigned TransposeProperties(unsigned propertyBits);
 
 private:
+	// The shared storage, and a pointer to the elements within it.
+	std::shared_ptr<T> m_storage;
 	T* m_matrixData;
 	int m_nRows, m_nCols, m_nElements;
+
+	/* The cached properties: a QBMATRIX_ flag in the low byte means that the property is known,
+		and the same flag in the next byte holds its value. This is updated by the const queries,
+		so it is atomic. */
+	mutable std::atomic<unsigned> m_properties{0};
+	static constexpr int PROPERTY_VALUE_SHIFT = 8;
 };
 
 /* **************************************************************************************************
@@ -146,7 +312,7 @@ qbMatrix2<T>::qbMatrix2(int nRows, int nCols) {
 	m_nRows = nRows;
 	m_nCols = nCols;
 	m_nElements = m_nRows * m_nCols;
-	m_matrixData = new T[m_nElements];
+	Allocate(m_nElements);
 	for(int i = 0; i < m_nElements; i++)
 		m_matrixData[i] = 0.0;
 }
@@ -157,21 +323,20 @@ qbMatrix2<T>::qbMatrix2(int nRows, int nCols, const T* inputData) {
 	m_nRows = nRows;
 	m_nCols = nCols;
 	m_nElements = m_nRows * m_nCols;
-	m_matrixData = new T[m_nElements];
+	Allocate(m_nElements);
 	for(int i = 0; i < m_nElements; i++)
 		m_matrixData[i] = inputData[i];
 }
 
-// The copy constructor.
+// The copy constructor (shares the storage of the input matrix).
 template <class T>
 qbMatrix2<T>::qbMatrix2(const qbMatrix2<T>& inputMatrix) {
 	m_nRows = inputMatrix.m_nRows;
 	m_nCols = inputMatrix.m_nCols;
 	m_nElements = inputMatrix.m_nElements;
-
-	m_matrixData = new T[m_nElements];
-	for(int i = 0; i < m_nElements; i++)
-		m_matrixData[i] = inputMatrix.m_matrixData[i];
+	m_storage = inputMatrix.m_storage;
+	m_matrixData = inputMatrix.m_matrixData;
+	m_properties.store(inputMatrix.m_properties.load(std::memory_order_relaxed), std::memory_order_relaxed);
 }
 
 // Construct from std::vector.
@@ -180,17 +345,14 @@ qbMatrix2<T>::qbMatrix2(int nRows, int nCols, const std::vector<T>& inputData) {
 	m_nRows = nRows;
 	m_nCols = nCols;
 	m_nElements = m_nRows * m_nCols;
-	m_matrixData = new T[m_nElements];
+	Allocate(m_nElements);
 	for(int i = 0; i < m_nElements; ++i)
 		m_matrixData[i] = inputData.at(i);
 }
 
 template <class T>
 qbMatrix2<T>::~qbMatrix2() {
-	// Destructor.
-	if(m_matrixData)
-		delete[] m_matrixData;
-
+	// Destructor (the storage is released when the last matrix that shares it is destroyed).
 	m_matrixData = nullptr;
 }
 
@@ -202,8 +364,7 @@ bool qbMatrix2<T>::Resize(int numRows, int numCols) {
 	m_nRows = numRows;
 	m_nCols = numCols;
 	m_nElements = (m_nRows * m_nCols);
-	delete[] m_matrixData;
-	m_matrixData = new T[m_nElements];
+	Allocate(m_nElements);
 	if(m_matrixData != nullptr) {
 		for(int i = 0; i < m_nElements; i++)
 			m_matrixData[i] = 0.0;
@@ -221,6 +382,7 @@ void qbMatrix2<T>::SetToIdentity() {
 	if(!IsSquare())
 		throw std::invalid_argument("Cannot form an identity matrix that is not square.");
 
+	Detach(false);
 	for(int row = 0; row < m_nRows; ++row) {
 		for(int col = 0; col < m_nCols; ++col) {
 			if(col == row)
@@ -229,6 +391,8 @@ void qbMatrix2<T>::SetToIdentity() {
 				m_matrixData[Sub2Ind(row, col)] = 0.0;
 		}
 	}
+	if(m_nRows > 0)
+		RecordProperties(QBMATRIX_SYMMETRIC | QBMATRIX_DIAGONAL | QBMATRIX_UPPERHESSENBERG | QBMATRIX_POSITIVEDEFINITE, true);
 }
 
 /* **************************************************************************************************
@@ -248,7 +412,14 @@ template <class T>
 bool qbMatrix2<T>::SetElement(int row, int col, T elementValue) {
 	int linearIndex = Sub2Ind(row, col);
 	if(linearIndex >= 0) {
+		/* The properties that only depend on elements elsewhere are still known afterwards (so
+			setting the diagonal of a diagonal matrix, say, does not lose the fact that it is). */
+		unsigned unaffected = ((row <= col) ? QBMATRIX_UPPERTRIANGULAR : 0) | ((row >= col) ? QBMATRIX_LOWERTRIANGULAR : 0)
+			| ((row <= col + 1) ? QBMATRIX_UPPERHESSENBERG : 0) | ((row == col) ? QBMATRIX_SYMMETRIC : 0);
+		unsigned propertyBits = m_properties.load(std::memory_order_relaxed);
+		Detach();
 		m_matrixData[linearIndex] = elementValue;
+		m_properties.store(propertyBits & (unaffected | (unaffected << PROPERTY_VALUE_SHIFT)), std::memory_order_relaxed);
 		return true;
 	}
 	else {
@@ -267,7 +438,18 @@ int qbMatrix2<T>::GetNumCols() const {
 }
 
 template <class T>
-bool qbMatrix2<T>::Compare(const qbMatrix2<T>& matrix1, double tolerance) {
+T* qbMatrix2<T>::GetData() {
+	Detach();
+	return m_matrixData;
+}
+
+template <class T>
+const T* qbMatrix2<T>::GetData() const {
+	return m_matrixData;
+}
+
+template <class T>
+bool qbMatrix2<T>::Compare(const qbMatrix2<T>& matrix1, double tolerance) const {
 	// First, check that the matrices have the same dimensions.
 	int numRows1 = matrix1.m_nRows;
 	int numCols1 = matrix1.m_nCols;
@@ -493,9 +675,9 @@ qbMatrix2<T> operator* (const qbMatrix2<T>& lhs, const qbMatrix2<T>& rhs) {
 THE == OPERATOR
 /* *************************************************************************************************/
 template <class T>
-bool qbMatrix2<T>::operator== (const qbMatrix2<T>& rhs) {
+bool qbMatrix2<T>::operator== (const qbMatrix2<T>& rhs) const {
 	// Check if the matricies are the same size, if not return false.
-	if((this->m_nRows != rhs.m_nRows) && (this->m_nCols != rhs.m_nCols))
+	if((this->m_nRows != rhs.m_nRows) || (this->m_nCols != rhs.m_nCols))
 		return false;
 
 	// Check if the elements are equal.
@@ -519,13 +701,10 @@ qbMatrix2<T> qbMatrix2<T>::operator= (const qbMatrix2<T>& rhs) {
 		m_nCols = rhs.m_nCols;
 		m_nElements = rhs.m_nElements;
 
-		if(m_matrixData)
-			delete[] m_matrixData;
-
-		m_matrixData = new T[m_nElements];
-		for(int i = 0; i < m_nElements; i++)
-			m_matrixData[i] = rhs.m_matrixData[i];
-
+		// Share the storage (and the known properties) of rhs.
+		m_storage = rhs.m_storage;
+		m_matrixData = rhs.m_matrixData;
+		m_properties.store(rhs.m_properties.load(std::memory_order_relaxed), std::memory_order_relaxed);
 	}
 	return *this;
 }
@@ -601,8 +780,7 @@ bool qbMatrix2<T>::Join(const qbMatrix2<T>& matrix2) {
 	// Update the stored data.
 	m_nCols = numCols1 + numCols2;
 	m_nElements = m_nRows * m_nCols;
-	delete[] m_matrixData;
-	m_matrixData = new T[m_nElements];
+	Allocate(m_nElements);
 	for(int i = 0; i < m_nElements; ++i)
 		m_matrixData[i] = newMatrixData[i];
 
@@ -614,7 +792,7 @@ bool qbMatrix2<T>::Join(const qbMatrix2<T>& matrix2) {
 COMPUTE MATRIX DETERMINANT
 /* *************************************************************************************************/
 template <class T>
-T qbMatrix2<T>::Determinant() {
+T qbMatrix2<T>::Determinant() const {
 	// Check if the matrix is square.
 	if(!IsSquare())
 		throw std::invalid_argument("Cannot compute the determinant of a matrix that is not square.");
@@ -768,8 +946,7 @@ bool qbMatrix2<T>::Inverse() {
 			// Rebuild the matrix with just the right half, which now contains the result.			
 			m_nCols = originalNumCols;
 			m_nElements = m_nRows * m_nCols;
-			delete[] m_matrixData;
-			m_matrixData = new T[m_nElements];
+			Allocate(m_nElements);
 			for(int i = 0; i < m_nElements; ++i)
 				m_matrixData[i] = rightHalf.m_matrixData[i];
 		}
@@ -791,176 +968,140 @@ qbMatrix2<T> qbMatrix2<T>::Transpose() const {
 	// Note that we reverse the order of rows and columns, as this will be the transpose.
 	qbMatrix2<T> resultMatrix(m_nCols, m_nRows);
 
-	// Now loop through the elements and copy in the appropriate order.
-	for(int i = 0; i < m_nRows; ++i) {
-		for(int j = 0; j < m_nCols; ++j) {
-			resultMatrix.SetElement(j, i, this->GetElement(i, j));
-		}
-	}
+	/* Copy the elements across using a cache-oblivious recursion, so that both the
+		reads and the writes stay within cache-sized tiles. */
+	qbMatrixKernels::TransposeRecursive(m_matrixData, m_nCols, resultMatrix.m_matrixData, m_nRows, m_nRows, m_nCols);
+	resultMatrix.m_properties.store(TransposeProperties(m_properties.load(std::memory_order_relaxed)), std::memory_order_relaxed);
 
 	return resultMatrix;
 }
 
-/* **************************************************************************************************
-CONVERT TO ROW ECHELON FORM (USING GAUSSIAN ELIMINATION)
-/* *************************************************************************************************/
 template <class T>
-qbMatrix2<T> qbMatrix2<T>::RowEchelon() {
-	/* The current matrix must have at least as many columns as rows, but note that we don't
-		actually require it to be square since we assume that the user may have combined a
-		square matrix with a vector. They would do this, for example, if they were trying to
-		solve a system of linear equations. */
-	if(m_nCols < m_nRows)
-		throw std::invalid_argument("The matrix must have at least as many columns as rows.");
-
-	/* Make a copy of the matrix data before we start. We do this because the procedure below
-		will make changes to the stored matrix data (it operates 'in place') and we don't want
-		this behaviour. Therefore we take a copy at the beginning and then we will replace the
-		modified matrix data with this copied data at the end, thus preserving the original. */
-	T* tempMatrixData;
-	tempMatrixData = new T[m_nRows * m_nCols];
-	for(int i = 0; i < (m_nRows * m_nCols); ++i)
-		tempMatrixData[i] = m_matrixData[i];
-
-	// Begin the main part of the process.
-	int cRow, cCol;
-	int maxCount = 100;
-	int count = 0;
-	bool completeFlag = false;
-	while((!completeFlag) && (count < maxCount)) {
-		for(int diagIndex = 0; diagIndex < m_nRows; ++diagIndex) {
-			// Loop over the diagonal of the matrix and ensure all diagonal elements are equal to one.
-			cRow = diagIndex;
-			cCol = diagIndex;
-
-			// Find the index of the maximum element in the current column.
-			int maxIndex = FindRowWithMaxElement(cCol, cRow);
-
-			// Now consider the column.
-			// Our aim is to set all elements BELOW the diagonal to zero.
-			for(int rowIndex = cRow + 1; rowIndex < m_nRows; ++rowIndex) {
-				// If the element is already zero, move on.
-				if(!CloseEnough(m_matrixData[Sub2Ind(rowIndex, cCol)], 0.0)) {
-					int rowOneIndex = cCol;
-
-					// Get the value stored at the current element.
-					T currentElementValue = m_matrixData[Sub2Ind(rowIndex, cCol)];
-
-					// Get the value stored at (rowOneIndex, cCol)
-					T rowOneValue = m_matrixData[Sub2Ind(rowOneIndex, cCol)];
-
-					// If this is equal to zero, then just move on.
-					if(!CloseEnough(rowOneValue, 0.0)) {
-						// Compute the correction factor.
-						// (required to reduce the element at (rowIndex, cCol) to zero).
-						T correctionFactor = -(currentElementValue / rowOneValue);
-						MultAdd(rowIndex, rowOneIndex, correctionFactor);
-					}
+void qbMatrix2<T>::TransposeInPlace() {
+	unsigned propertyBits = TransposeProperties(m_properties.load(std::memory_order_relaxed));
+	Detach();
+	if(m_nRows == m_nCols) {
+		/* For a square matrix we swap pairs of tiles either side of the diagonal, so
+			that both tiles remain in cache while we work on them. */
+		const int blockSize = 32;
+		for(int ii = 0; ii < m_nRows; ii += blockSize) {
+			int iMax = std::min(ii + blockSize, m_nRows);
+			for(int jj = ii; jj < m_nCols; jj += blockSize) {
+				int jMax = std::min(jj + blockSize, m_nCols);
+				for(int i = ii; i < iMax; ++i) {
+					int jStart = (ii == jj) ? i + 1 : jj;
+					for(int j = jStart; j < jMax; ++j)
+						std::swap(m_matrixData[i * m_nCols + j], m_matrixData[j * m_nCols + i]);
 				}
 			}
 		}
-
-		/* Test whether we have achieved the desired result of converting the
-			matrix into row-echelon form. */
-		completeFlag = this->IsRowEchelon();
-
-		// Increment the counter.
-		count++;
+	}
+	else if(m_nElements > 2) {
+		/* For a rectangular matrix, the element at linear index k moves to
+			(k * m_nRows) mod (m_nElements - 1). We follow each of these permutation
+			cycles in turn, marking elements as we go so that each cycle is only
+			visited once. This needs one bit per element rather than a full copy. */
+		int modulus = m_nElements - 1;
+		std::vector<bool> visited(m_nElements, false);
+		for(int start = 1; start < modulus; ++start) {
+			if(visited[start])
+				continue;
+
+			T carried = m_matrixData[start];
+			int current = start;
+			do {
+				int next = static_cast<int>((static_cast<long long>(current) * m_nRows) % modulus);
+				std::swap(carried, m_matrixData[next]);
+				visited[next] = true;
+				current = next;
+			} while(current != start);
+		}
 	}
 
-	// Form the output matrix.
-	qbMatrix2<T> outputMatrix(m_nRows, m_nCols, m_matrixData);
-
-	// Restore the original matrix data from the copy.
-	for(int i = 0; i < (m_nRows * m_nCols); ++i)
-		m_matrixData[i] = tempMatrixData[i];
-
-	// Delete the copy.
-	delete[] tempMatrixData;
-
-	return outputMatrix;
+	std::swap(m_nRows, m_nCols);
+	m_properties.store(propertyBits, std::memory_order_relaxed);
 }
 
 /* **************************************************************************************************
-COMPUTE THE RANK OF THE PROVIDED MATRIX
+CONVERT TO ROW ECHELON FORM (USING GAUSSIAN ELIMINATION)
 /* *************************************************************************************************/
 template <class T>
-int qbMatrix2<T>::Rank() {
-	// Convert the matrix to row-echelon form.
-	qbMatrix2<T> matrixCopy = this->RowEchelon();
-
-	/* If this didn't work, then we compute the rank by finding
-		the largest non-zero sub-matrix with a non-zero determinant.
-
-		Note that this method is slower for large matrices and therefore
-		it is better to use the RowEchelon method if possible. */
-	int numNonZeroRows = 0;
-	if(!matrixCopy.IsRowEchelon()) {
-		// Setup a std::vector to store the sub-matrices as we go.
-		std::vector<qbMatrix2<T>> subMatrixVector;
-
-		// Store the current matrix into the array first.
-		subMatrixVector.push_back(*this);
-
-		/* Loop through the subMatrixVector until either we have tested every
-			sub-matrix or the completeFlag is set. */
-		bool completeFlag = false;
-		int subMatrixCount = 0;
-		while((subMatrixCount < subMatrixVector.size()) && (!completeFlag)) {
-			// Extract the currentMatrix to work with.
-			qbMatrix2<T> currentMatrix = subMatrixVector[subMatrixCount];
-			subMatrixCount++;
-
-			// Test if this matrix is non-zero.
-			if(currentMatrix.IsNonZero()) {
-				// If the determinant is non-zero, then we have our result.
-				T currentMatrixDet = currentMatrix.Determinant();
-				if(!CloseEnough(currentMatrixDet, 0.0)) {
-					completeFlag = true;
-					numNonZeroRows = currentMatrix.GetNumRows();
-				}
-				else {
-					// Extract and store each sub-matrix (if larger than 2x2).
-					if((currentMatrix.GetNumRows() > 2) && (currentMatrix.GetNumCols() > 2)) {
-						for(int i = 0; i < currentMatrix.GetNumRows(); ++i) {
-							for(int j = 0; j < currentMatrix.GetNumCols(); ++j) {
-								// Extract this sub-matrix and store.
-								subMatrixVector.push_back(currentMatrix.FindSubMatrix(i, j));
-							}
-						}
-					}
-				}
-			}
+qbMatrix2<T> qbMatrix2<T>::RowEchelon() const {
+	qbMatrix2<T> outputMatrix;
+	std::vector<int> rowOrder;
+	RowEchelon(outputMatrix, rowOrder);
+	return outputMatrix;
+}
+
+/* A single pass of Gaussian elimination with partial pivoting: for each column in turn, the row
+	with the largest remaining element is swapped into the pivot position and used to eliminate
+	the elements below it (and above it, for the reduced form). A column with no element larger
+	than the CloseEnough tolerance has no pivot; what is left of it is set to zero and the pivot
+	row stays where it is, so the matrix may have any shape. The elimination is done in place
+	in result, which may be this matrix itself. */
+template <class T>
+int qbMatrix2<T>::RowEchelon(qbMatrix2<T>& result, std::vector<int>& rowOrder, bool reduced) const {
+	if(&result != this)
+		result = *this;
+	result.Detach();
+
+	rowOrder.resize(m_nRows);
+	for(int i = 0; i < m_nRows; ++i)
+		rowOrder[i] = i;
+
+	T* data = result.m_matrixData;
+	int pivotRow = 0;
+	for(int col = 0; (col < m_nCols) && (pivotRow < m_nRows); ++col) {
+		// Find the row with the largest element in this column, at or below the pivot row.
+		int maxIndex = result.FindRowWithMaxElement(col, pivotRow);
+		if(CloseEnough(data[Sub2Ind(maxIndex, col)], 0.0)) {
+			for(int i = pivotRow; i < m_nRows; ++i)
+				data[Sub2Ind(i, col)] = static_cast<T>(0.0);
+			continue;
 		}
-	}
-	else {
-		/* Converting to row echelon form did work, so we can simply
-			count the number of non-zero rows to get the rank. */
 
-		/* If we get to here, then we can assume that the matrix is now
-			in row-echelon form and we can compute the rank quite easily
-			as simply the number of non-zero rows. */
+		if(maxIndex != pivotRow) {
+			std::swap_ranges(data + Sub2Ind(pivotRow, 0), data + Sub2Ind(pivotRow, 0) + m_nCols, data + Sub2Ind(maxIndex, 0));
+			std::swap(rowOrder[pivotRow], rowOrder[maxIndex]);
+		}
 
-		int nRows = matrixCopy.GetNumRows();
-		int nCols = matrixCopy.GetNumCols();
+		// For the reduced form, scale the pivot row so that the pivot is one.
+		T* pivotData = data + Sub2Ind(pivotRow, 0);
+		if(reduced) {
+			T scale = static_cast<T>(1.0) / pivotData[col];
+			for(int j = col + 1; j < m_nCols; ++j)
+				pivotData[j] *= scale;
+			pivotData[col] = static_cast<T>(1.0);
+		}
 
-		// Loop over each row and test whether it has at least one non-zero element.
-		for(int i = 0; i < nRows; ++i) {
-			// Loop over the columns of this row.
-			int colSum = 0;
-			for(int j = 0; j < nCols; ++j) {
-				if(!CloseEnough(matrixCopy.GetElement(i, j), 0.0))
-					colSum++;
-			}
-			// If colSum is greater than zero, then increment numNonZeroRows.
-			if(colSum > 0)
-				numNonZeroRows++;
+		// Eliminate the elements below the pivot (and above it, for the reduced form).
+		for(int i = (reduced ? 0 : pivotRow + 1); i < m_nRows; ++i) {
+			T* rowData = data + Sub2Ind(i, 0);
+			if((i == pivotRow) || (rowData[col] == static_cast<T>(0.0)))
+				continue;
+			T factor = rowData[col] / pivotData[col];
+			rowData[col] = static_cast<T>(0.0);
+			for(int j = col + 1; j < m_nCols; ++j)
+				rowData[j] -= factor * pivotData[j];
 		}
 
+		pivotRow++;
 	}
-	// The rank of the matrix is simply the number of non-zero rows.
-	return numNonZeroRows;
 
+	// Every element below the diagonal has been set to zero.
+	result.RecordProperties(QBMATRIX_UPPERTRIANGULAR | QBMATRIX_UPPERHESSENBERG, true);
+	return pivotRow;
+}
+
+/* **************************************************************************************************
+COMPUTE THE RANK OF THE PROVIDED MATRIX
+/* *************************************************************************************************/
+template <class T>
+int qbMatrix2<T>::Rank() const {
+	// The rank is the number of pivots found when converting to row echelon form.
+	qbMatrix2<T> rowEchelonMatrix;
+	std::vector<int> rowOrder;
+	return RowEchelon(rowEchelonMatrix, rowOrder);
 }
 
 /* **************************************************************************************************
@@ -975,9 +1116,40 @@ int qbMatrix2<T>::Sub2Ind(int row, int col) const {
 		return -1;
 }
 
+// Function to replace the storage with a new (unshared) buffer of the given size.
+template <class T>
+void qbMatrix2<T>::Allocate(int numElements) {
+	m_storage.reset(new T[numElements], std::default_delete<T[]>());
+	m_matrixData = m_storage.get();
+	m_properties.store(0, std::memory_order_relaxed);
+}
+
+/* Function to make sure that the storage is not shared with any other matrix, before it is
+	modified. If it is shared, the matrix gets its own copy of the elements (or an uninitialized
+	buffer, if copyData is false and every element is about to be overwritten). The cached
+	properties are forgotten, since they may no longer hold. */
+template <class T>
+void qbMatrix2<T>::Detach(bool copyData) {
+	m_properties.store(0, std::memory_order_relaxed);
+	if(!m_storage)
+		return;
+
+	if(m_storage.use_count() > 1) {
+		std::shared_ptr<T> sharedStorage = m_storage;
+		Allocate(m_nElements);
+		if(copyData)
+			std::copy(sharedStorage.get(), sharedStorage.get() + m_nElements, m_matrixData);
+	}
+	else {
+		/* This is the only reference, but another thread may have just released the storage
+			after reading from it, so make sure that those reads happen before our writes. */
+		std::atomic_thread_fence(std::memory_order_acquire);
+	}
+}
+
 // Function to test whether the matrix is square.
 template <class T>
-bool qbMatrix2<T>::IsSquare() {
+bool qbMatrix2<T>::IsSquare() const {
 	if(m_nCols == m_nRows)
 		return true;
 	else
@@ -986,7 +1158,7 @@ bool qbMatrix2<T>::IsSquare() {
 
 // Function to test whether the matrix is non-zero.
 template <class T>
-bool qbMatrix2<T>::IsNonZero() {
+bool qbMatrix2<T>::IsNonZero() const {
 	// Loop over every element.
 	int numNonZero = 0;
 	for(int i = 0; i < m_nElements; ++i) {
@@ -1002,36 +1174,44 @@ bool qbMatrix2<T>::IsNonZero() {
 	return (numNonZero != 0);
 }
 
-// Function to test whether the matrix is in row-echelon form.
+/* Function to test whether the matrix is in row-echelon form (every element below the diagonal
+	is zero to within the CloseEnough tolerance). If the matrix is known to be upper Hessenberg,
+	only the subdiagonal is tested. Unlike IsUpperTriangular(), the result is not recorded. */
 template <class T>
-bool qbMatrix2<T>::IsRowEchelon() {
-	/* We do this by testing that the sum of all the elements in the
-		lower triangular matrix is zero. */
-	// Loop over each row, except the first one (which doesn't need to have any zero elements).
-	T cumulativeSum = static_cast<T>(0.0);
+bool qbMatrix2<T>::IsRowEchelon() const {
+	if(KnownProperty(QBMATRIX_UPPERTRIANGULAR) == 1)
+		return true;
+
+	bool upperHessenberg = (KnownProperty(QBMATRIX_UPPERHESSENBERG) == 1);
 	for(int i = 1; i < m_nRows; ++i) {
-		/* Loop over the columns that correspond to the lower triangular
-			matrix according to the current row. */
-		for(int j = 0; j < i; ++j) {
-			// Add this element to the cumulative sum.
-			cumulativeSum += m_matrixData[Sub2Ind(i, j)];
+		int rowEnd = std::min(i, m_nCols);
+		for(int j = (upperHessenberg ? std::max(rowEnd - 1, 0) : 0); j < rowEnd; ++j) {
+			if(!CloseEnough(m_matrixData[Sub2Ind(i, j)], 0.0))
+				return false;
 		}
 	}
-
-	/* If the matrix is in row-echelon form, then cumulative sum should
-		still equal zero, otherwise the matrix cannot be in row-echelon form. */
-	return CloseEnough(cumulativeSum, 0.0);
+	return true;
 }
 
 // Function to test whether the matrix is symmetric.
 template <class T>
-bool qbMatrix2<T>::IsSymmetric() {
+bool qbMatrix2<T>::IsSymmetric() const {
+	int known = KnownProperty(QBMATRIX_SYMMETRIC);
+	if(known >= 0)
+		return (known == 1);
+
 	/* First test that the matrix is square, if it is
 		not, then it cannot by symmetric. */
-	if(!this->IsSquare())
+	if(!this->IsSquare()) {
+		RecordProperties(QBMATRIX_SYMMETRIC, false);
 		return false;
+	}
 
-	// Now test for symmetry about the diagonal.
+	// Now test for symmetry about the diagonal, relative to the largest element.
+	T maxElement = static_cast<T>(0.0);
+	for(int i = 0; i < m_nElements; ++i)
+		maxElement = std::max(maxElement, static_cast<T>(fabs(m_matrixData[i])));
+	T tolerance = static_cast<T>(1e-9) * maxElement;
 	T currentRowElement = static_cast<T>(0.0);
 	T currentColElement = static_cast<T>(0.0);
 	bool returnFlag = true;
@@ -1043,7 +1223,7 @@ bool qbMatrix2<T>::IsSymmetric() {
 			currentColElement = this->GetElement(diagIndex, rowIndex);
 
 			// Compare the row and column elements.
-			if(!CloseEnough(currentRowElement, currentColElement))
+			if(fabs(currentRowElement - currentColElement) > tolerance)
 				returnFlag = false;
 
 			// Increment row index.
@@ -1055,14 +1235,129 @@ bool qbMatrix2<T>::IsSymmetric() {
 
 	}
 
-	// Return the result.
+	// Remember and return the result.
+	RecordProperties(QBMATRIX_SYMMETRIC, returnFlag);
 	return returnFlag;
 
 }
 
+// Function to test whether every element below the diagonal is (exactly) zero.
+template <class T>
+bool qbMatrix2<T>::IsUpperTriangular() const {
+	int known = KnownProperty(QBMATRIX_UPPERTRIANGULAR);
+	if(known >= 0)
+		return (known == 1);
+
+	// If the matrix is known to be upper Hessenberg, only the subdiagonal needs to be tested.
+	bool result = true;
+	if(KnownProperty(QBMATRIX_UPPERHESSENBERG) == 1) {
+		for(int i = 1; (i < m_nRows) && (i <= m_nCols) && result; ++i)
+			result = (m_matrixData[Sub2Ind(i, i - 1)] == static_cast<T>(0.0));
+	}
+	else {
+		result = IsZeroOutsideBand(0, m_nCols);
+	}
+	RecordProperties(QBMATRIX_UPPERTRIANGULAR, result);
+	if(result)
+		RecordProperties(QBMATRIX_UPPERHESSENBERG, true);
+	return result;
+}
+
+// Function to test whether every element above the diagonal is zero.
+template <class T>
+bool qbMatrix2<T>::IsLowerTriangular() const {
+	int known = KnownProperty(QBMATRIX_LOWERTRIANGULAR);
+	if(known >= 0)
+		return (known == 1);
+
+	bool result = IsZeroOutsideBand(m_nRows, 0);
+	RecordProperties(QBMATRIX_LOWERTRIANGULAR, result);
+	return result;
+}
+
+// Function to test whether every element off the diagonal is zero.
+template <class T>
+bool qbMatrix2<T>::IsDiagonal() const {
+	return IsUpperTriangular() && IsLowerTriangular();
+}
+
+// Function to test whether every element below the subdiagonal is zero.
+template <class T>
+bool qbMatrix2<T>::IsUpperHessenberg() const {
+	int known = KnownProperty(QBMATRIX_UPPERHESSENBERG);
+	if(known >= 0)
+		return (known == 1);
+
+	bool result = IsZeroOutsideBand(1, m_nCols);
+	RecordProperties(QBMATRIX_UPPERHESSENBERG, result);
+	return result;
+}
+
+/* Function to test whether the matrix is symmetric positive definite, by attempting a Cholesky
+	factorization (O(n^3), or O(n^2) if the matrix is diagonal). The test fails if a
+	pivot is not larger than n*u times the largest diagonal element. */
+template <class T>
+bool qbMatrix2<T>::IsPositiveDefinite() const {
+	int known = KnownProperty(QBMATRIX_POSITIVEDEFINITE);
+	if(known >= 0)
+		return (known == 1);
+
+	bool result = (m_nRows > 0) && IsSymmetric();
+	int n = m_nRows;
+	T maxDiagonal = static_cast<T>(0.0);
+	for(int i = 0; (i < n) && result; ++i)
+		maxDiagonal = std::max(maxDiagonal, m_matrixData[Sub2Ind(i, i)]);
+	T minPivot = static_cast<T>(n) * std::numeric_limits<T>::epsilon() * maxDiagonal;
+
+	if(result && IsDiagonal()) {
+		for(int i = 0; (i < n) && result; ++i)
+			result = (m_matrixData[Sub2Ind(i, i)] > minPivot);
+	}
+	else if(result) {
+		// Cholesky factorization of the lower triangle, L*L' = A, one row at a time.
+		std::vector<T> l((size_t)n * n, static_cast<T>(0.0));
+		for(int i = 0; (i < n) && result; ++i) {
+			T* lRow = l.data() + (size_t)i * n;
+			for(int j = 0; j <= i; ++j) {
+				const T* ljRow = l.data() + (size_t)j * n;
+				T sum = m_matrixData[Sub2Ind(i, j)];
+				for(int k = 0; k < j; ++k)
+					sum -= lRow[k] * ljRow[k];
+				if(j < i)
+					lRow[j] = sum / ljRow[j];
+				else if(sum > minPivot)
+					lRow[i] = sqrt(sum);
+				else
+					result = false;
+			}
+		}
+	}
+
+	RecordProperties(QBMATRIX_POSITIVEDEFINITE, result);
+	return result;
+}
+
+// Function to return the properties that are known to hold.
+template <class T>
+unsigned qbMatrix2<T>::GetKnownProperties() const {
+	unsigned propertyBits = m_properties.load(std::memory_order_relaxed);
+	return propertyBits & (propertyBits >> PROPERTY_VALUE_SHIFT);
+}
+
+// Function to record that the matrix has the given properties (and those that they imply).
+template <class T>
+void qbMatrix2<T>::SetProperties(unsigned properties) {
+	if(properties & QBMATRIX_UPPERTRIANGULAR)
+		properties |= QBMATRIX_UPPERHESSENBERG;
+	if(properties & QBMATRIX_POSITIVEDEFINITE)
+		properties |= QBMATRIX_SYMMETRIC;
+	RecordProperties(properties, true);
+}
+
 // Function to swap rows i and j (in place).
 template <class T>
 void qbMatrix2<T>::SwapRow(int i, int j) {
+	Detach();
 	// Store a tempory copy of row i.
 	T* tempRow = new T[m_nCols];
 	for(int k = 0; k < m_nCols; ++k)
@@ -1083,6 +1378,7 @@ void qbMatrix2<T>::SwapRow(int i, int j) {
 // Function to add a multiple of row j to row i (in place).
 template <class T>
 void qbMatrix2<T>::MultAdd(int i, int j, T multFactor) {
+	Detach();
 	for(int k = 0; k < m_nCols; ++k)
 		m_matrixData[Sub2Ind(i, k)] += (m_matrixData[Sub2Ind(j, k)] * multFactor);
 }
@@ -1090,7 +1386,7 @@ void qbMatrix2<T>::MultAdd(int i, int j, T multFactor) {
 // Function to the find the row with the maximum element at the column given.
 // Returns the row index.
 template <class T>
-int qbMatrix2<T>::FindRowWithMaxElement(int colNumber, int startingRow) {
+int qbMatrix2<T>::FindRowWithMaxElement(int colNumber, int startingRow) const {
 	T tempValue = m_matrixData[Sub2Ind(startingRow, colNumber)];
 	int rowIndex = startingRow;
 	for(int k = startingRow + 1; k < m_nRows; ++k) {
@@ -1105,13 +1401,14 @@ int qbMatrix2<T>::FindRowWithMaxElement(int colNumber, int startingRow) {
 // Function to multiply a row by the given value.
 template <class T>
 void qbMatrix2<T>::MultRow(int i, T multFactor) {
+	Detach();
 	for(int k = 0; k < m_nCols; ++k)
 		m_matrixData[Sub2Ind(i, k)] *= multFactor;
 }
 
 // A simple function to print a matrix to stdout.
 template <class T>
-void qbMatrix2<T>::PrintMatrix() {
+void qbMatrix2<T>::PrintMatrix() const {
 	int nRows = this->GetNumRows();
 	int nCols = this->GetNumCols();
 	for(int row = 0; row < nRows; ++row) {
@@ -1124,7 +1421,7 @@ void qbMatrix2<T>::PrintMatrix() {
 
 // A simple function to print a matrix to stdout, with specified precision.
 template <class T>
-void qbMatrix2<T>::PrintMatrix(int precision) {
+void qbMatrix2<T>::PrintMatrix(int precision) const {
 	int nRows = this->GetNumRows();
 	int nCols = this->GetNumCols();
 	for(int row = 0; row < nRows; ++row) {
@@ -1136,13 +1433,76 @@ void qbMatrix2<T>::PrintMatrix(int precision) {
 }
 
 template <class T>
-bool qbMatrix2<T>::CloseEnough(T f1, T f2) {
+bool qbMatrix2<T>::CloseEnough(T f1, T f2) const {
 	return fabs(f1 - f2) < 1e-9;
 }
 
+/* Function to test whether every element more than lowerBandwidth below the diagonal, or more
+	than upperBandwidth above it, is exactly zero. A small element may be significant (if the
+	whole matrix is small), so there is no tolerance here. */
+template <class T>
+bool qbMatrix2<T>::IsZeroOutsideBand(int lowerBandwidth, int upperBandwidth) const {
+	for(int i = 0; i < m_nRows; ++i) {
+		const T* rowData = m_matrixData + (size_t)i * m_nCols;
+		int bandStart = std::min(std::max(i - lowerBandwidth, 0), m_nCols);
+		int bandEnd = std::max(std::min(i + upperBandwidth + 1, m_nCols), bandStart);
+		for(int j = 0; j < bandStart; ++j) {
+			if(rowData[j] != static_cast<T>(0.0))
+				return false;
+		}
+		for(int j = bandEnd; j < m_nCols; ++j) {
+			if(rowData[j] != static_cast<T>(0.0))
+				return false;
+		}
+	}
+	return true;
+}
+
+/* Function to return 1 if the given property is known to hold, 0 if it is known not to hold,
+	and -1 if it is not known. For a combination of properties (such as QBMATRIX_DIAGONAL), 1
+	means that all of them are known to hold. */
+template <class T>
+int qbMatrix2<T>::KnownProperty(unsigned property) const {
+	unsigned propertyBits = m_properties.load(std::memory_order_relaxed);
+	unsigned values = propertyBits >> PROPERTY_VALUE_SHIFT;
+	if((propertyBits & values & property) == property)
+		return 1;
+	if(propertyBits & ~values & property)
+		return 0;
+	return -1;
+}
+
+/* Function to record the value of the given properties. Concurrent queries only ever add what
+	they have found about the same elements, so they can safely do so at the same time. */
+template <class T>
+void qbMatrix2<T>::RecordProperties(unsigned properties, bool value) const {
+	m_properties.fetch_or(properties | (value ? (properties << PROPERTY_VALUE_SHIFT) : 0), std::memory_order_relaxed);
+}
+
+/* Function to return the property bits of the transpose: the triangular properties swap over,
+	and upper Hessenberg is no longer known (unless the transpose is upper triangular). */
+template <class T>
+unsigned qbMatrix2<T>::TransposeProperties(unsigned propertyBits) {
+	unsigned swapped = 0;
+	for(int shift = 0; shift <= PROPERTY_VALUE_SHIFT; shift += PROPERTY_VALUE_SHIFT) {
+		unsigned bits = propertyBits >> shift;
+		unsigned transposed = bits & (QBMATRIX_SYMMETRIC | QBMATRIX_POSITIVEDEFINITE);
+		if(bits & QBMATRIX_UPPERTRIANGULAR)
+			transposed |= QBMATRIX_LOWERTRIANGULAR;
+		if(bits & QBMATRIX_LOWERTRIANGULAR)
+			transposed |= QBMATRIX_UPPERTRIANGULAR;
+		swapped |= (transposed << shift);
+	}
+	// The transpose of a lower triangular matrix is upper triangular, and so upper Hessenberg.
+	unsigned upper = QBMATRIX_UPPERTRIANGULAR | (QBMATRIX_UPPERTRIANGULAR << PROPERTY_VALUE_SHIFT);
+	if((swapped & upper) == upper)
+		swapped |= QBMATRIX_UPPERHESSENBERG | (QBMATRIX_UPPERHESSENBERG << PROPERTY_VALUE_SHIFT);
+	return swapped;
+}
+
 // Function to find the sub-matrix for the given element.
 template <class T>
-qbMatrix2<T> qbMatrix2<T>::FindSubMatrix(int rowNum, int colNum) {
+qbMatrix2<T> qbMatrix2<T>::FindSubMatrix(int rowNum, int colNum) const {
 	// Create a new matrix to store the sub-matrix.
 	// Note that this is one row and one column smaller than the original.
 	qbMatrix2<T> subMatrix(m_nRows - 1, m_nCols - 1);
@@ -15,11 +15,18 @@
 #include "qbMatrix.h"
 #include "qbVector.h"
 #include "qbEIG.h"
+#include "qbEIGSym.h"
+#include "qbGEMM.h"
+#include "qbTSQR.h"
 
 // Define error codes.
 constexpr int QBPCA_MATRIXNOTSQUARE = -1;
 constexpr int QBPCA_MATRIXNOTSYMMETRIC = -2;
 
+// Declared in qbDecompCache.h, which must be included to use the overload that takes a cache.
+template <class T>
+class qbDecompCache;
+
 namespace qbPCA
 {
 
@@ -75,18 +82,59 @@ qbMatrix2<T> ComputeCovariance(const qbMatrix2<T> &X)
 		matrix should be [p x p], so we need to transpose, hence the use of
 		X'X. */
 	int numRows = X.GetNumRows();
-	qbMatrix2<T> covX = (static_cast<T>(1.0) / static_cast<T>(numRows - 1)) * (X.Transpose() * X);
+	int numCols = X.GetNumCols();
+	if (numRows < 2*numCols)
+		return (static_cast<T>(1.0) / static_cast<T>(numRows - 1)) * (X.Transpose() * X);
+
+	/* For tall data (many more observations than variables), use X'X = R'R, with R from
+		TSQR. The blocks of observations are factorized in parallel, and only the small
+		[p x p] R factors are combined. */
+	qbTSQR<T> qr;
+	qr.Factorize(X);
+	qbMatrix2<T> R = qr.GetR(), covX;
+	qbGEMM(R.Transpose(), R, covX);
+	T scale = static_cast<T>(1.0) / static_cast<T>(numRows - 1);
+	for (int i=0; i<numCols; ++i)
+	{
+		for (int j=0; j<=i; ++j)
+		{
+			covX.SetElement(i, j, covX.GetElement(i, j) * scale);
+			covX.SetElement(j, i, covX.GetElement(i, j));
+		}
+	}
+	covX.SetProperties(QBMATRIX_SYMMETRIC);
 	return covX;
 }
 
+// Function to fix the sign of each eigenvector, so that its largest element is positive.
+template <typename T>
+void FixEigenvectorSigns(qbMatrix2<T> &eVM)
+{
+	int numRows = eVM.GetNumRows();
+	int numCols = eVM.GetNumCols();
+	for (int j=0; j<numCols; ++j)
+	{
+		T largest = static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+		{
+			if (fabs(eVM.GetElement(i, j)) > fabs(largest))
+				largest = eVM.GetElement(i, j);
+		}
+
+		if (largest < static_cast<T>(0.0))
+		{
+			for (int i=0; i<numRows; ++i)
+				eVM.SetElement(i, j, -eVM.GetElement(i, j));
+		}
+	}
+}
+
 // Function to compute the eigenvectors of the covariance matrix.
 template <typename T>
 int ComputeEigenvectors(const qbMatrix2<T> &covarianceMatrix, qbMatrix2<T> &eigenvectors)
 {
-	// Copy the input matrix.
-	qbMatrix2<T> X = covarianceMatrix;
-
 	// The covariance matrix must be square and symmetric.
+	const qbMatrix2<T> &X = covarianceMatrix;
 	if (!X.IsSquare())
 		return QBPCA_MATRIXNOTSQUARE;
 		
@@ -94,29 +142,96 @@ int ComputeEigenvectors(const qbMatrix2<T> &covarianceMatrix, qbMatrix2<T> &eige
 	if (!X.IsSymmetric())
 		return QBPCA_MATRIXNOTSYMMETRIC;
 		
-	// Compute the eignvalues.
+	/* Compute all the eigenvalues (in descending order) and eigenvectors together, with
+		the symmetric divide-and-conquer solver. For large matrices (on more than one thread)
+		this uses the two-stage reduction, so almost all of the work is in matrix-matrix
+		products. */
 	std::vector<T> eigenValues;
-	int returnStatus = qbEigQR(X, eigenValues);
+	qbMatrix2<T> eVM;
+	int returnStatus = qbEigSymmetric(X, eigenValues, eVM);
 
-	// Sort the eigenvalues.
-	std::sort(eigenValues.begin(), eigenValues.end());
-	std::reverse(eigenValues.begin(), eigenValues.end());
+	// Fix the sign of each eigenvector, so that its largest element is positive.
+	FixEigenvectorSigns(eVM);
+	
+	// Return the eigenvectors.
+	eigenvectors = eVM;
 
-	// Compute the eigenvector for each eigenvalue.
-	qbVector<T> eV(X.GetNumCols());
-	qbMatrix2<T> eVM(X.GetNumRows(), X.GetNumCols());
-	for (int j=0; j<eigenValues.size(); ++j)
+	// Return the final return status.	
+	return returnStatus;
+}
+
+/* Function to compute the eigenvectors of the covariance matrix, with the eigendecomposition
+	taken from (or added to) cache. */
+template <typename T>
+int ComputeEigenvectors(const qbMatrix2<T> &covarianceMatrix, qbMatrix2<T> &eigenvectors, qbDecompCache<T> &cache)
+{
+	// The covariance matrix must be square and symmetric.
+	const qbMatrix2<T> &X = covarianceMatrix;
+	if (!X.IsSquare())
+		return QBPCA_MATRIXNOTSQUARE;
+		
+	// Verify that the matrix is symmetric.
+	if (!X.IsSymmetric())
+		return QBPCA_MATRIXNOTSYMMETRIC;
+
+	// The cached eigenvectors are shared, so fix the signs of a copy.
+	auto eigen = cache.GetEigen(X);
+	qbMatrix2<T> eVM = eigen->eigenVectors;
+	FixEigenvectorSigns(eVM);
+
+	// Return the eigenvectors.
+	eigenvectors = eVM;
+
+	return eigen->status;
+}
+
+/* Function to compute the eigenvectors of the covariance matrix, warm-started from a
+	previous set of eigenvectors (for example from the previous run on slowly drifting
+	data). Uses subspace iteration with Rayleigh-Ritz refinement, which typically
+	converges in one or two iterations when the previous basis is close. Only as many
+	eigenvectors as there are columns in previousEigenvectors are computed, and their
+	signs are chosen to match the previous eigenvectors. */
+template <typename T>
+int ComputeEigenvectors(const qbMatrix2<T> &covarianceMatrix, qbMatrix2<T> &eigenvectors, const qbMatrix2<T> &previousEigenvectors)
+{
+	// The covariance matrix must be square and symmetric.
+	const qbMatrix2<T> &X = covarianceMatrix;
+	if (!X.IsSquare())
+		return QBPCA_MATRIXNOTSQUARE;
+		
+	// Verify that the matrix is symmetric.
+	if (!X.IsSymmetric())
+		return QBPCA_MATRIXNOTSYMMETRIC;
+
+	// If the previous basis doesn't fit this problem, fall back to a full solve.
+	if ((previousEigenvectors.GetNumRows() != X.GetNumRows()) || (previousEigenvectors.GetNumCols() < 1)
+		|| (previousEigenvectors.GetNumCols() > X.GetNumCols()))
+		return ComputeEigenvectors(covarianceMatrix, eigenvectors);
+
+	// Refine the previous basis.
+	std::vector<T> eigenValues;
+	qbMatrix2<T> eVM;
+	int returnStatus = qbEigSubspace(X, previousEigenvectors, eigenValues, eVM);
+
+	// Keep the sign of each eigenvector consistent with the previous run.
+	int numRows = eVM.GetNumRows();
+	int numCols = eVM.GetNumCols();
+	for (int j=0; j<numCols; ++j)
 	{
-		T eig = eigenValues.at(j);
-		int returnStatus2 = qbInvPIt<T>(X, eig, eV);
-		for (int i=0; i<eV.GetNumDims(); ++i)
-			eVM.SetElement(i, j, eV.GetElement(i));
+		T dotProduct = static_cast<T>(0.0);
+		for (int i=0; i<numRows; ++i)
+			dotProduct += eVM.GetElement(i, j) * previousEigenvectors.GetElement(i, j);
+
+		if (dotProduct < static_cast<T>(0.0))
+		{
+			for (int i=0; i<numRows; ++i)
+				eVM.SetElement(i, j, -eVM.GetElement(i, j));
+		}
 	}
-	
+
 	// Return the eigenvectors.
 	eigenvectors = eVM;
 
-	// Return the final return status.	
 	return returnStatus;
 }
 
@@ -146,6 +261,60 @@ int qbPCA(const qbMatrix2<T> &inputData, qbMatrix2<T> &outputComponents)
 	return returnStatus;
 }
 
+/* Function to compute the principal components of the supplied data, with the
+	eigendecomposition of the covariance matrix taken from (or added to) cache. */
+template <typename T>
+int qbPCA(const qbMatrix2<T> &inputData, qbMatrix2<T> &outputComponents, qbDecompCache<T> &cache)
+{
+	// Make a copy of the input matrix.
+	qbMatrix2<T> X = inputData;
+	
+	// Compute the mean of each column of X.
+	std::vector<T> columnMeans = ComputeColumnMeans(X);
+	
+	// Subtract the column means from the data.
+	SubtractColumnMeans<T>(X, columnMeans);
+	
+	// Compute the covariance matrix.
+	qbMatrix2<T> covX = ComputeCovariance(X);
+	
+	// Compute the eigenvectors.
+	qbMatrix2<T> eigenvectors;
+	int returnStatus = ComputeEigenvectors(covX, eigenvectors, cache);
+	
+	// Return the output.
+	outputComponents = eigenvectors;
+	
+	return returnStatus;
+}
+
+/* Function to compute the principal components of the supplied data, warm-started
+	from the components returned by a previous call. */
+template <typename T>
+int qbPCA(const qbMatrix2<T> &inputData, qbMatrix2<T> &outputComponents, const qbMatrix2<T> &previousComponents)
+{
+	// Make a copy of the input matrix.
+	qbMatrix2<T> X = inputData;
+	
+	// Compute the mean of each column of X.
+	std::vector<T> columnMeans = ComputeColumnMeans(X);
+	
+	// Subtract the column means from the data.
+	SubtractColumnMeans<T>(X, columnMeans);
+	
+	// Compute the covariance matrix.
+	qbMatrix2<T> covX = ComputeCovariance(X);
+	
+	// Compute the eigenvectors, starting from the previous components.
+	qbMatrix2<T> eigenvectors;
+	int returnStatus = ComputeEigenvectors(covX, eigenvectors, previousComponents);
+	
+	// Return the output.
+	outputComponents = eigenvectors;
+	
+	return returnStatus;
+}
+
 }
 
 #endif
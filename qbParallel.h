@@ -0,0 +1,65 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBPARALLEL_H
+#define QBPARALLEL_H
+
+/* *************************************************************************************************
+
+	qbParallel
+
+	Helper to split a loop over [0, numItems) into contiguous ranges and run them on separate
+	threads, for the data-parallel kernels in the library (sparse matrix-vector products,
+	smoothers, permuted copies and so on).
+
+	The function is called as function(first, last) for each range. Small loops are run
+	directly on the calling thread: a range is only given its own thread if it has at least
+	minItemsPerThread items, since starting a thread costs of the order of tens of microseconds.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <stddef.h>
+
+// Return the number of threads to use (queried once, since the query itself is a system call).
+inline size_t qbParallelNumThreads() {
+	static const size_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+	return numThreads;
+}
+
+// Call function(first, last) over [0, numItems), split across threads for large loops.
+template <class F>
+void qbParallelFor(size_t numItems, size_t minItemsPerThread, F function) {
+	size_t numThreads = qbParallelNumThreads();
+	minItemsPerThread = std::max(minItemsPerThread, static_cast<size_t>(1));
+	numThreads = std::min(numThreads, (numItems + minItemsPerThread - 1) / minItemsPerThread);
+
+	if(numThreads <= 1) {
+		function(static_cast<size_t>(0), numItems);
+	}
+	else {
+		std::vector<std::thread> threads;
+		size_t itemsPerThread = (numItems + numThreads - 1) / numThreads;
+		// The calling thread does the first range itself.
+		for(size_t t = 1; t < numThreads; ++t) {
+			size_t first = t * itemsPerThread;
+			size_t last = std::min(numItems, first + itemsPerThread);
+			if(first < last)
+				threads.emplace_back(function, first, last);
+		}
+		function(static_cast<size_t>(0), std::min(numItems, itemsPerThread));
+		for(auto& thread : threads)
+			thread.join();
+	}
+}
+
+#endif
@@ -16,14 +16,36 @@
 	A					qbMatrix2<T>	The matrix on which to perform QR decomposition.
 	Q					qbMatrix2<T>	The output Q matrix.
 	R					qbMatrix2<T>	The output R matrix.
+	method		INT						(Optional) The method to use, QBQR_HOUSEHOLDER (the default) or
+													QBQR_CHOLESKYQR2.
 															
 	*** OUTPUTS ***
 	
 	INT				Flag indicating success or failure of the process.
 						1 Indicates success.
 						-1 indicates failure due to a non-square input matrix.
+						-2 indicates failure due to a matrix with more columns than rows (qbQRThin).
+						-3 indicates failure due to an unknown method.
 								
-	Uses an implementation of Householder reflections to perform QR decomposition.
+	QBQR_HOUSEHOLDER uses an implementation of Householder reflections to perform QR decomposition.
+	The reflectors are applied in blocks (compact WY form, see qbHouseholder.h), so that most of
+	the work is done by matrix-matrix products.
+
+	QBQR_CHOLESKYQR2 is a fast path for tall and reasonably well conditioned matrices. CholeskyQR
+	forms the Gram matrix G = A'A, its Cholesky factor G = R'R and Q = A*inv(R), which is all
+	matrix-matrix work with a single pass over A for each step. On its own the loss of
+	orthogonality in Q grows like cond(A)^2, so the step is repeated on Q (CholeskyQR2, Fukaya et
+	al., 2014), which gives a Q that is orthogonal to working precision provided that cond(A) is
+	less than about 1/sqrt(u). The condition number is estimated from the first Cholesky factor,
+	by a few steps of power and inverse power iteration:
+
+		- If G is safely positive definite and A is well conditioned, CholeskyQR2 is used.
+		- Otherwise, shifted CholeskyQR3 is used (Fukaya, Kannan, Nakatsukasa, Yamamoto and
+			Yanagisawa, SIAM J. Sci. Comput. 42(1), 2020). A small shift on the diagonal of G
+			keeps the first Cholesky factorization stable, and the resulting Q (with cond(Q) of
+			about sqrt(11*m*n*u)*cond(A)) is then orthogonalized by CholeskyQR2. This works up to
+			a condition number of about 1/(sqrt(11*m*n)*u).
+		- If even the shifted Gram matrix is not positive definite, Householder QR is used.
 
 	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
 	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
@@ -38,116 +60,346 @@
 #include <iomanip>
 #include <math.h>
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <functional>
 
 #include "qbMatrix.h"
 #include "qbVector.h"
+#include "qbGEMM.h"
+#include "qbHouseholder.h"
+#include "qbParallel.h"
 
 // Define error codes.
 constexpr int QBQR_MATRIXNOTSQUARE = -1;
+constexpr int QBQR_MATRIXTOOWIDE = -2;
+constexpr int QBQR_INVALIDMETHOD = -3;
 
-// The qbQR function.
+// Define the methods.
+constexpr int QBQR_HOUSEHOLDER = 1;
+constexpr int QBQR_CHOLESKYQR2 = 2;
+
+// Reported by qbQRKernels::CholeskyQR when it had to use the shifted variant.
+constexpr int QBQR_SHIFTEDCHOLESKYQR3 = 3;
+
+namespace qbQRKernels
+{
+
+// Number of rows of A in each block of the Gram matrix computation.
+constexpr int GRAM_BLOCKSIZE = 256;
+
+// Householder QR of the m x n row-major matrix a (m >= n): Q is m x n and R is n x n.
 template <typename T>
-int qbQR(const qbMatrix2<T> &A, qbMatrix2<T> &Q, qbMatrix2<T> &R)
+void HouseholderQR(int m, int n, const T* a, T* q, T* r)
 {
+	std::vector<T> w(a, a + (size_t)m*n), tau(n);
+	qbHouseholderKernels::QRFactor(m, n, w.data(), n, tau.data());
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=0; j<n; ++j)
+			r[(size_t)i*n + j] = (j < i) ? static_cast<T>(0.0) : w[(size_t)i*n + j];
+	}
+	qbHouseholderKernels::FormQ(m, n, n, w.data(), n, tau.data(), q, n);
+}
 
-	// Make a copy of the input matrix.
-	qbMatrix2<T> inputMatrix = A;
+/* The n x n Gram matrix G = A'*A of the m x n row-major matrix a. The rows are split into one
+	group per thread, each group is accumulated a block of rows at a time with the blocked GEMM
+	kernel, and the partial sums are then added in a fixed order. */
+template <typename T>
+void Gram(int m, int n, const T* a, T* g)
+{
+	size_t numBlocks = (m + GRAM_BLOCKSIZE - 1) / GRAM_BLOCKSIZE;
+	size_t numGroups = std::max(static_cast<size_t>(1), std::min(qbParallelNumThreads(), numBlocks));
+	std::vector<std::vector<T>> partial(numGroups, std::vector<T>((size_t)n*n, static_cast<T>(0.0)));
+	qbParallelFor(numGroups, 1, [&](size_t first, size_t last)
+	{
+		std::vector<T> blockT((size_t)n*GRAM_BLOCKSIZE);
+		for (size_t group=first; group<last; ++group)
+		{
+			for (size_t blk=group*numBlocks/numGroups; blk<(group+1)*numBlocks/numGroups; ++blk)
+			{
+				int row0 = static_cast<int>(blk) * GRAM_BLOCKSIZE;
+				int rows = std::min(GRAM_BLOCKSIZE, m - row0);
+				const T* block = a + (size_t)row0*n;
+				for (int i=0; i<rows; ++i)
+				{
+					for (int j=0; j<n; ++j)
+						blockT[(size_t)j*rows + i] = block[(size_t)i*n + j];
+				}
+				qbGEMMKernels::BlockedGEMM(n, n, rows, blockT.data(), rows, block, n, partial[group].data(), n, true);
+			}
+		}
+	});
 
-	// Verify that the input matrix is square.
-	if (!inputMatrix.IsSquare())
-		return QBQR_MATRIXNOTSQUARE;
-		
-	// Determine the number of columns (and rows, since the matrix is square).
-	int numCols = inputMatrix.GetNumCols();
-	
-	// Create a vector to store the P matrices for each column.
-	std::vector<qbMatrix2<T>> Plist;
-	
-	// Loop through each column.
-	for (int j=0; j<(numCols-1); ++j)
+	std::fill(g, g + (size_t)n*n, static_cast<T>(0.0));
+	for (size_t group=0; group<numGroups; ++group)
+	{
+		for (size_t i=0; i<(size_t)n*n; ++i)
+			g[i] += partial[group][i];
+	}
+
+	// Make G exactly symmetric.
+	for (int i=0; i<n; ++i)
+	{
+		for (int j=0; j<i; ++j)
+			g[(size_t)j*n + i] = g[(size_t)i*n + j];
+	}
+}
+
+/* Cholesky factorization G = R'*R of the n x n symmetric row-major matrix g, with the upper
+	triangular R returned in r. Returns false if G is not safely positive definite, that is if
+	a pivot is not larger than n*u times the largest diagonal element. */
+template <typename T>
+bool Cholesky(int n, const T* g, T* r)
+{
+	T maxDiagonal = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+		maxDiagonal = std::max(maxDiagonal, g[(size_t)i*n + i]);
+	T minPivot = static_cast<T>(n) * std::numeric_limits<T>::epsilon() * maxDiagonal;
+
+	std::fill(r, r + (size_t)n*n, static_cast<T>(0.0));
+	for (int i=0; i<n; ++i)
 	{
-		// Create the a1 and b1 vectors.
-		// a1 is the column vector from A.
-		// b1 is the vector onto which we wish to reflect a1.
-		qbVector<T> a1 (numCols-j);
-		qbVector<T> b1 (numCols-j);
-		for (int i=j; i<numCols; ++i)
+		// Row i of R, from G(i, i:n) minus the contributions of the rows above.
+		T* rRow = r + (size_t)i*n;
+		for (int j=i; j<n; ++j)
+			rRow[j] = g[(size_t)i*n + j];
+		for (int p=0; p<i; ++p)
 		{
-			a1.SetElement(i-j, inputMatrix.GetElement(i,j));
-			b1.SetElement(i-j, static_cast<T>(0.0));
+			const T* pRow = r + (size_t)p*n;
+			T rpi = pRow[i];
+			for (int j=i; j<n; ++j)
+				rRow[j] -= rpi * pRow[j];
 		}
-		b1.SetElement(0, static_cast<T>(1.0));
-		
-		// Compute the norm of the a1 vector.
-		T a1norm = a1.norm();
-		
-		// Compute the sign we will use.
-		int sgn = -1;
-		if (a1.GetElement(0) < static_cast<T>(0.0))
-			sgn = 1;
-			
-		// Compute the u-vector.
-		qbVector<T> u = a1 - (sgn * a1norm * b1);
-		
-		// Compute the n-vector.
-		qbVector<T> n = u.Normalized();
-		
-		// Convert n to a matrix so that we can transpose it.
-		qbMatrix2<T> nMat (numCols-j, 1);
-		for (int i=0; i<(numCols-j); ++i)
-			nMat.SetElement(i, 0, n.GetElement(i));
-			
-		// Transpose nMat.
-		qbMatrix2<T> nMatT = nMat.Transpose();
-		
-		// Create an identity matrix of the appropriate size.
-		qbMatrix2<T> I (numCols-j, numCols-j);
-		I.SetToIdentity();
-		
-		// Compute Ptemp.
-		qbMatrix2<T> Ptemp = I - static_cast<T>(2.0) * nMat * nMatT;
-
-		// Form the P matrix with the original dimensions.
-		qbMatrix2<T> P (numCols, numCols);
-		P.SetToIdentity();
-		for (int row=j; row<numCols; ++row)
+		if (!(rRow[i] > minPivot))
+			return false;
+
+		T pivot = sqrt(rRow[i]);
+		rRow[i] = pivot;
+		for (int j=i+1; j<n; ++j)
+			rRow[j] /= pivot;
+	}
+	return true;
+}
+
+// a = a*inv(R) in place for the m x n row-major matrix a and n x n upper triangular R, by rows in parallel.
+template <typename T>
+void SolveUpperRight(int m, int n, const T* r, T* a)
+{
+	qbParallelFor(m, 256, [=](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; ++i)
 		{
-			for (int col=j; col<numCols; ++col)
+			// Solve x*R = a(i, :), one element of x at a time.
+			T* aRow = a + i*n;
+			for (int j=0; j<n; ++j)
 			{
-				P.SetElement(row, col, Ptemp.GetElement(row-j, col-j));
+				aRow[j] /= r[(size_t)j*n + j];
+				T xj = aRow[j];
+				const T* rRow = r + (size_t)j*n;
+				for (int p=j+1; p<n; ++p)
+					aRow[p] -= xj * rRow[p];
 			}
-		}	
-		
-		// Store the result into the Plist vector.
-		Plist.push_back(P);
-		
-		// Apply this transform matrix to inputMatrix and use this result
-		// next time through the loop.
-		inputMatrix = P * inputMatrix;
+		}
+	});
+}
+
+// R1 = R2*R1 in place, for n x n upper triangular R1 and R2.
+template <typename T>
+void MultiplyUpper(int n, const T* r2, T* r1)
+{
+	// Row i of the product only needs rows i to n-1 of R1, which have not been overwritten yet.
+	for (int i=0; i<n; ++i)
+	{
+		T* row = r1 + (size_t)i*n;
+		T r2ii = r2[(size_t)i*n + i];
+		for (int j=i; j<n; ++j)
+			row[j] *= r2ii;
+		for (int p=i+1; p<n; ++p)
+		{
+			T r2ip = r2[(size_t)i*n + p];
+			const T* pRow = r1 + (size_t)p*n;
+			for (int j=p; j<n; ++j)
+				row[j] += r2ip * pRow[j];
+		}
 	}
-	
-	// Compute Q.
-	qbMatrix2<T> Qmat = Plist.at(0);
-	for (int i=1; i<(numCols-1); ++i)
+}
+
+/* Estimate the 2-norm condition number of the n x n upper triangular R, from a few steps of
+	power iteration on R'*R for ||R|| and of inverse power iteration (two triangular solves per
+	step) for ||inv(R)||, at O(n^2) per step. Each estimate approaches its norm from below, but
+	unlike the ratio of the diagonal elements it finds small singular values that the diagonal
+	doesn't show. */
+template <typename T>
+T EstimateCondition(int n, const T* r, int numSteps = 5)
+{
+	// Power iteration x = M*x/||M*x||, returning the last ||M*x|| (the largest eigenvalue of M).
+	auto powerIteration = [=](const std::function<void(std::vector<T>&)> &multiply)
 	{
-		Qmat = Qmat * Plist.at(i).Transpose();
+		std::vector<T> x(n);
+		for (int i=0; i<n; ++i)
+			x[i] = ((i % 2) ? static_cast<T>(-1.0) : static_cast<T>(1.0)) * (static_cast<T>(1.0) + static_cast<T>(i) / n);
+		T lambda = static_cast<T>(0.0);
+		for (int step=0; step<numSteps; ++step)
+		{
+			T norm = static_cast<T>(0.0);
+			for (int i=0; i<n; ++i)
+				norm += x[i] * x[i];
+			norm = sqrt(norm);
+			for (int i=0; i<n; ++i)
+				x[i] /= norm;
+			multiply(x);
+			lambda = static_cast<T>(0.0);
+			for (int i=0; i<n; ++i)
+				lambda += x[i] * x[i];
+			lambda = sqrt(lambda);
+		}
+		return lambda;
+	};
+
+	// x = R'*(R*x).
+	T normSquared = powerIteration([=](std::vector<T> &x)
+	{
+		for (int i=0; i<n; ++i)
+		{
+			T sum = static_cast<T>(0.0);
+			for (int j=i; j<n; ++j)
+				sum += r[(size_t)i*n + j] * x[j];
+			x[i] = sum;
+		}
+		for (int i=n-1; i>=0; --i)
+		{
+			T sum = static_cast<T>(0.0);
+			for (int p=0; p<=i; ++p)
+				sum += r[(size_t)p*n + i] * x[p];
+			x[i] = sum;
+		}
+	});
+
+	// x = inv(R)*inv(R')*x, solving R'*y = x as y*R = x.
+	T inverseNormSquared = powerIteration([=](std::vector<T> &x)
+	{
+		SolveUpperRight(1, n, r, x.data());
+		for (int i=n-1; i>=0; --i)
+		{
+			T sum = x[i];
+			for (int j=i+1; j<n; ++j)
+				sum -= r[(size_t)i*n + j] * x[j];
+			x[i] = sum / r[(size_t)i*n + i];
+		}
+	});
+
+	return sqrt(normSquared) * sqrt(inverseNormSquared);
+}
+
+/* One CholeskyQR step on the m x n row-major matrix q, in place: R = chol(q'*q + shift*I)
+	and q = q*inv(R). Returns false (with q unchanged) if the Gram matrix is not safely positive
+	definite. */
+template <typename T>
+bool CholeskyQRStep(int m, int n, T* q, T* r, T shift)
+{
+	std::vector<T> g((size_t)n*n);
+	Gram(m, n, q, g.data());
+	for (int i=0; i<n; ++i)
+		g[(size_t)i*n + i] += shift;
+	if (!Cholesky(n, g.data(), r))
+		return false;
+	SolveUpperRight(m, n, r, q);
+	return true;
+}
+
+/* QR decomposition of the m x n row-major matrix a (m >= n) by CholeskyQR2, falling back to
+	shifted CholeskyQR3 or Householder QR as described above. Returns the method that was used
+	(QBQR_CHOLESKYQR2, QBQR_SHIFTEDCHOLESKYQR3 or QBQR_HOUSEHOLDER). */
+template <typename T>
+int CholeskyQR(int m, int n, const T* a, T* q, T* r)
+{
+	std::copy(a, a + (size_t)m*n, q);
+	std::vector<T> g((size_t)n*n), r1((size_t)n*n), r2((size_t)n*n);
+	Gram(m, n, q, g.data());
+
+	// CholeskyQR2 is safe if cond(A) is comfortably below 1/sqrt(u).
+	T maxCondition = static_cast<T>(0.01) / sqrt(std::numeric_limits<T>::epsilon());
+	if (Cholesky(n, g.data(), r1.data()))
+	{
+		if (EstimateCondition(n, r1.data()) <= maxCondition)
+		{
+			SolveUpperRight(m, n, r1.data(), q);
+			if (CholeskyQRStep(m, n, q, r2.data(), static_cast<T>(0.0)))
+			{
+				MultiplyUpper(n, r2.data(), r1.data());
+				std::copy(r1.begin(), r1.end(), r);
+				return QBQR_CHOLESKYQR2;
+			}
+			std::copy(a, a + (size_t)m*n, q);
+		}
 	}
-	
-	// Return the Q matrix.
-	Q = Qmat;
-	
-	// Compute R.
-	int numElements = Plist.size();
-	qbMatrix2<T> Rmat = Plist.at(numElements-1);
-	for (int i=(numElements-2); i>=0; --i)
+
+	// Shifted CholeskyQR3, with the shift s = 11*(m*n + n*(n+1))*u*||A||_F^2.
+	T normSquared = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+		normSquared += g[(size_t)i*n + i];
+	T shift = static_cast<T>(11.0) * (static_cast<T>(m)*n + static_cast<T>(n)*(n+1)) * std::numeric_limits<T>::epsilon() * normSquared;
+	for (int i=0; i<n; ++i)
+		g[(size_t)i*n + i] += shift;
+	if (Cholesky(n, g.data(), r1.data()))
 	{
-		Rmat = Rmat * Plist.at(i);
+		SolveUpperRight(m, n, r1.data(), q);
+		if (CholeskyQRStep(m, n, q, r2.data(), static_cast<T>(0.0)))
+		{
+			MultiplyUpper(n, r2.data(), r1.data());
+			if (CholeskyQRStep(m, n, q, r2.data(), static_cast<T>(0.0)))
+			{
+				MultiplyUpper(n, r2.data(), r1.data());
+				std::copy(r1.begin(), r1.end(), r);
+				return QBQR_SHIFTEDCHOLESKYQR3;
+			}
+		}
 	}
-	Rmat = Rmat * A;
-	
-	// And return the R matrix.
+
+	HouseholderQR(m, n, a, q, r);
+	return QBQR_HOUSEHOLDER;
+}
+
+}
+
+/* The qbQRThin function.
+	Computes the thin (economy) QR decomposition of an [m x n] matrix with m >= n, giving
+	Q with orthonormal columns [m x n] and upper-triangular R [n x n], such that A = QR.
+	Only the first n columns of Q are formed, so the full [m x m] matrix is never needed. */
+template <typename T>
+int qbQRThin(const qbMatrix2<T> &A, qbMatrix2<T> &Q, qbMatrix2<T> &R, int method = QBQR_HOUSEHOLDER)
+{
+	int numRows = A.GetNumRows();
+	int numCols = A.GetNumCols();
+	if (numRows < numCols)
+		return QBQR_MATRIXTOOWIDE;
+	if ((method != QBQR_HOUSEHOLDER) && (method != QBQR_CHOLESKYQR2))
+		return QBQR_INVALIDMETHOD;
+
+	qbMatrix2<T> Qmat(numRows, numCols);
+	qbMatrix2<T> Rmat(numCols, numCols);
+	if (method == QBQR_CHOLESKYQR2)
+		qbQRKernels::CholeskyQR(numRows, numCols, A.GetData(), Qmat.GetData(), Rmat.GetData());
+	else
+		qbQRKernels::HouseholderQR(numRows, numCols, A.GetData(), Qmat.GetData(), Rmat.GetData());
+	Rmat.SetProperties(QBMATRIX_UPPERTRIANGULAR);
+
+	Q = Qmat;
 	R = Rmat;
-	
+	return 1;
+}
+
+// The qbQR function.
+template <typename T>
+int qbQR(const qbMatrix2<T> &A, qbMatrix2<T> &Q, qbMatrix2<T> &R, int method = QBQR_HOUSEHOLDER)
+{
+	// Verify that the input matrix is square.
+	if (!A.IsSquare())
+		return QBQR_MATRIXNOTSQUARE;
+
+	// For a square matrix the thin and full decompositions are the same.
+	return qbQRThin(A, Q, R, method);
 }
 
 #endif
@@ -0,0 +1,431 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBQRCP_H
+#define QBQRCP_H
+
+/* *************************************************************************************************
+
+	qbQRCP
+
+	Function to compute the QR decomposition with column pivoting, A*P = Q*R, of an [m x n]
+	matrix.
+
+	*** INPUTS ***
+
+	A					qbMatrix2<T>	The matrix to decompose.
+	Q					qbMatrix2<T>	The output [m x k] Q matrix, with k = min(m, n).
+	R					qbMatrix2<T>	The output [k x n] upper triangular R matrix.
+	columnOrder	std::vector<int>	The output permutation: column j of A*P is column
+													columnOrder[j] of A.
+	method		INT						(Optional) The method to use, QBQRCP_QP3 (the default) or
+													QBQRCP_RANDOMIZED.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates failure due to an unknown method.
+
+	At each step the column with the largest remaining norm is moved to the front, so the
+	magnitudes of the diagonal elements of R decrease, and a sharp drop reveals the numerical
+	rank of A (with the first columns of A*P a well conditioned subset of the columns of A).
+
+	QBQRCP_QP3 is the blocked algorithm of Quintana-Orti, Sun and Bischof (1998), as in LAPACK's
+	dgeqp3. Choosing a pivot needs the norms of the trailing columns after every reflector, but
+	recomputing them would cost O(mn^2) extra operations. Instead, each norm is downdated from
+	the element that moves into R, |a(j)|^2 = |a(j)|^2 - r(k,j)^2, in O(1). The downdate loses
+	accuracy when most of the norm is removed, so it is tracked against the norm when it was last
+	computed, and once the ratio of the two falls below sqrt(eps) the norm is recomputed (Drmac
+	and Bujanovic, 2008). Within a panel of BLOCK_SIZE columns the trailing matrix is not updated;
+	only the current column and the current row are formed, from an accumulated matrix F, and
+	the rest of the matrix is updated with one matrix-matrix product at the end of the panel (or
+	earlier, when a norm has to be recomputed). Half of the work is still in matrix-vector
+	products, since F needs one pass over the trailing matrix per column.
+
+	QBQRCP_RANDOMIZED chooses the pivots from a sketch instead (HQRRP, Martinsson, Quintana-Orti,
+	Heavner and van de Geijn, SIAM J. Sci. Comput. 39(2), 2017). The trailing matrix is
+	multiplied by a Gaussian matrix with BLOCK_SIZE + OVERSAMPLING rows, and QP3 on this small
+	sketch chooses the next BLOCK_SIZE pivots, which are all moved to the front together. The
+	panel is then factorized without pivoting and applied to the rest of the matrix as a block
+	reflector, and the sketch is downdated with a small matrix product rather than recomputed.
+	Almost all of the work is then in matrix-matrix products. The pivots are not the same as
+	those of QP3, but they reveal the rank just as well in practice.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "qbMatrix.h"
+#include "qbHouseholder.h"
+#include "qbParallel.h"
+#include "qbRandom.h"
+
+// Define error codes.
+constexpr int QBQRCP_INVALIDMETHOD = -1;
+
+// Define the methods.
+constexpr int QBQRCP_QP3 = 1;
+constexpr int QBQRCP_RANDOMIZED = 2;
+
+namespace qbQRCPKernels
+{
+
+// Number of columns in each panel.
+constexpr int BLOCK_SIZE = 32;
+
+// Extra rows in the sketch for the randomized method.
+constexpr int OVERSAMPLING = 8;
+
+// Seed for the sketching matrices, so that the factorization is repeatable.
+constexpr uint64_t SKETCH_SEED = 20170101;
+
+// Norm of the column j of the row-major matrix a, from row r0 to m-1.
+template <typename T>
+T ColumnNorm(int r0, int m, const T* a, int lda, int j)
+{
+	T sum = static_cast<T>(0.0);
+	for (int r=r0; r<m; ++r)
+		sum += a[(size_t)r*lda + j] * a[(size_t)r*lda + j];
+	return sqrt(sum);
+}
+
+/* Reorder the n columns of the m x n row-major matrix a, so that column c is the old column
+	perm[c]. The rows are split across threads when there are at least 1 << 16 elements per thread. */
+template <typename T>
+void PermuteColumns(int m, int n, T* a, int lda, const std::vector<int> &perm)
+{
+	qbParallelFor(m, std::max(1, (1 << 16) / std::max(n, 1)), [&](size_t first, size_t last)
+	{
+		std::vector<T> row(n);
+		for (size_t r=first; r<last; ++r)
+		{
+			T* aRow = a + r*lda;
+			for (int c=0; c<n; ++c)
+				row[c] = aRow[perm[c]];
+			std::copy(row.begin(), row.end(), aRow);
+		}
+	});
+}
+
+/* One panel of QP3 on the m x n row-major matrix a, starting at row and column j0 and taking
+	at most maxSteps steps (as LAPACK's dlaqps). vn1 holds the downdated norms of the trailing
+	columns and vn2 the norms when they were last computed. Returns the number of steps taken,
+	which is less than maxSteps if a norm had to be recomputed. */
+template <typename T>
+int PanelQP3(int m, int n, int j0, int maxSteps, T* a, int lda, int* jpvt, T* tau, std::vector<T> &vn1, std::vector<T> &vn2)
+{
+	const T tol3z = sqrt(std::numeric_limits<T>::epsilon());
+	int nb = maxSteps;
+
+	// Row c of F (c >= j0) holds the corrections to column c: A(:, c) -= V*F(c, :)'.
+	std::vector<T> F((size_t)n*nb, static_cast<T>(0.0)), v(m), auxv(nb);
+	std::vector<int> recompute;
+	int k = 0;
+	while ((k < maxSteps) && recompute.empty())
+	{
+		int p = j0 + k;
+
+		// Move the column with the largest remaining norm to position p.
+		int pvt = p + static_cast<int>(std::max_element(vn1.begin() + p, vn1.end()) - (vn1.begin() + p));
+		if (pvt != p)
+		{
+			for (int r=0; r<m; ++r)
+				std::swap(a[(size_t)r*lda + p], a[(size_t)r*lda + pvt]);
+			for (int q=0; q<k; ++q)
+				std::swap(F[(size_t)p*nb + q], F[(size_t)pvt*nb + q]);
+			std::swap(jpvt[p], jpvt[pvt]);
+			vn1[pvt] = vn1[p];
+			vn2[pvt] = vn2[p];
+		}
+
+		// Apply the earlier reflectors of the panel to column p: A(p:m, p) -= V(p:m, :)*F(p, :)'.
+		if (k > 0)
+		{
+			const T* fRow = F.data() + (size_t)p*nb;
+			for (int r=p; r<m; ++r)
+			{
+				const T* vRow = a + (size_t)r*lda + j0;
+				T sum = static_cast<T>(0.0);
+				for (int q=0; q<k; ++q)
+					sum += vRow[q] * fRow[q];
+				a[(size_t)r*lda + p] -= sum;
+			}
+		}
+
+		// Generate the reflector, and keep it below the diagonal (with the unit element in place for now).
+		tau[p] = qbHouseholderKernels::MakeReflector(m - p, a + (size_t)p*lda + p, lda, v.data());
+		for (int i=1; i<m-p; ++i)
+			a[(size_t)(p+i)*lda + p] = v[i];
+		T akk = a[(size_t)p*lda + p];
+		a[(size_t)p*lda + p] = static_cast<T>(1.0);
+
+		/* F(p+1:n, k) = tau * A(p:m, p+1:n)' * v, with the columns split across threads once there
+			are at least 1 << 16 multiply-adds per thread (this runs once per step). */
+		int numTrailing = n - p - 1;
+		qbParallelFor(numTrailing, std::max(1, (1 << 16) / std::max(m - p, 1)), [&](size_t first, size_t last)
+		{
+			for (size_t c=first; c<last; ++c)
+				F[(size_t)(p+1+c)*nb + k] = static_cast<T>(0.0);
+			for (int r=p; r<m; ++r)
+			{
+				T vr = a[(size_t)r*lda + p];
+				if (vr == static_cast<T>(0.0))
+					continue;
+				const T* aRow = a + (size_t)r*lda + p + 1;
+				for (size_t c=first; c<last; ++c)
+					F[(size_t)(p+1+c)*nb + k] += vr * aRow[c];
+			}
+			for (size_t c=first; c<last; ++c)
+				F[(size_t)(p+1+c)*nb + k] *= tau[p];
+		});
+		for (int c=j0; c<=p; ++c)
+			F[(size_t)c*nb + k] = static_cast<T>(0.0);
+
+		// Account for the earlier reflectors: F(:, k) -= tau * F(:, 0:k) * (V(p:m, 0:k)' * v).
+		if (k > 0)
+		{
+			std::fill(auxv.begin(), auxv.begin() + k, static_cast<T>(0.0));
+			for (int r=p; r<m; ++r)
+			{
+				const T* vRow = a + (size_t)r*lda + j0;
+				for (int q=0; q<k; ++q)
+					auxv[q] += vRow[q] * vRow[k];
+			}
+			for (int q=0; q<k; ++q)
+				auxv[q] *= -tau[p];
+			for (int c=j0; c<n; ++c)
+			{
+				T* fRow = F.data() + (size_t)c*nb;
+				T sum = static_cast<T>(0.0);
+				for (int q=0; q<k; ++q)
+					sum += fRow[q] * auxv[q];
+				fRow[k] += sum;
+			}
+		}
+
+		// Form row p of R: A(p, p+1:n) -= V(p, 0:k+1) * F(p+1:n, 0:k+1)'.
+		const T* vRow = a + (size_t)p*lda + j0;
+		T* aRow = a + (size_t)p*lda;
+		for (int c=p+1; c<n; ++c)
+		{
+			const T* fRow = F.data() + (size_t)c*nb;
+			T sum = static_cast<T>(0.0);
+			for (int q=0; q<=k; ++q)
+				sum += vRow[q] * fRow[q];
+			aRow[c] -= sum;
+		}
+
+		// Downdate the norms of the trailing columns, and note any that have lost too much accuracy.
+		for (int c=p+1; c<n; ++c)
+		{
+			if (vn1[c] == static_cast<T>(0.0))
+				continue;
+			T temp = fabs(aRow[c]) / vn1[c];
+			temp = std::max(static_cast<T>(0.0), (static_cast<T>(1.0) + temp) * (static_cast<T>(1.0) - temp));
+			T ratio = vn1[c] / vn2[c];
+			if (temp * ratio * ratio <= tol3z)
+				recompute.push_back(c);
+			else
+				vn1[c] *= sqrt(temp);
+		}
+
+		a[(size_t)p*lda + p] = akk;
+		++k;
+	}
+
+	// Update the trailing matrix with the whole panel: A(rk:m, rk:n) -= V(rk:m, :) * F(rk:n, :)'.
+	int rk = j0 + k;
+	if ((rk < m) && (rk < n))
+	{
+		int numCols = n - rk;
+		std::vector<T> Ft((size_t)k*numCols);
+		for (int c=0; c<numCols; ++c)
+		{
+			for (int q=0; q<k; ++q)
+				Ft[(size_t)q*numCols + c] = -F[(size_t)(rk+c)*nb + q];
+		}
+		qbHouseholderKernels::ParallelGEMM(m - rk, numCols, k, a + (size_t)rk*lda + j0, lda, Ft.data(), numCols, a + (size_t)rk*lda + rk, lda, true);
+	}
+
+	// Recompute the norms that could not be downdated accurately.
+	for (int c : recompute)
+	{
+		vn1[c] = ColumnNorm(rk, m, a, lda, c);
+		vn2[c] = vn1[c];
+	}
+
+	return k;
+}
+
+/* QR factorization with column pivoting (QP3) of the m x n row-major matrix a, in place, for
+	the steps firstStep to lastStep-1 (firstStep = 0 and lastStep = min(m, n) for the full
+	factorization). The columns are swapped in full, and jpvt is permuted in the same way. On
+	return R is in the upper triangle and the reflectors are stored below the diagonal, as for
+	qbHouseholderKernels::QRFactor. */
+template <typename T>
+void QP3(int m, int n, T* a, int lda, int* jpvt, T* tau, int firstStep, int lastStep)
+{
+	// The norms of the trailing columns, in one pass over the rows.
+	std::vector<T> vn1(n, static_cast<T>(0.0)), vn2(n);
+	for (int r=firstStep; r<m; ++r)
+	{
+		const T* aRow = a + (size_t)r*lda;
+		for (int c=firstStep; c<n; ++c)
+			vn1[c] += aRow[c] * aRow[c];
+	}
+	for (int c=firstStep; c<n; ++c)
+	{
+		vn1[c] = sqrt(vn1[c]);
+		vn2[c] = vn1[c];
+	}
+
+	int j = firstStep;
+	while (j < lastStep)
+		j += PanelQP3(m, n, j, std::min(BLOCK_SIZE, lastStep - j), a, lda, jpvt, tau, vn1, vn2);
+}
+
+/* Randomized QR factorization with column pivoting (HQRRP) of the m x n row-major matrix a, in
+	place, with the same output as QP3 for the full factorization. */
+template <typename T>
+void RandomizedQRCP(int m, int n, T* a, int lda, int* jpvt, T* tau)
+{
+	int k = std::min(m, n);
+	int nb = BLOCK_SIZE;
+	int numSketchRows = BLOCK_SIZE + OVERSAMPLING;
+	qbRandom generator(SKETCH_SEED);
+
+	std::vector<T> Y;
+	bool needSketch = true;
+	int j = 0;
+	while (j < k)
+	{
+		// The last panel (or a matrix too small to sketch) is finished with QP3.
+		if ((k - j <= nb) || (m - j <= numSketchRows))
+		{
+			QP3(m, n, a, lda, jpvt, tau, j, k);
+			break;
+		}
+
+		int numCols = n - j;
+		T* panel = a + (size_t)j*lda + j;
+
+		// Y = G * A(j:m, j:n), for a Gaussian matrix G.
+		if (needSketch)
+		{
+			std::vector<T> G((size_t)numSketchRows*(m-j));
+			generator.FillGaussian(G.data(), G.size(), static_cast<T>(0.0), static_cast<T>(1.0));
+			Y.assign((size_t)numSketchRows*numCols, static_cast<T>(0.0));
+			qbHouseholderKernels::ParallelGEMM(numSketchRows, numCols, m - j, G.data(), m - j, panel, lda, Y.data(), numCols);
+		}
+
+		// Choose the next nb pivots with QP3 on a copy of the sketch.
+		std::vector<T> Ywork(Y), tauY(nb);
+		std::vector<int> local(numCols);
+		std::iota(local.begin(), local.end(), 0);
+		QP3(numSketchRows, numCols, Ywork.data(), numCols, local.data(), tauY.data(), 0, nb);
+
+		// Move the chosen columns to the front, in every row of A and in the sketch.
+		PermuteColumns(m, numCols, a + j, lda, local);
+		PermuteColumns(numSketchRows, numCols, Y.data(), numCols, local);
+		std::vector<int> order(jpvt + j, jpvt + n);
+		for (int c=0; c<numCols; ++c)
+			jpvt[j + c] = order[local[c]];
+
+		// Factorize the panel without pivoting, and apply it to the trailing columns as a block reflector.
+		qbHouseholderKernels::QRFactor(m - j, nb, panel, lda, tau + j);
+		qbHouseholderKernels::ApplyQ(m - j, numCols - nb, nb, panel, lda, tau + j, true, panel + nb, lda);
+
+		/* Downdate the sketch of the trailing matrix: Y2 = Y2 - Y1 * inv(R11) * R12. If R11 is
+			close to singular, the trailing matrix is sketched again instead. */
+		T maxDiag = static_cast<T>(0.0), minDiag = std::numeric_limits<T>::max();
+		for (int i=0; i<nb; ++i)
+		{
+			maxDiag = std::max(maxDiag, static_cast<T>(fabs(panel[(size_t)i*lda + i])));
+			minDiag = std::min(minDiag, static_cast<T>(fabs(panel[(size_t)i*lda + i])));
+		}
+		needSketch = !(minDiag > sqrt(std::numeric_limits<T>::epsilon()) * maxDiag);
+		if (!needSketch)
+		{
+			// W = -Y1 * inv(R11), one row at a time.
+			std::vector<T> W((size_t)numSketchRows*nb);
+			for (int r=0; r<numSketchRows; ++r)
+			{
+				const T* yRow = Y.data() + (size_t)r*numCols;
+				T* wRow = W.data() + (size_t)r*nb;
+				for (int c=0; c<nb; ++c)
+				{
+					T sum = yRow[c];
+					for (int q=0; q<c; ++q)
+						sum -= wRow[q] * panel[(size_t)q*lda + c];
+					wRow[c] = sum / panel[(size_t)c*lda + c];
+				}
+				for (int c=0; c<nb; ++c)
+					wRow[c] = -wRow[c];
+			}
+			qbHouseholderKernels::ParallelGEMM(numSketchRows, numCols - nb, nb, W.data(), nb, panel + nb, lda, Y.data() + nb, numCols, true);
+
+			std::vector<T> next((size_t)numSketchRows*(numCols - nb));
+			for (int r=0; r<numSketchRows; ++r)
+				std::copy(Y.begin() + (size_t)r*numCols + nb, Y.begin() + (size_t)(r+1)*numCols, next.begin() + (size_t)r*(numCols - nb));
+			Y.swap(next);
+		}
+
+		j += nb;
+	}
+}
+
+}
+
+// The qbQRCP function.
+template <typename T>
+int qbQRCP(const qbMatrix2<T> &A, qbMatrix2<T> &Q, qbMatrix2<T> &R, std::vector<int> &columnOrder, int method = QBQRCP_QP3)
+{
+	if ((method != QBQRCP_QP3) && (method != QBQRCP_RANDOMIZED))
+		return QBQRCP_INVALIDMETHOD;
+
+	int numRows = A.GetNumRows();
+	int numCols = A.GetNumCols();
+	int k = std::min(numRows, numCols);
+
+	qbMatrix2<T> work = A;
+	T* a = work.GetData();
+	std::vector<T> tau(k);
+	columnOrder.resize(numCols);
+	std::iota(columnOrder.begin(), columnOrder.end(), 0);
+
+	if (method == QBQRCP_QP3)
+		qbQRCPKernels::QP3(numRows, numCols, a, numCols, columnOrder.data(), tau.data(), 0, k);
+	else
+		qbQRCPKernels::RandomizedQRCP(numRows, numCols, a, numCols, columnOrder.data(), tau.data());
+
+	// Extract R from the upper triangle, and form the first k columns of Q from the reflectors.
+	qbMatrix2<T> Rmat(k, numCols);
+	T* r = Rmat.GetData();
+	for (int i=0; i<k; ++i)
+		std::copy(a + (size_t)i*numCols + i, a + (size_t)(i+1)*numCols, r + (size_t)i*numCols + i);
+
+	qbMatrix2<T> Qmat(numRows, k);
+	qbHouseholderKernels::FormQ(numRows, k, k, a, numCols, tau.data(), Qmat.GetData(), k);
+	Rmat.SetProperties(QBMATRIX_UPPERTRIANGULAR);
+
+	Q = Qmat;
+	R = Rmat;
+	return 1;
+}
+
+#endif
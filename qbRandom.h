@@ -0,0 +1,300 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBRANDOM_H
+#define QBRANDOM_H
+
+/* *************************************************************************************************
+
+	qbRandom
+
+	Class to provide seedable, reproducible random number generation for filling matrices and
+	vectors, for example for random start vectors, sketching and randomized SVD.
+
+	Uses the Philox4x32-10 counter-based generator (Salmon et al., "Parallel random numbers: as
+	easy as 1, 2, 3", SC11). Each call to the generator maps a 128-bit counter and a 64-bit key
+	(the seed) to four independent 32-bit random words. Since there is no sequential state, any
+	element of a fill can be computed independently of all the others: element i of a fill always
+	comes from the same counter value, whether the fill is done by one thread or many. Results
+	therefore depend only on the seed, the stream and the sequence of fills, never on the number
+	of threads used.
+
+	Different streams with the same seed give independent sequences, which is useful when
+	several objects (or threads) each need their own generator.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "qbMatrix.h"
+#include "qbVector.h"
+#include "qbParallel.h"
+
+// The seed used when none is given.
+constexpr uint64_t QBRANDOM_DEFAULTSEED = 0x5EED5EED5EED5EEDULL;
+
+class qbRandom {
+public:
+	// Define the various constructors.
+	qbRandom();
+	qbRandom(uint64_t seed, uint64_t stream = 0);
+
+	// Configuration methods.
+	void SetSeed(uint64_t seed, uint64_t stream = 0);
+	uint64_t GetCounter() const;
+	void SetCounter(uint64_t counter);
+
+	// Fill raw data.
+	template <class T> void FillUniform(T* data, size_t numElements, T lower, T upper);
+	template <class T> void FillGaussian(T* data, size_t numElements, T mean, T stdDev);
+	template <class T> void FillRademacher(T* data, size_t numElements);
+
+	// Fill matrices.
+	template <class T> void FillUniform(qbMatrix2<T>& matrix, T lower = 0.0, T upper = 1.0);
+	template <class T> void FillGaussian(qbMatrix2<T>& matrix, T mean = 0.0, T stdDev = 1.0);
+	template <class T> void FillRademacher(qbMatrix2<T>& matrix);
+
+	// Fill vectors.
+	template <class T> void FillUniform(qbVector<T>& vector, T lower = 0.0, T upper = 1.0);
+	template <class T> void FillGaussian(qbVector<T>& vector, T mean = 0.0, T stdDev = 1.0);
+	template <class T> void FillRademacher(qbVector<T>& vector);
+
+	// Draw single values.
+	double Uniform();
+	double Gaussian();
+
+	// The Philox4x32-10 block function.
+	static void Philox(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]);
+
+private:
+	void Block(uint64_t blockIndex, uint32_t output[4]) const;
+	template <class F> void ParallelBlocks(uint64_t numBlocks, F blockFunction);
+
+private:
+	uint32_t m_key[2];
+	uint32_t m_stream[2];
+	uint64_t m_counter;
+};
+
+/* **************************************************************************************************
+CONSTRUCTOR FUNCTIONS
+/* *************************************************************************************************/
+inline qbRandom::qbRandom() {
+	SetSeed(QBRANDOM_DEFAULTSEED, 0);
+}
+
+inline qbRandom::qbRandom(uint64_t seed, uint64_t stream) {
+	SetSeed(seed, stream);
+}
+
+/* **************************************************************************************************
+CONFIGURATION FUNCTIONS
+/* *************************************************************************************************/
+inline void qbRandom::SetSeed(uint64_t seed, uint64_t stream) {
+	m_key[0] = static_cast<uint32_t>(seed);
+	m_key[1] = static_cast<uint32_t>(seed >> 32);
+	m_stream[0] = static_cast<uint32_t>(stream);
+	m_stream[1] = static_cast<uint32_t>(stream >> 32);
+	m_counter = 0;
+}
+
+inline uint64_t qbRandom::GetCounter() const {
+	return m_counter;
+}
+
+inline void qbRandom::SetCounter(uint64_t counter) {
+	m_counter = counter;
+}
+
+/* **************************************************************************************************
+THE PHILOX4x32-10 BLOCK FUNCTION
+/* *************************************************************************************************/
+inline void qbRandom::Philox(const uint32_t counter[4], const uint32_t key[2], uint32_t output[4]) {
+	const uint32_t M0 = 0xD2511F53;
+	const uint32_t M1 = 0xCD9E8D57;
+	const uint32_t W0 = 0x9E3779B9;
+	const uint32_t W1 = 0xBB67AE85;
+
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+	for(int round = 0; round < 10; ++round) {
+		uint64_t product0 = static_cast<uint64_t>(M0) * c0;
+		uint64_t product1 = static_cast<uint64_t>(M1) * c2;
+		uint32_t hi0 = static_cast<uint32_t>(product0 >> 32), lo0 = static_cast<uint32_t>(product0);
+		uint32_t hi1 = static_cast<uint32_t>(product1 >> 32), lo1 = static_cast<uint32_t>(product1);
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+		k0 += W0;
+		k1 += W1;
+	}
+	output[0] = c0;
+	output[1] = c1;
+	output[2] = c2;
+	output[3] = c3;
+}
+
+// Compute the block for the given counter value (the stream forms the upper 64 bits).
+inline void qbRandom::Block(uint64_t blockIndex, uint32_t output[4]) const {
+	uint32_t counter[4] = {static_cast<uint32_t>(blockIndex), static_cast<uint32_t>(blockIndex >> 32), m_stream[0], m_stream[1]};
+	Philox(counter, m_key, output);
+}
+
+/* Call blockFunction(firstBlock, lastBlock) over the range [0, numBlocks), split across
+	threads for large fills. Since each block depends only on its counter value, the
+	result is the same however the range is split. */
+template <class F>
+void qbRandom::ParallelBlocks(uint64_t numBlocks, F blockFunction) {
+	const uint64_t minBlocksPerThread = 16384;
+	qbParallelFor(numBlocks, minBlocksPerThread, [&](size_t first, size_t last) {
+		blockFunction(static_cast<uint64_t>(first), static_cast<uint64_t>(last));
+	});
+}
+
+/* **************************************************************************************************
+FUNCTIONS TO FILL RAW DATA
+/* *************************************************************************************************/
+/* Uniform values in [lower, upper). Each block gives two 53-bit uniforms, so element i
+	comes from block (counter + i/2). */
+template <class T>
+void qbRandom::FillUniform(T* data, size_t numElements, T lower, T upper) {
+	const double scale = 1.0 / 9007199254740992.0;
+	const double range = static_cast<double>(upper) - static_cast<double>(lower);
+	uint64_t base = m_counter;
+	uint64_t numBlocks = (numElements + 1) / 2;
+
+	ParallelBlocks(numBlocks, [&](uint64_t first, uint64_t last) {
+		uint32_t r[4];
+		for(uint64_t b = first; b < last; ++b) {
+			Block(base + b, r);
+			uint64_t u0 = ((static_cast<uint64_t>(r[0]) << 32) | r[1]) >> 11;
+			uint64_t u1 = ((static_cast<uint64_t>(r[2]) << 32) | r[3]) >> 11;
+			size_t i = 2 * b;
+			data[i] = static_cast<T>(static_cast<double>(lower) + range * (static_cast<double>(u0) * scale));
+			if(i + 1 < numElements)
+				data[i + 1] = static_cast<T>(static_cast<double>(lower) + range * (static_cast<double>(u1) * scale));
+		}
+	});
+
+	m_counter += numBlocks;
+}
+
+/* Gaussian values with the given mean and standard deviation, using the Box-Muller
+	transform on the two uniforms from each block. */
+template <class T>
+void qbRandom::FillGaussian(T* data, size_t numElements, T mean, T stdDev) {
+	const double scale = 1.0 / 9007199254740992.0;
+	const double twoPi = 6.283185307179586476925;
+	uint64_t base = m_counter;
+	uint64_t numBlocks = (numElements + 1) / 2;
+
+	ParallelBlocks(numBlocks, [&](uint64_t first, uint64_t last) {
+		uint32_t r[4];
+		for(uint64_t b = first; b < last; ++b) {
+			Block(base + b, r);
+			// u0 is in (0, 1] so that the logarithm is finite.
+			double u0 = (static_cast<double>(((static_cast<uint64_t>(r[0]) << 32) | r[1]) >> 11) + 1.0) * scale;
+			double u1 = static_cast<double>(((static_cast<uint64_t>(r[2]) << 32) | r[3]) >> 11) * scale;
+			double radius = sqrt(-2.0 * log(u0));
+			size_t i = 2 * b;
+			data[i] = static_cast<T>(static_cast<double>(mean) + static_cast<double>(stdDev) * radius * cos(twoPi * u1));
+			if(i + 1 < numElements)
+				data[i + 1] = static_cast<T>(static_cast<double>(mean) + static_cast<double>(stdDev) * radius * sin(twoPi * u1));
+		}
+	});
+
+	m_counter += numBlocks;
+}
+
+/* Rademacher values (+1 or -1 with equal probability). Each block gives 128 random
+	bits, so element i comes from bit (i % 128) of block (counter + i/128). */
+template <class T>
+void qbRandom::FillRademacher(T* data, size_t numElements) {
+	uint64_t base = m_counter;
+	uint64_t numBlocks = (numElements + 127) / 128;
+
+	ParallelBlocks(numBlocks, [&](uint64_t first, uint64_t last) {
+		uint32_t r[4];
+		for(uint64_t b = first; b < last; ++b) {
+			Block(base + b, r);
+			size_t start = 128 * b;
+			size_t count = std::min(static_cast<size_t>(128), numElements - start);
+			for(size_t k = 0; k < count; ++k) {
+				uint32_t bit = (r[k >> 5] >> (k & 31)) & 1u;
+				data[start + k] = bit ? static_cast<T>(1.0) : static_cast<T>(-1.0);
+			}
+		}
+	});
+
+	m_counter += numBlocks;
+}
+
+/* **************************************************************************************************
+FUNCTIONS TO FILL MATRICES AND VECTORS
+/* *************************************************************************************************/
+template <class T>
+void qbRandom::FillUniform(qbMatrix2<T>& matrix, T lower, T upper) {
+	FillUniform(matrix.GetData(), static_cast<size_t>(matrix.GetNumRows()) * matrix.GetNumCols(), lower, upper);
+}
+
+template <class T>
+void qbRandom::FillGaussian(qbMatrix2<T>& matrix, T mean, T stdDev) {
+	FillGaussian(matrix.GetData(), static_cast<size_t>(matrix.GetNumRows()) * matrix.GetNumCols(), mean, stdDev);
+}
+
+template <class T>
+void qbRandom::FillRademacher(qbMatrix2<T>& matrix) {
+	FillRademacher(matrix.GetData(), static_cast<size_t>(matrix.GetNumRows()) * matrix.GetNumCols());
+}
+
+template <class T>
+void qbRandom::FillUniform(qbVector<T>& vector, T lower, T upper) {
+	std::vector<T> values(vector.GetNumDims());
+	FillUniform(values.data(), values.size(), lower, upper);
+	vector = qbVector<T>(values);
+}
+
+template <class T>
+void qbRandom::FillGaussian(qbVector<T>& vector, T mean, T stdDev) {
+	std::vector<T> values(vector.GetNumDims());
+	FillGaussian(values.data(), values.size(), mean, stdDev);
+	vector = qbVector<T>(values);
+}
+
+template <class T>
+void qbRandom::FillRademacher(qbVector<T>& vector) {
+	std::vector<T> values(vector.GetNumDims());
+	FillRademacher(values.data(), values.size());
+	vector = qbVector<T>(values);
+}
+
+/* **************************************************************************************************
+FUNCTIONS TO DRAW SINGLE VALUES
+/* *************************************************************************************************/
+inline double qbRandom::Uniform() {
+	double value;
+	FillUniform(&value, 1, 0.0, 1.0);
+	return value;
+}
+
+inline double qbRandom::Gaussian() {
+	double value;
+	FillGaussian(&value, 1, 0.0, 1.0);
+	return value;
+}
+
+#endif
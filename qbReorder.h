@@ -0,0 +1,710 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBREORDER_H
+#define QBREORDER_H
+
+/* *************************************************************************************************
+
+	qbReorder
+
+	Functions to compute and apply orderings (permutations) of the rows and columns of sparse
+	matrices. The order of the unknowns makes no difference to the solution of A*x = b, but it
+	makes a large difference to performance:
+
+	qbReorderRCM	Reverse Cuthill-McKee ordering. A breadth first search from a pseudo-peripheral
+					vertex of the graph of A, visiting neighbours in order of increasing degree,
+					then reversed. This clusters the non-zeros near the diagonal (reduces the
+					bandwidth), so the entries of x used by neighbouring rows of a sparse matrix-
+					vector product are close together in memory, and factorizations produce less
+					fill-in.
+
+	qbPartitionGraph	Multilevel k-way graph partitioning (in the style of METIS, Karypis and
+					Kumar 1998). The graph is repeatedly coarsened by heavy edge matching, the
+					small coarse graph is partitioned by greedy graph growing, and the partition is
+					projected back and refined at each level by moving boundary vertices to reduce
+					the number of cut edges, subject to a balance constraint. Splitting the rows of
+					a matrix into balanced parts with few cut edges means that each thread (or NUMA
+					node) mostly touches its own part of x. qbPartitionPermutation converts the
+					result into an ordering that makes each part a contiguous block of rows.
+
+	A permutation is stored as a vector perm with perm[newIndex] = oldIndex, so the permuted
+	matrix is B(i, j) = A(perm[i], perm[j]) and the permuted vector is y[i] = x[perm[i]]. To solve
+	A*x = b with a reordered matrix, permute b, solve with B, and inverse permute the result.
+	The permuted copies are done in parallel.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates that the matrix is not square.
+						-2 indicates that the permutation is not valid.
+						-3 indicates an invalid number of parts.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "qbVector.h"
+#include "qbSparse.h"
+#include "qbParallel.h"
+#include "qbRandom.h"
+
+// Define error codes.
+constexpr int QBREORDER_MATRIXNOTSQUARE = -1;
+constexpr int QBREORDER_INVALIDPERMUTATION = -2;
+constexpr int QBREORDER_INVALIDNUMPARTS = -3;
+
+namespace qbReorderKernels
+{
+
+// An undirected graph in adjacency (CSR) form, with vertex and edge weights.
+struct Graph
+{
+	int numVertices;
+	std::vector<int> ptr;
+	std::vector<int> adjacent;
+	std::vector<int> edgeWeight;
+	std::vector<int> vertexWeight;
+};
+
+// Build the graph of the structure of A + A' (without self loops), with unit weights.
+template <typename T>
+Graph BuildGraph(const qbSparseMatrix<T> &A)
+{
+	int n = A.GetNumRows();
+	qbSparseMatrix<T> At = A.Transpose();
+	const std::vector<int> &aPtr = A.GetRowPtr();
+	const std::vector<int> &aCol = A.GetColIndex();
+	const std::vector<int> &tPtr = At.GetRowPtr();
+	const std::vector<int> &tCol = At.GetColIndex();
+
+	Graph graph;
+	graph.numVertices = n;
+	graph.ptr.assign(n + 1, 0);
+	graph.adjacent.reserve(2 * aCol.size());
+	for (int i=0; i<n; ++i)
+	{
+		// Merge the (sorted) rows i of A and A'.
+		int ka = aPtr[i], kt = tPtr[i];
+		while ((ka < aPtr[i+1]) || (kt < tPtr[i+1]))
+		{
+			int j;
+			if ((kt >= tPtr[i+1]) || ((ka < aPtr[i+1]) && (aCol[ka] < tCol[kt])))
+				j = aCol[ka++];
+			else if ((ka >= aPtr[i+1]) || (tCol[kt] < aCol[ka]))
+				j = tCol[kt++];
+			else
+			{
+				j = aCol[ka++];
+				kt++;
+			}
+			if (j != i)
+				graph.adjacent.push_back(j);
+		}
+		graph.ptr[i+1] = graph.adjacent.size();
+	}
+	graph.edgeWeight.assign(graph.adjacent.size(), 1);
+	graph.vertexWeight.assign(n, 1);
+	return graph;
+}
+
+// Check that perm is a permutation of 0 to n-1.
+inline bool IsPermutation(const std::vector<int> &perm, int n)
+{
+	if (static_cast<int>(perm.size()) != n)
+		return false;
+	std::vector<bool> seen(n, false);
+	for (int p : perm)
+	{
+		if ((p < 0) || (p >= n) || seen[p])
+			return false;
+		seen[p] = true;
+	}
+	return true;
+}
+
+// Compute the inverse permutation.
+inline std::vector<int> InversePermutation(const std::vector<int> &perm)
+{
+	std::vector<int> inverse(perm.size());
+	for (size_t i=0; i<perm.size(); ++i)
+		inverse[perm[i]] = i;
+	return inverse;
+}
+
+/* Breadth first search from root, returning the vertices in the order visited and
+	the start of each level in that list. level[] must be -1 for all vertices on entry,
+	and is restored to -1 on exit. */
+inline void BreadthFirstLevels(const Graph &graph, int root, std::vector<int> &level,
+	std::vector<int> &order, std::vector<int> &levelStart)
+{
+	order.clear();
+	levelStart.clear();
+	order.push_back(root);
+	level[root] = 0;
+	size_t head = 0;
+	int currentLevel = -1;
+	while (head < order.size())
+	{
+		int v = order[head];
+		if (level[v] != currentLevel)
+		{
+			currentLevel = level[v];
+			levelStart.push_back(head);
+		}
+		head++;
+		for (int k=graph.ptr[v]; k<graph.ptr[v+1]; ++k)
+		{
+			int w = graph.adjacent[k];
+			if (level[w] < 0)
+			{
+				level[w] = level[v] + 1;
+				order.push_back(w);
+			}
+		}
+	}
+	levelStart.push_back(order.size());
+	for (int v : order)
+		level[v] = -1;
+}
+
+/* Find a pseudo-peripheral vertex (one at the end of a long path through the graph)
+	in the component containing start, with the algorithm of Gibbs, Poole and Stockmeyer
+	as modified by George and Liu. */
+inline int PseudoPeripheral(const Graph &graph, int start, std::vector<int> &level)
+{
+	std::vector<int> order, levelStart;
+	int root = start;
+	BreadthFirstLevels(graph, root, level, order, levelStart);
+	int eccentricity = levelStart.size() - 2;
+	while (true)
+	{
+		// Try the vertex of smallest degree in the last level.
+		int candidate = -1;
+		int minDegree = graph.numVertices + 1;
+		for (int k=levelStart[levelStart.size()-2]; k<levelStart.back(); ++k)
+		{
+			int v = order[k];
+			int degree = graph.ptr[v+1] - graph.ptr[v];
+			if (degree < minDegree)
+			{
+				minDegree = degree;
+				candidate = v;
+			}
+		}
+		BreadthFirstLevels(graph, candidate, level, order, levelStart);
+		int candidateEccentricity = levelStart.size() - 2;
+		if (candidateEccentricity <= eccentricity)
+			return root;
+		root = candidate;
+		eccentricity = candidateEccentricity;
+	}
+}
+
+// Compute the total weight of the edges cut by a partition.
+inline int EdgeCut(const Graph &graph, const std::vector<int> &part)
+{
+	int cut = 0;
+	for (int v=0; v<graph.numVertices; ++v)
+	{
+		for (int k=graph.ptr[v]; k<graph.ptr[v+1]; ++k)
+		{
+			if (part[graph.adjacent[k]] != part[v])
+				cut += graph.edgeWeight[k];
+		}
+	}
+	return cut / 2;
+}
+
+/* Coarsen the graph by heavy edge matching: each vertex, in random order, is matched
+	with the unmatched neighbour it shares the heaviest edge with. Matched pairs become
+	single coarse vertices, and parallel edges are merged with their weights added. */
+inline Graph Coarsen(const Graph &graph, std::vector<int> &coarseMap, qbRandom &randomGenerator)
+{
+	int n = graph.numVertices;
+	std::vector<int> visitOrder(n);
+	std::iota(visitOrder.begin(), visitOrder.end(), 0);
+	for (int i=n-1; i>0; --i)
+		std::swap(visitOrder[i], visitOrder[std::min(static_cast<int>(randomGenerator.Uniform() * (i + 1)), i)]);
+
+	std::vector<int> match(n, -1);
+	coarseMap.assign(n, -1);
+	int numCoarse = 0;
+	for (int v : visitOrder)
+	{
+		if (match[v] >= 0)
+			continue;
+		int best = v;
+		int bestWeight = -1;
+		for (int k=graph.ptr[v]; k<graph.ptr[v+1]; ++k)
+		{
+			int w = graph.adjacent[k];
+			if ((match[w] < 0) && (graph.edgeWeight[k] > bestWeight))
+			{
+				best = w;
+				bestWeight = graph.edgeWeight[k];
+			}
+		}
+		match[v] = best;
+		match[best] = v;
+		coarseMap[v] = numCoarse;
+		coarseMap[best] = numCoarse;
+		numCoarse++;
+	}
+
+	// Build the coarse graph, merging parallel edges with a marker array.
+	Graph coarse;
+	coarse.numVertices = numCoarse;
+	coarse.ptr.assign(numCoarse + 1, 0);
+	coarse.vertexWeight.assign(numCoarse, 0);
+	std::vector<int> marker(numCoarse, -1);
+	std::vector<int> members;
+	std::vector<int> fineOfCoarse(numCoarse, -1);
+	for (int v=0; v<n; ++v)
+	{
+		if (fineOfCoarse[coarseMap[v]] < 0)
+			fineOfCoarse[coarseMap[v]] = v;
+	}
+	for (int c=0; c<numCoarse; ++c)
+	{
+		int v = fineOfCoarse[c];
+		members.clear();
+		members.push_back(v);
+		if (match[v] != v)
+			members.push_back(match[v]);
+		for (int u : members)
+		{
+			coarse.vertexWeight[c] += graph.vertexWeight[u];
+			for (int k=graph.ptr[u]; k<graph.ptr[u+1]; ++k)
+			{
+				int cw = coarseMap[graph.adjacent[k]];
+				if (cw == c)
+					continue;
+				if (marker[cw] < coarse.ptr[c])
+				{
+					marker[cw] = coarse.adjacent.size();
+					coarse.adjacent.push_back(cw);
+					coarse.edgeWeight.push_back(graph.edgeWeight[k]);
+				}
+				else
+					coarse.edgeWeight[marker[cw]] += graph.edgeWeight[k];
+			}
+		}
+		coarse.ptr[c+1] = coarse.adjacent.size();
+	}
+	return coarse;
+}
+
+/* Partition a (small) graph by greedy graph growing: each part is grown breadth first
+	from a seed vertex until it reaches its share of the total weight. */
+inline void GrowPartition(const Graph &graph, int numParts, int seedVertex, std::vector<int> &part)
+{
+	int n = graph.numVertices;
+	int totalWeight = std::accumulate(graph.vertexWeight.begin(), graph.vertexWeight.end(), 0);
+	part.assign(n, -1);
+	int assignedWeight = 0;
+	int nextSeed = seedVertex;
+	std::vector<int> queue;
+	for (int p=0; p<numParts-1; ++p)
+	{
+		int target = static_cast<int>((static_cast<long long>(totalWeight) * (p + 1)) / numParts);
+		queue.clear();
+		size_t head = 0;
+		while (assignedWeight < target)
+		{
+			if (head == queue.size())
+			{
+				// Start (or restart, for a disconnected graph) from an unassigned vertex.
+				while ((nextSeed < n) && (part[nextSeed] >= 0))
+					nextSeed++;
+				if (nextSeed == n)
+				{
+					nextSeed = 0;
+					while ((nextSeed < n) && (part[nextSeed] >= 0))
+						nextSeed++;
+				}
+				if (nextSeed == n)
+					break;
+				part[nextSeed] = p;
+				assignedWeight += graph.vertexWeight[nextSeed];
+				queue.push_back(nextSeed);
+				continue;
+			}
+			int v = queue[head++];
+			for (int k=graph.ptr[v]; (k<graph.ptr[v+1]) && (assignedWeight < target); ++k)
+			{
+				int w = graph.adjacent[k];
+				if (part[w] < 0)
+				{
+					part[w] = p;
+					assignedWeight += graph.vertexWeight[w];
+					queue.push_back(w);
+				}
+			}
+		}
+		// The next part grows from the frontier of this one.
+		if (head < queue.size())
+			nextSeed = queue[head];
+	}
+	for (int v=0; v<n; ++v)
+	{
+		if (part[v] < 0)
+			part[v] = numParts - 1;
+	}
+}
+
+/* Greedy k-way refinement: move boundary vertices to the neighbouring part that most
+	reduces the edge cut, without exceeding maxPartWeight. Vertices in overweight parts
+	may also move with a negative gain, to restore the balance. */
+inline void Refine(const Graph &graph, int numParts, int maxPartWeight, std::vector<int> &part, int numPasses)
+{
+	int n = graph.numVertices;
+	std::vector<int> partWeight(numParts, 0);
+	for (int v=0; v<n; ++v)
+		partWeight[part[v]] += graph.vertexWeight[v];
+
+	std::vector<int> connection(numParts, 0);
+	std::vector<int> touched;
+	for (int pass=0; pass<numPasses; ++pass)
+	{
+		int numMoves = 0;
+		for (int v=0; v<n; ++v)
+		{
+			int home = part[v];
+			touched.clear();
+			for (int k=graph.ptr[v]; k<graph.ptr[v+1]; ++k)
+			{
+				int p = part[graph.adjacent[k]];
+				if (connection[p] == 0)
+					touched.push_back(p);
+				connection[p] += graph.edgeWeight[k];
+			}
+
+			int internal = connection[home];
+			bool overweight = partWeight[home] > maxPartWeight;
+			int bestPart = home;
+			int bestGain = 0;
+			for (int p : touched)
+			{
+				if ((p == home) || (partWeight[p] + graph.vertexWeight[v] > maxPartWeight))
+					continue;
+				int gain = connection[p] - internal;
+				bool allowed = overweight || (gain > 0) || ((gain == 0) && (partWeight[p] + graph.vertexWeight[v] < partWeight[home]));
+				if (!allowed)
+					continue;
+				if ((bestPart == home) || (gain > bestGain) || ((gain == bestGain) && (partWeight[p] < partWeight[bestPart])))
+				{
+					bestPart = p;
+					bestGain = gain;
+				}
+			}
+			for (int p : touched)
+				connection[p] = 0;
+
+			if (bestPart != home)
+			{
+				part[v] = bestPart;
+				partWeight[home] -= graph.vertexWeight[v];
+				partWeight[bestPart] += graph.vertexWeight[v];
+				numMoves++;
+			}
+		}
+		if (numMoves == 0)
+			break;
+	}
+}
+
+}
+
+// Function to compute the bandwidth of a matrix (the largest |i - j| over the non-zeros).
+template <typename T>
+int qbBandwidth(const qbSparseMatrix<T> &A)
+{
+	const std::vector<int> &rowPtr = A.GetRowPtr();
+	const std::vector<int> &colIndex = A.GetColIndex();
+	int bandwidth = 0;
+	for (int i=0; i<A.GetNumRows(); ++i)
+	{
+		for (int k=rowPtr[i]; k<rowPtr[i+1]; ++k)
+			bandwidth = std::max(bandwidth, std::abs(colIndex[k] - i));
+	}
+	return bandwidth;
+}
+
+// The qbReorderRCM function.
+template <typename T>
+int qbReorderRCM(const qbSparseMatrix<T> &A, std::vector<int> &perm)
+{
+	if (A.GetNumRows() != A.GetNumCols())
+		return QBREORDER_MATRIXNOTSQUARE;
+
+	int n = A.GetNumRows();
+	qbReorderKernels::Graph graph = qbReorderKernels::BuildGraph(A);
+	std::vector<int> level(n, -1);
+	std::vector<bool> visited(n, false);
+	std::vector<int> order;
+	order.reserve(n);
+	std::vector<int> neighbours;
+
+	auto degree = [&graph](int v) { return graph.ptr[v+1] - graph.ptr[v]; };
+
+	// Process each connected component, starting from the unvisited vertex of lowest degree.
+	std::vector<int> byDegree(n);
+	std::iota(byDegree.begin(), byDegree.end(), 0);
+	std::stable_sort(byDegree.begin(), byDegree.end(), [&](int a, int b) { return degree(a) < degree(b); });
+	for (int start : byDegree)
+	{
+		if (visited[start])
+			continue;
+
+		int root = qbReorderKernels::PseudoPeripheral(graph, start, level);
+		size_t head = order.size();
+		order.push_back(root);
+		visited[root] = true;
+		while (head < order.size())
+		{
+			int v = order[head++];
+			neighbours.clear();
+			for (int k=graph.ptr[v]; k<graph.ptr[v+1]; ++k)
+			{
+				int w = graph.adjacent[k];
+				if (!visited[w])
+				{
+					visited[w] = true;
+					neighbours.push_back(w);
+				}
+			}
+			std::stable_sort(neighbours.begin(), neighbours.end(), [&](int a, int b) { return degree(a) < degree(b); });
+			order.insert(order.end(), neighbours.begin(), neighbours.end());
+		}
+	}
+
+	perm.assign(order.rbegin(), order.rend());
+	return 1;
+}
+
+// The qbPartitionGraph function.
+template <typename T>
+int qbPartitionGraph(const qbSparseMatrix<T> &A, int numParts, std::vector<int> &part,
+	double imbalance = 1.03, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	if (A.GetNumRows() != A.GetNumCols())
+		return QBREORDER_MATRIXNOTSQUARE;
+	int n = A.GetNumRows();
+	if ((numParts < 1) || (numParts > n))
+		return QBREORDER_INVALIDNUMPARTS;
+	if (numParts == 1)
+	{
+		part.assign(n, 0);
+		return 1;
+	}
+
+	qbRandom randomGenerator(seed);
+
+	// Coarsening phase.
+	std::vector<qbReorderKernels::Graph> graphs;
+	std::vector<std::vector<int>> coarseMaps;
+	graphs.push_back(qbReorderKernels::BuildGraph(A));
+	int coarsestSize = std::max(20 * numParts, 100);
+	while (graphs.back().numVertices > coarsestSize)
+	{
+		std::vector<int> coarseMap;
+		qbReorderKernels::Graph coarse = qbReorderKernels::Coarsen(graphs.back(), coarseMap, randomGenerator);
+		// Stop when matching no longer makes much progress (e.g. star-like graphs).
+		if (coarse.numVertices > 0.9 * graphs.back().numVertices)
+			break;
+		coarseMaps.push_back(coarseMap);
+		graphs.push_back(coarse);
+	}
+
+	// Initial partitioning, keeping the best of several attempts from different seeds.
+	const qbReorderKernels::Graph &coarsest = graphs.back();
+	int totalWeight = n;
+	int maxPartWeight = static_cast<int>(ceil(imbalance * totalWeight / numParts));
+	std::vector<int> bestPart;
+	int bestCut = -1;
+	for (int attempt=0; attempt<8; ++attempt)
+	{
+		int seedVertex = std::min(static_cast<int>(randomGenerator.Uniform() * coarsest.numVertices), coarsest.numVertices - 1);
+		std::vector<int> trialPart;
+		qbReorderKernels::GrowPartition(coarsest, numParts, seedVertex, trialPart);
+		qbReorderKernels::Refine(coarsest, numParts, maxPartWeight, trialPart, 10);
+		int cut = qbReorderKernels::EdgeCut(coarsest, trialPart);
+		if ((bestCut < 0) || (cut < bestCut))
+		{
+			bestCut = cut;
+			bestPart = trialPart;
+		}
+	}
+
+	// Uncoarsening phase: project the partition to each finer graph and refine it.
+	part = bestPart;
+	for (int l=graphs.size()-2; l>=0; --l)
+	{
+		std::vector<int> finePart(graphs[l].numVertices);
+		for (int v=0; v<graphs[l].numVertices; ++v)
+			finePart[v] = part[coarseMaps[l][v]];
+		part.swap(finePart);
+		qbReorderKernels::Refine(graphs[l], numParts, maxPartWeight, part, 4);
+	}
+
+	return 1;
+}
+
+// Function to compute the number of edges of the graph of A cut by a partition.
+template <typename T>
+int qbEdgeCut(const qbSparseMatrix<T> &A, const std::vector<int> &part)
+{
+	return qbReorderKernels::EdgeCut(qbReorderKernels::BuildGraph(A), part);
+}
+
+/* Convert a partition into a permutation that puts the rows of each part in a contiguous
+	block (keeping their original relative order). Part p occupies new indices partStart[p]
+	to partStart[p+1]-1. */
+inline int qbPartitionPermutation(const std::vector<int> &part, int numParts, std::vector<int> &perm, std::vector<int> &partStart)
+{
+	int n = part.size();
+	partStart.assign(numParts + 1, 0);
+	for (int p : part)
+	{
+		if ((p < 0) || (p >= numParts))
+			return QBREORDER_INVALIDNUMPARTS;
+		partStart[p + 1]++;
+	}
+	std::partial_sum(partStart.begin(), partStart.end(), partStart.begin());
+
+	perm.resize(n);
+	std::vector<int> next(partStart.begin(), partStart.end() - 1);
+	for (int i=0; i<n; ++i)
+		perm[next[part[i]]++] = i;
+	return 1;
+}
+
+/* Function to permute the rows and columns of a sparse matrix, B(i, j) = A(rowPerm[i], colPerm[j]).
+	The rows of B are filled in parallel. */
+template <typename T>
+int qbPermute(const qbSparseMatrix<T> &A, const std::vector<int> &rowPerm, const std::vector<int> &colPerm, qbSparseMatrix<T> &B)
+{
+	int numRows = A.GetNumRows();
+	int numCols = A.GetNumCols();
+	if (!qbReorderKernels::IsPermutation(rowPerm, numRows) || !qbReorderKernels::IsPermutation(colPerm, numCols))
+		return QBREORDER_INVALIDPERMUTATION;
+
+	const std::vector<int> &aPtr = A.GetRowPtr();
+	const std::vector<int> &aCol = A.GetColIndex();
+	const std::vector<T> &aValues = A.GetValues();
+	std::vector<int> inverseColPerm = qbReorderKernels::InversePermutation(colPerm);
+
+	std::vector<int> bPtr(numRows + 1, 0);
+	for (int i=0; i<numRows; ++i)
+		bPtr[i+1] = bPtr[i] + aPtr[rowPerm[i]+1] - aPtr[rowPerm[i]];
+	std::vector<int> bCol(aCol.size());
+	std::vector<T> bValues(aValues.size());
+
+	qbParallelFor(numRows, QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; ++i)
+		{
+			int source = aPtr[rowPerm[i]];
+			int start = bPtr[i];
+			int length = bPtr[i+1] - start;
+			// Copy the row with renumbered columns, keeping it sorted (insertion sort, since rows are short).
+			for (int k=0; k<length; ++k)
+			{
+				int col = inverseColPerm[aCol[source + k]];
+				T value = aValues[source + k];
+				int position = start + k;
+				while ((position > start) && (bCol[position - 1] > col))
+				{
+					bCol[position] = bCol[position - 1];
+					bValues[position] = bValues[position - 1];
+					position--;
+				}
+				bCol[position] = col;
+				bValues[position] = value;
+			}
+		}
+	});
+
+	B.SetCSR(numRows, numCols, bPtr, bCol, bValues);
+	return 1;
+}
+
+// Function to apply the same permutation to the rows and columns, B = A(perm, perm).
+template <typename T>
+int qbPermuteSymmetric(const qbSparseMatrix<T> &A, const std::vector<int> &perm, qbSparseMatrix<T> &B)
+{
+	if (A.GetNumRows() != A.GetNumCols())
+		return QBREORDER_MATRIXNOTSQUARE;
+	return qbPermute(A, perm, perm, B);
+}
+
+// Function to permute a vector, y[i] = x[perm[i]] x and y may be the same vector.
+template <typename T>
+int qbPermute(const qbVector<T> &x, const std::vector<int> &perm, qbVector<T> &y)
+{
+	int n = x.GetNumDims();
+	if (!qbReorderKernels::IsPermutation(perm, n))
+		return QBREORDER_INVALIDPERMUTATION;
+
+	// y is replaced before x is read, so permute in place from a copy.
+	if (&x == &y)
+	{
+		qbVector<T> xCopy = x;
+		return qbPermute(xCopy, perm, y);
+	}
+
+	y = qbVector<T>(n);
+	const T *xData = x.GetData();
+	T *yData = y.GetData();
+	const int *p = perm.data();
+	qbParallelFor(n, 16 * QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; ++i)
+			yData[i] = xData[p[i]];
+	});
+	return 1;
+}
+
+// Function to undo a permutation, y[perm[i]] = x[i] x and y may be the same vector.
+template <typename T>
+int qbInversePermute(const qbVector<T> &x, const std::vector<int> &perm, qbVector<T> &y)
+{
+	int n = x.GetNumDims();
+	if (!qbReorderKernels::IsPermutation(perm, n))
+		return QBREORDER_INVALIDPERMUTATION;
+
+	// y is replaced before x is read, so permute in place from a copy.
+	if (&x == &y)
+	{
+		qbVector<T> xCopy = x;
+		return qbInversePermute(xCopy, perm, y);
+	}
+
+	y = qbVector<T>(n);
+	const T *xData = x.GetData();
+	T *yData = y.GetData();
+	const int *p = perm.data();
+	qbParallelFor(n, 16 * QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last)
+	{
+		for (size_t i=first; i<last; ++i)
+			yData[p[i]] = xData[i];
+	});
+	return 1;
+}
+
+#endif
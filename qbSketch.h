@@ -0,0 +1,461 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBSKETCH_H
+#define QBSKETCH_H
+
+/* *************************************************************************************************
+
+	qbSketch
+
+	Functions to apply random sketching operators to tall matrices, and to use them to solve large
+	over-determined least squares problems (y = X*beta with many more rows than columns).
+
+	A sketch S is a random [s x m] matrix, with s much smaller than m, that approximately preserves
+	the norms of all vectors in the column space of X. Three sketches are provided:
+
+		QBSKETCH_GAUSSIAN		Dense Gaussian, entries N(0, 1/s). The most robust, but applying it
+								costs O(smn).
+		QBSKETCH_SRHT			Subsampled randomized Hadamard transform, S = sqrt(1/s)*P*H*D, with D
+								random signs, H the Walsh-Hadamard transform (applied with the fast
+								transform) and P a random selection of s rows. Costs O(mn log m), but
+								needs a zero-padded copy of X with a power-of-two number of rows.
+		QBSKETCH_COUNTSKETCH	Each row of X is added, with a random sign, to one randomly chosen row
+								of SX. Costs O(mn) - a single pass over X - but needs a larger s for
+								the same quality.
+
+	Every sketch reads X once, row by row, so X never needs to be transposed or copied (apart from
+	the padded buffer for SRHT). The sketch is fully determined by the seed.
+
+	Two least squares solvers are built on these:
+
+		qbLSQSketchSolve			Sketch-and-solve: solves min ||S*(X*beta - y)|| by QR. Fast, but
+									only approximate (the residual is within a small factor of optimal).
+		qbLSQSketchPrecondition		Sketch-and-precondition (as in Blendenpik / LSRN): uses the R factor
+									from the QR of S*X as a right preconditioner for LSQR on the full
+									problem, starting from the sketch-and-solve solution. X*inv(R) is
+									well conditioned, so LSQR converges to full accuracy in a small
+									number of iterations that doesn't depend on the conditioning of X.
+
+	For an [m x n] problem this replaces the O(mn^2) cost of forming and inverting X'X with
+	O(mn log m) for the sketch, O(sn^2) for the small QR and O(mn) per LSQR iteration.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates an unknown sketch type.
+						-2 indicates that the sketch size is too small for the problem.
+						-3 indicates that the (sketched) problem is rank deficient.
+						-4 indicates that LSQR reached its maximum number of iterations.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <stdint.h>
+
+#include "qbMatrix.h"
+#include "qbVector.h"
+#include "qbGEMM.h"
+#include "qbQR.h"
+#include "qbLSQR.h"
+#include "qbRandom.h"
+
+// Define the sketch types.
+constexpr int QBSKETCH_GAUSSIAN = 1;
+constexpr int QBSKETCH_SRHT = 2;
+constexpr int QBSKETCH_COUNTSKETCH = 3;
+
+// Define error codes.
+constexpr int QBSKETCH_INVALIDTYPE = -1;
+constexpr int QBSKETCH_SKETCHTOOSMALL = -2;
+constexpr int QBSKETCH_RANKDEFICIENT = -3;
+constexpr int QBSKETCH_MAXITERATIONSEXCEEDED = -4;
+
+namespace qbSketchKernels
+{
+
+// Solve R*x = b for upper-triangular [n x n] R, in place.
+template <typename T>
+void SolveUpper(const qbMatrix2<T> &R, std::vector<T> &x)
+{
+	int n = R.GetNumRows();
+	const T *r = R.GetData();
+	for (int i=n-1; i>=0; --i)
+	{
+		T sum = x[i];
+		for (int j=i+1; j<n; ++j)
+			sum -= r[(size_t)i*n + j] * x[j];
+		x[i] = sum / r[(size_t)i*n + i];
+	}
+}
+
+// Solve R'*x = b for upper-triangular [n x n] R, in place.
+template <typename T>
+void SolveUpperTranspose(const qbMatrix2<T> &R, std::vector<T> &x)
+{
+	int n = R.GetNumRows();
+	const T *r = R.GetData();
+	for (int i=0; i<n; ++i)
+	{
+		x[i] /= r[(size_t)i*n + i];
+		for (int j=i+1; j<n; ++j)
+			x[j] -= r[(size_t)i*n + j] * x[i];
+	}
+}
+
+// Test whether the upper-triangular R is numerically rank deficient.
+template <typename T>
+bool IsRankDeficient(const qbMatrix2<T> &R)
+{
+	int n = R.GetNumRows();
+	T maxDiagonal = static_cast<T>(0.0);
+	T minDiagonal = static_cast<T>(0.0);
+	for (int i=0; i<n; ++i)
+	{
+		T value = fabs(R.GetElement(i, i));
+		maxDiagonal = std::max(maxDiagonal, value);
+		minDiagonal = (i == 0) ? value : std::min(minDiagonal, value);
+	}
+	return (maxDiagonal == static_cast<T>(0.0)) || (minDiagonal <= static_cast<T>(n) * static_cast<T>(1e-14) * maxDiagonal);
+}
+
+// Compute the smallest power of two that is >= n.
+inline int NextPowerOfTwo(int n)
+{
+	int result = 1;
+	while (result < n)
+		result *= 2;
+	return result;
+}
+
+}
+
+/* Function to apply a dense Gaussian sketch. Rows of X are processed in chunks; the
+	corresponding columns of S are generated on the fly (each from a fixed counter, so
+	the sketch depends only on the seed) and the chunk's contribution is accumulated
+	with a blocked GEMM. */
+template <typename T>
+int qbSketchGaussian(const qbMatrix2<T> &X, int sketchSize, qbMatrix2<T> &SX, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	int numRows = X.GetNumRows();
+	int numCols = X.GetNumCols();
+	int s = sketchSize;
+	if (s < 1)
+		return QBSKETCH_SKETCHTOOSMALL;
+
+	const int chunkSize = 256;
+	const uint64_t blocksPerColumn = (s + 1) / 2;
+	T scale = static_cast<T>(1.0) / sqrt(static_cast<T>(s));
+	qbRandom randomGenerator(seed);
+
+	qbMatrix2<T> result(s, numCols);
+	std::vector<T> G((size_t)chunkSize*s);
+	std::vector<T> Gt((size_t)s*chunkSize);
+	const T *x = X.GetData();
+	for (int rowStart=0; rowStart<numRows; rowStart+=chunkSize)
+	{
+		int count = std::min(chunkSize, numRows - rowStart);
+
+		// Row r of G is column (rowStart + r) of S.
+		for (int r=0; r<count; ++r)
+		{
+			randomGenerator.SetCounter(static_cast<uint64_t>(rowStart + r) * blocksPerColumn);
+			randomGenerator.FillGaussian(G.data() + (size_t)r*s, s, static_cast<T>(0.0), scale);
+		}
+
+		// SX += S(:, chunk) * X(chunk, :).
+		qbMatrixKernels::TransposeRecursive(G.data(), s, Gt.data(), count, count, s);
+		qbGEMMKernels::BlockedGEMM(s, numCols, count, Gt.data(), count, x + (size_t)rowStart*numCols, numCols,
+			result.GetData(), numCols, true);
+	}
+
+	SX = result;
+	return 1;
+}
+
+/* Function to apply a subsampled randomized Hadamard transform. Rows of X are streamed,
+	with random signs, into a zero-padded buffer; the fast Walsh-Hadamard transform is then
+	applied in place with butterflies that combine whole rows (so the inner loops are
+	contiguous), and s distinct rows are sampled. */
+template <typename T>
+int qbSketchSRHT(const qbMatrix2<T> &X, int sketchSize, qbMatrix2<T> &SX, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	int numRows = X.GetNumRows();
+	int numCols = X.GetNumCols();
+	int paddedRows = qbSketchKernels::NextPowerOfTwo(numRows);
+	int s = sketchSize;
+	if ((s < 1) || (s > paddedRows))
+		return QBSKETCH_SKETCHTOOSMALL;
+
+	qbRandom randomGenerator(seed);
+
+	// Stream D*X into the padded buffer.
+	std::vector<T> signs(numRows);
+	randomGenerator.FillRademacher(signs.data(), numRows);
+	std::vector<T> Y((size_t)paddedRows*numCols, static_cast<T>(0.0));
+	const T *x = X.GetData();
+	for (int i=0; i<numRows; ++i)
+	{
+		const T *xRow = x + (size_t)i*numCols;
+		T *yRow = Y.data() + (size_t)i*numCols;
+		for (int j=0; j<numCols; ++j)
+			yRow[j] = signs[i] * xRow[j];
+	}
+
+	// Fast Walsh-Hadamard transform along the columns.
+	for (int h=1; h<paddedRows; h*=2)
+	{
+		for (int i=0; i<paddedRows; i+=2*h)
+		{
+			for (int k=i; k<i+h; ++k)
+			{
+				T *a = Y.data() + (size_t)k*numCols;
+				T *b = Y.data() + (size_t)(k+h)*numCols;
+				for (int j=0; j<numCols; ++j)
+				{
+					T sum = a[j] + b[j];
+					T difference = a[j] - b[j];
+					a[j] = sum;
+					b[j] = difference;
+				}
+			}
+		}
+	}
+
+	// Choose s distinct rows with a partial Fisher-Yates shuffle.
+	std::vector<int> rowIndex(paddedRows);
+	for (int i=0; i<paddedRows; ++i)
+		rowIndex[i] = i;
+	std::vector<double> uniforms(s);
+	randomGenerator.FillUniform(uniforms.data(), s, 0.0, 1.0);
+	for (int i=0; i<s; ++i)
+	{
+		int j = i + std::min(static_cast<int>(uniforms[i] * (paddedRows - i)), paddedRows - i - 1);
+		std::swap(rowIndex[i], rowIndex[j]);
+	}
+
+	// Extract and scale the sampled rows.
+	T scale = static_cast<T>(1.0) / sqrt(static_cast<T>(s));
+	qbMatrix2<T> result(s, numCols);
+	T *sx = result.GetData();
+	for (int i=0; i<s; ++i)
+	{
+		const T *yRow = Y.data() + (size_t)rowIndex[i]*numCols;
+		for (int j=0; j<numCols; ++j)
+			sx[(size_t)i*numCols + j] = scale * yRow[j];
+	}
+
+	SX = result;
+	return 1;
+}
+
+/* Function to apply a CountSketch. Each row i of X is hashed to row h(i) of SX and
+	added with sign g(i), with h and g drawn from the counter-based generator, so this
+	is a single pass over X with no multiplications. */
+template <typename T>
+int qbSketchCountSketch(const qbMatrix2<T> &X, int sketchSize, qbMatrix2<T> &SX, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	int numRows = X.GetNumRows();
+	int numCols = X.GetNumCols();
+	int s = sketchSize;
+	if (s < 1)
+		return QBSKETCH_SKETCHTOOSMALL;
+
+	uint32_t key[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+	qbMatrix2<T> result(s, numCols);
+	T *sx = result.GetData();
+	const T *x = X.GetData();
+	for (int i=0; i<numRows; ++i)
+	{
+		uint32_t counter[4] = {static_cast<uint32_t>(i), 0, 0x43534b54, 0};
+		uint32_t r[4];
+		qbRandom::Philox(counter, key, r);
+		int bucket = static_cast<int>(r[0] % static_cast<uint32_t>(s));
+		T sign = (r[1] & 1u) ? static_cast<T>(1.0) : static_cast<T>(-1.0);
+
+		const T *xRow = x + (size_t)i*numCols;
+		T *sxRow = sx + (size_t)bucket*numCols;
+		for (int j=0; j<numCols; ++j)
+			sxRow[j] += sign * xRow[j];
+	}
+
+	SX = result;
+	return 1;
+}
+
+// Function to apply the given type of sketch.
+template <typename T>
+int qbSketch(int sketchType, const qbMatrix2<T> &X, int sketchSize, qbMatrix2<T> &SX, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	switch (sketchType)
+	{
+		case QBSKETCH_GAUSSIAN:
+			return qbSketchGaussian(X, sketchSize, SX, seed);
+		case QBSKETCH_SRHT:
+			return qbSketchSRHT(X, sketchSize, SX, seed);
+		case QBSKETCH_COUNTSKETCH:
+			return qbSketchCountSketch(X, sketchSize, SX, seed);
+		default:
+			return QBSKETCH_INVALIDTYPE;
+	}
+}
+
+/* Sketch X and y and factorize, giving the R factor of S*X and the sketch-and-solve
+	solution. Shared by both least squares solvers. */
+template <typename T>
+int qbSketchFactorize(const qbMatrix2<T> &X, const qbVector<T> &y, int sketchType, int sketchSize, uint64_t seed,
+	qbMatrix2<T> &R, std::vector<T> &beta)
+{
+	int numRows = X.GetNumRows();
+	int numCols = X.GetNumCols();
+	if (y.GetNumDims() != numRows)
+		throw std::invalid_argument("The number of elements in y must equal the number of rows in X.");
+
+	// The default sketch size is four times the number of unknowns (as used by Blendenpik).
+	if (sketchSize <= 0)
+		sketchSize = 4 * (numCols + 1);
+	if (sketchType == QBSKETCH_SRHT)
+		sketchSize = std::min(sketchSize, qbSketchKernels::NextPowerOfTwo(numRows));
+	if (sketchSize < numCols + 1)
+		return QBSKETCH_SKETCHTOOSMALL;
+
+	/* Sketch X and y separately. S depends only on the seed and the number of rows (every
+		random number is drawn per row, or per sample, never per column), so both see the
+		same S without joining y onto a copy of X. */
+	qbMatrix2<T> SX;
+	int status = qbSketch(sketchType, X, sketchSize, SX, seed);
+	if (status < 0)
+		return status;
+	std::vector<T> yData = y.data();
+	qbMatrix2<T> yMatrix(numRows, 1, yData);
+	qbMatrix2<T> Sy;
+	status = qbSketch(sketchType, yMatrix, sketchSize, Sy, seed);
+	if (status < 0)
+		return status;
+
+	// SX = Q*R, and the sketch-and-solve solution is inv(R)*Q'*Sy.
+	qbMatrix2<T> Q;
+	qbQRThin(SX, Q, R);
+	beta.assign(numCols, static_cast<T>(0.0));
+	const T *q = Q.GetData();
+	const T *sy = Sy.GetData();
+	for (int i=0; i<sketchSize; ++i)
+	{
+		const T *qRow = q + (size_t)i*numCols;
+		for (int j=0; j<numCols; ++j)
+			beta[j] += qRow[j] * sy[i];
+	}
+
+	if (qbSketchKernels::IsRankDeficient(R))
+		return QBSKETCH_RANKDEFICIENT;
+
+	qbSketchKernels::SolveUpper(R, beta);
+	return 1;
+}
+
+// The qbLSQSketchSolve function (sketch-and-solve least squares).
+template <typename T>
+int qbLSQSketchSolve(const qbMatrix2<T> &X, const qbVector<T> &y, qbVector<T> &result,
+	int sketchType = QBSKETCH_SRHT, int sketchSize = 0, uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	qbMatrix2<T> R;
+	std::vector<T> beta;
+	int status = qbSketchFactorize(X, y, sketchType, sketchSize, seed, R, beta);
+	if (status < 0)
+		return status;
+
+	result = qbVector<T>(beta);
+	return 1;
+}
+
+// The qbLSQSketchPrecondition function (sketch-and-precondition least squares).
+template <typename T>
+int qbLSQSketchPrecondition(const qbMatrix2<T> &X, const qbVector<T> &y, qbVector<T> &result,
+	int sketchType = QBSKETCH_SRHT, int sketchSize = 0, T tolerance = static_cast<T>(1e-12), int maxIterations = 200,
+	uint64_t seed = QBRANDOM_DEFAULTSEED)
+{
+	int numRows = X.GetNumRows();
+	int numCols = X.GetNumCols();
+
+	// Get the preconditioner, R, and the starting point, beta0, from the sketch.
+	qbMatrix2<T> R;
+	std::vector<T> beta0;
+	int status = qbSketchFactorize(X, y, sketchType, sketchSize, seed, R, beta0);
+	if (status < 0)
+		return status;
+
+	// Compute the residual at the starting point, r0 = y - X*beta0.
+	const T *x = X.GetData();
+	std::vector<T> r0(numRows);
+	for (int i=0; i<numRows; ++i)
+	{
+		const T *xRow = x + (size_t)i*numCols;
+		T sum = static_cast<T>(0.0);
+		for (int j=0; j<numCols; ++j)
+			sum += xRow[j] * beta0[j];
+		r0[i] = y.GetElement(i) - sum;
+	}
+
+	// Products with X and X', and the preconditioner, R.
+	auto matVec = [&](const std::vector<T> &v, std::vector<T> &out)
+	{
+		for (int i=0; i<numRows; ++i)
+		{
+			const T *xRow = x + (size_t)i*numCols;
+			T sum = static_cast<T>(0.0);
+			for (int j=0; j<numCols; ++j)
+				sum += xRow[j] * v[j];
+			out[i] = sum;
+		}
+	};
+	auto rmatVec = [&](const std::vector<T> &u, std::vector<T> &out)
+	{
+		std::fill(out.begin(), out.end(), static_cast<T>(0.0));
+		for (int i=0; i<numRows; ++i)
+		{
+			const T *xRow = x + (size_t)i*numCols;
+			for (int j=0; j<numCols; ++j)
+				out[j] += u[i] * xRow[j];
+		}
+	};
+	auto precondition = [&](const std::vector<T> &in, std::vector<T> &out)
+	{
+		out = in;
+		qbSketchKernels::SolveUpper(R, out);
+	};
+	auto rprecondition = [&](const std::vector<T> &in, std::vector<T> &out)
+	{
+		out = in;
+		qbSketchKernels::SolveUpperTranspose(R, out);
+	};
+
+	// Solve for the correction with preconditioned LSQR: beta = beta0 + z.
+	std::vector<T> z;
+	int lsqrStatus = qbLSQR<T>(matVec, rmatVec, precondition, rprecondition, numRows, numCols, r0, z,
+		tolerance, maxIterations);
+	for (int j=0; j<numCols; ++j)
+		beta0[j] += z[j];
+
+	result = qbVector<T>(beta0);
+
+	if (lsqrStatus < 0)
+		return QBSKETCH_MAXITERATIONSEXCEEDED;
+
+	return 1;
+}
+
+#endif
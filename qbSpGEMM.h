@@ -0,0 +1,554 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBSPGEMM_H
+#define QBSPGEMM_H
+
+/* *************************************************************************************************
+
+	qbSpGEMM
+
+	Functions to compute the product of two sparse matrices, C = A*B (SpGEMM), in parallel over
+	the rows of C. Sparse products are needed to form Galerkin coarse operators in multigrid
+	(P' * A * P, see qbAMG.h), powers of a graph, and the normal equations A'*A for sparse least
+	squares problems.
+
+	Row i of C is the sum of the rows of B selected by the non-zeros of row i of A (Gustavson's
+	algorithm). The number of non-zeros in each row of C is not known in advance, so the product
+	is computed in two phases:
+
+	qbSpGEMMSymbolic	Computes the sparsity pattern of C, in two parallel passes: the first
+						counts the non-zeros in each row (to size the output), and the second
+						writes the sorted column indices. The values of C are set to zero.
+
+	qbSpGEMMNumeric		Computes the values of C, given its pattern. The pattern only depends on
+						the patterns of A and B, so when only the values change (as in qbAMG
+						UpdateValues, or a time dependent problem) the symbolic phase can be done
+						once and the numeric phase repeated.
+
+	qbSpGEMM			The full product, for when there is no reuse: the rows are counted, then
+						the columns and values are computed in a single pass.
+
+	qbSpGEMMAtA			C = A'*A. Since C is symmetric, only the upper triangle is computed (half
+						the work), then mirrored.
+
+	Each thread merges the rows of B with an accumulator indexed by column. A dense accumulator
+	(arrays the width of C) has constant time access and is best when C is narrow enough for the
+	arrays to stay in cache; a hash accumulator (sized for the current row) uses memory in
+	proportion to the row rather than to the width of C, which is better for very wide matrices.
+	With QBSPGEMM_AUTO the dense accumulator is used when C has at most QBSPGEMM_DENSECOLUMNS
+	columns.
+
+	*** INPUTS ***
+
+	A				qbSparseMatrix	The left hand matrix.
+	B				qbSparseMatrix	The right hand matrix.
+	C				qbSparseMatrix	The product (output). For qbSpGEMMNumeric, it must already have
+									the pattern computed by qbSpGEMMSymbolic for matrices with the
+									same patterns as A and B.
+	accumulator		INT				(Optional) QBSPGEMM_AUTO, QBSPGEMM_DENSE or QBSPGEMM_HASH.
+
+	*** OUTPUTS ***
+
+	INT				Flag indicating success or failure of the process.
+						1 Indicates success.
+						-1 indicates that the dimensions of A and B are not compatible.
+						-2 indicates that the pattern of C does not match the product.
+						-3 indicates an invalid accumulator type.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <atomic>
+#include <stdint.h>
+
+#include "qbSparse.h"
+#include "qbParallel.h"
+
+// Define the accumulator types.
+constexpr int QBSPGEMM_AUTO = 0;
+constexpr int QBSPGEMM_DENSE = 1;
+constexpr int QBSPGEMM_HASH = 2;
+
+// The largest number of columns for which QBSPGEMM_AUTO uses the dense accumulator.
+constexpr int QBSPGEMM_DENSECOLUMNS = 65536;
+
+// The minimum number of rows given to each thread.
+constexpr size_t QBSPGEMM_MINROWSPERTHREAD = 512;
+
+// Define error codes.
+constexpr int QBSPGEMM_DIMENSIONMISMATCH = -1;
+constexpr int QBSPGEMM_PATTERNMISMATCH = -2;
+constexpr int QBSPGEMM_INVALIDACCUMULATOR = -3;
+
+namespace qbSpGEMMKernels
+{
+	// Accumulator with arrays indexed by column. The stamp marks the columns in the current row.
+	struct DenseAccumulator
+	{
+		std::vector<int> stamp;
+		std::vector<int> position;
+		std::vector<int> columns;
+		int current;
+
+		DenseAccumulator(int numCols) : stamp(numCols, -1), position(numCols, 0), current(-1) {}
+
+		// Start a new row with at most upperBound columns, so the list of columns never grows.
+		void Reset(int upperBound)
+		{
+			current++;
+			columns.clear();
+			columns.reserve(std::min(static_cast<size_t>(upperBound), stamp.size()));
+		}
+
+		// Add a column to the current row, and return its index in the list of columns.
+		int Insert(int column)
+		{
+			if (stamp[column] != current)
+			{
+				stamp[column] = current;
+				position[column] = columns.size();
+				columns.push_back(column);
+			}
+			return position[column];
+		}
+
+		void SetPosition(int column, int k)
+		{
+			stamp[column] = current;
+			position[column] = k;
+		}
+
+		int Find(int column) const
+		{
+			return (stamp[column] == current) ? position[column] : -1;
+		}
+	};
+
+	// Accumulator with an open addressing hash table, sized for the current row.
+	struct HashAccumulator
+	{
+		std::vector<int> keys;
+		std::vector<int> position;
+		std::vector<int> columns;
+		size_t mask;
+		int maxColumns;
+
+		HashAccumulator(int numCols) : mask(0), maxColumns(numCols) {}
+
+		void Reset(int upperBound)
+		{
+			/* A row has no more distinct columns than B, however many products contribute to it.
+				The table is at most half full, so probe sequences stay short. */
+			size_t size = 1;
+			while (size < 2 * static_cast<size_t>(std::min(upperBound, maxColumns)))
+				size <<= 1;
+			if (keys.size() < size)
+			{
+				keys.resize(size);
+				position.resize(size);
+			}
+			mask = size - 1;
+			std::fill(keys.begin(), keys.begin() + size, -1);
+			columns.clear();
+		}
+
+		size_t Slot(int column) const
+		{
+			size_t slot = (static_cast<uint32_t>(column) * 2654435761u) & mask;
+			while ((keys[slot] != -1) && (keys[slot] != column))
+				slot = (slot + 1) & mask;
+			return slot;
+		}
+
+		// Add a column to the current row, and return its index in the list of columns.
+		int Insert(int column)
+		{
+			size_t slot = Slot(column);
+			if (keys[slot] == -1)
+			{
+				keys[slot] = column;
+				position[slot] = columns.size();
+				columns.push_back(column);
+			}
+			return position[slot];
+		}
+
+		void SetPosition(int column, int k)
+		{
+			size_t slot = Slot(column);
+			keys[slot] = column;
+			position[slot] = k;
+		}
+
+		int Find(int column) const
+		{
+			size_t slot = Slot(column);
+			return (keys[slot] == column) ? position[slot] : -1;
+		}
+	};
+
+	// The first entry of row k of B to use (only columns >= i for the upper triangle).
+	inline int FirstEntry(const std::vector<int> &bRowPtr, const std::vector<int> &bColIndex, int k, int i, bool upperOnly)
+	{
+		if (!upperOnly)
+			return bRowPtr[k];
+		auto first = bColIndex.begin() + bRowPtr[k];
+		auto last = bColIndex.begin() + bRowPtr[k + 1];
+		return std::lower_bound(first, last, i) - bColIndex.begin();
+	}
+
+	// An upper bound on the length of row i of A*B (the number of products, or the width of B).
+	template <typename T>
+	int RowUpperBound(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, int i)
+	{
+		const std::vector<int> &aRowPtr = A.GetRowPtr();
+		const std::vector<int> &aColIndex = A.GetColIndex();
+		const std::vector<int> &bRowPtr = B.GetRowPtr();
+		long long upperBound = 0;
+		for (int ka=aRowPtr[i]; ka<aRowPtr[i+1]; ++ka)
+			upperBound += bRowPtr[aColIndex[ka] + 1] - bRowPtr[aColIndex[ka]];
+		return static_cast<int>(std::min(upperBound, static_cast<long long>(B.GetNumCols())));
+	}
+
+	// Collect the (unsorted) columns of row i of A*B in the accumulator.
+	template <typename T, class Accumulator>
+	void RowPattern(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, int i, bool upperOnly, Accumulator &accumulator)
+	{
+		const std::vector<int> &aRowPtr = A.GetRowPtr();
+		const std::vector<int> &aColIndex = A.GetColIndex();
+		const std::vector<int> &bRowPtr = B.GetRowPtr();
+		const std::vector<int> &bColIndex = B.GetColIndex();
+
+		accumulator.Reset(RowUpperBound(A, B, i));
+
+		for (int ka=aRowPtr[i]; ka<aRowPtr[i+1]; ++ka)
+		{
+			int k = aColIndex[ka];
+			for (int kb=FirstEntry(bRowPtr, bColIndex, k, i, upperOnly); kb<bRowPtr[k+1]; ++kb)
+				accumulator.Insert(bColIndex[kb]);
+		}
+	}
+
+	/* Compute the columns and values of row i of A*B together, in the order the columns are
+		first reached, with rowValues[k] the value for accumulator.columns[k]. */
+	template <typename T, class Accumulator>
+	void RowProduct(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, int i, bool upperOnly,
+		Accumulator &accumulator, std::vector<T> &rowValues)
+	{
+		const std::vector<int> &aRowPtr = A.GetRowPtr();
+		const std::vector<int> &aColIndex = A.GetColIndex();
+		const std::vector<T> &aValues = A.GetValues();
+		const std::vector<int> &bRowPtr = B.GetRowPtr();
+		const std::vector<int> &bColIndex = B.GetColIndex();
+		const std::vector<T> &bValues = B.GetValues();
+
+		accumulator.Reset(RowUpperBound(A, B, i));
+		rowValues.clear();
+		for (int ka=aRowPtr[i]; ka<aRowPtr[i+1]; ++ka)
+		{
+			int k = aColIndex[ka];
+			T aik = aValues[ka];
+			for (int kb=FirstEntry(bRowPtr, bColIndex, k, i, upperOnly); kb<bRowPtr[k+1]; ++kb)
+			{
+				size_t index = accumulator.Insert(bColIndex[kb]);
+				if (index == rowValues.size())
+					rowValues.push_back(static_cast<T>(0.0));
+				rowValues[index] += aik * bValues[kb];
+			}
+		}
+	}
+
+	// Compute the values of row i of A*B into the existing pattern. Returns false on a mismatch.
+	template <typename T, class Accumulator>
+	bool RowValues(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, int i, bool upperOnly,
+		const std::vector<int> &cRowPtr, const std::vector<int> &cColIndex, std::vector<T> &cValues, Accumulator &accumulator)
+	{
+		const std::vector<int> &aRowPtr = A.GetRowPtr();
+		const std::vector<int> &aColIndex = A.GetColIndex();
+		const std::vector<T> &aValues = A.GetValues();
+		const std::vector<int> &bRowPtr = B.GetRowPtr();
+		const std::vector<int> &bColIndex = B.GetColIndex();
+		const std::vector<T> &bValues = B.GetValues();
+
+		accumulator.Reset(cRowPtr[i+1] - cRowPtr[i]);
+		for (int kc=cRowPtr[i]; kc<cRowPtr[i+1]; ++kc)
+		{
+			accumulator.SetPosition(cColIndex[kc], kc);
+			cValues[kc] = static_cast<T>(0.0);
+		}
+
+		for (int ka=aRowPtr[i]; ka<aRowPtr[i+1]; ++ka)
+		{
+			int k = aColIndex[ka];
+			T aik = aValues[ka];
+			for (int kb=FirstEntry(bRowPtr, bColIndex, k, i, upperOnly); kb<bRowPtr[k+1]; ++kb)
+			{
+				int position = accumulator.Find(bColIndex[kb]);
+				if (position < 0)
+					return false;
+				cValues[position] += aik * bValues[kb];
+			}
+		}
+		return true;
+	}
+
+	// Count the non-zeros in each row of A*B, to give the row pointers of the product.
+	template <typename T, class Accumulator>
+	void CountRows(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, std::vector<int> &rowPtr)
+	{
+		int numRows = A.GetNumRows();
+		int numCols = B.GetNumCols();
+		rowPtr.assign(numRows + 1, 0);
+		qbParallelFor(numRows, QBSPGEMM_MINROWSPERTHREAD, [&](size_t first, size_t last)
+		{
+			Accumulator accumulator(numCols);
+			for (size_t i=first; i<last; ++i)
+			{
+				RowPattern(A, B, i, upperOnly, accumulator);
+				rowPtr[i+1] = accumulator.columns.size();
+			}
+		});
+		std::partial_sum(rowPtr.begin(), rowPtr.end(), rowPtr.begin());
+	}
+
+	// The symbolic phase: count the row lengths, then fill in the sorted column indices.
+	template <typename T, class Accumulator>
+	void Symbolic(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C)
+	{
+		int numRows = A.GetNumRows();
+		int numCols = B.GetNumCols();
+		std::vector<int> rowPtr;
+		CountRows<T, Accumulator>(A, B, upperOnly, rowPtr);
+
+		std::vector<int> colIndex(rowPtr[numRows]);
+		qbParallelFor(numRows, QBSPGEMM_MINROWSPERTHREAD, [&](size_t first, size_t last)
+		{
+			Accumulator accumulator(numCols);
+			for (size_t i=first; i<last; ++i)
+			{
+				RowPattern(A, B, i, upperOnly, accumulator);
+				std::sort(accumulator.columns.begin(), accumulator.columns.end());
+				std::copy(accumulator.columns.begin(), accumulator.columns.end(), colIndex.begin() + rowPtr[i]);
+			}
+		});
+
+		C.SetCSR(numRows, numCols, rowPtr, colIndex, std::vector<T>(colIndex.size(), static_cast<T>(0.0)));
+	}
+
+	// The full product: count the row lengths, then compute the columns and values together.
+	template <typename T, class Accumulator>
+	void Product(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C)
+	{
+		int numRows = A.GetNumRows();
+		int numCols = B.GetNumCols();
+		std::vector<int> rowPtr;
+		CountRows<T, Accumulator>(A, B, upperOnly, rowPtr);
+
+		std::vector<int> colIndex(rowPtr[numRows]);
+		std::vector<T> values(rowPtr[numRows]);
+		qbParallelFor(numRows, QBSPGEMM_MINROWSPERTHREAD, [&](size_t first, size_t last)
+		{
+			Accumulator accumulator(numCols);
+			std::vector<T> rowValues;
+			std::vector<std::pair<int, T>> entries;
+			for (size_t i=first; i<last; ++i)
+			{
+				RowProduct(A, B, i, upperOnly, accumulator, rowValues);
+				entries.resize(rowValues.size());
+				for (size_t k=0; k<rowValues.size(); ++k)
+					entries[k] = std::make_pair(accumulator.columns[k], rowValues[k]);
+				std::sort(entries.begin(), entries.end(), [](const std::pair<int, T> &a, const std::pair<int, T> &b) { return a.first < b.first; });
+				for (size_t k=0; k<entries.size(); ++k)
+				{
+					colIndex[rowPtr[i] + k] = entries[k].first;
+					values[rowPtr[i] + k] = entries[k].second;
+				}
+			}
+		});
+
+		C.SetCSR(numRows, numCols, rowPtr, colIndex, values);
+	}
+
+	// The numeric phase. Returns false if the pattern of C does not contain the product.
+	template <typename T, class Accumulator>
+	bool Numeric(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C)
+	{
+		const std::vector<int> &cRowPtr = C.GetRowPtr();
+		const std::vector<int> &cColIndex = C.GetColIndex();
+		std::vector<T> &cValues = C.GetValues();
+		int numCols = B.GetNumCols();
+		std::atomic<bool> matches(true);
+		qbParallelFor(A.GetNumRows(), QBSPGEMM_MINROWSPERTHREAD, [&](size_t first, size_t last)
+		{
+			Accumulator accumulator(numCols);
+			for (size_t i=first; i<last; ++i)
+			{
+				if (!RowValues(A, B, i, upperOnly, cRowPtr, cColIndex, cValues, accumulator))
+				{
+					matches = false;
+					return;
+				}
+			}
+		});
+		return matches;
+	}
+
+	// Resolve QBSPGEMM_AUTO to an accumulator type.
+	inline int ChooseAccumulator(int accumulator, int numCols)
+	{
+		if (accumulator == QBSPGEMM_AUTO)
+			return (numCols <= QBSPGEMM_DENSECOLUMNS) ? QBSPGEMM_DENSE : QBSPGEMM_HASH;
+		return accumulator;
+	}
+
+	template <typename T>
+	int Symbolic(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C, int accumulator)
+	{
+		accumulator = ChooseAccumulator(accumulator, B.GetNumCols());
+		if (accumulator == QBSPGEMM_DENSE)
+			Symbolic<T, DenseAccumulator>(A, B, upperOnly, C);
+		else if (accumulator == QBSPGEMM_HASH)
+			Symbolic<T, HashAccumulator>(A, B, upperOnly, C);
+		else
+			return QBSPGEMM_INVALIDACCUMULATOR;
+		return 1;
+	}
+
+	template <typename T>
+	int Product(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C, int accumulator)
+	{
+		accumulator = ChooseAccumulator(accumulator, B.GetNumCols());
+		if (accumulator == QBSPGEMM_DENSE)
+			Product<T, DenseAccumulator>(A, B, upperOnly, C);
+		else if (accumulator == QBSPGEMM_HASH)
+			Product<T, HashAccumulator>(A, B, upperOnly, C);
+		else
+			return QBSPGEMM_INVALIDACCUMULATOR;
+		return 1;
+	}
+
+	template <typename T>
+	int Numeric(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, bool upperOnly, qbSparseMatrix<T> &C, int accumulator)
+	{
+		if ((C.GetNumRows() != A.GetNumRows()) || (C.GetNumCols() != B.GetNumCols()))
+			return QBSPGEMM_PATTERNMISMATCH;
+
+		bool matches;
+		accumulator = ChooseAccumulator(accumulator, B.GetNumCols());
+		if (accumulator == QBSPGEMM_DENSE)
+			matches = Numeric<T, DenseAccumulator>(A, B, upperOnly, C);
+		else if (accumulator == QBSPGEMM_HASH)
+			matches = Numeric<T, HashAccumulator>(A, B, upperOnly, C);
+		else
+			return QBSPGEMM_INVALIDACCUMULATOR;
+		return matches ? 1 : QBSPGEMM_PATTERNMISMATCH;
+	}
+
+	/* Form the full symmetric matrix from its upper triangle U. Row i of U' holds the
+		columns j <= i, so row i of the result is row i of U' without its diagonal,
+		followed by row i of U, which is already in order. */
+	template <typename T>
+	void SymmetricFromUpper(const qbSparseMatrix<T> &U, qbSparseMatrix<T> &C)
+	{
+		int n = U.GetNumRows();
+		qbSparseMatrix<T> L = U.Transpose();
+		const std::vector<int> &uRowPtr = U.GetRowPtr();
+		const std::vector<int> &uColIndex = U.GetColIndex();
+		const std::vector<T> &uValues = U.GetValues();
+		const std::vector<int> &lRowPtr = L.GetRowPtr();
+		const std::vector<int> &lColIndex = L.GetColIndex();
+		const std::vector<T> &lValues = L.GetValues();
+
+		std::vector<int> lowerCount(n);
+		std::vector<int> rowPtr(n + 1, 0);
+		for (int i=0; i<n; ++i)
+		{
+			lowerCount[i] = lRowPtr[i+1] - lRowPtr[i];
+			if ((lowerCount[i] > 0) && (lColIndex[lRowPtr[i+1] - 1] == i))
+				lowerCount[i]--;
+			rowPtr[i+1] = rowPtr[i] + lowerCount[i] + (uRowPtr[i+1] - uRowPtr[i]);
+		}
+
+		std::vector<int> colIndex(rowPtr[n]);
+		std::vector<T> values(rowPtr[n]);
+		qbParallelFor(n, QBSPARSE_MINROWSPERTHREAD, [&](size_t first, size_t last)
+		{
+			for (size_t i=first; i<last; ++i)
+			{
+				int position = rowPtr[i];
+				for (int k=lRowPtr[i]; k<lRowPtr[i] + lowerCount[i]; ++k, ++position)
+				{
+					colIndex[position] = lColIndex[k];
+					values[position] = lValues[k];
+				}
+				for (int k=uRowPtr[i]; k<uRowPtr[i+1]; ++k, ++position)
+				{
+					colIndex[position] = uColIndex[k];
+					values[position] = uValues[k];
+				}
+			}
+		});
+
+		C.SetCSR(n, n, rowPtr, colIndex, values);
+	}
+}
+
+// The symbolic phase: compute the pattern of C = A*B.
+template <typename T>
+int qbSpGEMMSymbolic(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, qbSparseMatrix<T> &C, int accumulator = QBSPGEMM_AUTO)
+{
+	if (A.GetNumCols() != B.GetNumRows())
+		return QBSPGEMM_DIMENSIONMISMATCH;
+
+	return qbSpGEMMKernels::Symbolic(A, B, false, C, accumulator);
+}
+
+// The numeric phase: compute the values of C = A*B, with C already holding the pattern.
+template <typename T>
+int qbSpGEMMNumeric(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, qbSparseMatrix<T> &C, int accumulator = QBSPGEMM_AUTO)
+{
+	if (A.GetNumCols() != B.GetNumRows())
+		return QBSPGEMM_DIMENSIONMISMATCH;
+
+	return qbSpGEMMKernels::Numeric(A, B, false, C, accumulator);
+}
+
+// Compute C = A*B.
+template <typename T>
+int qbSpGEMM(const qbSparseMatrix<T> &A, const qbSparseMatrix<T> &B, qbSparseMatrix<T> &C, int accumulator = QBSPGEMM_AUTO)
+{
+	if (A.GetNumCols() != B.GetNumRows())
+		return QBSPGEMM_DIMENSIONMISMATCH;
+
+	return qbSpGEMMKernels::Product(A, B, false, C, accumulator);
+}
+
+// Compute C = A'*A, forming only the upper triangle of the product.
+template <typename T>
+int qbSpGEMMAtA(const qbSparseMatrix<T> &A, qbSparseMatrix<T> &C, int accumulator = QBSPGEMM_AUTO)
+{
+	qbSparseMatrix<T> At = A.Transpose();
+	qbSparseMatrix<T> U;
+	int flag = qbSpGEMMKernels::Product(At, A, true, U, accumulator);
+	if (flag != 1)
+		return flag;
+
+	qbSpGEMMKernels::SymmetricFromUpper(U, C);
+	return 1;
+}
+
+#endif
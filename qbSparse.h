@@ -0,0 +1,402 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBSPARSE_H
+#define QBSPARSE_H
+
+/* *************************************************************************************************
+
+	qbSparseMatrix
+
+	Class to store a sparse matrix in compressed sparse row (CSR) format. Row i of the matrix
+	occupies entries m_rowPtr[i] to m_rowPtr[i+1]-1 of m_colIndex and m_values, with the column
+	indices of each row stored in increasing order. Storage is O(rows + non-zeros), so matrices
+	with millions of rows and a handful of entries per row (finite difference and finite element
+	operators, graph Laplacians, design matrices) fit comfortably in memory.
+
+	A sparse matrix can be built from (row, column, value) triplets, in any order (duplicate
+	entries are summed, as in finite element assembly), from a dense qbMatrix2, or directly from
+	CSR arrays. Once built, the values can be changed in place through GetValues() without
+	changing the sparsity pattern, which allows setup work that depends only on the pattern to
+	be reused.
+
+	Products with vectors are computed in parallel over the rows.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+
+#include "qbMatrix.h"
+#include "qbVector.h"
+#include "qbParallel.h"
+
+// The minimum number of rows given to each thread in the parallel kernels.
+constexpr size_t QBSPARSE_MINROWSPERTHREAD = 4096;
+
+template <class T>
+class qbSparseMatrix {
+public:
+	// Define the various constructors.
+	qbSparseMatrix();
+	qbSparseMatrix(int nRows, int nCols);
+	qbSparseMatrix(int nRows, int nCols, const std::vector<int>& rowIndex, const std::vector<int>& colIndex, const std::vector<T>& values);
+	explicit qbSparseMatrix(const qbMatrix2<T>& denseMatrix, T dropTolerance = static_cast<T>(0.0));
+
+	// Configuration methods.
+	void SetCSR(int nRows, int nCols, const std::vector<int>& rowPtr, const std::vector<int>& colIndex, const std::vector<T>& values);
+
+	// Element access methods.
+	T GetElement(int row, int col) const;
+	int GetNumRows() const;
+	int GetNumCols() const;
+	int GetNumNonZeros() const;
+
+	// Direct access to the CSR arrays.
+	const std::vector<int>& GetRowPtr() const;
+	const std::vector<int>& GetColIndex() const;
+	const std::vector<T>& GetValues() const;
+	std::vector<T>& GetValues();
+	bool SamePattern(const qbSparseMatrix<T>& other) const;
+
+	// Compute y = A*x and y = A'*x.
+	void Multiply(const std::vector<T>& x, std::vector<T>& y) const;
+	void MultiplyTranspose(const std::vector<T>& x, std::vector<T>& y) const;
+
+	// Manipulation methods.
+	std::vector<T> Diagonal() const;
+	qbSparseMatrix<T> Transpose() const;
+	qbMatrix2<T> ToDense() const;
+
+	// Overload the * operator for qbSparseMatrix * qbVector and qbSparseMatrix * qbSparseMatrix.
+	template <class U> friend qbVector<U> operator* (const qbSparseMatrix<U>& lhs, const qbVector<U>& rhs);
+	template <class U> friend qbSparseMatrix<U> operator* (const qbSparseMatrix<U>& lhs, const qbSparseMatrix<U>& rhs);
+
+private:
+	int m_nRows, m_nCols;
+	std::vector<int> m_rowPtr;
+	std::vector<int> m_colIndex;
+	std::vector<T> m_values;
+};
+
+/* **************************************************************************************************
+CONSTRUCTOR FUNCTIONS
+/* *************************************************************************************************/
+// The default constructor.
+template <class T>
+qbSparseMatrix<T>::qbSparseMatrix() {
+	m_nRows = 0;
+	m_nCols = 0;
+	m_rowPtr.assign(1, 0);
+}
+
+// Construct an empty (all zero) matrix.
+template <class T>
+qbSparseMatrix<T>::qbSparseMatrix(int nRows, int nCols) {
+	m_nRows = nRows;
+	m_nCols = nCols;
+	m_rowPtr.assign(nRows + 1, 0);
+}
+
+// Construct from (row, column, value) triplets. Duplicates are summed.
+template <class T>
+qbSparseMatrix<T>::qbSparseMatrix(int nRows, int nCols, const std::vector<int>& rowIndex, const std::vector<int>& colIndex, const std::vector<T>& values) {
+	if((rowIndex.size() != colIndex.size()) or (rowIndex.size() != values.size()))
+		throw std::invalid_argument("The triplet arrays must all have the same length.");
+
+	m_nRows = nRows;
+	m_nCols = nCols;
+	size_t numTriplets = values.size();
+
+	// Count the entries in each row and bucket the triplets by row.
+	std::vector<int> rowCount(nRows + 1, 0);
+	for(size_t k = 0; k < numTriplets; ++k) {
+		if((rowIndex[k] < 0) or (rowIndex[k] >= nRows) or (colIndex[k] < 0) or (colIndex[k] >= nCols))
+			throw std::invalid_argument("Triplet index out of range.");
+		rowCount[rowIndex[k] + 1]++;
+	}
+	std::partial_sum(rowCount.begin(), rowCount.end(), rowCount.begin());
+
+	std::vector<int> bucketCol(numTriplets);
+	std::vector<T> bucketValue(numTriplets);
+	std::vector<int> next(rowCount.begin(), rowCount.end() - 1);
+	for(size_t k = 0; k < numTriplets; ++k) {
+		int position = next[rowIndex[k]]++;
+		bucketCol[position] = colIndex[k];
+		bucketValue[position] = values[k];
+	}
+
+	// Sort each row by column and sum any duplicates.
+	m_rowPtr.assign(nRows + 1, 0);
+	m_colIndex.reserve(numTriplets);
+	m_values.reserve(numTriplets);
+	std::vector<int> order;
+	for(int i = 0; i < nRows; ++i) {
+		int start = rowCount[i];
+		int end = rowCount[i + 1];
+		order.resize(end - start);
+		std::iota(order.begin(), order.end(), start);
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return bucketCol[a] < bucketCol[b]; });
+		for(size_t k = 0; k < order.size(); ++k) {
+			int col = bucketCol[order[k]];
+			if((k > 0) and (col == m_colIndex.back()))
+				m_values.back() += bucketValue[order[k]];
+			else {
+				m_colIndex.push_back(col);
+				m_values.push_back(bucketValue[order[k]]);
+			}
+		}
+		m_rowPtr[i + 1] = m_colIndex.size();
+	}
+}
+
+// Construct from a dense matrix, dropping entries with magnitude <= dropTolerance.
+template <class T>
+qbSparseMatrix<T>::qbSparseMatrix(const qbMatrix2<T>& denseMatrix, T dropTolerance) {
+	m_nRows = denseMatrix.GetNumRows();
+	m_nCols = denseMatrix.GetNumCols();
+	m_rowPtr.assign(m_nRows + 1, 0);
+	const T* data = denseMatrix.GetData();
+	for(int i = 0; i < m_nRows; ++i) {
+		for(int j = 0; j < m_nCols; ++j) {
+			T value = data[static_cast<size_t>(i) * m_nCols + j];
+			if(fabs(value) > dropTolerance) {
+				m_colIndex.push_back(j);
+				m_values.push_back(value);
+			}
+		}
+		m_rowPtr[i + 1] = m_colIndex.size();
+	}
+}
+
+/* **************************************************************************************************
+CONFIGURATION FUNCTIONS
+/* *************************************************************************************************/
+// Set the matrix directly from CSR arrays (column indices must be sorted within each row).
+template <class T>
+void qbSparseMatrix<T>::SetCSR(int nRows, int nCols, const std::vector<int>& rowPtr, const std::vector<int>& colIndex, const std::vector<T>& values) {
+	if((static_cast<int>(rowPtr.size()) != nRows + 1) or (colIndex.size() != values.size()) or (rowPtr.back() != static_cast<int>(values.size())))
+		throw std::invalid_argument("Inconsistent CSR arrays.");
+
+	m_nRows = nRows;
+	m_nCols = nCols;
+	m_rowPtr = rowPtr;
+	m_colIndex = colIndex;
+	m_values = values;
+}
+
+/* **************************************************************************************************
+ELEMENT ACCESS FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+T qbSparseMatrix<T>::GetElement(int row, int col) const {
+	if((row < 0) or (row >= m_nRows) or (col < 0) or (col >= m_nCols))
+		throw std::invalid_argument("Matrix index out of range");
+
+	auto first = m_colIndex.begin() + m_rowPtr[row];
+	auto last = m_colIndex.begin() + m_rowPtr[row + 1];
+	auto position = std::lower_bound(first, last, col);
+	if((position != last) and (*position == col))
+		return m_values[position - m_colIndex.begin()];
+
+	return static_cast<T>(0.0);
+}
+
+template <class T>
+int qbSparseMatrix<T>::GetNumRows() const {
+	return m_nRows;
+}
+
+template <class T>
+int qbSparseMatrix<T>::GetNumCols() const {
+	return m_nCols;
+}
+
+template <class T>
+int qbSparseMatrix<T>::GetNumNonZeros() const {
+	return m_values.size();
+}
+
+template <class T>
+const std::vector<int>& qbSparseMatrix<T>::GetRowPtr() const {
+	return m_rowPtr;
+}
+
+template <class T>
+const std::vector<int>& qbSparseMatrix<T>::GetColIndex() const {
+	return m_colIndex;
+}
+
+template <class T>
+const std::vector<T>& qbSparseMatrix<T>::GetValues() const {
+	return m_values;
+}
+
+// Mutable access to the values only, so the sparsity pattern cannot change.
+template <class T>
+std::vector<T>& qbSparseMatrix<T>::GetValues() {
+	return m_values;
+}
+
+// Test whether two matrices have the same dimensions and sparsity pattern.
+template <class T>
+bool qbSparseMatrix<T>::SamePattern(const qbSparseMatrix<T>& other) const {
+	return (m_nRows == other.m_nRows) and (m_nCols == other.m_nCols) and (m_rowPtr == other.m_rowPtr) and (m_colIndex == other.m_colIndex);
+}
+
+/* **************************************************************************************************
+MATRIX-VECTOR PRODUCTS
+/* *************************************************************************************************/
+// Compute y = A*x, in parallel over the rows.
+template <class T>
+void qbSparseMatrix<T>::Multiply(const std::vector<T>& x, std::vector<T>& y) const {
+	if(static_cast<int>(x.size()) != m_nCols)
+		throw std::invalid_argument("The vector length must equal the number of columns.");
+
+	y.resize(m_nRows);
+	const int* rowPtr = m_rowPtr.data();
+	const int* colIndex = m_colIndex.data();
+	const T* values = m_values.data();
+	const T* xData = x.data();
+	T* yData = y.data();
+	qbParallelFor(m_nRows, QBSPARSE_MINROWSPERTHREAD, [=](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i) {
+			T sum = static_cast<T>(0.0);
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k)
+				sum += values[k] * xData[colIndex[k]];
+			yData[i] = sum;
+		}
+	});
+}
+
+/* Compute y = A'*x. The rows scatter into y, so this is done sequentially; for repeated
+	products it is faster to form the transpose once and use Multiply. */
+template <class T>
+void qbSparseMatrix<T>::MultiplyTranspose(const std::vector<T>& x, std::vector<T>& y) const {
+	if(static_cast<int>(x.size()) != m_nRows)
+		throw std::invalid_argument("The vector length must equal the number of rows.");
+
+	y.assign(m_nCols, static_cast<T>(0.0));
+	for(int i = 0; i < m_nRows; ++i) {
+		T xi = x[i];
+		for(int k = m_rowPtr[i]; k < m_rowPtr[i + 1]; ++k)
+			y[m_colIndex[k]] += m_values[k] * xi;
+	}
+}
+
+/* **************************************************************************************************
+MANIPULATION FUNCTIONS
+/* *************************************************************************************************/
+// Return the diagonal (zero where there is no stored diagonal entry).
+template <class T>
+std::vector<T> qbSparseMatrix<T>::Diagonal() const {
+	int n = std::min(m_nRows, m_nCols);
+	std::vector<T> diagonal(n, static_cast<T>(0.0));
+	for(int i = 0; i < n; ++i) {
+		for(int k = m_rowPtr[i]; k < m_rowPtr[i + 1]; ++k) {
+			if(m_colIndex[k] == i) {
+				diagonal[i] = m_values[k];
+				break;
+			}
+		}
+	}
+	return diagonal;
+}
+
+// Return the transpose (a counting sort of the entries by column, so rows stay sorted).
+template <class T>
+qbSparseMatrix<T> qbSparseMatrix<T>::Transpose() const {
+	qbSparseMatrix<T> result(m_nCols, m_nRows);
+	int numNonZeros = m_values.size();
+	result.m_colIndex.resize(numNonZeros);
+	result.m_values.resize(numNonZeros);
+
+	for(int k = 0; k < numNonZeros; ++k)
+		result.m_rowPtr[m_colIndex[k] + 1]++;
+	std::partial_sum(result.m_rowPtr.begin(), result.m_rowPtr.end(), result.m_rowPtr.begin());
+
+	std::vector<int> next(result.m_rowPtr.begin(), result.m_rowPtr.end() - 1);
+	for(int i = 0; i < m_nRows; ++i) {
+		for(int k = m_rowPtr[i]; k < m_rowPtr[i + 1]; ++k) {
+			int position = next[m_colIndex[k]]++;
+			result.m_colIndex[position] = i;
+			result.m_values[position] = m_values[k];
+		}
+	}
+	return result;
+}
+
+// Convert to a dense matrix.
+template <class T>
+qbMatrix2<T> qbSparseMatrix<T>::ToDense() const {
+	qbMatrix2<T> result(m_nRows, m_nCols);
+	T* data = result.GetData();
+	for(int i = 0; i < m_nRows; ++i) {
+		for(int k = m_rowPtr[i]; k < m_rowPtr[i + 1]; ++k)
+			data[static_cast<size_t>(i) * m_nCols + m_colIndex[k]] = m_values[k];
+	}
+	return result;
+}
+
+/* **************************************************************************************************
+THE * OPERATOR
+/* *************************************************************************************************/
+// qbSparseMatrix * qbVector.
+template <class T>
+qbVector<T> operator* (const qbSparseMatrix<T>& lhs, const qbVector<T>& rhs) {
+	std::vector<T> y;
+	lhs.Multiply(rhs.data(), y);
+	return qbVector<T>(y);
+}
+
+/* qbSparseMatrix * qbSparseMatrix, by rows (Gustavson's algorithm): row i of the result
+	is the sum of the rows of rhs selected by the entries of row i of lhs, accumulated
+	in a dense array with a marker to record which columns have been touched. This is
+	sequential; see qbSpGEMM.h for a parallel version with reuse of the pattern. */
+template <class T>
+qbSparseMatrix<T> operator* (const qbSparseMatrix<T>& lhs, const qbSparseMatrix<T>& rhs) {
+	if(lhs.m_nCols != rhs.m_nRows)
+		throw std::invalid_argument("Left hand matrix columns must equal right hand matrix rows.");
+
+	qbSparseMatrix<T> result(lhs.m_nRows, rhs.m_nCols);
+	std::vector<T> accumulator(rhs.m_nCols, static_cast<T>(0.0));
+	std::vector<int> marker(rhs.m_nCols, -1);
+	std::vector<int> rowColumns;
+	for(int i = 0; i < lhs.m_nRows; ++i) {
+		rowColumns.clear();
+		for(int ka = lhs.m_rowPtr[i]; ka < lhs.m_rowPtr[i + 1]; ++ka) {
+			int k = lhs.m_colIndex[ka];
+			T aik = lhs.m_values[ka];
+			for(int kb = rhs.m_rowPtr[k]; kb < rhs.m_rowPtr[k + 1]; ++kb) {
+				int j = rhs.m_colIndex[kb];
+				if(marker[j] != i) {
+					marker[j] = i;
+					accumulator[j] = static_cast<T>(0.0);
+					rowColumns.push_back(j);
+				}
+				accumulator[j] += aik * rhs.m_values[kb];
+			}
+		}
+		std::sort(rowColumns.begin(), rowColumns.end());
+		for(int j : rowColumns) {
+			result.m_colIndex.push_back(j);
+			result.m_values.push_back(accumulator[j]);
+		}
+		result.m_rowPtr[i + 1] = result.m_colIndex.size();
+	}
+	return result;
+}
+
+#endif
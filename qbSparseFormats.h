@@ -0,0 +1,780 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBSPARSEFORMATS_H
+#define QBSPARSEFORMATS_H
+
+/* *************************************************************************************************
+
+	qbSparseFormats
+
+	Alternative sparse matrix storage formats, designed to make the sparse matrix-vector product
+	(SpMV) vectorize well, together with a heuristic to choose between them. Both formats are
+	built from a qbSparseMatrix (CSR), and both compute y = A*x in parallel.
+
+	In CSR the inner loop of SpMV runs along a single row, so when rows are short (a handful of
+	entries, as in most discretizations) the SIMD units are mostly idle, and every value needs
+	its own column index.
+
+	qbBSRMatrix		Block sparse row format. The matrix is divided into dense r x c blocks, and only
+					the non-zero blocks are stored, with one column index per block. Matrices from
+					finite element discretizations with several unknowns per node (displacement
+					components, velocity and pressure, ...) are made up of exactly such blocks, so
+					no explicit zeros are stored, the index storage falls by a factor of r*c, and
+					the fixed size block product keeps the block of x and the partial sums in
+					registers across each block row.
+
+	qbSELLMatrix	SELL-C-sigma format (Kreutzer et al., SIAM J. Sci. Comput. 36(5), 2014). Rows
+					are sorted by length within windows of sigma rows, then grouped into chunks of
+					C rows, and each chunk is padded to its longest row and stored column by column.
+					The inner loop then runs across the C rows of a chunk, which is exactly a SIMD
+					operation (with a gather of x), whatever the row lengths. Sorting keeps the
+					padding small, while the window keeps the reordering local, so accesses to x
+					stay cache friendly.
+
+	qbSelectSparseFormat	Chooses a format from the structure of the matrix, with a simple cost
+					model (the bytes moved per product, plus a fixed cost per row). BSR wins
+					when the matrix has a natural block size (the non-zero blocks are mostly
+					full), SELL when the rows are short and similar enough in length for the
+					padding to be small, and CSR otherwise (long or very irregular rows).
+
+	qbSparseMatVec	Converts a matrix to the given (or automatically selected) format and returns
+					a matrix-vector product callback, for use with the iterative solvers (qbCG,
+					qbLSQR, ...).
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <functional>
+#include <memory>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "qbSparse.h"
+#include "qbParallel.h"
+
+// Define the format types.
+constexpr int QBSPARSE_AUTO = 0;
+constexpr int QBSPARSE_CSR = 1;
+constexpr int QBSPARSE_BSR = 2;
+constexpr int QBSPARSE_SELL = 3;
+
+// Default parameters for the SELL-C-sigma format.
+constexpr int QBSPARSE_SELLCHUNKSIZE = 8;
+constexpr int QBSPARSE_SELLSIGMA = 256;
+
+/* Parameters of the cost model used to select a format: the fixed cost of the inner loop over
+	a (block) row, in stored entries, and the fraction of the cost of CSR that another format
+	must come below to be chosen. */
+constexpr double QBSPARSE_ROWOVERHEAD = 8.0;
+constexpr double QBSPARSE_MINGAIN = 0.8;
+
+namespace qbSparseFormatKernels
+{
+
+/* Product of the block rows [first, last) of a BSR matrix, with compile-time block size R x C.
+	Blocks are stored column by column, so each column of a block is added to the R partial
+	sums with one element of x, and the loop over the rows of the block can be vectorized. */
+template <class T, int R, int C>
+void BSRRows(const int* blockRowPtr, const int* blockColIndex, const T* blockValues, size_t first, size_t last,
+	const T* x, T* y, int nRows) {
+	for(size_t br = first; br < last; ++br) {
+		T sum[R] = {};
+		int k1 = blockRowPtr[br + 1];
+		for(int k = blockRowPtr[br]; k < k1; ++k) {
+			const T* block = blockValues + static_cast<size_t>(k) * R * C;
+			const T* xBlock = x + static_cast<size_t>(blockColIndex[k]) * C;
+			for(int jj = 0; jj < C; ++jj) {
+				T xj = xBlock[jj];
+				for(int ii = 0; ii < R; ++ii)
+					sum[ii] += block[jj * R + ii] * xj;
+			}
+		}
+		int rowStart = br * R;
+		int count = std::min(R, nRows - rowStart);
+		for(int ii = 0; ii < count; ++ii)
+			y[rowStart + ii] = sum[ii];
+	}
+}
+
+/* The same product for 3 x 3 blocks, written out so that the partial sums and the block of x
+	stay in registers across the block row (compilers do not always unroll the loops above, and
+	then every update goes through memory). */
+template <class T>
+void BSRRows3x3(const int* blockRowPtr, const int* blockColIndex, const T* blockValues, size_t first, size_t last,
+	const T* x, T* y, int nRows) {
+	for(size_t br = first; br < last; ++br) {
+		T sum0 = static_cast<T>(0.0);
+		T sum1 = static_cast<T>(0.0);
+		T sum2 = static_cast<T>(0.0);
+		int k1 = blockRowPtr[br + 1];
+		for(int k = blockRowPtr[br]; k < k1; ++k) {
+			const T* block = blockValues + static_cast<size_t>(k) * 9;
+			const T* xBlock = x + static_cast<size_t>(blockColIndex[k]) * 3;
+			T x0 = xBlock[0];
+			T x1 = xBlock[1];
+			T x2 = xBlock[2];
+			sum0 += block[0] * x0 + block[3] * x1 + block[6] * x2;
+			sum1 += block[1] * x0 + block[4] * x1 + block[7] * x2;
+			sum2 += block[2] * x0 + block[5] * x1 + block[8] * x2;
+		}
+		T sum[3] = {sum0, sum1, sum2};
+		int rowStart = br * 3;
+		int count = std::min(3, nRows - rowStart);
+		for(int ii = 0; ii < count; ++ii)
+			y[rowStart + ii] = sum[ii];
+	}
+}
+
+// The same product for 4 x 4 blocks.
+template <class T>
+void BSRRows4x4(const int* blockRowPtr, const int* blockColIndex, const T* blockValues, size_t first, size_t last,
+	const T* x, T* y, int nRows) {
+	for(size_t br = first; br < last; ++br) {
+		T sum0 = static_cast<T>(0.0);
+		T sum1 = static_cast<T>(0.0);
+		T sum2 = static_cast<T>(0.0);
+		T sum3 = static_cast<T>(0.0);
+		int k1 = blockRowPtr[br + 1];
+		for(int k = blockRowPtr[br]; k < k1; ++k) {
+			const T* block = blockValues + static_cast<size_t>(k) * 16;
+			const T* xBlock = x + static_cast<size_t>(blockColIndex[k]) * 4;
+			T x0 = xBlock[0];
+			T x1 = xBlock[1];
+			T x2 = xBlock[2];
+			T x3 = xBlock[3];
+			sum0 += block[0] * x0 + block[4] * x1 + block[8] * x2 + block[12] * x3;
+			sum1 += block[1] * x0 + block[5] * x1 + block[9] * x2 + block[13] * x3;
+			sum2 += block[2] * x0 + block[6] * x1 + block[10] * x2 + block[14] * x3;
+			sum3 += block[3] * x0 + block[7] * x1 + block[11] * x2 + block[15] * x3;
+		}
+		T sum[4] = {sum0, sum1, sum2, sum3};
+		int rowStart = br * 4;
+		int count = std::min(4, nRows - rowStart);
+		for(int ii = 0; ii < count; ++ii)
+			y[rowStart + ii] = sum[ii];
+	}
+}
+
+#if defined(__AVX2__)
+// Explicit AVX2 version for double precision: the four partial sums are one register, and each
+// column of the block is added with a broadcast element of x.
+template <>
+inline void BSRRows4x4<double>(const int* blockRowPtr, const int* blockColIndex, const double* blockValues, size_t first, size_t last,
+	const double* x, double* y, int nRows) {
+	for(size_t br = first; br < last; ++br) {
+		__m256d sum = _mm256_setzero_pd();
+		int k1 = blockRowPtr[br + 1];
+		for(int k = blockRowPtr[br]; k < k1; ++k) {
+			const double* block = blockValues + static_cast<size_t>(k) * 16;
+			const double* xBlock = x + static_cast<size_t>(blockColIndex[k]) * 4;
+			for(int jj = 0; jj < 4; ++jj) {
+#if defined(__FMA__)
+				sum = _mm256_fmadd_pd(_mm256_loadu_pd(block + jj * 4), _mm256_broadcast_sd(xBlock + jj), sum);
+#else
+				sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(block + jj * 4), _mm256_broadcast_sd(xBlock + jj)));
+#endif
+			}
+		}
+		int rowStart = br * 4;
+		if(rowStart + 4 <= nRows) {
+			_mm256_storeu_pd(y + rowStart, sum);
+		} else {
+			double sumLocal[4];
+			_mm256_storeu_pd(sumLocal, sum);
+			for(int ii = 0; ii < nRows - rowStart; ++ii)
+				y[rowStart + ii] = sumLocal[ii];
+		}
+	}
+}
+#endif
+
+// Product of the block rows [first, last) of a BSR matrix, with run-time block size.
+template <class T>
+void BSRRows(const int* blockRowPtr, const int* blockColIndex, const T* blockValues, size_t first, size_t last,
+	const T* x, T* y, int nRows, int R, int C) {
+	std::vector<T> sum(R);
+	for(size_t br = first; br < last; ++br) {
+		std::fill(sum.begin(), sum.end(), static_cast<T>(0.0));
+		for(int k = blockRowPtr[br]; k < blockRowPtr[br + 1]; ++k) {
+			const T* block = blockValues + static_cast<size_t>(k) * R * C;
+			const T* xBlock = x + static_cast<size_t>(blockColIndex[k]) * C;
+			for(int jj = 0; jj < C; ++jj) {
+				for(int ii = 0; ii < R; ++ii)
+					sum[ii] += block[jj * R + ii] * xBlock[jj];
+			}
+		}
+		int rowStart = br * R;
+		int count = std::min(R, nRows - rowStart);
+		for(int ii = 0; ii < count; ++ii)
+			y[rowStart + ii] = sum[ii];
+	}
+}
+
+/* Product of one chunk of a SELL matrix with compile-time chunk size C. The inner loop runs
+	across the rows of the chunk, so it vectorizes (with a gather of x). */
+template <class T, int C>
+inline void SELLChunk(const int* colIndex, const T* values, int length, const T* x, T* sum) {
+	for(int r = 0; r < C; ++r)
+		sum[r] = static_cast<T>(0.0);
+	for(int k = 0; k < length; ++k) {
+		const int* col = colIndex + static_cast<size_t>(k) * C;
+		const T* value = values + static_cast<size_t>(k) * C;
+		for(int r = 0; r < C; ++r)
+			sum[r] += value[r] * x[col[r]];
+	}
+}
+
+#if defined(__AVX2__)
+// Explicit AVX2 version for double precision with C = 8: two 4-wide gathers per column.
+template <>
+inline void SELLChunk<double, 8>(const int* colIndex, const double* values, int length, const double* x, double* sum) {
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d mask = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+	__m256d sum0 = zero;
+	__m256d sum1 = zero;
+	for(int k = 0; k < length; ++k) {
+		const int* col = colIndex + static_cast<size_t>(k) * 8;
+		const double* value = values + static_cast<size_t>(k) * 8;
+		__m256d x0 = _mm256_mask_i32gather_pd(zero, x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(col)), mask, 8);
+		__m256d x1 = _mm256_mask_i32gather_pd(zero, x, _mm_loadu_si128(reinterpret_cast<const __m128i*>(col + 4)), mask, 8);
+#if defined(__FMA__)
+		sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(value), x0, sum0);
+		sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(value + 4), x1, sum1);
+#else
+		sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(_mm256_loadu_pd(value), x0));
+		sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(_mm256_loadu_pd(value + 4), x1));
+#endif
+	}
+	_mm256_storeu_pd(sum, sum0);
+	_mm256_storeu_pd(sum + 4, sum1);
+}
+#endif
+
+// Product of the chunks [first, last) of a SELL matrix, with compile-time chunk size C.
+template <class T, int C>
+void SELLChunks(const int* chunkPtr, const int* chunkLength, const int* colIndex, const T* values, const int* rowOrder,
+	size_t first, size_t last, const T* x, T* y, int nRows) {
+	T sum[C];
+	for(size_t c = first; c < last; ++c) {
+		SELLChunk<T, C>(colIndex + chunkPtr[c], values + chunkPtr[c], chunkLength[c], x, sum);
+		int positionStart = c * C;
+		int count = std::min(C, nRows - positionStart);
+		for(int r = 0; r < count; ++r)
+			y[rowOrder[positionStart + r]] = sum[r];
+	}
+}
+
+// Product of the chunks [first, last) of a SELL matrix, with run-time chunk size.
+template <class T>
+void SELLChunks(const int* chunkPtr, const int* chunkLength, const int* colIndex, const T* values, const int* rowOrder,
+	size_t first, size_t last, const T* x, T* y, int nRows, int C) {
+	std::vector<T> sum(C);
+	for(size_t c = first; c < last; ++c) {
+		std::fill(sum.begin(), sum.end(), static_cast<T>(0.0));
+		for(int k = 0; k < chunkLength[c]; ++k) {
+			const int* col = colIndex + chunkPtr[c] + static_cast<size_t>(k) * C;
+			const T* value = values + chunkPtr[c] + static_cast<size_t>(k) * C;
+			for(int r = 0; r < C; ++r)
+				sum[r] += value[r] * x[col[r]];
+		}
+		int positionStart = c * C;
+		int count = std::min(C, nRows - positionStart);
+		for(int r = 0; r < count; ++r)
+			y[rowOrder[positionStart + r]] = sum[r];
+	}
+}
+
+/* Compute the sorting permutation and chunk lengths for SELL-C-sigma: rows are sorted by
+	decreasing length within each window of sigma rows. */
+inline void SELLLayout(const std::vector<int>& rowPtr, int numRows, int chunkSize, int sigma,
+	std::vector<int>& rowOrder, std::vector<int>& chunkLength) {
+	rowOrder.resize(numRows);
+	std::iota(rowOrder.begin(), rowOrder.end(), 0);
+	auto length = [&rowPtr](int i) { return rowPtr[i + 1] - rowPtr[i]; };
+	for(int start = 0; start < numRows; start += sigma) {
+		int end = std::min(numRows, start + sigma);
+		std::stable_sort(rowOrder.begin() + start, rowOrder.begin() + end, [&](int a, int b) { return length(a) > length(b); });
+	}
+
+	int numChunks = (numRows + chunkSize - 1) / chunkSize;
+	chunkLength.assign(numChunks, 0);
+	for(int position = 0; position < numRows; ++position)
+		chunkLength[position / chunkSize] = std::max(chunkLength[position / chunkSize], length(rowOrder[position]));
+}
+
+// Bytes moved per stored entry: its value, its column index and the element of x it reads.
+template <class T>
+double EntryBytes() {
+	return 2.0 * sizeof(T) + sizeof(int);
+}
+
+/* Cost of one BSR product with r x r blocks, in bytes moved: each block with its index and
+	the block of x it reads, and for each block row its pointer, its elements of y and the
+	fixed loop overhead. */
+template <class T>
+double BSRCost(const std::vector<int>& rowPtr, const std::vector<int>& colIndex, int nRows, int nCols, int r) {
+	int numBlockRows = (nRows + r - 1) / r;
+	std::vector<int> marker((nCols + r - 1) / r, -1);
+	long long numBlocks = 0;
+	for(int br = 0; br < numBlockRows; ++br) {
+		int lastRow = std::min(nRows, (br + 1) * r);
+		for(int i = br * r; i < lastRow; ++i) {
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+				int bc = colIndex[k] / r;
+				if(marker[bc] != br) {
+					marker[bc] = br;
+					numBlocks++;
+				}
+			}
+		}
+	}
+	return numBlocks * (r * r * sizeof(T) + r * sizeof(T) + sizeof(int))
+		+ numBlockRows * (sizeof(int) + r * sizeof(T) + QBSPARSE_ROWOVERHEAD * EntryBytes<T>());
+}
+
+// The BSR block size (4, 3 or 2) with the lowest cost, which is returned in cost.
+template <class T>
+int BSRBlockSize(const std::vector<int>& rowPtr, const std::vector<int>& colIndex, int nRows, int nCols, double& cost) {
+	int blockSize = 4;
+	cost = BSRCost<T>(rowPtr, colIndex, nRows, nCols, 4);
+	for(int r = 3; r >= 2; --r) {
+		double rCost = BSRCost<T>(rowPtr, colIndex, nRows, nCols, r);
+		if(rCost < cost) {
+			blockSize = r;
+			cost = rCost;
+		}
+	}
+	return blockSize;
+}
+
+}
+
+/* **************************************************************************************************
+THE BSR FORMAT
+/* *************************************************************************************************/
+template <class T>
+class qbBSRMatrix {
+public:
+	// Define the various constructors.
+	qbBSRMatrix();
+	qbBSRMatrix(const qbSparseMatrix<T>& A, int blockRows, int blockCols);
+
+	// Element access methods.
+	int GetNumRows() const;
+	int GetNumCols() const;
+	int GetBlockRows() const;
+	int GetBlockCols() const;
+	int GetNumBlocks() const;
+	// The fraction of the stored block entries that are non-zeros of the original matrix.
+	double GetFillRatio() const;
+
+	// Compute y = A*x.
+	void Multiply(const std::vector<T>& x, std::vector<T>& y) const;
+
+	// Convert back to CSR (explicit zeros in the blocks are dropped).
+	qbSparseMatrix<T> ToCSR() const;
+
+private:
+	int m_nRows, m_nCols;
+	int m_blockRows, m_blockCols;
+	int m_numBlockRows, m_numBlockCols;
+	int m_originalNonZeros;
+	std::vector<int> m_blockRowPtr;
+	std::vector<int> m_blockColIndex;
+	std::vector<T> m_blockValues;
+};
+
+// The default constructor.
+template <class T>
+qbBSRMatrix<T>::qbBSRMatrix() {
+	m_nRows = m_nCols = 0;
+	m_blockRows = m_blockCols = 1;
+	m_numBlockRows = m_numBlockCols = 0;
+	m_originalNonZeros = 0;
+	m_blockRowPtr.assign(1, 0);
+}
+
+// Convert from CSR. Rows and columns are padded up to a whole number of blocks.
+template <class T>
+qbBSRMatrix<T>::qbBSRMatrix(const qbSparseMatrix<T>& A, int blockRows, int blockCols) {
+	if((blockRows < 1) or (blockCols < 1))
+		throw std::invalid_argument("The block size must be positive.");
+
+	m_nRows = A.GetNumRows();
+	m_nCols = A.GetNumCols();
+	m_blockRows = blockRows;
+	m_blockCols = blockCols;
+	m_numBlockRows = (m_nRows + blockRows - 1) / blockRows;
+	m_numBlockCols = (m_nCols + blockCols - 1) / blockCols;
+	m_originalNonZeros = A.GetNumNonZeros();
+
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	const std::vector<T>& values = A.GetValues();
+	size_t blockSize = static_cast<size_t>(blockRows) * blockCols;
+
+	// Find the non-zero blocks in each block row (sorted, since each row is sorted).
+	std::vector<int> blockPosition(m_numBlockCols, -1);
+	std::vector<int> rowBlocks;
+	m_blockRowPtr.assign(m_numBlockRows + 1, 0);
+	for(int br = 0; br < m_numBlockRows; ++br) {
+		rowBlocks.clear();
+		int lastRow = std::min(m_nRows, (br + 1) * blockRows);
+		for(int i = br * blockRows; i < lastRow; ++i) {
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+				int bc = colIndex[k] / blockCols;
+				if(blockPosition[bc] < 0) {
+					blockPosition[bc] = 0;
+					rowBlocks.push_back(bc);
+				}
+			}
+		}
+		std::sort(rowBlocks.begin(), rowBlocks.end());
+		for(size_t k = 0; k < rowBlocks.size(); ++k) {
+			blockPosition[rowBlocks[k]] = m_blockColIndex.size();
+			m_blockColIndex.push_back(rowBlocks[k]);
+		}
+		m_blockRowPtr[br + 1] = m_blockColIndex.size();
+
+		// Copy the values into their blocks, which are stored column by column.
+		m_blockValues.resize(m_blockColIndex.size() * blockSize, static_cast<T>(0.0));
+		for(int i = br * blockRows; i < lastRow; ++i) {
+			for(int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+				int bc = colIndex[k] / blockCols;
+				size_t offset = blockPosition[bc] * blockSize + static_cast<size_t>(colIndex[k] - bc * blockCols) * blockRows + (i - br * blockRows);
+				m_blockValues[offset] = values[k];
+			}
+		}
+		for(int bc : rowBlocks)
+			blockPosition[bc] = -1;
+	}
+}
+
+template <class T>
+int qbBSRMatrix<T>::GetNumRows() const {
+	return m_nRows;
+}
+
+template <class T>
+int qbBSRMatrix<T>::GetNumCols() const {
+	return m_nCols;
+}
+
+template <class T>
+int qbBSRMatrix<T>::GetBlockRows() const {
+	return m_blockRows;
+}
+
+template <class T>
+int qbBSRMatrix<T>::GetBlockCols() const {
+	return m_blockCols;
+}
+
+template <class T>
+int qbBSRMatrix<T>::GetNumBlocks() const {
+	return m_blockColIndex.size();
+}
+
+template <class T>
+double qbBSRMatrix<T>::GetFillRatio() const {
+	if(m_blockValues.empty())
+		return 1.0;
+	return static_cast<double>(m_originalNonZeros) / static_cast<double>(m_blockValues.size());
+}
+
+// Compute y = A*x, in parallel over the block rows.
+template <class T>
+void qbBSRMatrix<T>::Multiply(const std::vector<T>& x, std::vector<T>& y) const {
+	if(static_cast<int>(x.size()) != m_nCols)
+		throw std::invalid_argument("The vector length must equal the number of columns.");
+
+	// Pad x if the columns don't divide into whole blocks.
+	std::vector<T> xPadded;
+	const T* xData = x.data();
+	if(m_numBlockCols * m_blockCols != m_nCols) {
+		xPadded.assign(static_cast<size_t>(m_numBlockCols) * m_blockCols, static_cast<T>(0.0));
+		std::copy(x.begin(), x.end(), xPadded.begin());
+		xData = xPadded.data();
+	}
+
+	y.resize(m_nRows);
+	T* yData = y.data();
+	const int* blockRowPtr = m_blockRowPtr.data();
+	const int* blockColIndex = m_blockColIndex.data();
+	const T* blockValues = m_blockValues.data();
+	int R = m_blockRows;
+	int C = m_blockCols;
+	int nRows = m_nRows;
+	size_t minBlockRows = std::max(static_cast<size_t>(1), QBSPARSE_MINROWSPERTHREAD / R);
+	// Use a fixed size kernel for the common square block sizes.
+	qbParallelFor(m_numBlockRows, minBlockRows, [=](size_t first, size_t last) {
+		if((R == 2) and (C == 2))
+			qbSparseFormatKernels::BSRRows<T, 2, 2>(blockRowPtr, blockColIndex, blockValues, first, last, xData, yData, nRows);
+		else if((R == 3) and (C == 3))
+			qbSparseFormatKernels::BSRRows3x3<T>(blockRowPtr, blockColIndex, blockValues, first, last, xData, yData, nRows);
+		else if((R == 4) and (C == 4))
+			qbSparseFormatKernels::BSRRows4x4<T>(blockRowPtr, blockColIndex, blockValues, first, last, xData, yData, nRows);
+		else
+			qbSparseFormatKernels::BSRRows<T>(blockRowPtr, blockColIndex, blockValues, first, last, xData, yData, nRows, R, C);
+	});
+}
+
+// Convert back to CSR.
+template <class T>
+qbSparseMatrix<T> qbBSRMatrix<T>::ToCSR() const {
+	std::vector<int> rows, cols;
+	std::vector<T> values;
+	size_t blockSize = static_cast<size_t>(m_blockRows) * m_blockCols;
+	for(int br = 0; br < m_numBlockRows; ++br) {
+		for(int k = m_blockRowPtr[br]; k < m_blockRowPtr[br + 1]; ++k) {
+			for(int ii = 0; ii < m_blockRows; ++ii) {
+				for(int jj = 0; jj < m_blockCols; ++jj) {
+					T value = m_blockValues[k * blockSize + jj * m_blockRows + ii];
+					if(value != static_cast<T>(0.0)) {
+						rows.push_back(br * m_blockRows + ii);
+						cols.push_back(m_blockColIndex[k] * m_blockCols + jj);
+						values.push_back(value);
+					}
+				}
+			}
+		}
+	}
+	return qbSparseMatrix<T>(m_nRows, m_nCols, rows, cols, values);
+}
+
+/* **************************************************************************************************
+THE SELL-C-SIGMA FORMAT
+/* *************************************************************************************************/
+template <class T>
+class qbSELLMatrix {
+public:
+	// Define the various constructors.
+	qbSELLMatrix();
+	qbSELLMatrix(const qbSparseMatrix<T>& A, int chunkSize = QBSPARSE_SELLCHUNKSIZE, int sigma = QBSPARSE_SELLSIGMA);
+
+	// Element access methods.
+	int GetNumRows() const;
+	int GetNumCols() const;
+	int GetChunkSize() const;
+	// The fraction of the stored entries that are non-zeros (the rest is padding).
+	double GetFillRatio() const;
+
+	// Compute y = A*x.
+	void Multiply(const std::vector<T>& x, std::vector<T>& y) const;
+
+private:
+	int m_nRows, m_nCols;
+	int m_chunkSize, m_sigma;
+	int m_originalNonZeros;
+	std::vector<int> m_rowOrder;
+	std::vector<int> m_chunkPtr;
+	std::vector<int> m_chunkLength;
+	std::vector<int> m_colIndex;
+	std::vector<T> m_values;
+};
+
+// The default constructor.
+template <class T>
+qbSELLMatrix<T>::qbSELLMatrix() {
+	m_nRows = m_nCols = 0;
+	m_chunkSize = QBSPARSE_SELLCHUNKSIZE;
+	m_sigma = QBSPARSE_SELLSIGMA;
+	m_originalNonZeros = 0;
+	m_chunkPtr.assign(1, 0);
+}
+
+// Convert from CSR.
+template <class T>
+qbSELLMatrix<T>::qbSELLMatrix(const qbSparseMatrix<T>& A, int chunkSize, int sigma) {
+	if((chunkSize < 1) or (sigma < 1))
+		throw std::invalid_argument("The chunk size and sorting window must be positive.");
+
+	m_nRows = A.GetNumRows();
+	m_nCols = A.GetNumCols();
+	m_chunkSize = chunkSize;
+	m_sigma = sigma;
+	m_originalNonZeros = A.GetNumNonZeros();
+
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	const std::vector<T>& values = A.GetValues();
+	qbSparseFormatKernels::SELLLayout(rowPtr, m_nRows, chunkSize, sigma, m_rowOrder, m_chunkLength);
+
+	int numChunks = m_chunkLength.size();
+	m_chunkPtr.assign(numChunks + 1, 0);
+	for(int c = 0; c < numChunks; ++c)
+		m_chunkPtr[c + 1] = m_chunkPtr[c] + m_chunkLength[c] * chunkSize;
+
+	/* Fill column by column within each chunk. Padding uses value zero and a column
+		index from the same row (or zero for an empty row), so x stays in bounds. */
+	m_colIndex.assign(m_chunkPtr.back(), 0);
+	m_values.assign(m_chunkPtr.back(), static_cast<T>(0.0));
+	for(int position = 0; position < m_nRows; ++position) {
+		int row = m_rowOrder[position];
+		int c = position / chunkSize;
+		int r = position % chunkSize;
+		int length = rowPtr[row + 1] - rowPtr[row];
+		int padColumn = (length > 0) ? colIndex[rowPtr[row + 1] - 1] : 0;
+		for(int k = 0; k < m_chunkLength[c]; ++k) {
+			size_t offset = m_chunkPtr[c] + static_cast<size_t>(k) * chunkSize + r;
+			if(k < length) {
+				m_colIndex[offset] = colIndex[rowPtr[row] + k];
+				m_values[offset] = values[rowPtr[row] + k];
+			}
+			else {
+				m_colIndex[offset] = padColumn;
+			}
+		}
+	}
+}
+
+template <class T>
+int qbSELLMatrix<T>::GetNumRows() const {
+	return m_nRows;
+}
+
+template <class T>
+int qbSELLMatrix<T>::GetNumCols() const {
+	return m_nCols;
+}
+
+template <class T>
+int qbSELLMatrix<T>::GetChunkSize() const {
+	return m_chunkSize;
+}
+
+template <class T>
+double qbSELLMatrix<T>::GetFillRatio() const {
+	if(m_values.empty())
+		return 1.0;
+	return static_cast<double>(m_originalNonZeros) / static_cast<double>(m_values.size());
+}
+
+// Compute y = A*x, in parallel over the chunks.
+template <class T>
+void qbSELLMatrix<T>::Multiply(const std::vector<T>& x, std::vector<T>& y) const {
+	if(static_cast<int>(x.size()) != m_nCols)
+		throw std::invalid_argument("The vector length must equal the number of columns.");
+
+	y.resize(m_nRows);
+	T* yData = y.data();
+	const T* xData = x.data();
+	const int* chunkPtr = m_chunkPtr.data();
+	const int* chunkLength = m_chunkLength.data();
+	const int* colIndex = m_colIndex.data();
+	const T* values = m_values.data();
+	const int* rowOrder = m_rowOrder.data();
+	int C = m_chunkSize;
+	int nRows = m_nRows;
+	size_t minChunks = std::max(static_cast<size_t>(1), QBSPARSE_MINROWSPERTHREAD / C);
+	// Use a fixed size kernel for the common chunk sizes.
+	qbParallelFor(m_chunkLength.size(), minChunks, [=](size_t first, size_t last) {
+		if(C == 4)
+			qbSparseFormatKernels::SELLChunks<T, 4>(chunkPtr, chunkLength, colIndex, values, rowOrder, first, last, xData, yData, nRows);
+		else if(C == 8)
+			qbSparseFormatKernels::SELLChunks<T, 8>(chunkPtr, chunkLength, colIndex, values, rowOrder, first, last, xData, yData, nRows);
+		else if(C == 16)
+			qbSparseFormatKernels::SELLChunks<T, 16>(chunkPtr, chunkLength, colIndex, values, rowOrder, first, last, xData, yData, nRows);
+		else
+			qbSparseFormatKernels::SELLChunks<T>(chunkPtr, chunkLength, colIndex, values, rowOrder, first, last, xData, yData, nRows, C);
+	});
+}
+
+/* **************************************************************************************************
+FORMAT SELECTION
+/* *************************************************************************************************/
+/* Choose the storage format for SpMV from the structure of A. For BSR, blockSize is set
+	to the chosen (square) block size.
+
+	Each format is given a cost, in bytes moved per product: the stored values and their
+	indices, the elements of x they read, and for each (block) row its pointer, its element of
+	y and a fixed overhead for starting a short inner loop and reducing its sum. BSR stores
+	explicit zeros but one index per block, and reads x a block at a time. SELL stores the
+	padding but has no per row loop. Since the model is rough, CSR is kept unless another
+	format is clearly cheaper. */
+template <class T>
+int qbSelectSparseFormat(const qbSparseMatrix<T>& A, int& blockSize) {
+	blockSize = 1;
+	int n = A.GetNumRows();
+	int numNonZeros = A.GetNumNonZeros();
+	if((n == 0) or (numNonZeros == 0))
+		return QBSPARSE_CSR;
+
+	const std::vector<int>& rowPtr = A.GetRowPtr();
+	const std::vector<int>& colIndex = A.GetColIndex();
+	double entryBytes = qbSparseFormatKernels::EntryBytes<T>();
+	double csrCost = numNonZeros * entryBytes + n * (sizeof(int) + sizeof(T) + QBSPARSE_ROWOVERHEAD * entryBytes);
+	int bestFormat = QBSPARSE_CSR;
+	double bestCost = QBSPARSE_MINGAIN * csrCost;
+
+	// BSR, with the best block size.
+	double bsrCost;
+	int bsrBlockSize = qbSparseFormatKernels::BSRBlockSize<T>(rowPtr, colIndex, n, A.GetNumCols(), bsrCost);
+	if(bsrCost < bestCost) {
+		bestFormat = QBSPARSE_BSR;
+		bestCost = bsrCost;
+		blockSize = bsrBlockSize;
+	}
+
+	/* SELL, where the cost grows with the padding. After sorting within each window this is
+		small when the row lengths are similar, but very irregular rows, such as a power law
+		distribution with a few rows holding much of the matrix, stay in CSR. */
+	std::vector<int> rowOrder, chunkLength;
+	qbSparseFormatKernels::SELLLayout(rowPtr, n, QBSPARSE_SELLCHUNKSIZE, QBSPARSE_SELLSIGMA, rowOrder, chunkLength);
+	long long stored = 0;
+	for(int length : chunkLength)
+		stored += static_cast<long long>(length) * QBSPARSE_SELLCHUNKSIZE;
+	double sellCost = stored * entryBytes + n * (sizeof(int) + sizeof(T));
+	if(sellCost < bestCost) {
+		bestFormat = QBSPARSE_SELL;
+		blockSize = 1;
+	}
+
+	return bestFormat;
+}
+
+/* Return a matrix-vector product callback for A, stored in the given format (or in the
+	format chosen by qbSelectSparseFormat). For BSR the block size with the lowest modeled cost
+	is used. The callback holds its own copy of the matrix. */
+template <class T>
+std::function<void(const std::vector<T>&, std::vector<T>&)> qbSparseMatVec(const qbSparseMatrix<T>& A, int format = QBSPARSE_AUTO) {
+	int blockSize = 1;
+	if(format == QBSPARSE_AUTO) {
+		format = qbSelectSparseFormat(A, blockSize);
+	} else if(format == QBSPARSE_BSR) {
+		double cost;
+		blockSize = qbSparseFormatKernels::BSRBlockSize<T>(A.GetRowPtr(), A.GetColIndex(), A.GetNumRows(), A.GetNumCols(), cost);
+	}
+
+	if(format == QBSPARSE_BSR) {
+		auto matrix = std::make_shared<qbBSRMatrix<T>>(A, blockSize, blockSize);
+		return [matrix](const std::vector<T>& x, std::vector<T>& y) { matrix->Multiply(x, y); };
+	}
+	if(format == QBSPARSE_SELL) {
+		auto matrix = std::make_shared<qbSELLMatrix<T>>(A);
+		return [matrix](const std::vector<T>& x, std::vector<T>& y) { matrix->Multiply(x, y); };
+	}
+	if(format == QBSPARSE_CSR) {
+		auto matrix = std::make_shared<qbSparseMatrix<T>>(A);
+		return [matrix](const std::vector<T>& x, std::vector<T>& y) { matrix->Multiply(x, y); };
+	}
+	throw std::invalid_argument("Unknown sparse format.");
+}
+
+#endif
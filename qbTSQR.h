@@ -0,0 +1,316 @@
+// This file is part of the qbLinAlg linear algebra library.
+// Copyright (c) 2021 Michael Bennett
+// MIT license
+
+#ifndef QBTSQR_H
+#define QBTSQR_H
+
+/* *************************************************************************************************
+
+	qbTSQR
+
+	Class to compute the thin QR decomposition, A = Q*R, of a tall and skinny [m x n] matrix
+	(m >> n) with the communication-avoiding TSQR algorithm (Demmel, Grigori, Hoemmen and
+	Langou, SIAM J. Sci. Comput. 34(1), 2012).
+
+	A parallel Householder QR of a tall matrix has to synchronize all the threads once for every
+	panel. TSQR instead splits the rows of A into blocks (one per thread by default) and computes
+	the QR factorization of each block independently. The [n x n] R factors are then combined
+	in pairs, up a binary tree: the QR factorization of two stacked R factors gives the R factor
+	of both blocks together, and the R factor at the root of the tree is the R factor of A. The
+	threads only synchronize once per level of the tree, and the leaves (where almost all of the
+	work is) run with no communication at all.
+
+	Q is not formed explicitly. It is the product of the block diagonal matrix of the leaf Q
+	factors and the Q factors of the tree, and the Householder reflectors of every node are kept,
+	so that Q can be applied to a matrix (ApplyQ / ApplyQTranspose) with the same tree, in
+	parallel. This is all that is needed for a least squares solve (qbLSQ uses Q'*y), and GetQ
+	forms the explicit [m x n] matrix when it is needed.
+
+	Factorize returns an INT flag:
+
+						1 Indicates success.
+						-1 indicates failure due to the matrix having more columns than rows.
+
+	ApplyQ and ApplyQTranspose throw std::invalid_argument if the dimensions of the input do not
+	match the factorization. After a factorization the object is only read, so it can be used
+	by several threads at once.
+
+	Created as part of the qbLinAlg linear algebra library, which is intended to be primarily for
+	educational purposes. For more details, see the corresponding videos on the QuantitativeBytes
+	YouTube channel at:
+
+	www.youtube.com/c/QuantitativeBytes
+
+	************************************************************************************************* */
+
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "qbMatrix.h"
+#include "qbHouseholder.h"
+#include "qbParallel.h"
+
+// Define error codes.
+constexpr int QBTSQR_MATRIXTOOWIDE = -1;
+
+template <class T>
+class qbTSQR {
+public:
+	// Define the various constructors.
+	qbTSQR();
+
+	/* Compute the factorization, with the rows split into numBlocks blocks (0 uses one block
+		per thread). Each block needs at least n rows, so fewer blocks may be used. */
+	int Factorize(const qbMatrix2<T>& A, int numBlocks = 0);
+
+	// C = Q*B for an [n x k] matrix B, and C = Q'*B for an [m x k] matrix B.
+	void ApplyQ(const qbMatrix2<T>& B, qbMatrix2<T>& C) const;
+	void ApplyQTranspose(const qbMatrix2<T>& B, qbMatrix2<T>& C) const;
+
+	// Information about the factorization.
+	qbMatrix2<T> GetR() const;
+	qbMatrix2<T> GetQ() const;
+	int GetNumBlocks() const;
+	// The memory used by the stored factorization, in bytes.
+	size_t GetStorageSize() const;
+
+private:
+	/* A node of the reduction tree. Leaves hold a block of rows of A, and the other nodes the
+		two R factors of their children stacked together. After the factorization, data holds
+		the R factor in its upper triangle and the reflectors below it. */
+	struct Node {
+		int numRows;
+		int rowStart;
+		int children[2];
+		std::vector<T> data;
+		std::vector<T> tau;
+	};
+
+	void FactorizeNode(Node& node) const;
+	void CopyR(const Node& node, T* destination) const;
+
+private:
+	int m_numRows, m_numCols, m_numLeaves;
+	std::vector<Node> m_nodes;
+
+	// The nodes created at each level of the tree (the leaves are nodes 0 to m_numLeaves-1).
+	std::vector<std::vector<int>> m_levels;
+};
+
+/* **************************************************************************************************
+CONSTRUCTOR FUNCTIONS
+/* *************************************************************************************************/
+// The default constructor.
+template <class T>
+qbTSQR<T>::qbTSQR() {
+	m_numRows = 0;
+	m_numCols = 0;
+	m_numLeaves = 0;
+}
+
+/* **************************************************************************************************
+FACTORIZATION FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+int qbTSQR<T>::Factorize(const qbMatrix2<T>& A, int numBlocks) {
+	int m = A.GetNumRows();
+	int n = A.GetNumCols();
+	if(m < n)
+		return QBTSQR_MATRIXTOOWIDE;
+
+	if(numBlocks <= 0)
+		numBlocks = static_cast<int>(qbParallelNumThreads());
+	numBlocks = std::max(1, std::min(numBlocks, m / std::max(n, 1)));
+
+	m_numRows = m;
+	m_numCols = n;
+	m_numLeaves = numBlocks;
+	m_nodes.assign(numBlocks, Node());
+	m_levels.clear();
+
+	// The leaves: split the rows as evenly as possible and factorize each block independently.
+	const T* a = A.GetData();
+	for(int b = 0; b < numBlocks; ++b) {
+		Node& leaf = m_nodes[b];
+		leaf.rowStart = static_cast<int>((size_t)b*m / numBlocks);
+		leaf.numRows = static_cast<int>((size_t)(b+1)*m / numBlocks) - leaf.rowStart;
+		leaf.children[0] = leaf.children[1] = -1;
+		leaf.data.assign(a + (size_t)leaf.rowStart*n, a + (size_t)(leaf.rowStart + leaf.numRows)*n);
+	}
+	qbParallelFor(numBlocks, 1, [&](size_t first, size_t last) {
+		for(size_t b = first; b < last; ++b)
+			FactorizeNode(m_nodes[b]);
+	});
+
+	// Combine the R factors in pairs until only the root is left.
+	std::vector<int> current(numBlocks);
+	for(int b = 0; b < numBlocks; ++b)
+		current[b] = b;
+
+	while(current.size() > 1) {
+		std::vector<int> next, created;
+		for(size_t i = 0; i + 1 < current.size(); i += 2) {
+			Node node;
+			node.numRows = 2*n;
+			node.rowStart = -1;
+			node.children[0] = current[i];
+			node.children[1] = current[i+1];
+			node.data.resize((size_t)2*n*n);
+			CopyR(m_nodes[current[i]], node.data.data());
+			CopyR(m_nodes[current[i+1]], node.data.data() + (size_t)n*n);
+			m_nodes.push_back(std::move(node));
+			created.push_back(static_cast<int>(m_nodes.size()) - 1);
+			next.push_back(created.back());
+		}
+
+		// An odd node out moves up to the next level unchanged.
+		if(current.size() % 2 == 1)
+			next.push_back(current.back());
+
+		qbParallelFor(created.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i)
+				FactorizeNode(m_nodes[created[i]]);
+		});
+		m_levels.push_back(created);
+		current = next;
+	}
+
+	return 1;
+}
+
+// Householder QR factorization of the data of one node, in place.
+template <class T>
+void qbTSQR<T>::FactorizeNode(Node& node) const {
+	node.tau.resize(std::min(node.numRows, m_numCols));
+	qbHouseholderKernels::QRFactor(node.numRows, m_numCols, node.data.data(), m_numCols, node.tau.data());
+}
+
+// Copy the R factor of a node to the [n x n] destination, with zeros below the diagonal.
+template <class T>
+void qbTSQR<T>::CopyR(const Node& node, T* destination) const {
+	int n = m_numCols;
+	for(int i = 0; i < n; ++i) {
+		for(int j = 0; j < n; ++j)
+			destination[(size_t)i*n + j] = (j < i) ? static_cast<T>(0.0) : node.data[(size_t)i*n + j];
+	}
+}
+
+/* **************************************************************************************************
+APPLICATION FUNCTIONS
+/* *************************************************************************************************/
+// C = Q*B, working down the tree from the root to the leaves.
+template <class T>
+void qbTSQR<T>::ApplyQ(const qbMatrix2<T>& B, qbMatrix2<T>& C) const {
+	if((m_nodes.empty()) || (B.GetNumRows() != m_numCols))
+		throw std::invalid_argument("The matrix dimensions do not match the factorization.");
+
+	int n = m_numCols;
+	int k = B.GetNumCols();
+
+	// The [n x k] input to each node; the root gets B itself.
+	std::vector<std::vector<T>> input(m_nodes.size());
+	input.back().assign(B.GetData(), B.GetData() + (size_t)n*k);
+
+	for(int level = static_cast<int>(m_levels.size())-1; level >= 0; --level) {
+		const std::vector<int>& nodes = m_levels[level];
+		qbParallelFor(nodes.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i) {
+				const Node& node = m_nodes[nodes[i]];
+				std::vector<T> Z((size_t)2*n*k, static_cast<T>(0.0));
+				std::copy(input[nodes[i]].begin(), input[nodes[i]].end(), Z.begin());
+				qbHouseholderKernels::ApplyQ(2*n, k, n, node.data.data(), n, node.tau.data(), false, Z.data(), k);
+				input[node.children[0]].assign(Z.begin(), Z.begin() + (size_t)n*k);
+				input[node.children[1]].assign(Z.begin() + (size_t)n*k, Z.end());
+			}
+		});
+	}
+
+	// Each leaf writes its own block of rows of C.
+	C.Resize(m_numRows, k);
+	T* c = C.GetData();
+	qbParallelFor(m_numLeaves, 1, [&](size_t first, size_t last) {
+		for(size_t b = first; b < last; ++b) {
+			const Node& leaf = m_nodes[b];
+			T* cBlock = c + (size_t)leaf.rowStart*k;
+			std::copy(input[b].begin(), input[b].end(), cBlock);
+			qbHouseholderKernels::ApplyQ(leaf.numRows, k, static_cast<int>(leaf.tau.size()), leaf.data.data(), n, leaf.tau.data(), false, cBlock, k);
+		}
+	});
+}
+
+// C = Q'*B, working up the tree from the leaves to the root.
+template <class T>
+void qbTSQR<T>::ApplyQTranspose(const qbMatrix2<T>& B, qbMatrix2<T>& C) const {
+	if((m_nodes.empty()) || (B.GetNumRows() != m_numRows))
+		throw std::invalid_argument("The matrix dimensions do not match the factorization.");
+
+	int n = m_numCols;
+	int k = B.GetNumCols();
+
+	// The [n x k] output of each node.
+	std::vector<std::vector<T>> output(m_nodes.size());
+	const T* b = B.GetData();
+	qbParallelFor(m_numLeaves, 1, [&](size_t first, size_t last) {
+		for(size_t i = first; i < last; ++i) {
+			const Node& leaf = m_nodes[i];
+			std::vector<T> Z(b + (size_t)leaf.rowStart*k, b + (size_t)(leaf.rowStart + leaf.numRows)*k);
+			qbHouseholderKernels::ApplyQ(leaf.numRows, k, static_cast<int>(leaf.tau.size()), leaf.data.data(), n, leaf.tau.data(), true, Z.data(), k);
+			output[i].assign(Z.begin(), Z.begin() + (size_t)n*k);
+		}
+	});
+
+	for(const std::vector<int>& nodes : m_levels) {
+		qbParallelFor(nodes.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i) {
+				const Node& node = m_nodes[nodes[i]];
+				std::vector<T> Z(output[node.children[0]]);
+				Z.insert(Z.end(), output[node.children[1]].begin(), output[node.children[1]].end());
+				qbHouseholderKernels::ApplyQ(2*n, k, n, node.data.data(), n, node.tau.data(), true, Z.data(), k);
+				output[nodes[i]].assign(Z.begin(), Z.begin() + (size_t)n*k);
+			}
+		});
+	}
+
+	C = qbMatrix2<T>(n, k, output.back());
+}
+
+/* **************************************************************************************************
+INFORMATION FUNCTIONS
+/* *************************************************************************************************/
+template <class T>
+qbMatrix2<T> qbTSQR<T>::GetR() const {
+	qbMatrix2<T> R(m_numCols, m_numCols);
+	if(!m_nodes.empty())
+		CopyR(m_nodes.back(), R.GetData());
+	R.SetProperties(QBMATRIX_UPPERTRIANGULAR);
+	return R;
+}
+
+// Form the explicit [m x n] Q, as Q times the identity.
+template <class T>
+qbMatrix2<T> qbTSQR<T>::GetQ() const {
+	qbMatrix2<T> I(m_numCols, m_numCols), Q;
+	I.SetToIdentity();
+	ApplyQ(I, Q);
+	return Q;
+}
+
+template <class T>
+int qbTSQR<T>::GetNumBlocks() const {
+	return m_numLeaves;
+}
+
+template <class T>
+size_t qbTSQR<T>::GetStorageSize() const {
+	size_t numElements = 0;
+	for(const Node& node : m_nodes)
+		numElements += node.data.size() + node.tau.size();
+	return numElements * sizeof(T);
+}
+
+#endif
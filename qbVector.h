@@ -44,6 +44,10 @@ public:
 	// Function to return underlying data
 	std::vector<T> data() const;
 
+	// Direct access to the underlying data.
+	T* GetData();
+	const T* GetData() const;
+
 	// Functions to return parameters of the vector.
 	int GetNumDims() const;
 
@@ -53,10 +57,10 @@ public:
 
 	// Functions to perform computations on the vector.
 	// Return the length of the vector.
-	T norm();
+	T norm() const;
 
 	// Return a normalized copy of the vector.
-	qbVector<T> Normalized();
+	qbVector<T> Normalized() const;
 
 	// Normalize the vector in place.
 	void Normalize();
@@ -122,6 +126,16 @@ std::vector<T> qbVector<T>::data() const {
 	return m_vectorData;
 }
 
+template <class T>
+T* qbVector<T>::GetData() {
+	return m_vectorData.data();
+}
+
+template <class T>
+const T* qbVector<T>::GetData() const {
+	return m_vectorData.data();
+}
+
 /* **************************************************************************************************
 FUNCTIONS TO HANDLE ELEMENTS OF THE VECTOR
 /* *************************************************************************************************/
@@ -140,7 +154,7 @@ FUNCTIONS TO PERFORM COMPUTATIONS ON THE VECTOR
 /* *************************************************************************************************/
 // Compute the length of the vector,known as the 'norm'.
 template <class T>
-T qbVector<T>::norm() {
+T qbVector<T>::norm() const {
 	T cumulativeSum = static_cast<T>(0.0);
 	for(int i = 0; i < m_nDims; ++i)
 		cumulativeSum += (m_vectorData.at(i) * m_vectorData.at(i));
@@ -150,7 +164,7 @@ T qbVector<T>::norm() {
 
 // Return a normalized copy of the vector.
 template <class T>
-qbVector<T> qbVector<T>::Normalized() {
+qbVector<T> qbVector<T>::Normalized() const {
 	// Compute the vector norm.
 	T vecNorm = this->norm();
 